@@ -0,0 +1,140 @@
+#! /bin/sh
+#
+# run-bench.sh -- Run Turtle benchmark programs and compare the
+# results against a baseline.
+#
+# Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+#
+# This is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# Usage: run-bench.sh [-n RUNS] [-t PERCENT] [-b BASELINE] [-o RESULTS]
+#                     PROGRAM...
+#
+# Each PROGRAM is run RUNS times (default 5) with the runtime option
+# `-:S', which makes it print its statistics as `stat NAME VALUE'
+# lines on exit.  For every program, one line with the medians of the
+# wall time and GC time (in milliseconds), the number of allocations
+# and the number of dispatched calls is written to RESULTS (default
+# standard output).  The file has the same format as BASELINE, so a
+# results file can be saved as the baseline for later runs.
+#
+# If BASELINE exists, each result is compared against it, and every
+# value which is more than PERCENT (default 5) percent larger than in
+# the baseline is reported as a regression.  Times are only compared
+# when they differ by at least a millisecond.  The exit status is 1 if
+# there were regressions.
+
+runs=5
+threshold=5
+baseline=
+results=
+
+while test $# -gt 0; do
+  case "$1" in
+    -n) runs="$2"; shift 2 ;;
+    -t) threshold="$2"; shift 2 ;;
+    -b) baseline="$2"; shift 2 ;;
+    -o) results="$2"; shift 2 ;;
+    -*) echo "run-bench.sh: unknown option: $1" >&2; exit 2 ;;
+    *) break ;;
+  esac
+done
+
+if test $# -eq 0; then
+  echo "usage: run-bench.sh [-n RUNS] [-t PERCENT] [-b BASELINE] [-o RESULTS] PROGRAM..." >&2
+  exit 2
+fi
+
+tmp=${TMPDIR-/tmp}/run-bench.$$
+trap 'rm -f $tmp.*' 0 1 2 15
+: > $tmp.results
+
+# Print the median of the numbers on standard input.
+median ()
+{
+  sort -n | awk '{ v[NR] = $1 }
+    END { if (NR == 0) print 0;
+          else if (NR % 2) print v[(NR + 1) / 2];
+          else print (v[NR / 2] + v[NR / 2 + 1]) / 2 }'
+}
+
+for program in "$@"; do
+  case "$program" in
+    /*) command=$program ;;
+    *) command=./$program ;;
+  esac
+  : > $tmp.stats
+  i=0
+  while test $i -lt $runs; do
+    if $command -:S < /dev/null > /dev/null 2> $tmp.run ||
+       grep '^stat ' $tmp.run > /dev/null; then
+      grep '^stat ' $tmp.run >> $tmp.stats
+    else
+      echo "run-bench.sh: $program failed:" >&2
+      cat $tmp.run >&2
+      break
+    fi
+    i=`expr $i + 1`
+  done
+  test -s $tmp.stats || continue
+  line=$program
+  for stat in wall_time gc_time allocations dispatch_calls; do
+    value=`awk '$2 == "'$stat'" { print $3 }' $tmp.stats | median`
+    line="$line $value"
+  done
+  echo "$line" >> $tmp.results
+done
+
+{
+  echo "# program wall_ms gc_ms allocations dispatch_calls (medians of $runs runs)"
+  cat $tmp.results
+} > $tmp.out
+if test -n "$results"; then
+  cp $tmp.out "$results"
+fi
+if test -z "$results" || test -z "$baseline" || test ! -f "$baseline"; then
+  cat $tmp.out
+fi
+
+test -n "$baseline" && test -f "$baseline" || exit 0
+
+awk -v threshold=$threshold '
+  BEGIN { split ("wall_ms gc_ms allocations dispatch_calls", names, " ") }
+  /^#/ { next }
+  FNR == NR { for (i = 2; i <= 5; i++) base[$1, i] = $i; known[$1] = 1; next }
+  {
+    if (!($1 in known))
+      {
+        printf ("%-20s (not in baseline)\n", $1);
+        next;
+      }
+    line = sprintf ("%-20s", $1);
+    for (i = 2; i <= 5; i++)
+      {
+        b = base[$1, i];
+        change = b > 0 ? ($i - b) * 100.0 / b : ($i > 0 ? 100.0 : 0.0);
+        mark = "";
+        # Differences of less than a millisecond are noise.
+        if (change > threshold && (i > 3 || $i - b >= 1))
+          {
+            mark = " REGRESSION";
+            regressions++;
+          }
+        line = line sprintf ("  %s %s (%+.1f%%)%s", names[i - 1], $i,
+                             change, mark);
+      }
+    print line;
+  }
+  END {
+    if (regressions)
+      {
+        printf ("%d regression(s) of more than %s%%\n", regressions,
+                threshold);
+        exit 1;
+      }
+  }' "$baseline" $tmp.results
+
+# End of run-bench.sh.
@@ -0,0 +1,355 @@
+/* bench/runtime-bench.c -- Microbenchmarks for the Turtle runtime.
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+/* This program measures the primitive operations of the runtime
+   library in isolation and prints the time per operation in
+   nanoseconds.  The continuation and dispatcher benchmarks run in a
+   handcoded host procedure, which uses the same macros as the code
+   generated by the compiler.
+
+   Usage: runtime-bench [-:RUNTIME-OPTION...] [-n ITERATIONS]
+                        [-l LIVE] [-s list|tree|array] [-c CONSTRAINTS]
+
+   ITERATIONS (default 1000000) is the number of operations for each
+   benchmark; garbage collections are run ITERATIONS / 1000 times,
+   over a live heap of LIVE (default 100000) objects which form a
+   list, a binary tree or an array of strings.  CONSTRAINTS (default
+   1000) is the number of constraints added to the finite domain
+   constraint store.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <libturtle/libturtlert.h>
+#include <libturtle/fd-solver.h>
+
+static unsigned long iterations = 1000000;
+static unsigned long live_objects = 100000;
+static char * heap_shape = "list";
+static unsigned long constraint_count = 1000;
+
+/* GC roots of the benchmarks.  */
+static ttl_value live = TTL_NULL;
+static ttl_value string1 = TTL_NULL;
+static ttl_value string2 = TTL_NULL;
+static ttl_value variables = TTL_NULL;
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec * 1e9 + tv.tv_usec * 1e3;
+}
+
+static void
+report (char * name, unsigned long ops, double ns)
+{
+  printf ("%-28s %10lu ops %12.1f ns/op\n", name, ops, ops ? ns / ops : 0.0);
+}
+
+
+/* The handcoded module.  ========== */
+
+static struct ttl_function_info func_info =
+  {"loop", "runtime_bench", "runtime-bench.c"};
+
+static int host_procedure (void);
+
+static struct ttl_descr descriptors[] =
+  {
+    {TTL_DESCRIPTOR_HEADER, host_procedure, &func_info, -1, 0},
+    {TTL_DESCRIPTOR_HEADER, host_procedure, &func_info, -1, 0},
+    {TTL_DESCRIPTOR_HEADER, host_procedure, &func_info, -1, 0}
+  };
+
+/* Remaining iterations of the running loop.  */
+static unsigned long loop_count;
+
+static int
+host_procedure (void)
+{
+  ttl_value acc;
+  ttl_value * sp;
+  ttl_value * alloc;
+  ttl_environment env;
+  ttl_descr pc;
+
+  TTL_RESTORE_REGISTERS;
+ L_jump:
+  switch (pc - descriptors)
+    {
+      /* Return to the dispatcher once per iteration.  */
+    case 0:
+      if (--loop_count > 0)
+	goto save_regs_and_return;
+      TTL_RESTORE_CONT;
+      break;
+
+      /* Save a continuation and resume it once per iteration.  */
+    case 1:
+      TTL_GC_CHECK (TTL_SIZEOF_CONTINUATION + 1);
+      TTL_SAVE_CONT (descriptors + 2, 0);
+      TTL_RESTORE_CONT;
+      break;
+    case 2:
+      if (--loop_count > 0)
+	{
+	  pc = descriptors + 1;
+	  goto L_jump;
+	}
+      TTL_RESTORE_CONT;
+      break;
+
+    restore_cont:
+      TTL_RESTORE_CONT_REALLY;
+    }
+  if (pc->host == host_procedure)
+    goto L_jump;
+ save_regs_and_return:
+  TTL_SAVE_REGISTERS;
+  return 0;
+}
+
+
+/* The benchmarks.  ========== */
+
+static void
+bench_alloc_array (void)
+{
+  unsigned long i;
+  double start = now ();
+
+  for (i = 0; i < iterations; i++)
+    ttl_alloc_array (8);
+  report ("ttl_alloc_array (8)", iterations, now () - start);
+}
+
+static void
+bench_cons (void)
+{
+  unsigned long i;
+  double start = now ();
+
+  for (i = 0; i < iterations; i++)
+    ttl_cons (TTL_INT_TO_VALUE (i), TTL_NULL);
+  report ("ttl_cons", iterations, now () - start);
+}
+
+static void
+bench_append_strings (void)
+{
+  unsigned long i;
+  double start;
+
+  string1 = ttl_string_to_value ("Hello, ", -1);
+  string2 = ttl_string_to_value ("world!", -1);
+  start = now ();
+  for (i = 0; i < iterations; i++)
+    ttl_append_strings (string1, string2);
+  report ("ttl_append_strings (7+6)", iterations, now () - start);
+  string1 = string2 = TTL_NULL;
+}
+
+/* Run the loop starting at `descriptor' for `iterations'
+   iterations.  */
+static void
+bench_loop (char * name, int descriptor)
+{
+  double start;
+
+  loop_count = iterations;
+  start = now ();
+  ttl_init_dispatcher (TTL_OBJ_TO_VALUE (descriptors + descriptor));
+  report (name, iterations, now () - start);
+}
+
+/* Build the live heap for the garbage collection benchmark.  All
+   intermediate values are stored in GC roots or in heap objects
+   reachable from them, because every allocation may move them.  */
+static void
+build_live_heap (void)
+{
+  unsigned long i;
+
+  if (!strcmp (heap_shape, "list"))
+    {
+      for (i = 0; i < live_objects; i++)
+	live = ttl_cons (TTL_INT_TO_VALUE (i), live);
+    }
+  else if (!strcmp (heap_shape, "tree"))
+    {
+      /* A complete binary tree of two-element arrays, built in level
+	 order in a temporary array.  */
+      live = ttl_alloc_array (live_objects);
+      for (i = 0; i < live_objects; i++)
+	{
+	  ttl_value node = ttl_alloc_array (2);
+	  TTL_VALUE_TO_OBJ (ttl_array, live)->data[i] = node;
+	}
+      for (i = 0; 2 * i + 1 < live_objects; i++)
+	{
+	  ttl_value * data = TTL_VALUE_TO_OBJ (ttl_array, live)->data;
+	  ttl_array node = TTL_VALUE_TO_OBJ (ttl_array, data[i]);
+	  node->data[0] = data[2 * i + 1];
+	  if (2 * i + 2 < live_objects)
+	    node->data[1] = data[2 * i + 2];
+	}
+      live = TTL_VALUE_TO_OBJ (ttl_array, live)->data[0];
+    }
+  else if (!strcmp (heap_shape, "array"))
+    {
+      live = ttl_alloc_array (live_objects);
+      for (i = 0; i < live_objects; i++)
+	{
+	  ttl_value s = ttl_string_to_value ("live string", -1);
+	  TTL_VALUE_TO_OBJ (ttl_array, live)->data[i] = s;
+	}
+    }
+  else
+    {
+      fprintf (stderr, "runtime-bench: unknown heap shape: %s\n",
+	       heap_shape);
+      exit (1);
+    }
+}
+
+static void
+bench_garbage_collect (void)
+{
+  unsigned long i, collections = iterations / 1000 + 1;
+  unsigned forwarded;
+  double start, ns;
+  char name[64];
+
+  build_live_heap ();
+  ttl_garbage_collect (0);
+  forwarded = ttl_stats.forwarded_words;
+  start = now ();
+  for (i = 0; i < collections; i++)
+    ttl_garbage_collect (0);
+  ns = now () - start;
+  sprintf (name, "ttl_garbage_collect (%s)", heap_shape);
+  report (name, collections, ns);
+  forwarded = ttl_stats.forwarded_words - forwarded;
+  if (forwarded > 0)
+    report ("  per forwarded word", forwarded, ns);
+  live = TTL_NULL;
+}
+
+static void
+bench_fd_constraints (void)
+{
+  unsigned long i;
+  double start, ns;
+
+  /* One variable x_i for every constraint `x_i = i'.  */
+  variables = ttl_alloc_array (constraint_count);
+  for (i = 0; i < constraint_count; i++)
+    {
+      ttl_value v = ttl_alloc_fd_variable ();
+      TTL_VALUE_TO_OBJ (ttl_constrainable_variable, v)->hook =
+	(ttl_solver_variable) fd_new_variable ("x", v);
+      TTL_VALUE_TO_OBJ (ttl_array, variables)->data[i] = v;
+    }
+
+  start = now ();
+  for (i = 0; i < constraint_count; i++)
+    {
+      /* Strength, constant and the variables with their coefficients,
+	 in the order the compiled code pushes them.  */
+      ttl_stack[ttl_global_sp++] = TTL_INT_TO_VALUE (0);
+      ttl_stack[ttl_global_sp++] = TTL_INT_TO_VALUE (i);
+      ttl_stack[ttl_global_sp++] =
+	TTL_VALUE_TO_OBJ (ttl_array, variables)->data[i];
+      ttl_stack[ttl_global_sp++] = TTL_INT_TO_VALUE (1);
+      ttl_add_fd_constraint (EQ_EQ, 1);
+    }
+  report ("ttl_add_fd_constraint", constraint_count, now () - start);
+
+  start = now ();
+  ttl_fd_resolve ();
+  ns = now () - start;
+  report ("ttl_fd_resolve", 1, ns);
+  report ("  per constraint", constraint_count, ns);
+
+  for (i = 0; i < constraint_count; i++)
+    {
+      ttl_value v = TTL_VALUE_TO_OBJ (ttl_array, variables)->data[i];
+      if (TTL_VALUE_TO_OBJ (ttl_constrainable_variable, v)->value !=
+	  TTL_INT_TO_VALUE (i))
+	{
+	  fprintf (stderr, "runtime-bench: wrong solution for x_%lu\n", i);
+	  exit (1);
+	}
+    }
+  variables = TTL_NULL;
+}
+
+int
+main (int argc, char * argv[])
+{
+  int i;
+
+  ttl_initialize (argc, argv);
+  /* Drop the command line list, which the initialization pushes for
+     the main function.  */
+  ttl_global_sp = 0;
+  ttl_register_root (&live);
+  ttl_register_root (&string1);
+  ttl_register_root (&string2);
+  ttl_register_root (&variables);
+
+  for (i = 1; i < argc; i++)
+    {
+      if (argv[i][0] == '-' && argv[i][1] == ':')
+	continue;
+      if (i + 1 < argc && !strcmp (argv[i], "-n"))
+	iterations = strtoul (argv[++i], NULL, 10);
+      else if (i + 1 < argc && !strcmp (argv[i], "-l"))
+	live_objects = strtoul (argv[++i], NULL, 10);
+      else if (i + 1 < argc && !strcmp (argv[i], "-s"))
+	heap_shape = argv[++i];
+      else if (i + 1 < argc && !strcmp (argv[i], "-c"))
+	constraint_count = strtoul (argv[++i], NULL, 10);
+      else
+	{
+	  fprintf (stderr, "usage: %s [-:RUNTIME-OPTION...] [-n ITERATIONS] "
+		   "[-l LIVE]\n"
+		   "       [-s list|tree|array] [-c CONSTRAINTS]\n", argv[0]);
+	  return 1;
+	}
+    }
+  if (iterations == 0)
+    iterations = 1;
+
+  bench_alloc_array ();
+  bench_cons ();
+  bench_append_strings ();
+  bench_loop ("save_cont/restore_cont", 1);
+  bench_loop ("dispatcher round trip", 0);
+  bench_garbage_collect ();
+  bench_fd_constraints ();
+  return 0;
+}
+
+/* End of runtime-bench.c.  */
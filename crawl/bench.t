@@ -0,0 +1,256 @@
+// bench.t -- Benchmarking support.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this package; see the file COPYING.  If not, write to the
+// Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+// MA 02111-1307, USA.
+
+// Commentary:
+//
+//* Module for timing Turtle code.  @code{clock} reads a monotonic
+//* clock with nanosecond resolution, and @code{elapsed} returns the
+//* nanoseconds between two readings.  @code{measure} calls a function
+//* repeatedly and records its run time, the number of allocations and
+//* allocated heap words, and the number and duration of the garbage
+//* collections during the calls, as counted by the runtime system.
+//* @code{report} prints such a measurement as a single line, for
+//* example
+//*
+//* @example
+//* bench.run ("cons 100", fun () make_list (100); end);
+//* @end example
+//*
+//* prints
+//*
+//* @example
+//* bench cons 100 runs=10 mean_ns=1302 min_ns=1190 max_ns=2210 allocs=102 words=210 gcs=0 gc_ns=0
+//* @end example
+
+module bench;
+
+import io, ints, longs;
+
+
+//* A time of the monotonic clock, in seconds and nanoseconds.  A
+//* @code{long} holds only about two seconds worth of nanoseconds, so
+//* the clock is read as a pair.
+//
+public datatype timestamp = timestamp (seconds: long, nanoseconds: long);
+
+
+//* The result of measuring a function.  @code{mean_ns},
+//* @code{min_ns} and @code{max_ns} are the mean, smallest and
+//* largest time of a single call in nanoseconds.
+//* @code{allocations} and @code{words} are the number of allocations
+//* and allocated heap words per call.  @code{gcs} and @code{gc_ns}
+//* are the number of garbage collections and their total duration in
+//* nanoseconds over all calls.  Times which do not fit into a
+//* @code{long} are reported as the largest @code{long} value.
+//
+public datatype result = result (name: string, runs: int,
+                                 mean_ns: long, min_ns: long, max_ns: long,
+                                 allocations: long, words: long,
+                                 gcs: long, gc_ns: long);
+
+
+//* - Internal functions returning the counters of the runtime
+//* - system.
+fun alloc_count (): long;
+fun alloc_words (): long;
+fun gc_count (): long;
+
+//* - Internal functions for reading 64-bit times.  @code{read_clock}
+//* - and @code{read_gc_time} store the time of the clock or the total
+//* - time spent in garbage collections, which the other functions
+//* - return split into seconds and nanoseconds.
+//* - @code{scaled_nanoseconds} returns the nanoseconds of a time
+//* - divided by @var{count}, or the largest @code{long} value if they
+//* - do not fit.
+fun read_clock ();
+fun read_gc_time ();
+fun reading_seconds (): long;
+fun reading_nanoseconds (): long;
+fun scaled_nanoseconds (secs: long, nsecs: long, count: int): long;
+
+
+//* Return the time of a monotonic clock.  The origin of the clock is
+//* unspecified, so only the difference between two values is
+//* meaningful.
+//
+public fun clock (): timestamp
+  read_clock ();
+  return timestamp (reading_seconds (), reading_nanoseconds ());
+end;
+
+// Return the total time spent in garbage collections.
+fun gc_time (): timestamp
+  read_gc_time ();
+  return timestamp (reading_seconds (), reading_nanoseconds ());
+end;
+
+// Return the time from `start' to `stop'.
+fun difference (start: timestamp, stop: timestamp): timestamp
+  var s: long := seconds (stop) - seconds (start);
+  var ns: long := nanoseconds (stop) - nanoseconds (start);
+  if ns < 0L then
+    s := s - 1L;
+    ns := ns + 1000000000L;
+  end;
+  return timestamp (s, ns);
+end;
+
+// Return the sum of the times `a' and `b'.
+fun sum (a: timestamp, b: timestamp): timestamp
+  var s: long := seconds (a) + seconds (b);
+  var ns: long := nanoseconds (a) + nanoseconds (b);
+  if ns >= 1000000000L then
+    s := s + 1L;
+    ns := ns - 1000000000L;
+  end;
+  return timestamp (s, ns);
+end;
+
+// Return true if the time `a' is smaller than `b'.
+fun shorter? (a: timestamp, b: timestamp): bool
+  return seconds (a) < seconds (b) or
+    (seconds (a) = seconds (b) and nanoseconds (a) < nanoseconds (b));
+end;
+
+
+//* Return the number of nanoseconds from @var{start} to @var{stop},
+//* or the largest @code{long} value if it does not fit.
+//
+public fun elapsed (start: timestamp, stop: timestamp): long
+  var d: timestamp := difference (start, stop);
+  return scaled_nanoseconds (seconds (d), nanoseconds (d), 1);
+end;
+
+
+// The cost of a single call of a function.
+datatype sample = sample (duration: timestamp, allocated: long,
+                          heap_words: long, collections: long,
+                          collection_time: timestamp);
+
+// Call `thunk' once and return its cost.  The cost includes the
+// allocations for reading the counters, which `measure' subtracts.
+fun take (thunk: (fun (): ())): sample
+  var allocs: long := alloc_count ();
+  var words: long := alloc_words ();
+  var gcs: long := gc_count ();
+  var gc_start: timestamp := gc_time ();
+  var start: timestamp := clock ();
+  var t: timestamp;
+  var gc_t: timestamp;
+  thunk ();
+  t := difference (start, clock ());
+  gc_t := difference (gc_start, gc_time ());
+  gcs := gc_count () - gcs;
+  words := alloc_words () - words;
+  allocs := alloc_count () - allocs;
+  return sample (t, allocs, words, gcs, gc_t);
+end;
+
+fun nothing ()
+end;
+
+
+//* Call @var{thunk} @var{warmup} times without measuring it, then
+//* @var{runs} times while measuring it, and return the result under
+//* the name @var{name}.  The times include the overhead of calling
+//* @var{thunk}, the allocation counts do not.
+//
+public fun measure (name: string, warmup: int, runs: int,
+                    thunk: (fun (): ())): result
+  var base: sample;
+  var s: sample;
+  var total: timestamp := timestamp (0L, 0L);
+  var min: timestamp := total, max: timestamp := total;
+  var gc_total: timestamp := total;
+  var allocs: long := 0L, words: long := 0L;
+  var gcs: long := 0L;
+  var n: long := 1L;
+  var i: int := 0;
+
+  while i < warmup do
+    thunk ();
+    i := i + 1;
+  end;
+  base := take (nothing);
+  i := 0;
+  while i < runs do
+    s := take (thunk);
+    total := sum (total, duration (s));
+    if i = 0 or shorter? (duration (s), min) then
+      min := duration (s);
+    end;
+    if shorter? (max, duration (s)) then
+      max := duration (s);
+    end;
+    allocs := allocs + allocated (s) - allocated (base);
+    words := words + heap_words (s) - heap_words (base);
+    gcs := gcs + collections (s);
+    gc_total := sum (gc_total, collection_time (s));
+    i := i + 1;
+  end;
+  if runs > 1 then
+    n := longs.from_int (runs);
+  end;
+  return result (name, runs,
+                 scaled_nanoseconds (seconds (total), nanoseconds (total),
+                                     ints.max (runs, 1)),
+                 scaled_nanoseconds (seconds (min), nanoseconds (min), 1),
+                 scaled_nanoseconds (seconds (max), nanoseconds (max), 1),
+                 allocs / n, words / n, gcs,
+                 scaled_nanoseconds (seconds (gc_total),
+                                     nanoseconds (gc_total), 1));
+end;
+
+
+//* Print the result @var{r} on a single line to standard output.  The
+//* line consists of the word @code{bench}, the name of the result and
+//* the fields @code{runs}, @code{mean_ns}, @code{min_ns},
+//* @code{max_ns}, @code{allocs}, @code{words}, @code{gcs} and
+//* @code{gc_ns} in this order, each written as @var{field}=@var{value}.
+//* This format will be kept stable, so that the output can be
+//* processed by scripts.
+//
+public fun report (r: result)
+  io.put ("bench ");
+  io.put (name (r));
+  io.put (" runs="); io.put (runs (r));
+  io.put (" mean_ns="); io.put (mean_ns (r));
+  io.put (" min_ns="); io.put (min_ns (r));
+  io.put (" max_ns="); io.put (max_ns (r));
+  io.put (" allocs="); io.put (allocations (r));
+  io.put (" words="); io.put (words (r));
+  io.put (" gcs="); io.put (gcs (r));
+  io.put (" gc_ns="); io.put (gc_ns (r));
+  io.nl ();
+end;
+
+
+//* Measure @var{thunk} like @code{measure} and print the result like
+//* @code{report}.  Without @var{warmup} and @var{runs}, the function
+//* is called 3 times for warming up and measured over 10 runs.
+//
+public fun run (name: string, warmup: int, runs: int, thunk: (fun (): ()))
+  report (measure (name, warmup, runs, thunk));
+end;
+//* ""
+public fun run (name: string, thunk: (fun (): ()))
+  run (name, 3, 10, thunk);
+end;
+
+// End of bench.t.
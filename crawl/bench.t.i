@@ -0,0 +1,89 @@
+/* bench.t.i -- C implementation for bench.t.               -*-c-*-  */
+
+/* This file contains the implementation for the various functions in
+   the `bench' module.
+
+   For details on how to hand-code Turtle modules, see the Turtle
+   reference manual.  */
+
+
+#include <limits.h>
+
+
+/* The counters are read after the heap check, so that a garbage
+   collection caused by the check is included in the value.  */
+
+/* Function alloc_count: fun(): long.  */
+#define bench_alloc_count_pF0_pL_implementation		\
+{							\
+  TTL_GC_CHECK (4);					\
+  TTL_MAKE_LONG ((long) ttl_stats.allocations);		\
+}
+
+/* Function alloc_words: fun(): long.  */
+#define bench_alloc_words_pF0_pL_implementation		\
+{							\
+  TTL_GC_CHECK (4);					\
+  TTL_MAKE_LONG ((long) ttl_stats.alloced_words);	\
+}
+
+/* Function gc_count: fun(): long.  */
+#define bench_gc_count_pF0_pL_implementation		\
+{							\
+  TTL_GC_CHECK (4);					\
+  TTL_MAKE_LONG ((long) ttl_stats.gc_calls);		\
+}
+
+/* The last time stored by `read_clock' or `read_gc_time'.  It is
+   returned in two parts, since a `long' may only have 32 bits.  */
+static TTL_THREAD_LOCAL ttl_nanoseconds bench_reading;
+
+/* Function read_clock: fun(): ().  */
+#define bench_read_clock_pF0_pV_implementation		\
+{							\
+  bench_reading = ttl_monotonic_time ();		\
+}
+
+/* Function read_gc_time: fun(): ().  */
+#define bench_read_gc_time_pF0_pV_implementation	\
+{							\
+  bench_reading = ttl_stats.total_gc_nsecs;		\
+}
+
+/* Function reading_seconds: fun(): long.  */
+#define bench_reading_seconds_pF0_pL_implementation	\
+{							\
+  TTL_GC_CHECK (4);					\
+  TTL_MAKE_LONG ((long) (bench_reading / 1000000000));	\
+}
+
+/* Function reading_nanoseconds: fun(): long.  */
+#define bench_reading_nanoseconds_pF0_pL_implementation	\
+{							\
+  TTL_GC_CHECK (4);					\
+  TTL_MAKE_LONG ((long) (bench_reading % 1000000000));	\
+}
+
+/* Return the time of `secs' seconds and `nsecs' nanoseconds in
+   nanoseconds, divided by `count', or LONG_MAX if that does not fit
+   into a `long'.  */
+static long
+bench_scaled_nanoseconds (long secs, long nsecs, int count)
+{
+  ttl_nanoseconds ns = ((ttl_nanoseconds) secs * 1000000000 + nsecs) / count;
+
+  return ns > LONG_MAX ? LONG_MAX : (long) ns;
+}
+
+/* Function scaled_nanoseconds: fun(long, long, int): long.  */
+#define bench_scaled_nanoseconds_pF3pLpLpI_pL_implementation		\
+{									\
+  long ns = bench_scaled_nanoseconds					\
+    (TTL_VALUE_TO_OBJ (ttl_long, env->locals[0])->value,		\
+     TTL_VALUE_TO_OBJ (ttl_long, env->locals[1])->value,		\
+     TTL_VALUE_TO_INT (env->locals[2]));				\
+  TTL_GC_CHECK (4);							\
+  TTL_MAKE_LONG (ns);							\
+}
+
+/* End of bench.t.i.  */
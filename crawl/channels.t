@@ -0,0 +1,65 @@
+// channels.t -- Channels for communication between threads.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this package; see the file COPYING.  If not, write to the
+// Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+// MA 02111-1307, USA.
+
+
+// Commentary:
+//
+//* Channels pass values of type @var{A}, which is a parameter to this
+//* module, between threads (@pxref{threads module}).  A channel
+//* buffers a fixed number of values.  @code{send} waits while the
+//* buffer is full and @code{receive} waits while it is empty, so that
+//* a channel with a capacity of 1 makes the sender and the receiver
+//* take turns.  Values are received in the order in which they were
+//* sent.
+//*
+//* @example
+//* var c: channels.channel := channels.make (16);
+//* var t: threads.thread :=
+//*   threads.spawn (fun () channels.send (c, 42); end);
+//* io.put (channels.receive (c));
+//* @end example
+
+module channels<A>;
+
+
+//* The type of channels.
+//
+public datatype channel = channel;
+
+
+//* Create an empty channel which buffers up to @var{capacity} values.
+//* A capacity smaller than 1 is taken as 1.
+//
+public fun make (capacity: int): channel;
+
+//* Append @var{x} to the values in the channel @var{c}.  If the
+//* buffer is full, wait until a value is received.
+//
+public fun send (c: channel, x: A);
+
+//* Remove the oldest value from the channel @var{c} and return it.  If
+//* the channel is empty, wait until a value is sent.
+//
+public fun receive (c: channel): A;
+
+//* Return the number of values buffered in the channel @var{c}.
+//
+public fun size (c: channel): int;
+
+// End of channels.t.
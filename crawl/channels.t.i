@@ -0,0 +1,51 @@
+/* channels.t.i -- C implementation for channels.t.         -*-c-*-  */
+
+/* This file contains the implementation for the various functions in
+   the `channels' module.
+
+   For details on how to hand-code Turtle modules, see the Turtle
+   reference manual.  */
+
+
+/* Like in the `threads' module, `send' and `receive' may switch to
+   another thread by replacing the current continuation and the
+   accumulator.  */
+
+/* Function make: fun(int): channels.channel.  */
+#define channels_make_pF1pI_uchannel_implementation		\
+{								\
+  TTL_SAVE_REGISTERS;						\
+  ttl_global_acc =						\
+    ttl_make_channel (TTL_VALUE_TO_INT (env->locals[0]));	\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function send: fun(channels.channel, A): ().  */
+#define channels_send_pF2uchanneluA_pV_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  TTL_SAVE_REGISTERS;						\
+  ttl_channel_send (env->locals[0], env->locals[1]);		\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function receive: fun(channels.channel): A.  */
+#define channels_receive_pF1uchannel_uA_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  TTL_SAVE_REGISTERS;						\
+  ttl_channel_receive (env->locals[0]);				\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function size: fun(channels.channel): int.  */
+#define channels_size_pF1uchannel_pI_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  acc = TTL_INT_TO_VALUE (ttl_channel_count (acc));		\
+}
+
+/* End of channels.t.i.  */
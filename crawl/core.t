@@ -45,9 +45,19 @@ public fun write_char (fd: int, c: char);
 
 
 //* Read a character from file descriptor @var{fd}.
-//* On end-of-file, the constant @code{chars.EOF} is returned.
-//
-public fun read_char (fd: int): char;
+//* On end-of-file, the constant @code{chars.EOF} is returned.  While
+//* no input is available, the other threads run (@pxref{threads
+//* module}).
+//
+public fun read_char (fd: int): char
+  wait_input (fd);
+  return iread_char (fd);
+end;
+//* -
+// Support functions for @code{read_char}.
+//
+fun wait_input (fd: int);
+fun iread_char (fd: int): char;
 
 
 //* Return the character with character code @var{i}.
@@ -18,8 +18,16 @@
   write (fd, &c, 1);					\
 }
 
-/* Function read_char: fun(int): char.  */
-#define core_read_char_pF1pI_pC_implementation \
+/* Function wait_input: fun(int): ().  */
+#define core_wait_input_pF1pI_pV_implementation		\
+{							\
+  TTL_SAVE_REGISTERS;					\
+  ttl_io_wait (TTL_VALUE_TO_INT (env->locals[0]), TTL_IO_READ); \
+  TTL_RESTORE_REGISTERS;				\
+}
+
+/* Function iread_char: fun(int): char.  */
+#define core_iread_char_pF1pI_pC_implementation \
 {							\
   int fd = TTL_VALUE_TO_INT (env->locals[0]);		\
   char c;						\
@@ -17,13 +17,7 @@
 /* Function handle: fun(fun(): (), fun(string): ()): ().  */
 #define	internal_ex_handle_pF2pF0_pVpF1pS_pV_pV_implementation \
 {									\
-  *sp++ = ttl_global_cont;					\
-  acc = env->locals[1];							\
-  TTL_CONS;								\
-  *sp++ = acc;						\
-  acc = ttl_exception_handler;						\
-  TTL_CONS;								\
-  ttl_exception_handler = acc;						\
+  TTL_PUSH_HANDLER (env->locals[1]);					\
   pc = TTL_VALUE_TO_OBJ (ttl_descr, env->locals[0]);			\
   goto save_regs_and_return;						\
 }
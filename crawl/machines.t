@@ -0,0 +1,94 @@
+// machines.t -- Virtual machines running in parallel.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this package; see the file COPYING.  If not, write to the
+// Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+// MA 02111-1307, USA.
+
+
+// Commentary:
+//
+//* Virtual machines run Turtle code in parallel, each in an operating
+//* system thread of its own.  Every machine has its own heap and its
+//* own copy of the module variables, which are initialized when the
+//* machine starts, so machines share no data.  They communicate by
+//* sending messages of type @var{A}, which is a parameter to this
+//* module.  A message is a deep copy of the sent value, so changes to
+//* the value after sending are not seen by the receiver.  Values
+//* containing constraint variables, or threads and other objects
+//* holding continuations, cannot be sent.  All machines of a program
+//* must use the same type of messages.
+//*
+//* Each machine has a mailbox, in which messages wait in the order of
+//* their arrival until they are received.  @code{receive} and
+//* @code{join} block the whole machine, including its threads
+//* (@pxref{threads module}).  Threads are only preempted by timer in
+//* the main machine, which also handles all signals.  The program
+//* ends when @code{main} returns, and an uncaught exception in any
+//* machine halts the program.
+//*
+//* @example
+//* var parent: machines.machine := machines.self ();
+//* var m: machines.machine :=
+//*   machines.spawn (fun () machines.send (parent, 42); end);
+//* io.put (machines.receive ());
+//* machines.join (m);
+//* @end example
+
+module machines<A>;
+
+
+//* The type of virtual machines.
+//
+public datatype machine = machine;
+
+
+//* Create a new virtual machine which initializes all modules, calls
+//* @var{f} and finishes when it returns, and return it.  @var{f} is
+//* copied to the new machine like a message.
+//
+public fun spawn (f: (fun (): ())): machine;
+
+//* Return the machine running the caller.
+//
+public fun self (): machine;
+
+//* Append a copy of @var{x} to the mailbox of the machine @var{m}.
+//* Messages to a machine which has finished are dropped.
+//
+public fun send (m: machine, x: A);
+
+//* Remove the oldest message from the mailbox of the current machine
+//* and return it.  If the mailbox is empty, wait until a message
+//* arrives.
+//
+public fun receive (): A;
+
+//* Return the number of messages in the mailbox of the current
+//* machine.
+//
+public fun pending (): int;
+
+//* Wait until the machine @var{m} has finished.  A machine cannot
+//* join itself.
+//
+public fun join (m: machine);
+
+//* Return the number of the machine @var{m}.  The main machine has
+//* number 0.
+//
+public fun id (m: machine): int;
+
+// End of machines.t.
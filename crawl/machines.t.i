@@ -0,0 +1,75 @@
+/* machines.t.i -- C implementation for machines.t.         -*-c-*-  */
+
+/* This file contains the implementation for the various functions in
+   the `machines' module.
+
+   For details on how to hand-code Turtle modules, see the Turtle
+   reference manual.  */
+
+
+/* A machine is represented by its number plus one, so that the main
+   machine is not confused with the null value.  */
+#define MACHINES_TO_VALUE(id) TTL_INT_TO_VALUE ((id) + 1)
+#define MACHINES_FROM_VALUE(v) (TTL_VALUE_TO_INT (v) - 1)
+
+/* Function spawn: fun(fun(): ()): machines.machine.  */
+#define machines_spawn_pF1pF0_pV_umachine_implementation	\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  TTL_SAVE_REGISTERS;						\
+  ttl_global_acc =						\
+    MACHINES_TO_VALUE (ttl_vm_spawn (env->locals[0]));		\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function self: fun(): machines.machine.  */
+#define machines_self_pF0_umachine_implementation		\
+{								\
+  acc = MACHINES_TO_VALUE (ttl_vm_self ());			\
+}
+
+/* Function send: fun(machines.machine, A): ().  */
+#define machines_send_pF2umachineuA_pV_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  TTL_SAVE_REGISTERS;						\
+  ttl_vm_send (MACHINES_FROM_VALUE (env->locals[0]),		\
+	       env->locals[1]);					\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function receive: fun(): A.  */
+#define machines_receive_pF0_uA_implementation			\
+{								\
+  TTL_SAVE_REGISTERS;						\
+  ttl_vm_receive ();						\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function pending: fun(): int.  */
+#define machines_pending_pF0_pI_implementation			\
+{								\
+  acc = TTL_INT_TO_VALUE (ttl_vm_pending ());			\
+}
+
+/* Function join: fun(machines.machine): ().  */
+#define machines_join_pF1umachine_pV_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  TTL_SAVE_REGISTERS;						\
+  ttl_vm_join (MACHINES_FROM_VALUE (env->locals[0]));		\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function id: fun(machines.machine): int.  */
+#define machines_id_pF1umachine_pI_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  acc = TTL_INT_TO_VALUE (MACHINES_FROM_VALUE (acc));		\
+}
+
+/* End of machines.t.i.  */
@@ -23,13 +23,6 @@
 //
 //
 
-// Note:
-//
-// This module must be compiled with the `--pragma=handcoded' option.
-//
-// For details on how to hand-code Turtle modules, see the
-// Turtle reference manual
- 
 module math;
 
 
@@ -41,18 +34,18 @@ public const pi: real := 3.14159265358979323846;
 //* These are the common trigonometric functions.  They are mapped
 //* directly to the functions in the C library.
 //
-public fun sin (x: real): real;
+public fun sin (x: real): real = leaf "sin";
 //* ""
-public fun asin (x: real): real;
+public fun asin (x: real): real = leaf "asin";
 //* ""
-public fun cos (x: real): real;
+public fun cos (x: real): real = leaf "cos";
 //* ""
-public fun acos (x: real): real;
+public fun acos (x: real): real = leaf "acos";
 //* ""
-public fun tan (x: real): real;
+public fun tan (x: real): real = leaf "tan";
 //* ""
-public fun atan (x: real): real;
+public fun atan (x: real): real = leaf "atan";
 //* ""
-public fun atan (x: real, y: real): real;
+public fun atan (x: real, y: real): real = leaf "atan2";
 
 // End of math.t.
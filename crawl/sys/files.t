@@ -66,16 +66,32 @@ end;
 //* descriptor @var{fd}, starting at offset 0 of the byte array.
 //* Return the number of bytes actually written, or -1 if an error
 //* occurs.  The variable @code{sys.errno.errno} is set accordingly.
+//* While @var{fd} cannot take any data, the other threads run
+//* (@pxref{threads module}).
 //
-public fun write (fd: int, b: internal.binary.binary, len: int): int;
+public fun write (fd: int, b: internal.binary.binary, len: int): int
+  wait_output (fd);
+  return iwrite (fd, b, len);
+end;
 
 
 //* Read @var{len} bytes from the file descriptor @var{fd} into the
 //* byte array @var{b}.  Return the number of bytes read, or -1 if
 //* an error occurs.  The variable @code{sys.errno.errno} is set
-//* accordingly.
+//* accordingly.  While no input is available, the other threads run
+//* (@pxref{threads module}).
+//
+public fun read (fd: int, b: internal.binary.binary, len: int): int
+  wait_input (fd);
+  return iread (fd, b, len);
+end;
+//* -
+// Support functions for @code{write} and @code{read}.
 //
-public fun read (fd: int, b: internal.binary.binary, len: int): int;
+fun wait_output (fd: int);
+fun iwrite (fd: int, b: internal.binary.binary, len: int): int;
+fun wait_input (fd: int);
+fun iread (fd: int, b: internal.binary.binary, len: int): int;
 
 
 //* Delete a name from the filesystem.  If that name was the alst
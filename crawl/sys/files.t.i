@@ -65,8 +65,16 @@
 }
 
 
-/* Function write: fun(int, internal.binary.binary, int): int.  */
-#define sys_files_write_pF3pIubinarypI_pI_implementation \
+/* Function wait_output: fun(int): ().  */
+#define sys_files_wait_output_pF1pI_pV_implementation		\
+{								\
+  TTL_SAVE_REGISTERS;						\
+  ttl_io_wait (TTL_VALUE_TO_INT (env->locals[0]), TTL_IO_WRITE);	\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function iwrite: fun(int, internal.binary.binary, int): int.  */
+#define sys_files_iwrite_pF3pIubinarypI_pI_implementation \
 {									\
   acc = env->locals[1];							\
   TTL_NULL_CHECK;							\
@@ -85,8 +93,16 @@
   }									\
 }
 
-/* Function read: fun(int, internal.binary.binary, int): int.  */
-#define sys_files_read_pF3pIubinarypI_pI_implementation \
+/* Function wait_input: fun(int): ().  */
+#define sys_files_wait_input_pF1pI_pV_implementation		\
+{								\
+  TTL_SAVE_REGISTERS;						\
+  ttl_io_wait (TTL_VALUE_TO_INT (env->locals[0]), TTL_IO_READ);	\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function iread: fun(int, internal.binary.binary, int): int.  */
+#define sys_files_iread_pF3pIubinarypI_pI_implementation \
 {									\
   acc = env->locals[1];							\
   TTL_NULL_CHECK;							\
@@ -137,24 +153,24 @@
     ret = stat (fn, &s);					\
     if (ret >= 0)						\
       {								\
-	a->data[1] = TTL_INT_TO_VALUE ((int)s.st_dev);		\
-	a->data[2] = TTL_INT_TO_VALUE (s.st_ino);		\
-	a->data[3] = TTL_INT_TO_VALUE (s.st_mode);		\
-	a->data[4] = TTL_INT_TO_VALUE (s.st_nlink);		\
-	a->data[5] = TTL_INT_TO_VALUE (s.st_uid);		\
-	a->data[6] = TTL_INT_TO_VALUE (s.st_gid);		\
-	a->data[7] = TTL_INT_TO_VALUE ((int)s.st_rdev);		\
-	TTL_VALUE_TO_OBJ (ttl_long, a->data[8])->value =	\
+	a->data[0] = TTL_INT_TO_VALUE ((int)s.st_dev);		\
+	a->data[1] = TTL_INT_TO_VALUE (s.st_ino);		\
+	a->data[2] = TTL_INT_TO_VALUE (s.st_mode);		\
+	a->data[3] = TTL_INT_TO_VALUE (s.st_nlink);		\
+	a->data[4] = TTL_INT_TO_VALUE (s.st_uid);		\
+	a->data[5] = TTL_INT_TO_VALUE (s.st_gid);		\
+	a->data[6] = TTL_INT_TO_VALUE ((int)s.st_rdev);		\
+	TTL_VALUE_TO_OBJ (ttl_long, a->data[7])->value =	\
 	  s.st_size;				\
-	TTL_VALUE_TO_OBJ (ttl_long, a->data[9])->value =	\
+	TTL_VALUE_TO_OBJ (ttl_long, a->data[8])->value =	\
 	  s.st_blksize;			\
-	TTL_VALUE_TO_OBJ (ttl_long, a->data[10])->value =	\
+	TTL_VALUE_TO_OBJ (ttl_long, a->data[9])->value =	\
 	  s.st_blocks;			\
-	TTL_VALUE_TO_OBJ (ttl_long, a->data[11])->value =	\
+	TTL_VALUE_TO_OBJ (ttl_long, a->data[10])->value =	\
 	  s.st_atime;			\
-	TTL_VALUE_TO_OBJ (ttl_long, a->data[12])->value =	\
+	TTL_VALUE_TO_OBJ (ttl_long, a->data[11])->value =	\
 	  s.st_mtime;			\
-	TTL_VALUE_TO_OBJ (ttl_long, a->data[13])->value =	\
+	TTL_VALUE_TO_OBJ (ttl_long, a->data[12])->value =	\
 	  s.st_ctime;			\
 	ttl_global_acc = env->locals[1];			\
       }								\
@@ -105,16 +105,20 @@ public fun listen (sockfd: int, backlog: int): int;
 
 //* Accept a client connection on the given socket @var{sockfd}.
 //* Return a pair of a socket descriptor for the connection to the
-//* client, and the address of the client.
+//* client, and the address of the client.  While no connection is
+//* pending, the other threads run (@pxref{threads module}).
 //
 public fun accept (sockfd: int): (int, sockaddr)
   var sa: sockaddr := inetaddr (0, 0, 0, 0, 0);
-  var ret: int := iaccept (sockfd, sa);
+  var ret: int;
+  wait_input (sockfd);
+  ret := iaccept (sockfd, sa);
   return ret, sa;
 end;
 //* -
-// Support function for @code{accept}.
+// Support functions for @code{accept}.
 //
+fun wait_input (sockfd: int);
 fun iaccept (sockfd: int, sockaddr: sockaddr): int;
 
 
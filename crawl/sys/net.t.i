@@ -48,10 +48,10 @@ static int
 sockaddr_to_sockaddr_in (ttl_value sockaddr, struct sockaddr_in * sa)
 {
   ttl_binary_array b = TTL_VALUE_TO_OBJ
-    (ttl_binary_array, TTL_VALUE_TO_OBJ (ttl_array, sockaddr)->data[2]);
+    (ttl_binary_array, TTL_VALUE_TO_OBJ (ttl_array, sockaddr)->data[1]);
   sa->sin_family = AF_INET;
   sa->sin_port =
-    htons (TTL_VALUE_TO_INT (TTL_VALUE_TO_OBJ (ttl_array, sockaddr)->data[1]));
+    htons (TTL_VALUE_TO_INT (TTL_VALUE_TO_OBJ (ttl_array, sockaddr)->data[0]));
   sa->sin_addr.s_addr =
     (b->data[0] << 24) |
     (b->data[1] << 16) |
@@ -66,17 +66,17 @@ static int
 sockaddr_in_to_sockaddr (struct sockaddr_in * sa, ttl_value sockaddr)
 {
   ttl_binary_array b = TTL_VALUE_TO_OBJ
-    (ttl_binary_array, TTL_VALUE_TO_OBJ (ttl_array, sockaddr)->data[2]);
+    (ttl_binary_array, TTL_VALUE_TO_OBJ (ttl_array, sockaddr)->data[1]);
   int port = ntohs (sa->sin_port);
   long addr = ntohl (sa->sin_addr.s_addr);
   sa->sin_family = AF_INET;
   sa->sin_port =
-    htons (TTL_VALUE_TO_INT (TTL_VALUE_TO_OBJ (ttl_array, sockaddr)->data[1]));
+    htons (TTL_VALUE_TO_INT (TTL_VALUE_TO_OBJ (ttl_array, sockaddr)->data[0]));
   sa->sin_addr.s_addr = (b->data[0] << 24) |
     (b->data[1] << 16) | (b->data[2] << 8) | b->data[3];
   sa->sin_addr.s_addr = htonl (sa->sin_addr.s_addr);
 
-  TTL_VALUE_TO_OBJ (ttl_array, sockaddr)->data[1] = TTL_INT_TO_VALUE (port);
+  TTL_VALUE_TO_OBJ (ttl_array, sockaddr)->data[0] = TTL_INT_TO_VALUE (port);
   b->data[0] = (addr >> 24) & 0xff;
   b->data[1] = (addr >> 16) & 0xff;
   b->data[2] = (addr >>  8) & 0xff;
@@ -93,7 +93,7 @@ sockaddr_in_to_sockaddr (struct sockaddr_in * sa, ttl_value sockaddr)
 								\
   acc = env->locals[1];						\
   TTL_NULL_CHECK;						\
-  acc = TTL_VALUE_TO_OBJ (ttl_array, acc)->data[2];		\
+  acc = TTL_VALUE_TO_OBJ (ttl_array, acc)->data[1];		\
   TTL_NULL_CHECK;						\
   sockaddr_to_sockaddr_in (env->locals[1], &sa);		\
   SYS_CALL (ret, (bind (TTL_VALUE_TO_INT (env->locals[0]),	\
@@ -109,7 +109,7 @@ sockaddr_in_to_sockaddr (struct sockaddr_in * sa, ttl_value sockaddr)
 								\
   acc = env->locals[1];						\
   TTL_NULL_CHECK;						\
-  acc = TTL_VALUE_TO_OBJ (ttl_array, acc)->data[2];		\
+  acc = TTL_VALUE_TO_OBJ (ttl_array, acc)->data[1];		\
   TTL_NULL_CHECK;						\
   sockaddr_to_sockaddr_in (env->locals[1], &sa);		\
   SYS_CALL (ret, (connect (TTL_VALUE_TO_INT (env->locals[0]),	\
@@ -128,11 +128,19 @@ sockaddr_in_to_sockaddr (struct sockaddr_in * sa, ttl_value sockaddr)
   acc = TTL_INT_TO_VALUE (ret);				\
 }
 
+/* Function wait_input: fun(int): ().  */
+#define sys_net_wait_input_pF1pI_pV_implementation		\
+{								\
+  TTL_SAVE_REGISTERS;						\
+  ttl_io_wait (TTL_VALUE_TO_INT (env->locals[0]), TTL_IO_READ);	\
+  TTL_RESTORE_REGISTERS;					\
+}
+
 /* Function iaccept: fun(int, sys.net.sockaddr): int.  */
 #define sys_net_iaccept_pF2pIusockaddr_pI_implementation \
 {								\
   struct sockaddr_in sa;					\
-  socklen_t sa_len;						\
+  socklen_t sa_len = sizeof (sa);				\
   int sockfd = TTL_VALUE_TO_INT (env->locals[0]);		\
   int ret;							\
 								\
@@ -56,39 +56,49 @@
 /* Function wait: fun(): (int, int).  */
 #define sys_procs_wait_pF0_pT2pIpI_implementation \
 {									      \
-  TTL_GC_CHECK (3);							      \
-  TTL_SAVE_REGISTERS;							      \
-  {									      \
-    int pid, status;							      \
-    ttl_value tup;							      \
+  int pid, status;							      \
 									      \
-    pid = wait (&status);						      \
-    tup = ttl_unsafe_alloc_array (2);					      \
-    TTL_VALUE_TO_OBJ (ttl_array, tup)->data[0] = TTL_INT_TO_VALUE (pid);    \
-    TTL_VALUE_TO_OBJ (ttl_array, tup)->data[1] = TTL_INT_TO_VALUE (status); \
-    ttl_global_acc = tup;						      \
-  }									      \
+  TTL_SAVE_REGISTERS;							      \
+  pid = wait (&status);							      \
   TTL_RESTORE_REGISTERS;						      \
+  if (TTL_VALUES_WANTED_P ())						      \
+    {									      \
+      ttl_values[0] = TTL_INT_TO_VALUE (pid);				      \
+      ttl_values[1] = TTL_INT_TO_VALUE (status);			      \
+      acc = TTL_VALUES_MARKER;						      \
+    }									      \
+  else									      \
+    {									      \
+      TTL_GC_CHECK (3);							      \
+      TTL_MAKE_UNINITIALIZED_ARRAY (2);					      \
+      TTL_VALUE_TO_OBJ (ttl_array, acc)->data[0] = TTL_INT_TO_VALUE (pid);    \
+      TTL_VALUE_TO_OBJ (ttl_array, acc)->data[1] = TTL_INT_TO_VALUE (status); \
+    }									      \
 }
 
 
 /* Function waitpid: fun(int, int): int.  */
 #define sys_procs_waitpid_pF2pIpI_pT2pIpI_implementation \
-{									    \
-  TTL_GC_CHECK (3);							    \
-  TTL_SAVE_REGISTERS;							    \
-  {									    \
-    int pid, status, options;						    \
-    ttl_value tup;							    \
-									    \
-    pid = waitpid (TTL_VALUE_TO_INT (env->locals[0]), &status,		    \
-		   TTL_VALUE_TO_INT (env->locals[1]));			    \
-    tup = ttl_unsafe_alloc_array (2);					    \
-    TTL_VALUE_TO_OBJ (ttl_array, tup)->data[0] = TTL_INT_TO_VALUE (pid);    \
-    TTL_VALUE_TO_OBJ (ttl_array, tup)->data[1] = TTL_INT_TO_VALUE (status); \
-    ttl_global_acc = tup;						    \
-  }									    \
-  TTL_RESTORE_REGISTERS;						    \
+{									      \
+  int pid, status;							      \
+									      \
+  TTL_SAVE_REGISTERS;							      \
+  pid = waitpid (TTL_VALUE_TO_INT (env->locals[0]), &status,		      \
+		 TTL_VALUE_TO_INT (env->locals[1]));			      \
+  TTL_RESTORE_REGISTERS;						      \
+  if (TTL_VALUES_WANTED_P ())						      \
+    {									      \
+      ttl_values[0] = TTL_INT_TO_VALUE (pid);				      \
+      ttl_values[1] = TTL_INT_TO_VALUE (status);			      \
+      acc = TTL_VALUES_MARKER;						      \
+    }									      \
+  else									      \
+    {									      \
+      TTL_GC_CHECK (3);							      \
+      TTL_MAKE_UNINITIALIZED_ARRAY (2);					      \
+      TTL_VALUE_TO_OBJ (ttl_array, acc)->data[0] = TTL_INT_TO_VALUE (pid);    \
+      TTL_VALUE_TO_OBJ (ttl_array, acc)->data[1] = TTL_INT_TO_VALUE (status); \
+    }									      \
 }
 
 
@@ -18,15 +18,15 @@
     time_t t = TTL_VALUE_TO_OBJ (ttl_long, env->locals[1])->value;	\
     ttl_array a = TTL_VALUE_TO_OBJ (ttl_array, env->locals[0]);		\
     struct tm * tm = gmtime (&t);					\
-    a->data[1] = TTL_INT_TO_VALUE (tm->tm_sec);				\
-    a->data[2] = TTL_INT_TO_VALUE (tm->tm_min);				\
-    a->data[3] = TTL_INT_TO_VALUE (tm->tm_hour);			\
-    a->data[4] = TTL_INT_TO_VALUE (tm->tm_mday);			\
-    a->data[5] = TTL_INT_TO_VALUE (tm->tm_mon);				\
-    a->data[6] = TTL_INT_TO_VALUE (tm->tm_year);			\
-    a->data[7] = TTL_INT_TO_VALUE (tm->tm_wday);			\
-    a->data[8] = TTL_INT_TO_VALUE (tm->tm_yday);			\
-    a->data[9] = TTL_INT_TO_VALUE (tm->tm_isdst);			\
+    a->data[0] = TTL_INT_TO_VALUE (tm->tm_sec);				\
+    a->data[1] = TTL_INT_TO_VALUE (tm->tm_min);				\
+    a->data[2] = TTL_INT_TO_VALUE (tm->tm_hour);			\
+    a->data[3] = TTL_INT_TO_VALUE (tm->tm_mday);			\
+    a->data[4] = TTL_INT_TO_VALUE (tm->tm_mon);				\
+    a->data[5] = TTL_INT_TO_VALUE (tm->tm_year);			\
+    a->data[6] = TTL_INT_TO_VALUE (tm->tm_wday);			\
+    a->data[7] = TTL_INT_TO_VALUE (tm->tm_yday);			\
+    a->data[8] = TTL_INT_TO_VALUE (tm->tm_isdst);			\
     acc = env->locals[0];						\
   }									\
 }
@@ -40,15 +40,15 @@
     time_t t = TTL_VALUE_TO_OBJ (ttl_long, env->locals[1])->value;	\
     ttl_array a = TTL_VALUE_TO_OBJ (ttl_array, env->locals[0]);		\
     struct tm * tm = localtime (&t);					\
-    a->data[1] = TTL_INT_TO_VALUE (tm->tm_sec);				\
-    a->data[2] = TTL_INT_TO_VALUE (tm->tm_min);				\
-    a->data[3] = TTL_INT_TO_VALUE (tm->tm_hour);			\
-    a->data[4] = TTL_INT_TO_VALUE (tm->tm_mday);			\
-    a->data[5] = TTL_INT_TO_VALUE (tm->tm_mon);				\
-    a->data[6] = TTL_INT_TO_VALUE (tm->tm_year);			\
-    a->data[7] = TTL_INT_TO_VALUE (tm->tm_wday);			\
-    a->data[8] = TTL_INT_TO_VALUE (tm->tm_yday);			\
-    a->data[9] = TTL_INT_TO_VALUE (tm->tm_isdst);			\
+    a->data[0] = TTL_INT_TO_VALUE (tm->tm_sec);				\
+    a->data[1] = TTL_INT_TO_VALUE (tm->tm_min);				\
+    a->data[2] = TTL_INT_TO_VALUE (tm->tm_hour);			\
+    a->data[3] = TTL_INT_TO_VALUE (tm->tm_mday);			\
+    a->data[4] = TTL_INT_TO_VALUE (tm->tm_mon);				\
+    a->data[5] = TTL_INT_TO_VALUE (tm->tm_year);			\
+    a->data[6] = TTL_INT_TO_VALUE (tm->tm_wday);			\
+    a->data[7] = TTL_INT_TO_VALUE (tm->tm_yday);			\
+    a->data[8] = TTL_INT_TO_VALUE (tm->tm_isdst);			\
     acc = env->locals[0];						\
   }									\
 }
@@ -78,15 +78,15 @@
   {								\
     ttl_array a = TTL_VALUE_TO_OBJ (ttl_array, env->locals[0]);	\
     struct tm tm;						\
-    tm.tm_sec = TTL_VALUE_TO_INT (a->data[1]);			\
-    tm.tm_min = TTL_VALUE_TO_INT (a->data[2]);			\
-    tm.tm_hour = TTL_VALUE_TO_INT (a->data[3]);			\
-    tm.tm_mday = TTL_VALUE_TO_INT (a->data[4]);			\
-    tm.tm_mon = TTL_VALUE_TO_INT (a->data[5]);			\
-    tm.tm_year = TTL_VALUE_TO_INT (a->data[6]);			\
-    tm.tm_wday = TTL_VALUE_TO_INT (a->data[7]);			\
-    tm.tm_yday = TTL_VALUE_TO_INT (a->data[8]);			\
-    tm.tm_isdst = TTL_VALUE_TO_INT (a->data[9]);		\
+    tm.tm_sec = TTL_VALUE_TO_INT (a->data[0]);			\
+    tm.tm_min = TTL_VALUE_TO_INT (a->data[1]);			\
+    tm.tm_hour = TTL_VALUE_TO_INT (a->data[2]);			\
+    tm.tm_mday = TTL_VALUE_TO_INT (a->data[3]);			\
+    tm.tm_mon = TTL_VALUE_TO_INT (a->data[4]);			\
+    tm.tm_year = TTL_VALUE_TO_INT (a->data[5]);			\
+    tm.tm_wday = TTL_VALUE_TO_INT (a->data[6]);			\
+    tm.tm_yday = TTL_VALUE_TO_INT (a->data[7]);			\
+    tm.tm_isdst = TTL_VALUE_TO_INT (a->data[8]);		\
     ttl_global_acc = ttl_string_to_value (asctime (&tm), -1);	\
   }								\
   TTL_RESTORE_REGISTERS;					\
@@ -25,14 +25,13 @@ copy_pw_to_pw_struct (ttl_value pw_struct, struct passwd * pw)
 {
   ttl_array a = TTL_VALUE_TO_OBJ (ttl_array, pw_struct);
 
-  a->data[0] = TTL_INT_TO_VALUE (0);
-  a->data[1] = ttl_string_to_value (pw->pw_name, -1);
-  a->data[2] = ttl_string_to_value (pw->pw_passwd, -1);
-  a->data[3] = TTL_INT_TO_VALUE (pw->pw_uid);
-  a->data[4] = TTL_INT_TO_VALUE (pw->pw_gid);
-  a->data[5] = ttl_string_to_value (pw->pw_gecos, -1);
-  a->data[6] = ttl_string_to_value (pw->pw_dir, -1);
-  a->data[7] = ttl_string_to_value (pw->pw_shell, -1);
+  a->data[0] = ttl_string_to_value (pw->pw_name, -1);
+  a->data[1] = ttl_string_to_value (pw->pw_passwd, -1);
+  a->data[2] = TTL_INT_TO_VALUE (pw->pw_uid);
+  a->data[3] = TTL_INT_TO_VALUE (pw->pw_gid);
+  a->data[4] = ttl_string_to_value (pw->pw_gecos, -1);
+  a->data[5] = ttl_string_to_value (pw->pw_dir, -1);
+  a->data[6] = ttl_string_to_value (pw->pw_shell, -1);
 }
 
 /* Function getpwnam: fun(string): sys.users.passwd.  */
@@ -45,7 +44,7 @@ copy_pw_to_pw_struct (ttl_value pw_struct, struct passwd * pw)
   {								\
     struct passwd * pw;						\
     char * user_name = ttl_malloc_c_string (env->locals[0]);	\
-    ttl_value pw_struct = ttl_unsafe_alloc_array (8);		\
+    ttl_value pw_struct = ttl_unsafe_alloc_data (0, 7);		\
     ttl_global_acc = pw_struct;					\
     pw = getpwnam (user_name);					\
     if (pw)							\
@@ -68,7 +67,7 @@ copy_pw_to_pw_struct (ttl_value pw_struct, struct passwd * pw)
   {								\
     struct passwd * pw;						\
     int uid = TTL_VALUE_TO_INT (env->locals[0]);		\
-    ttl_value pw_struct = ttl_unsafe_alloc_array (8);		\
+    ttl_value pw_struct = ttl_unsafe_alloc_data (0, 7);		\
     ttl_global_acc = pw_struct;					\
     pw = getpwuid (uid);					\
     if (pw)							\
@@ -89,7 +88,7 @@ copy_pw_to_pw_struct (ttl_value pw_struct, struct passwd * pw)
   TTL_SAVE_REGISTERS;						\
   {								\
     struct passwd * pw;						\
-    ttl_value pw_struct = ttl_unsafe_alloc_array (8);		\
+    ttl_value pw_struct = ttl_unsafe_alloc_data (0, 7);		\
     ttl_global_acc = pw_struct;					\
     pw = getpwent ();						\
     if (pw)							\
@@ -131,12 +130,11 @@ copy_gr_to_gr_struct (ttl_value gr_struct, struct group * gr)
       len++;
     }
 
-  a->data[0] = TTL_INT_TO_VALUE (0);
-  a->data[1] = ttl_string_to_value (gr->gr_name, -1);
-  a->data[2] = ttl_string_to_value (gr->gr_passwd, -1);
-  a->data[3] = TTL_INT_TO_VALUE (gr->gr_gid);
-  a->data[4] = ttl_alloc_array (len);
-  a = TTL_VALUE_TO_OBJ (ttl_array, a->data[4]);
+  a->data[0] = ttl_string_to_value (gr->gr_name, -1);
+  a->data[1] = ttl_string_to_value (gr->gr_passwd, -1);
+  a->data[2] = TTL_INT_TO_VALUE (gr->gr_gid);
+  a->data[3] = ttl_alloc_array (len);
+  a = TTL_VALUE_TO_OBJ (ttl_array, a->data[3]);
   p = gr->gr_mem;
   for (idx = 0; idx < len; idx++)
     a->data[idx] = ttl_string_to_value (*p++, -1);
@@ -153,7 +151,7 @@ copy_gr_to_gr_struct (ttl_value gr_struct, struct group * gr)
   {								\
     struct group * gr;						\
     char * group_name = ttl_malloc_c_string (env->locals[0]);	\
-    ttl_value gr_struct = ttl_unsafe_alloc_array (5);		\
+    ttl_value gr_struct = ttl_unsafe_alloc_data (0, 4);		\
     ttl_global_acc = gr_struct;					\
     gr = getgrnam (group_name);					\
     if (gr)							\
@@ -177,7 +175,7 @@ copy_gr_to_gr_struct (ttl_value gr_struct, struct group * gr)
   {								\
     struct group * gr;						\
     int gid = TTL_VALUE_TO_INT (env->locals[0]);		\
-    ttl_value gr_struct = ttl_unsafe_alloc_array (5);		\
+    ttl_value gr_struct = ttl_unsafe_alloc_data (0, 4);		\
     ttl_global_acc = gr_struct;					\
     gr = getgrgid (gid);					\
     if (gr)							\
@@ -199,7 +197,7 @@ copy_gr_to_gr_struct (ttl_value gr_struct, struct group * gr)
   TTL_SAVE_REGISTERS;						\
   {								\
     struct group * gr;						\
-    ttl_value gr_struct = ttl_unsafe_alloc_array (5);		\
+    ttl_value gr_struct = ttl_unsafe_alloc_data (0, 4);		\
     ttl_global_acc = gr_struct;					\
     gr = getgrent ();						\
     if (gr)							\
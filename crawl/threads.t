@@ -0,0 +1,139 @@
+// threads.t -- Green threads and mutexes.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+//
+// This software is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this package; see the file COPYING.  If not, write to the
+// Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+// MA 02111-1307, USA.
+
+
+// Commentary:
+//
+//* Lightweight threads, which are scheduled by the runtime system.
+//* @code{spawn} creates a thread which runs a function without
+//* arguments.  A thread runs until it blocks in @code{yield},
+//* @code{join}, @code{lock} or one of the functions of the
+//* @code{channels} module, or until its time slice expires.  Time
+//* slices end after a fixed number of function calls and loop
+//* iterations, and every 10 milliseconds of processor time, so a
+//* thread in a tight loop cannot starve the others.  The interval can
+//* be changed with the runtime option @option{-:q@var{msecs}}.
+//*
+//* The program ends when @code{main} returns, even if other threads
+//* are still running.  An uncaught exception in any thread halts the
+//* program.  When all threads are blocked, the program is halted
+//* with a deadlock message, unless some of them wait for input or
+//* output.
+//*
+//* A thread which reads from a file descriptor with
+//* @code{core.read_char} (and therefore the @code{io} module),
+//* @code{sys.files.read} or @code{sys.net.accept}, or writes with
+//* @code{sys.files.write}, waits until the file descriptor is ready
+//* while the other threads run, so one process can serve many
+//* network connections with a thread for each.  When no other thread
+//* is runnable, the program sleeps until a file descriptor becomes
+//* ready.
+//*
+//* @example
+//* var t: threads.thread := threads.spawn (fun () work (); end);
+//* threads.join (t);
+//* @end example
+
+module threads;
+
+
+//* The type of threads.
+//
+public datatype thread = thread;
+
+//* The type of mutexes, which are created with @code{make_mutex}.
+//
+public datatype mutex = mutex;
+
+
+//* Create a new thread which calls @var{f} and finishes when it
+//* returns, and return it.  The new thread runs after the current
+//* thread blocks or its time slice expires.
+//
+public fun spawn (f: (fun (): ())): thread;
+
+//* Let the other runnable threads run before continuing.
+//
+public fun yield ();
+
+//* Wait until the thread @var{t} has finished.
+//
+public fun join (t: thread);
+
+//* Return the current thread.
+//
+public fun current (): thread;
+
+//* Return the number of the thread @var{t}.  The thread running
+//* @code{main} has number 0, the other threads are numbered in the
+//* order of their creation.
+//
+public fun id (t: thread): int;
+
+//* Return @code{true} if the function of the thread @var{t} has
+//* returned.
+//
+public fun finished (t: thread): bool;
+
+
+//* Wait until input is available on the file descriptor @var{fd},
+//* letting the other threads run meanwhile.  The functions
+//* @code{core.read_char}, @code{sys.files.read} and
+//* @code{sys.net.accept} call this before reading, so that a thread
+//* waiting for input does not block the others.
+//
+public fun wait_readable (fd: int);
+
+//* Wait until the file descriptor @var{fd} can take output, letting
+//* the other threads run meanwhile.
+//
+public fun wait_writable (fd: int);
+
+
+//* Create an unlocked mutex.
+//
+public fun make_mutex (): mutex;
+
+//* Lock the mutex @var{m}, waiting until it is unlocked if another
+//* thread holds it.  Mutexes are not recursive, a thread which locks
+//* a mutex it already holds waits forever.  Waiting threads get the
+//* mutex in the order in which they called @code{lock}.
+//
+public fun lock (m: mutex);
+
+//* Lock the mutex @var{m} if it is unlocked and return @code{true},
+//* otherwise return @code{false} without waiting.
+//
+public fun try_lock (m: mutex): bool;
+
+//* Unlock the mutex @var{m}, which must be held by the current
+//* thread.
+//
+public fun unlock (m: mutex);
+
+//* Call @var{f} with the mutex @var{m} locked.  The mutex stays locked
+//* if @var{f} raises an exception.
+//
+public fun with_lock (m: mutex, f: (fun (): ()))
+  lock (m);
+  f ();
+  unlock (m);
+end;
+
+// End of threads.t.
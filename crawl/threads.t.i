@@ -0,0 +1,119 @@
+/* threads.t.i -- C implementation for threads.t.           -*-c-*-  */
+
+/* This file contains the implementation for the various functions in
+   the `threads' module.
+
+   For details on how to hand-code Turtle modules, see the Turtle
+   reference manual.  */
+
+
+/* The functions which block may switch to another thread by
+   replacing the current continuation and the accumulator, and the
+   generated code returns by restoring the continuation after each
+   of the functions below.  */
+
+/* Function spawn: fun(fun(): ()): threads.thread.  */
+#define threads_spawn_pF1pF0_pV_uthread_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  TTL_SAVE_REGISTERS;						\
+  ttl_global_acc = ttl_thread_spawn (env->locals[0]);		\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function yield: fun(): ().  */
+#define threads_yield_pF0_pV_implementation			\
+{								\
+  TTL_SAVE_REGISTERS;						\
+  ttl_thread_yield ();						\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function join: fun(threads.thread): ().  */
+#define threads_join_pF1uthread_pV_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  TTL_SAVE_REGISTERS;						\
+  ttl_thread_join (env->locals[0]);				\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function current: fun(): threads.thread.  */
+#define threads_current_pF0_uthread_implementation		\
+{								\
+  TTL_SAVE_REGISTERS;						\
+  ttl_global_acc = ttl_thread_current ();			\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function id: fun(threads.thread): int.  */
+#define threads_id_pF1uthread_pI_implementation			\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  acc = TTL_INT_TO_VALUE (ttl_thread_id (acc));			\
+}
+
+/* Function finished: fun(threads.thread): bool.  */
+#define threads_finished_pF1uthread_pB_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  acc = TTL_BOOL_TO_VALUE (ttl_thread_finished_p (acc));	\
+}
+
+/* Function wait_readable: fun(int): ().  */
+#define threads_wait_readable_pF1pI_pV_implementation		\
+{								\
+  TTL_SAVE_REGISTERS;						\
+  ttl_io_wait (TTL_VALUE_TO_INT (env->locals[0]), TTL_IO_READ);	\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function wait_writable: fun(int): ().  */
+#define threads_wait_writable_pF1pI_pV_implementation		\
+{								\
+  TTL_SAVE_REGISTERS;						\
+  ttl_io_wait (TTL_VALUE_TO_INT (env->locals[0]), TTL_IO_WRITE);	\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function make_mutex: fun(): threads.mutex.  */
+#define threads_make_mutex_pF0_umutex_implementation		\
+{								\
+  TTL_SAVE_REGISTERS;						\
+  ttl_global_acc = ttl_make_mutex ();				\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function lock: fun(threads.mutex): ().  */
+#define threads_lock_pF1umutex_pV_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  TTL_SAVE_REGISTERS;						\
+  ttl_mutex_lock (env->locals[0]);				\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* Function try_lock: fun(threads.mutex): bool.  */
+#define threads_try_lock_pF1umutex_pB_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  acc = TTL_BOOL_TO_VALUE (ttl_mutex_try_lock (acc));		\
+}
+
+/* Function unlock: fun(threads.mutex): ().  */
+#define threads_unlock_pF1umutex_pV_implementation		\
+{								\
+  acc = env->locals[0];						\
+  TTL_NULL_CHECK;						\
+  TTL_SAVE_REGISTERS;						\
+  ttl_mutex_unlock (env->locals[0]);				\
+  TTL_RESTORE_REGISTERS;					\
+}
+
+/* End of threads.t.i.  */
@@ -0,0 +1,50 @@
+// pipeline.t -- List pipeline for benchmarking.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+// Commentary:
+//
+// This program passes a million numbers through a three-stage
+// pipeline of `map', `filter' and `ifoldl'.  Compiled with `-O L'
+// (as `pipeline'), the pipeline becomes a single loop; compiled
+// without it (as `pipeline_unfused'), the intermediate lists are
+// constructed.
+
+module pipeline;
+
+import io, lists<int>, listmap<int, int>, listfold<int>;
+
+fun residue (x: int): int
+  return x % 1000;
+end;
+
+fun odd? (x: int): bool
+  return x % 2 = 1;
+end;
+
+fun add (a: int, b: int): int
+  return a + b;
+end;
+
+fun main (args: list of string): int
+  var n: int := 1000000;
+  var sum: int;
+
+  io.put ("pipeline (");
+  io.put (n);
+  io.put ("): ");
+  sum := listfold.ifoldl (add, 0,
+			  lists.filter (odd?,
+					listmap.map (residue, lists.iota (n))));
+  io.put (sum);
+  io.nl ();
+
+  return 0;
+end;
+
+// End of pipeline.t.
@@ -473,7 +473,13 @@ ttl_make_ast_function (ttl_pool pool, ttl_ast_node name, ttl_ast_node params,
   node->d.function.public = public;
   node->d.function.handcoded = handcoded;
   node->d.function.mapped = 0;
+  node->d.function.leaf = 0;
   node->d.function.alias = NULL;
+  node->d.function.inline_params = NULL;
+  node->d.function.inline_body = NULL;
+  node->d.function.inline_stmts = 0;
+  node->d.function.data_layout = NULL;
+  node->d.function.external = NULL;
   node->d.function.documentation = documentation;
   return node;
 }
@@ -981,6 +987,8 @@ ttl_ast_print (FILE * f, ttl_ast_node node, int indent)
       if (node->d.function.mapped)
 	{
 	  fprintf (f, " = ");
+	  if (node->d.function.leaf)
+	    fprintf (f, "leaf ");
 	  ttl_symbol_print (f, node->d.function.alias);
 	}
       else if (!node->d.function.handcoded)
@@ -326,7 +326,16 @@ struct ttl_ast_function
   int public;
   unsigned handcoded;		/* Non-zero if handcoded function.  */
   unsigned mapped;		/* Non-zero if mapped.  */
+  unsigned leaf;		/* Non-zero if mapped to a leaf function.  */
   ttl_symbol alias;		/* Name of mapped function.  */
+  ttl_ast_node inline_params;	/* Parameter names and body expression */
+  ttl_ast_node inline_body;	/* of inlinable imported functions.  */
+  unsigned inline_stmts;	/* Non-zero if `inline_body' is a
+				   statement list.  */
+  ttl_ast_node data_layout;	/* Kind and field layout of a data type
+				   function used by inline bodies.  */
+  ttl_ast_node external;	/* Module of another module's function
+				   used by inline bodies.  */
   char * documentation;
 };
 
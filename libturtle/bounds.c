@@ -0,0 +1,360 @@
+/* libturtle/bounds.c -- Elimination of redundant range checks.
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+
+#include <stdio.h>
+
+#include "bounds.h"
+#include "il.h"
+#include "util.h"
+
+/* Largest increment of an index variable which is accepted by the
+   analysis.  Together with the limited size of arrays and strings,
+   this makes sure that guarded index variables cannot overflow.  */
+#define MAX_INCREMENT 0x10000
+
+/* A fact established by a loop condition: the value of `index' is
+   less than the size of `array'.  */
+typedef struct bounds_fact * bounds_fact;
+struct bounds_fact
+{
+  bounds_fact next;
+  ttl_variable index;
+  ttl_variable array;
+};
+
+/* The function currently analyzed.  */
+static ttl_function bounds_function = NULL;
+
+/* Return the variable referenced by `node', if it is a local variable
+   or parameter of the current function, and NULL otherwise.  */
+static ttl_variable
+own_variable (ttl_il_node node)
+{
+  ttl_variable var;
+
+  if (node->kind != il_variable)
+    return NULL;
+  var = node->d.variable.variable;
+  if (var && (var->kind == variable_local || var->kind == variable_param) &&
+      var->defining == bounds_function)
+    return var;
+  return NULL;
+}
+
+/* If `node' is a comparison of the form `x < sizeof a' or
+   `sizeof a > x', return the corresponding fact.  */
+static bounds_fact
+comparison_fact (ttl_compile_state state, ttl_il_node node, bounds_fact next)
+{
+  ttl_il_node index, size;
+  bounds_fact fact;
+
+  if (node->kind != il_binop)
+    return next;
+  if (node->d.binop.op == il_binop_lt)
+    {
+      index = node->d.binop.op0;
+      size = node->d.binop.op1;
+    }
+  else if (node->d.binop.op == il_binop_gt)
+    {
+      index = node->d.binop.op1;
+      size = node->d.binop.op0;
+    }
+  else
+    return next;
+  if (size->kind != il_unop || size->d.unop.op != il_unop_sizeof ||
+      !own_variable (index) || !own_variable (size->d.unop.op0) ||
+      index->type != state->int_type)
+    return next;
+  fact = ttl_malloc (state->pool, sizeof (struct bounds_fact));
+  fact->next = next;
+  fact->index = own_variable (index);
+  fact->array = own_variable (size->d.unop.op0);
+  return fact;
+}
+
+/* Return non-zero if the variable `var' is referenced in `node'.  */
+static int
+references_p (ttl_il_node node, ttl_variable var)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return 0;
+  if (node->kind == il_variable)
+    return node->d.variable.variable == var;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (references_p (*slots[i], var))
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if the assignment target `lhs' is the variable `var'
+   or a tuple containing it.  Assignments to array elements do not
+   modify the array variable.  */
+static int
+assigns_p (ttl_il_node lhs, ttl_variable var)
+{
+  if (lhs->kind == il_variable)
+    return lhs->d.variable.variable == var;
+  else if (lhs->kind == il_tuple_expr)
+    return references_p (lhs, var);
+  return 0;
+}
+
+/* Return non-zero if the variable `var' may be modified by `node'.  */
+static int
+modifies_p (ttl_il_node node, ttl_variable var)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return 0;
+  if (node->kind == il_binop && node->d.binop.op == il_binop_assign &&
+      assigns_p (node->d.binop.op0, var))
+    return 1;
+  if (node->kind == il_var_expr || node->kind == il_in ||
+      node->kind == il_require)
+    return references_p (node, var);
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (modifies_p (*slots[i], var))
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if the loop condition `cond' contains a conjunct of
+   the form `var < sizeof a'.  */
+static int
+guards_p (ttl_compile_state state, ttl_il_node cond, ttl_variable var)
+{
+  bounds_fact fact;
+
+  if (cond->kind == il_binop && cond->d.binop.op == il_binop_and)
+    return guards_p (state, cond->d.binop.op0, var) ||
+      guards_p (state, cond->d.binop.op1, var);
+  fact = comparison_fact (state, cond, NULL);
+  return fact && fact->index == var;
+}
+
+/* Return non-zero if all assignments to `var' in the statement list
+   `list' either assign a non-negative constant, or increment the
+   variable by a small positive constant inside of a loop which is
+   guarded by a comparison of the variable with the size of an array.
+   `guarded' is non-zero if `list' is inside such a loop.  */
+static int
+nonnegative_assignments_p (ttl_compile_state state, ttl_il_node node,
+			   ttl_variable var, int guarded)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return 1;
+  if (node->kind == il_binop && node->d.binop.op == il_binop_assign &&
+      assigns_p (node->d.binop.op0, var))
+    {
+      ttl_il_node lhs = node->d.binop.op0;
+      ttl_il_node rhs = node->d.binop.op1;
+
+      if (lhs->kind != il_variable)
+	return 0;
+      if (rhs->kind == il_int_const)
+	return rhs->d.integer.value >= 0;
+      if (guarded && rhs->kind == il_binop &&
+	  rhs->d.binop.op == il_binop_add &&
+	  rhs->d.binop.op0->kind == il_variable &&
+	  rhs->d.binop.op0->d.variable.variable == var &&
+	  rhs->d.binop.op1->kind == il_int_const &&
+	  rhs->d.binop.op1->d.integer.value > 0 &&
+	  rhs->d.binop.op1->d.integer.value <= MAX_INCREMENT)
+	return 1;
+      return 0;
+    }
+  if (node->kind == il_var_expr || node->kind == il_in ||
+      node->kind == il_require)
+    return !references_p (node, var);
+  if (node->kind == il_while)
+    return nonnegative_assignments_p (state, node->d.whilestmt.cond, var,
+				      guarded) &&
+      nonnegative_assignments_p (state, node->d.whilestmt.dostmt, var,
+				 guarded ||
+				 guards_p (state, node->d.whilestmt.cond,
+					   var));
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (!nonnegative_assignments_p (state, *slots[i], var, guarded))
+      return 0;
+  return 1;
+}
+
+/* Return non-zero if the index variable of `fact' can never be
+   negative.  Parameters may be negative, so only local variables are
+   accepted.  Uninitialized local variables are null, which has the
+   integer value 0.  */
+static int
+nonnegative_p (ttl_compile_state state, bounds_fact fact)
+{
+  return fact->index->kind == variable_local &&
+    nonnegative_assignments_p (state, bounds_function->d.function.il_code,
+			       fact->index, 0);
+}
+
+/* Mark all accesses of the form `a[x]' in `node' as unchecked, where
+   `x < sizeof a' is recorded in `facts'.  */
+static void
+mark_accesses (ttl_il_node node, bounds_fact facts)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node || !facts)
+    return;
+  if (node->kind == il_index)
+    {
+      ttl_variable array = own_variable (node->d.index.array);
+      ttl_variable index = own_variable (node->d.index.index);
+      bounds_fact fact;
+
+      for (fact = facts; fact; fact = fact->next)
+	if (fact->array == array && fact->index == index)
+	  node->d.index.unchecked = 1;
+    }
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    mark_accesses (*slots[i], facts);
+}
+
+/* Collect the facts established by the loop condition `cond', for
+   index variables which can never be negative.  The facts established
+   by the left operand of `and' already hold when the right operand is
+   evaluated, so accesses there are marked, too.  */
+static bounds_fact
+condition_facts (ttl_compile_state state, ttl_il_node cond,
+		 bounds_fact facts)
+{
+  bounds_fact fact;
+
+  if (cond->kind == il_binop && cond->d.binop.op == il_binop_and)
+    {
+      facts = condition_facts (state, cond->d.binop.op0, facts);
+      mark_accesses (cond->d.binop.op1, facts);
+      return condition_facts (state, cond->d.binop.op1, facts);
+    }
+  fact = comparison_fact (state, cond, facts);
+  if (fact != facts && !nonnegative_p (state, fact))
+    return facts;
+  return fact;
+}
+
+/* Remove the facts from `facts' whose variables may be modified by
+   `stmt'.  */
+static bounds_fact
+kill_facts (ttl_compile_state state, ttl_il_node stmt, bounds_fact facts)
+{
+  bounds_fact result = NULL, fact, copy;
+
+  for (fact = facts; fact; fact = fact->next)
+    if (!modifies_p (stmt, fact->index) && !modifies_p (stmt, fact->array))
+      {
+	copy = ttl_malloc (state->pool, sizeof (struct bounds_fact));
+	*copy = *fact;
+	copy->next = result;
+	result = copy;
+      }
+  return result;
+}
+
+static void analyze_stmt_list (ttl_compile_state state, ttl_il_node list);
+
+/* Analyze the loop `node'.  The facts from the loop condition hold at
+   the start of the loop body, and until one of the variables involved
+   is modified.  */
+static void
+analyze_while (ttl_compile_state state, ttl_il_node node)
+{
+  bounds_fact facts = condition_facts (state, node->d.whilestmt.cond, NULL);
+  ttl_il_node list;
+
+  for (list = node->d.whilestmt.dostmt; list && facts;
+       list = list->d.pair.cdr)
+    {
+      facts = kill_facts (state, list->d.pair.car, facts);
+      mark_accesses (list->d.pair.car, facts);
+    }
+  analyze_stmt_list (state, node->d.whilestmt.dostmt);
+}
+
+static void
+analyze_stmt (ttl_compile_state state, ttl_il_node node)
+{
+  switch (node->kind)
+    {
+    case il_while:
+      analyze_while (state, node);
+      break;
+    case il_if:
+      analyze_stmt_list (state, node->d.ifstmt.thenstmt);
+      analyze_stmt_list (state, node->d.ifstmt.elsestmt);
+      break;
+    case il_seq:
+      analyze_stmt_list (state, node->d.seq.stmts);
+      break;
+    default:
+      break;
+    }
+}
+
+static void
+analyze_stmt_list (ttl_compile_state state, ttl_il_node list)
+{
+  while (list)
+    {
+      analyze_stmt (state, list->d.pair.car);
+      list = list->d.pair.cdr;
+    }
+}
+
+void
+ttl_bounds_module (ttl_compile_state state, ttl_module module)
+{
+  ttl_function function;
+
+  for (function = module->functions; function;
+       function = function->total_next)
+    {
+      /* Nested functions may modify the variables of their enclosing
+	 functions at any time, so functions containing nested
+	 functions are not analyzed.  */
+      if (function->kind != function_function ||
+	  function->d.function.handcoded || function->d.function.mapped ||
+	  !function->d.function.il_code || function->enclosed)
+	continue;
+      bounds_function = function;
+      analyze_stmt_list (state, function->d.function.il_code);
+    }
+  bounds_function = NULL;
+}
+
+/* End of bounds.c.  */
@@ -0,0 +1,32 @@
+/* libturtle/bounds.h - elimination of redundant range checks
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+#ifndef TTL_BOUNDS_H
+#define TTL_BOUNDS_H
+
+#include "env.h"
+#include "compiler.h"
+
+/* Mark the array and string accesses in all functions of `module'
+   which are known to be in range, because they are guarded by a loop
+   condition like `i < sizeof a' and the index can never be negative.
+   The code generator omits the range checks for these accesses.  */
+void ttl_bounds_module (ttl_compile_state state, ttl_module module);
+
+#endif /* not TTL_BOUNDS_H */
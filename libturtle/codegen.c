@@ -19,6 +19,8 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "codegen.h"
 #include "il.h"
@@ -133,12 +135,37 @@ static char * opcode_names[] =
     "variable-set",
     "coerce-to-constrained-array",
     "coerce-to-constrained-list",
-    "load-foreign"
+    "load-foreign",
+    "load-descr",
+    "return-values",
+    "receive-values",
+    "jump-if-variant",
+    "jump-if-not-variant",
+    "leaf-call",
+    "aload-unchecked",
+    "astore-unchecked",
+    "sload-unchecked",
+    "sstore-unchecked",
+    "je-int",
+    "jne-int",
+    "jl-int",
+    "jnl-int",
+    "jg-int",
+    "jng-int"
   };
 
 static int load_constrainable_variables = 0;
 static int compiling_constraint = 0;
 
+/* Maximum number of tuple elements returned in value registers.  Must
+   match TTL_MAX_VALUES in libturtlert.h.  */
+#define MAX_VALUE_REGISTERS 8
+
+/* Set to non-zero before compiling a call whose tuple result is
+   destructured immediately.  The continuation label of the next
+   compiled call is then marked as accepting multiple values.  */
+static int values_wanted = 0;
+
 /* static int static_sp_value = 0; */
 
 ttl_operand
@@ -404,7 +431,7 @@ fixup_calls (ttl_compile_state state, ttl_function function)
 	  instr->op0 = ttl_make_operand (state->pool, operand_label,
 					 (void *) f->index);
 	}
-      else if (instr->op == op_make_closure)
+      else if (instr->op == op_make_closure || instr->op == op_load_descr)
 	{
 	  ttl_function f = (ttl_function) (instr->op0->data);
 	  instr->op0 = ttl_make_operand (state->pool, operand_label,
@@ -475,6 +502,200 @@ compile_parameters (ttl_compile_state state, ttl_il_node param,
     }
 }
 
+/* Return non-zero if `function' is mapped to a C function which may
+   be called directly, without creating an environment or saving the
+   registers.  */
+static int
+leaf_function_p (ttl_function function)
+{
+  return function && function->kind == function_function &&
+    function->d.function.leaf;
+}
+
+/* Return non-zero if `function' is a data type function of another
+   module.  Interface files describe the layout of the data type
+   functions which are called by inlinable bodies, but these functions
+   are private to their module, so they must be compiled in place.  */
+static int
+foreign_data_function_p (ttl_compile_state state, ttl_function function)
+{
+  ttl_function f;
+
+  if (!function || function->kind == function_function ||
+      function->kind == function_constraint)
+    return 0;
+  for (f = state->current_module->functions; f; f = f->total_next)
+    if (f == function)
+      return 0;
+  return 1;
+}
+
+/* Append code for calling the leaf function `function', whose
+   arguments have been pushed onto the stack.  The result is left in
+   the accumulator.  If `node' is not NULL, it is the call, and its
+   position is recorded for the null checks of real and long
+   arguments.  */
+static void
+append_leaf_call (ttl_compile_state state, ttl_object obj,
+		  ttl_function function, ttl_il_node node)
+{
+  ttl_type result = function->type->d.function.return_type;
+  unsigned i;
+
+  if (result->kind == type_real || result->kind == type_long)
+    append_gc_check (state, obj, 4);
+  if (node && node->filename)
+    for (i = 0; i < function->type->d.function.param_type_count; i++)
+      {
+	ttl_type pt = function->type->d.function.param_types[i];
+	if (pt->kind == type_real || pt->kind == type_long)
+	  {
+	    ttl_instruction instr = ttl_make_new_note_label_stmt (state);
+	    instr->filename = node->filename;
+	    instr->line = node->start_line;
+	    ttl_append_instruction (obj, instr);
+	    break;
+	  }
+      }
+  ttl_append_instruction
+    (obj,
+     ttl_make_instruction (state->pool,
+			   op_leaf_call,
+			   ttl_make_operand
+			   (state->pool,
+			    operand_mem,
+			    (void *) function->d.function.alias),
+			   ttl_make_operand
+			   (state->pool,
+			    operand_constant,
+			    (void *) function->type),
+			   NULL, -1));
+}
+
+/* Return non-zero if tail calls to `function' may be compiled into a
+   jump to its loop label, reusing the environment of the caller.
+   This is not possible if the environment may be referenced by
+   nested functions, or contains constrainable variables which are
+   set up on function entry.  */
+static int
+tail_loop_function_p (ttl_compile_state state, ttl_function function)
+{
+  ttl_variable var;
+
+  if (!state->compile_options->opt_tail_loops ||
+      function->kind != function_function ||
+      function->d.function.handcoded || function->d.function.mapped ||
+      !function->d.function.il_code || function->enclosed ||
+      leaf_function_p (function))
+    return 0;
+  for (var = function->locals; var; var = var->next)
+    if (var->type->kind == type_constrained)
+      return 0;
+  return 1;
+}
+
+/* Return the function whose environment is the parent of the
+   environments of `function', or NULL if `function' does not access
+   the environment register on entry.  */
+static ttl_function
+parent_environment (ttl_function function)
+{
+  if (!function->enclosing || function->closed)
+    return NULL;
+  return function->enclosing;
+}
+
+/* Return the label of `function' to which tail calls are compiled
+   when they reuse the caller's environment.  */
+static ttl_operand
+loop_label (ttl_compile_state state, ttl_function function)
+{
+  if (!function->loop_label)
+    function->loop_label = ttl_make_new_label (state);
+  return (ttl_operand) function->loop_label;
+}
+
+/* Return non-zero if the tail call to `function' from the current
+   function can reuse the current environment.  The environment must
+   have the same parent and must be large enough for the parameters
+   and local variables of `function'.  */
+static int
+tail_loop_call_p (ttl_compile_state state, ttl_function function)
+{
+  ttl_function current = state->current_function;
+
+  return tail_loop_function_p (state, current) &&
+    tail_loop_function_p (state, function) &&
+    parent_environment (current) == parent_environment (function) &&
+    function->param_count + function->local_count <=
+    current->param_count + current->local_count;
+}
+
+/* Compile the tail call `node' to `function' into a jump to the loop
+   label of `function'.  The arguments are stored into the parameter
+   slots of the current environment, and the remaining slots are
+   cleared, as if a new environment had been created.  */
+static void
+compile_tail_loop_call (ttl_compile_state state, ttl_object obj,
+			ttl_il_node node, ttl_function function)
+{
+  ttl_function current = state->current_function;
+  ttl_il_node param = node->d.call.args;
+  int sp_value = 0;
+  unsigned i;
+
+  /* The last argument is stored directly from the accumulator, the
+     others are pushed until all arguments have been evaluated.  */
+  while (param)
+    {
+      compile_expr (state, obj, param->d.pair.car, link_next, NULL,
+		    sp_value);
+      if (param->d.pair.cdr)
+	{
+	  ttl_append_instruction
+	    (obj,
+	     ttl_make_instruction (state->pool, op_push, NULL, NULL,
+				   param->d.pair.car->filename,
+				   param->d.pair.car->start_line));
+	  sp_value++;
+	}
+      param = param->d.pair.cdr;
+    }
+  for (i = function->param_count; i > 0; i--)
+    {
+      if (i < function->param_count)
+	ttl_append_instruction
+	  (obj,
+	   ttl_make_instruction (state->pool, op_pop, NULL, NULL, NULL, -1));
+      ttl_append_instruction
+	(obj,
+	 ttl_make_instruction
+	 (state->pool, op_store,
+	  ttl_make_operand (state->pool, operand_local, (void *) (i - 1)),
+	  NULL, NULL, -1));
+    }
+  if (current->param_count + current->local_count > function->param_count)
+    {
+      ttl_append_instruction
+	(obj,
+	 ttl_make_instruction (state->pool, op_load_null, NULL, NULL,
+			       NULL, -1));
+      for (i = function->param_count;
+	   i < current->param_count + current->local_count; i++)
+	ttl_append_instruction
+	  (obj,
+	   ttl_make_instruction
+	   (state->pool, op_store,
+	    ttl_make_operand (state->pool, operand_local, (void *) i),
+	    NULL, NULL, -1));
+    }
+  ttl_append_instruction
+    (obj,
+     ttl_make_instruction (state->pool, op_jump,
+			   loop_label (state, function), NULL,
+			   node->filename, node->start_line));
+}
+
 static void
 compile_call (ttl_compile_state state, ttl_object obj, ttl_il_node node,
 	      enum ttl_link link, ttl_operand target, int sp_value)
@@ -482,6 +703,50 @@ compile_call (ttl_compile_state state, ttl_object obj, ttl_il_node node,
   ttl_il_node param = node->d.call.args;
   ttl_operand cont_label = ttl_make_new_label (state);
 
+  if (values_wanted)
+    {
+      cont_label->unsigned_data = 1;
+      values_wanted = 0;
+    }
+
+  /* Leaf functions neither allocate nor call back into Turtle code,
+     so they can be called in place, without a continuation.  */
+  if (state->compile_options->opt_leaf_calls &&
+      node->d.call.function->kind == il_function &&
+      leaf_function_p (node->d.call.function->d.function.function))
+    {
+      compile_parameters (state, node->d.call.args, obj, sp_value);
+      append_leaf_call (state, obj,
+			node->d.call.function->d.function.function, node);
+      compile_link (state, obj, link, target);
+      return;
+    }
+
+  if (node->d.call.function->kind == il_function &&
+      foreign_data_function_p (state,
+			       node->d.call.function->d.function.function))
+    {
+      ttl_function f = node->d.call.function->d.function.function;
+
+      compile_parameters (state, node->d.call.args, obj, sp_value);
+      switch (f->kind)
+	{
+	case function_constructor:
+	  compile_constructor_body (state, f, obj, link, target);
+	  break;
+	case function_discriminator:
+	  compile_discriminator_body (state, f, obj, link, target);
+	  break;
+	case function_accessor:
+	  compile_accessor_body (state, f, obj, link, target);
+	  break;
+	default:
+	  compile_setter_body (state, f, obj, link, target);
+	  break;
+	}
+      return;
+    }
+
   if (state->compile_options->opt_local_jumps &&
       node->d.call.function->kind == il_function)
     {
@@ -493,6 +758,12 @@ compile_call (ttl_compile_state state, ttl_object obj, ttl_il_node node,
 	}
       if (f)
 	{
+	  if (link == link_return && sp_value == 0 &&
+	      tail_loop_call_p (state, f))
+	    {
+	      compile_tail_loop_call (state, obj, node, f);
+	      return;
+	    }
 	  if (!state->compile_options->opt_inline_constructors)
 	    goto compile_normal_call;
 	  switch (f->kind)
@@ -530,7 +801,10 @@ compile_call (ttl_compile_state state, ttl_object obj, ttl_il_node node,
 		  sp_value = 0;
 		}
 	      compile_parameters (state, node->d.call.args, obj, sp_value);
-	      if (state->current_function->d.function.nesting_level >=
+	      /* Toplevel and closed functions clear the environment
+		 register on entry, so there is no need to set it up.  */
+	      if (f->enclosing && !f->closed &&
+		  state->current_function->d.function.nesting_level >=
 		  f->d.function.nesting_level)
 		{
 		  ttl_append_instruction
@@ -978,13 +1252,17 @@ compile_bool_expr (ttl_compile_state state, ttl_object obj, ttl_il_node node,
 	    if (node->d.index.array->type == state->string_type)
 	      ttl_append_instruction
 		(obj,
-		 ttl_make_instruction (state->pool, op_sload, NULL, NULL,
-				       NULL, -1));
+		 ttl_make_instruction (state->pool,
+				       node->d.index.unchecked ?
+				       op_sload_unchecked : op_sload,
+				       NULL, NULL, NULL, -1));
 	    else
 	      ttl_append_instruction
 		(obj,
-		 ttl_make_instruction (state->pool, op_aload, NULL, NULL,
-				       NULL, -1));
+		 ttl_make_instruction (state->pool,
+				       node->d.index.unchecked ?
+				       op_aload_unchecked : op_aload,
+				       NULL, NULL, NULL, -1));
 	  }
 	ttl_append_instruction
 	  (obj,
@@ -1128,7 +1406,14 @@ compile_expr (ttl_compile_state state, ttl_object obj, ttl_il_node node,
     case il_function:
       {
 	ttl_function func = node->d.function.function;
-	if (func->enclosing)
+	if (func->enclosing && func->closed)
+	  ttl_append_instruction
+	    (obj,
+	     ttl_make_instruction
+	     (state->pool, op_load_descr,
+	      ttl_make_operand (state->pool, operand_label,
+				(void *) func), NULL, NULL, -1));
+	else if (func->enclosing)
 	  {
 	    append_gc_check (state, obj, 4);
 	    ttl_append_instruction
@@ -1467,13 +1752,17 @@ compile_expr (ttl_compile_state state, ttl_object obj, ttl_il_node node,
 	    if (node->d.index.array->type == state->string_type)
 	      ttl_append_instruction
 		(obj,
-		 ttl_make_instruction (state->pool, op_sload, NULL, NULL,
-				       NULL, -1));
+		 ttl_make_instruction (state->pool,
+				       node->d.index.unchecked ?
+				       op_sload_unchecked : op_sload,
+				       NULL, NULL, NULL, -1));
 	    else
 	      ttl_append_instruction
 		(obj,
-		 ttl_make_instruction (state->pool, op_aload, NULL, NULL,
-				       NULL, -1));
+		 ttl_make_instruction (state->pool,
+				       node->d.index.unchecked ?
+				       op_aload_unchecked : op_aload,
+				       NULL, NULL, NULL, -1));
 	  }
 	compile_link (state, obj, link, target);
       }
@@ -1563,13 +1852,29 @@ compile_expr (ttl_compile_state state, ttl_object obj, ttl_il_node node,
 	    elems = elems->d.pair.cdr;
 	    count++;
 	  }
-	append_gc_check (state, obj, count + 1);
-	ttl_append_instruction
-	  (obj,
-	   ttl_make_instruction
-	   (state->pool, op_make_tuple,
-	    ttl_make_operand (state->pool, operand_constant,
-			      (void *) count), NULL, NULL, -1));
+	if (link == link_return &&
+	    state->compile_options->opt_multiple_values &&
+	    count <= MAX_VALUE_REGISTERS)
+	  {
+	    /* The tuple is only allocated if the continuation does not
+	       accept the elements in the value registers.  */
+	    ttl_append_instruction
+	      (obj,
+	       ttl_make_instruction
+	       (state->pool, op_return_values,
+		ttl_make_operand (state->pool, operand_constant,
+				  (void *) count), NULL, NULL, -1));
+	  }
+	else
+	  {
+	    append_gc_check (state, obj, count + 1);
+	    ttl_append_instruction
+	      (obj,
+	       ttl_make_instruction
+	       (state->pool, op_make_tuple,
+		ttl_make_operand (state->pool, operand_constant,
+				  (void *) count), NULL, NULL, -1));
+	  }
 	compile_link (state, obj, link, target);
       }
       break;
@@ -1690,6 +1995,69 @@ static void
 compile_stmt_list (ttl_compile_state state, ttl_object obj, ttl_il_node code,
 		   enum ttl_link link, ttl_operand target);
 
+static void
+compile_store (ttl_compile_state state, ttl_object obj,
+	       ttl_il_node lvalue, enum ttl_link link,
+	       ttl_operand target, int sp_value);
+
+/* Store the elements of the tuple in the accumulator into the
+   lvalues of the tuple expression `lvalue'.  If `values' is non-zero,
+   the tuple was returned by a call whose continuation accepts
+   multiple values, so the elements may be in the value registers
+   instead.  */
+static void
+compile_tuple_store (ttl_compile_state state, ttl_object obj,
+		     ttl_il_node lvalue, enum ttl_link link,
+		     ttl_operand target, int sp_value, int values)
+{
+  unsigned index = 0;
+  ttl_il_node elems = lvalue->d.tuple_expr.elements;
+  unsigned size = lvalue->type->d.tuple.elem_type_count;
+
+  if (values)
+    {
+      ttl_append_instruction
+	(obj,
+	 ttl_make_instruction
+	 (state->pool, op_receive_values,
+	  ttl_make_operand (state->pool, operand_constant, (void *) size),
+	  NULL, NULL, -1));
+      sp_value += size;
+    }
+  else
+    {
+      ttl_append_instruction
+	(obj,
+	 ttl_make_instruction
+	 (state->pool, op_null_check, NULL, NULL, NULL, -1));
+      while (index < size)
+	{
+	  ttl_append_instruction
+	    (obj,
+	     ttl_make_instruction
+	     (state->pool, op_tuple_ref,
+	      ttl_make_operand (state->pool,
+				operand_constant,
+				(void *) (size - index - 1)),
+	      NULL, NULL, -1));
+	  sp_value++;
+	  index++;
+	}
+    }
+  while (elems)
+    {
+      ttl_append_instruction
+	(obj,
+	 ttl_make_instruction
+	 (state->pool, op_pop, NULL, NULL, NULL, -1));
+      compile_store (state, obj, elems->d.pair.car,
+		     link_next, NULL, sp_value);
+      sp_value--;
+      elems = elems->d.pair.cdr;
+    }
+  compile_link (state, obj, link, target);
+}
+
 static void
 compile_store (ttl_compile_state state, ttl_object obj,
 	       ttl_il_node lvalue, enum ttl_link link,
@@ -1800,54 +2168,22 @@ compile_store (ttl_compile_state state, ttl_object obj,
 	      ttl_append_instruction
 		(obj,
 		 ttl_make_instruction (state->pool,
-				       op_sstore, NULL, NULL, NULL, -1));
+				       lvalue->d.index.unchecked ?
+				       op_sstore_unchecked : op_sstore,
+				       NULL, NULL, NULL, -1));
 	    else
 	      ttl_append_instruction
 		(obj,
 		 ttl_make_instruction (state->pool,
-				       op_astore, NULL, NULL, NULL, -1));
+				       lvalue->d.index.unchecked ?
+				       op_astore_unchecked : op_astore,
+				       NULL, NULL, NULL, -1));
 	  }
 	compile_link (state, obj, link, target);
 	break;
       }
     case il_tuple_expr:
-      {
-	unsigned index = 0;
-	ttl_il_node elems =
-	  lvalue->d.tuple_expr.elements;
-	unsigned size =
-	  lvalue->type->d.tuple.elem_type_count;
-
-	ttl_append_instruction
-	  (obj,
-	   ttl_make_instruction
-	   (state->pool, op_null_check, NULL, NULL, NULL, -1));
-	while (index < size)
-	  {
-	    ttl_append_instruction
-	      (obj,
-	       ttl_make_instruction
-	       (state->pool, op_tuple_ref,
-		ttl_make_operand (state->pool,
-				  operand_constant,
-				  (void *) (size - index - 1)),
-		NULL, NULL, -1));
-	    sp_value++;
-	    index++;
-	  }
-	while (elems)
-	  {
-	    ttl_append_instruction
-	      (obj,
-	       ttl_make_instruction
-	       (state->pool, op_pop, NULL, NULL, NULL, -1));
-	    compile_store (state, obj, elems->d.pair.car,
-			   link_next, NULL, sp_value);
-	    sp_value--;
-	    elems = elems->d.pair.cdr;
-	  }
-	compile_link (state, obj, link, target);
-      }
+      compile_tuple_store (state, obj, lvalue, link, target, sp_value, 0);
       break;
       
     case il_error:
@@ -3807,6 +4143,17 @@ compile_stmt (ttl_compile_state state, ttl_object obj, ttl_il_node node,
 			}
 		      compile_link (state, obj, link, target);
 		    }
+		  else if (rvalue->kind == il_call &&
+			   state->compile_options->opt_multiple_values &&
+			   lvalue->type->d.tuple.elem_type_count <=
+			   MAX_VALUE_REGISTERS)
+		    {
+		      values_wanted = 1;
+		      compile_expr (state, obj, rvalue, link_next, NULL, 0);
+		      values_wanted = 0;
+		      compile_tuple_store (state, obj, lvalue, link, target,
+					   0, 1);
+		    }
 		  else
 		    {
 		      compile_expr (state, obj, node->d.binop.op1, link_next,
@@ -4062,60 +4409,22 @@ jump_instr_p (ttl_instruction instr)
     case op_jump_if_not_lless:
     case op_jump_if_lgtr:
     case op_jump_if_not_lgtr:
+    case op_jump_if_variant:
+    case op_jump_if_not_variant:
+    case op_jump_if_equal_int:
+    case op_jump_if_not_equal_int:
+    case op_jump_if_less_int:
+    case op_jump_if_not_less_int:
+    case op_jump_if_gtr_int:
+    case op_jump_if_not_gtr_int:
       return 1;
     default:
       return 0;
     }
 }
 
-static int
-end_of_basic_block_p (ttl_instruction instr)
-{
-  switch (instr->op)
-    {
-    case op_label:
-    case op_cont_label:
-    case op_proc_label:
-/*     case op_note_label: */
-/*     case op_save_cont: */
-    case op_restore_cont:
-    case op_jump:
-    case op_jump_proc:
-    case op_jump_if_false:
-    case op_jump_if_true:
-    case op_jump_if_equal:
-    case op_jump_if_not_equal:
-    case op_jump_if_less:
-    case op_jump_if_not_less:
-    case op_jump_if_gtr:
-    case op_jump_if_not_gtr:
-    case op_jump_if_fequal:
-    case op_jump_if_not_fequal:
-    case op_jump_if_fless:
-    case op_jump_if_not_fless:
-    case op_jump_if_fgtr:
-    case op_jump_if_not_fgtr:
-    case op_jump_if_lequal:
-    case op_jump_if_not_lequal:
-    case op_jump_if_lless:
-    case op_jump_if_not_lless:
-    case op_jump_if_lgtr:
-    case op_jump_if_not_lgtr:
-    case op_call:
-/*     case op_load_real: */
-/*     case op_load_string: */
-    case op_macro_call:
-    case op_make_array:
-    case op_make_string:
-    case op_make_list:
-      return 1;
-    default:
-      return 0;
-    }
-}
-
-static int
-conditional_jump_instr_p (ttl_instruction instr)
+int
+ttl_conditional_jump_p (ttl_instruction instr)
 {
   switch (instr->op)
     {
@@ -4139,6 +4448,14 @@ conditional_jump_instr_p (ttl_instruction instr)
     case op_jump_if_not_lless:
     case op_jump_if_lgtr:
     case op_jump_if_not_lgtr:
+    case op_jump_if_variant:
+    case op_jump_if_not_variant:
+    case op_jump_if_equal_int:
+    case op_jump_if_not_equal_int:
+    case op_jump_if_less_int:
+    case op_jump_if_not_less_int:
+    case op_jump_if_gtr_int:
+    case op_jump_if_not_gtr_int:
       return 1;
     default:
       return 0;
@@ -4190,6 +4507,22 @@ complement_conditional_jump (enum ttl_op_kind kind)
       return op_jump_if_not_lgtr;
     case op_jump_if_not_lgtr:
       return op_jump_if_lgtr;
+    case op_jump_if_variant:
+      return op_jump_if_not_variant;
+    case op_jump_if_not_variant:
+      return op_jump_if_variant;
+    case op_jump_if_equal_int:
+      return op_jump_if_not_equal_int;
+    case op_jump_if_not_equal_int:
+      return op_jump_if_equal_int;
+    case op_jump_if_less_int:
+      return op_jump_if_not_less_int;
+    case op_jump_if_not_less_int:
+      return op_jump_if_less_int;
+    case op_jump_if_gtr_int:
+      return op_jump_if_not_gtr_int;
+    case op_jump_if_not_gtr_int:
+      return op_jump_if_gtr_int;
     default:
       fprintf (stderr, "Invalid Opcode in complement_conditional_jump()\n");
       abort ();
@@ -4222,6 +4555,14 @@ jump_instruction_label (ttl_instruction instr)
     case op_jump_if_not_lless:
     case op_jump_if_lgtr:
     case op_jump_if_not_lgtr:
+    case op_jump_if_variant:
+    case op_jump_if_not_variant:
+    case op_jump_if_equal_int:
+    case op_jump_if_not_equal_int:
+    case op_jump_if_less_int:
+    case op_jump_if_not_less_int:
+    case op_jump_if_gtr_int:
+    case op_jump_if_not_gtr_int:
       return instr->op0;
     default:
       fprintf (stderr, "Invalid Opcode in jump_instruction_label()\n");
@@ -4255,6 +4596,14 @@ set_jump_instruction_label (ttl_instruction instr, ttl_operand lab)
     case op_jump_if_not_lless:
     case op_jump_if_lgtr:
     case op_jump_if_not_lgtr:
+    case op_jump_if_variant:
+    case op_jump_if_not_variant:
+    case op_jump_if_equal_int:
+    case op_jump_if_not_equal_int:
+    case op_jump_if_less_int:
+    case op_jump_if_not_less_int:
+    case op_jump_if_gtr_int:
+    case op_jump_if_not_gtr_int:
       instr->op0 = lab;
       break;
     default:
@@ -4278,42 +4627,403 @@ same_operands_p (ttl_operand op0, ttl_operand op1)
     }
 }
 
+/* Per-label information for merging GC checks, indexed by label
+   number.  `label_refs' holds the number of references to a label in
+   the current function, the other arrays are only valid for a label
+   if `label_region' holds the number of the current region.  */
+static int * label_refs = NULL;
+static int * label_seen = NULL;
+static int * label_alloc = NULL;
+static int * label_region = NULL;
+static int label_capacity = 0;
+
+static int *
+grow_label_array (int * array, int capacity)
+{
+  int * a = realloc (array, capacity * sizeof (int));
+  if (!a)
+    {
+      fprintf (stderr, "grow_label_array: out of memory\n");
+      abort ();
+    }
+  memset (a + label_capacity, 0, (capacity - label_capacity) * sizeof (int));
+  return a;
+}
+
 static void
-peephole_opt (ttl_compile_state state, ttl_object obj)
+ensure_label_capacity (int count)
 {
-  ttl_instruction instr = obj->first;
+  if (count > label_capacity)
+    {
+      int capacity = count * 2;
+      label_refs = grow_label_array (label_refs, capacity);
+      label_seen = grow_label_array (label_seen, capacity);
+      label_alloc = grow_label_array (label_alloc, capacity);
+      label_region = grow_label_array (label_region, capacity);
+      label_capacity = capacity;
+    }
+}
 
-  while (instr)
+/* Return non-zero if the label operands of `instr' are references to
+   labels of the current function.  Label definitions are no
+   references, and the operands of procedure jumps, closure creations
+   and descriptor loads still refer to functions before
+   `fixup_calls' is run.  */
+static int
+refers_to_labels_p (ttl_instruction instr)
+{
+  switch (instr->op)
     {
-      if (instr->next)
-	{
-	  if (instr->op == op_gc_check &&
-	      state->compile_options->opt_merge_gc_checks)
-	    {
-	      ttl_instruction i = instr->next;
-	      int found = 0;
-	      int amount = (int) (instr->op0->data);
-	      while (i && !end_of_basic_block_p (i))
-		{
-		  if (i->op == op_gc_check)
-		    {
-		      i->prev->next = i->next;
-		      if (i->next)
-			i->next->prev = i->prev;
-		      else
-			obj->last = i->prev;
-		      found = 1;
-		      amount += (int) (i->op0->data);
-		    }
-		  i = i->next;
-		}
-	      if (found)
-		{
-		  instr->op0->data = (void *) amount;
-		}
-	      instr = instr->next;
-	      continue;
-	    }
+    case op_label:
+    case op_cont_label:
+    case op_proc_label:
+    case op_jump_proc:
+    case op_make_closure:
+    case op_load_descr:
+      return 0;
+    default:
+      return 1;
+    }
+}
+
+/* Return non-zero if the garbage collector may run while `instr' is
+   executed, or if other code may allocate before the next
+   instruction is executed.  Heap space reserved by a GC check is not
+   available after such an instruction.  */
+static int
+may_gc_p (ttl_instruction instr)
+{
+  switch (instr->op)
+    {
+    case op_cont_label:
+    case op_proc_label:
+    case op_restore_cont:
+    case op_jump_proc:
+    case op_call:
+    case op_macro_call:
+    case op_mapped_call:
+    case op_tick:
+    case op_raise:
+    case op_make_array:
+    case op_make_string:
+    case op_make_list:
+    case op_make_constrained_array:
+    case op_concat:
+    case op_coerce_to_constrained_array:
+    case op_coerce_to_constrained_list:
+    case op_add_int_constraint:
+    case op_add_real_constraint:
+    case op_resolve_int_constraint:
+    case op_resolve_real_constraint:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+/* Return the number of words actually reserved by a GC check for
+   `words' words, since all allocations are rounded to an even number
+   of words.  */
+static int
+gc_check_words (ttl_instruction instr)
+{
+  return (((int) instr->op0->data) + 1) & ~1;
+}
+
+static void
+remove_instruction (ttl_object obj, ttl_instruction instr)
+{
+  if (instr->prev)
+    instr->prev->next = instr->next;
+  else
+    obj->first = instr->next;
+  if (instr->next)
+    instr->next->prev = instr->prev;
+  else
+    obj->last = instr->prev;
+}
+
+/* Merge all GC checks in the region starting at `first' into a
+   single check.  The region extends over straight-line code and
+   forward branches, as long as every label in it is only reachable
+   from inside the region and no instruction in it may run the garbage
+   collector.  For each instruction, the maximal amount of memory
+   allocated on any path from the start of the region to it is
+   tracked, so that if/else diamonds reserve the maximum of their
+   branches.  The merged check is placed at the first GC check, or
+   before the first jump of the region if that comes earlier, so that
+   it is executed on all paths through the region.  Return the
+   instruction which ended the region.  */
+static ttl_instruction
+merge_gc_region (ttl_compile_state state, ttl_object obj,
+		 ttl_instruction first, int region)
+{
+  ttl_instruction instr = first;
+  ttl_instruction place = NULL;
+  int current = 0;
+  int maximum = 0;
+  int checks = 0;
+
+  while (instr)
+    {
+      ttl_instruction next = instr->next;
+
+      if (instr->op == op_label)
+	{
+	  int label = (int) instr->op0->data;
+	  if (label_region[label] != region)
+	    {
+	      if (label_refs[label] > 0)
+		break;
+	    }
+	  else
+	    {
+	      if (label_seen[label] != label_refs[label])
+		break;
+	      if (label_alloc[label] > current)
+		current = label_alloc[label];
+	    }
+	  /* Unreachable label.  */
+	  if (current < 0)
+	    break;
+	}
+      else if (current < 0 || may_gc_p (instr))
+	break;
+      else if (instr->op == op_gc_check)
+	{
+	  current += gc_check_words (instr);
+	  if (current > maximum)
+	    maximum = current;
+	  checks++;
+	  if (!place)
+	    place = instr;
+	  else
+	    remove_instruction (obj, instr);
+	}
+      else if (jump_instr_p (instr))
+	{
+	  int label = (int) jump_instruction_label (instr)->data;
+	  if (!place)
+	    place = instr;
+	  if (label_region[label] != region)
+	    {
+	      label_region[label] = region;
+	      label_seen[label] = 0;
+	      label_alloc[label] = -1;
+	    }
+	  label_seen[label]++;
+	  if (current > label_alloc[label])
+	    label_alloc[label] = current;
+	  if (instr->op == op_jump)
+	    current = -1;
+	}
+      instr = next;
+    }
+
+  if (checks > 0)
+    {
+      if (place->op != op_gc_check)
+	{
+	  ttl_instruction check =
+	    ttl_make_instruction (state->pool, op_gc_check,
+				  ttl_make_operand (state->pool,
+						    operand_constant,
+						    (void *) 0),
+				  NULL, NULL, -1);
+	  check->prev = place->prev;
+	  check->next = place;
+	  if (place->prev)
+	    place->prev->next = check;
+	  else
+	    obj->first = check;
+	  place->prev = check;
+	  place = check;
+	}
+      place->op0->data = (void *) maximum;
+    }
+  return instr;
+}
+
+/* Merge GC checks over regions of straight-line code and forward
+   branches, so that only the first check of each region remains,
+   reserving enough space for all allocations in the region.  */
+static void
+merge_gc_checks (ttl_compile_state state, ttl_object obj)
+{
+  static int region = 0;
+  ttl_instruction instr;
+
+  ensure_label_capacity (state->next_label);
+  for (instr = obj->first; instr; instr = instr->next)
+    {
+      if (!refers_to_labels_p (instr))
+	continue;
+      if (instr->op0 && instr->op0->op == operand_label)
+	label_refs[(int) instr->op0->data]++;
+      if (instr->op1 && instr->op1->op == operand_label)
+	label_refs[(int) instr->op1->data]++;
+    }
+  /* The loop label may also be reached from other functions.  */
+  if (state->current_function->loop_label)
+    label_refs[(int) ((ttl_operand)
+		      state->current_function->loop_label)->data]++;
+
+  instr = obj->first;
+  while (instr)
+    {
+      instr = merge_gc_region (state, obj, instr, ++region);
+      if (instr)
+	instr = instr->next;
+    }
+
+  if (state->current_function->loop_label)
+    label_refs[(int) ((ttl_operand)
+		      state->current_function->loop_label)->data] = 0;
+  for (instr = obj->first; instr; instr = instr->next)
+    {
+      if (!refers_to_labels_p (instr))
+	continue;
+      if (instr->op0 && instr->op0->op == operand_label)
+	label_refs[(int) instr->op0->data] = 0;
+      if (instr->op1 && instr->op1->op == operand_label)
+	label_refs[(int) instr->op1->data] = 0;
+    }
+}
+
+/* Return non-zero if the operands `op0' and `op1' denote the same
+   memory location.  */
+static int
+same_location_p (ttl_operand op0, ttl_operand op1)
+{
+  return op0->op == op1->op && op0->data == op1->data &&
+    op0->unsigned_data == op1->unsigned_data &&
+    (op0->op == operand_local || op0->op == operand_mem);
+}
+
+/* Return non-zero if `instr' only sets the accumulator, without
+   reading it or having any other effect.  */
+static int
+pure_load_p (ttl_instruction instr)
+{
+  switch (instr->op)
+    {
+    case op_load:
+    case op_load_int:
+    case op_load_char:
+    case op_load_null:
+    case op_load_false:
+    case op_load_true:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+/* Return the superinstruction which compares the accumulator with an
+   integer constant and jumps like the conditional jump `op', or `op'
+   itself if there is none.  */
+static enum ttl_op_kind
+int_jump_instr (enum ttl_op_kind op)
+{
+  switch (op)
+    {
+    case op_jump_if_equal:
+      return op_jump_if_equal_int;
+    case op_jump_if_not_equal:
+      return op_jump_if_not_equal_int;
+    case op_jump_if_less:
+      return op_jump_if_less_int;
+    case op_jump_if_not_less:
+      return op_jump_if_not_less_int;
+    case op_jump_if_gtr:
+      return op_jump_if_gtr_int;
+    case op_jump_if_not_gtr:
+      return op_jump_if_not_gtr_int;
+    default:
+      return op;
+    }
+}
+
+/* Remove `instr' from `obj'.  The source location of `instr' is
+   passed on to the following instruction, so that it does not get
+   lost.  */
+static void
+delete_instruction (ttl_object obj, ttl_instruction instr)
+{
+  if (instr->filename && instr->next && !instr->next->filename)
+    {
+      instr->next->filename = instr->filename;
+      instr->next->line = instr->line;
+    }
+  remove_instruction (obj, instr);
+}
+
+/* Remove redundant stack and accumulator operations in a window of
+   adjacent instructions, and replace the comparison of the
+   accumulator with an integer constant followed by a conditional jump
+   by a superinstruction:
+
+   push; pop                   =>  (nothing)
+   store X; load X             =>  store X
+   load X; store X             =>  load X
+   load X; load Y              =>  load Y
+   push; load-int #c; jcc L    =>  jcc-int L, #c
+
+   After each change, the window is moved back by one instruction, so
+   that sequences exposed by the change are found, too.  */
+static void
+window_opt (ttl_compile_state state, ttl_object obj)
+{
+  ttl_instruction instr = obj->first;
+
+  while (instr && instr->next)
+    {
+      ttl_instruction next = instr->next;
+      ttl_instruction prev = instr->prev;
+
+      if (instr->op == op_push && next->op == op_pop)
+	{
+	  delete_instruction (obj, instr);
+	  delete_instruction (obj, next);
+	}
+      else if (((instr->op == op_store && next->op == op_load) ||
+		(instr->op == op_load && next->op == op_store)) &&
+	       same_location_p (instr->op0, next->op0))
+	delete_instruction (obj, next);
+      else if (pure_load_p (instr) && pure_load_p (next))
+	delete_instruction (obj, instr);
+      else if (instr->op == op_push && next->op == op_load_int &&
+	       next->next && int_jump_instr (next->next->op) != next->next->op)
+	{
+	  ttl_instruction jump = next->next;
+	  jump->op = int_jump_instr (jump->op);
+	  jump->op1 = next->op0;
+	  delete_instruction (obj, instr);
+	  delete_instruction (obj, next);
+	}
+      else
+	{
+	  instr = next;
+	  continue;
+	}
+      instr = prev ? prev : obj->first;
+    }
+}
+
+static void
+peephole_opt (ttl_compile_state state, ttl_object obj)
+{
+  ttl_instruction instr;
+
+  if (state->compile_options->opt_peephole)
+    window_opt (state, obj);
+
+  instr = obj->first;
+
+  while (instr)
+    {
+      if (instr->next)
+	{
 	  /* At least two instructions remaining... */
 	  if (instr->next->next)
 	    {
@@ -4322,7 +5032,7 @@ peephole_opt (ttl_compile_state state, ttl_object obj)
 		j = instr->next,
 		l = instr->next->next;
 
-	      if (conditional_jump_instr_p (jif) &&
+	      if (ttl_conditional_jump_p (jif) &&
 		  j->op == op_jump &&
 		  l->op == op_label &&
 		  same_operands_p (jump_instruction_label (jif), l->op0))
@@ -4360,6 +5070,36 @@ peephole_opt (ttl_compile_state state, ttl_object obj)
 	}
       instr = instr->next;
     }
+  if (state->compile_options->opt_merge_gc_checks)
+    merge_gc_checks (state, obj);
+}
+
+/* Append a jump to `label' to `obj', which is taken if the data value
+   in the accumulator is not of variant `variant'.  `function' is a
+   discriminator, accessor or setter of the data type, and `nullary'
+   is non-zero if the variant has no fields.  The accumulator is not
+   modified.  */
+static void
+append_variant_jump (ttl_compile_state state, ttl_object obj,
+		     ttl_function function, unsigned variant,
+		     int nullary, ttl_operand label)
+{
+  ttl_operand oper = ttl_make_operand (state->pool, operand_constant,
+				       (void *) variant);
+
+  if (nullary)
+    oper->unsigned_data = variant_test_immediate;
+  else if (function->variant_count - function->nullary_count == 1)
+    oper->unsigned_data = variant_test_object;
+  else if (function->nullary_count > 0)
+    oper->unsigned_data = variant_test_object_header;
+  else
+    oper->unsigned_data = variant_test_header;
+
+  ttl_append_instruction
+    (obj,
+     ttl_make_instruction
+     (state->pool, op_jump_if_not_variant, label, oper, NULL, -1));
 }
 
 static void
@@ -4376,8 +5116,10 @@ compile_constructor_body (ttl_compile_state state, ttl_function function,
       mask >>= 1;
     }
 
-  append_gc_check (state, obj, function->d.constr_discrim.field_count + 2 +
-		   (variables * 2)); /* XXX: Must be size of variable obj.  */
+  /* Variants without fields are immediate values.  */
+  if (function->d.constr_discrim.field_count > 0)
+    append_gc_check (state, obj, function->d.constr_discrim.field_count + 2 +
+		     (variables * 2)); /* XXX: Must be size of variable obj.  */
 
   {
     ttl_operand oper = ttl_make_operand
@@ -4435,9 +5177,6 @@ compile_discriminator_body (ttl_compile_state state, ttl_function function,
       return;
     }
 
-  ttl_append_instruction
-    (obj,
-     ttl_make_instruction (state->pool, op_dup, NULL, NULL, NULL, -1));
   ttl_append_instruction
     (obj,
      ttl_make_instruction (state->pool, op_pop, NULL, NULL, NULL, -1));
@@ -4450,35 +5189,9 @@ compile_discriminator_body (ttl_compile_state state, ttl_function function,
   if (link == link_next)
     end_label = ttl_make_new_label (state);
 
-  ttl_append_instruction
-    (obj,
-     ttl_make_instruction (state->pool, op_pop, NULL, NULL, NULL, -1));
-
-  {
-    ttl_operand oper = ttl_make_operand (state->pool, operand_constant,
-					 (void *) 0);
-    ttl_append_instruction
-    (obj,
-     ttl_make_instruction
-     (state->pool, op_tuple_ref, oper, NULL, NULL, -1));
-  }
-
-  ttl_append_instruction
-    (obj,
-     ttl_make_instruction
-     (state->pool,
-      op_load_int,
-      ttl_make_operand (state->pool, operand_constant,
-			(void *) (function->d.constr_discrim.variant)),
-      NULL, NULL, -1));
-
-  ttl_append_instruction
-    (obj,
-     ttl_make_instruction
-     (state->pool,
-      op_jump_if_not_equal,
-      falsel,
-      NULL, NULL, -1));
+  append_variant_jump (state, obj, function,
+		       function->d.constr_discrim.variant,
+		       function->d.constr_discrim.field_count == 0, falsel);
 
   ttl_append_instruction
     (obj,
@@ -4550,7 +5263,7 @@ compile_accessor_body (ttl_compile_state state, ttl_function function,
       {
 	ttl_operand oper = ttl_make_operand
 	  (state->pool, operand_constant,
-	   (void *) (field_list->offset + 1));
+	   (void *) (field_list->offset));
 	ttl_append_instruction
 	  (obj,
 	   ttl_make_instruction
@@ -4578,67 +5291,24 @@ compile_accessor_body (ttl_compile_state state, ttl_function function,
       return;
     }
 
+  ttl_append_instruction
+    (obj,
+     ttl_make_instruction
+     (state->pool,
+      op_pop,
+      NULL,
+      NULL, NULL, -1));
   if (link == link_next)
     end_label = ttl_make_new_label (state);
   next_label = ttl_make_new_label (state);
   while (field_list)
     {
-      ttl_append_instruction
-	(obj,
-	 ttl_make_instruction
-	 (state->pool,
-	  op_pop,
-	  NULL,
-	  NULL, NULL, -1));
-
-      ttl_append_instruction
-	(obj,
-	 ttl_make_instruction
-	 (state->pool,
-	  op_push,
-	  NULL,
-	  NULL, NULL, -1));
-
-      {
-	ttl_operand oper = ttl_make_operand (state->pool, operand_constant,
-					     (void *) 0);
-	ttl_append_instruction
-	  (obj,
-	   ttl_make_instruction
-	   (state->pool,
-	    op_tuple_ref,
-	    oper,
-	    NULL, NULL, -1));
-      }
-
-      ttl_append_instruction
-	(obj,
-	 ttl_make_instruction
-	 (state->pool,
-	  op_load_int,
-	  ttl_make_operand (state->pool, operand_constant,
-			    (void *) (field_list->variant)),
-	  NULL, NULL, -1));
-
-      ttl_append_instruction
-	(obj,
-	 ttl_make_instruction
-	 (state->pool,
-	  op_jump_if_not_equal,
-	  next_label,
-	  NULL, NULL, -1));
-
-      ttl_append_instruction
-	(obj,
-	 ttl_make_instruction
-	 (state->pool,
-	  op_pop,
-	  NULL,
-	  NULL, NULL, -1));
+      append_variant_jump (state, obj, function, field_list->variant, 0,
+			   next_label);
       {
 	ttl_operand oper = ttl_make_operand
 	  (state->pool, operand_constant,
-	   (void *) (field_list->offset + 1));
+	   (void *) (field_list->offset));
 	ttl_append_instruction
 	  (obj,
 	   ttl_make_instruction
@@ -4678,13 +5348,6 @@ compile_accessor_body (ttl_compile_state state, ttl_function function,
     }
   ttl_append_instruction (obj, ttl_make_label_stmt (state, next_label));
 
-  ttl_append_instruction
-    (obj,
-     ttl_make_instruction
-     (state->pool,
-      op_drop,
-      NULL,
-      NULL, NULL, -1));
   ttl_append_instruction
     (obj,
      ttl_make_instruction
@@ -4754,7 +5417,7 @@ compile_setter_body (ttl_compile_state state, ttl_function function,
 	     (state->pool,
 	      op_tuple_ref,
 	      ttl_make_operand (state->pool, operand_constant,
-				(void *) (field_list->offset + 1)),
+				(void *) (field_list->offset)),
 	      NULL, NULL, -1));
 	  ttl_append_instruction
 	    (obj,
@@ -4786,7 +5449,7 @@ compile_setter_body (ttl_compile_state state, ttl_function function,
 	     (state->pool,
 	      op_tuple_set,
 	      ttl_make_operand (state->pool, operand_constant,
-				(void *) (field_list->offset + 1)),
+				(void *) (field_list->offset)),
 	      NULL, NULL, -1));
 	}
       compile_link (state, obj, link, target);
@@ -4797,49 +5460,8 @@ compile_setter_body (ttl_compile_state state, ttl_function function,
     end_label = ttl_make_new_label (state);
   while (field_list)
     {
-      ttl_append_instruction
-	(obj,
-	 ttl_make_instruction
-	 (state->pool,
-	  op_over,
-	  NULL,
-	  NULL, NULL, -1));
-      ttl_append_instruction
-	(obj,
-	 ttl_make_instruction
-	 (state->pool,
-	  op_pop,
-	  NULL,
-	  NULL, NULL, -1));
-
-      {
-	ttl_operand oper = ttl_make_operand (state->pool, operand_constant,
-					     (void *) 0);
-	ttl_append_instruction
-	  (obj,
-	   ttl_make_instruction
-	   (state->pool,
-	    op_tuple_ref,
-	    oper,
-	    NULL, NULL, -1));
-      }
-
-      ttl_append_instruction
-	(obj,
-	 ttl_make_instruction
-	 (state->pool,
-	  op_load_int,
-	  ttl_make_operand (state->pool, operand_constant,
-			    (void *) (field_list->variant)),
-	  NULL, NULL, -1));
-
-      ttl_append_instruction
-	(obj,
-	 ttl_make_instruction
-	 (state->pool,
-	  op_jump_if_not_equal,
-	  next_label,
-	  NULL, NULL, -1));
+      append_variant_jump (state, obj, function, field_list->variant, 0,
+			   next_label);
 
 #if AUTO_DEREF
       if (field_list->constrainable)
@@ -4860,7 +5482,7 @@ compile_setter_body (ttl_compile_state state, ttl_function function,
 	     (state->pool,
 	      op_tuple_ref,
 	      ttl_make_operand (state->pool, operand_constant,
-				(void *) (field_list->offset + 1)),
+				(void *) (field_list->offset)),
 	      NULL, NULL, -1));
 	  ttl_append_instruction
 	    (obj,
@@ -4895,7 +5517,7 @@ compile_setter_body (ttl_compile_state state, ttl_function function,
 	     (state->pool,
 	      op_tuple_set,
 	      ttl_make_operand (state->pool, operand_constant,
-				(void *) (field_list->offset + 1)),
+				(void *) (field_list->offset)),
 	      NULL, NULL, -1));
 	}
       if (link == link_next)
@@ -4961,6 +5583,147 @@ compile_setter (ttl_compile_state state, ttl_function function)
   function->asm_code = obj;
 }
 
+/* Return non-zero if `function' is `ancestor' or is nested
+   (transitively) inside of it.  */
+static int
+nested_in_p (ttl_function function, ttl_function ancestor)
+{
+  while (function)
+    {
+      if (function == ancestor)
+	return 1;
+      function = function->enclosing;
+    }
+  return 0;
+}
+
+/* Return non-zero if the IL code `node' refers to a parameter, local
+   variable or nested function which is not defined inside of
+   `function'.  Code which cannot be analyzed is considered to have
+   free references.  */
+static int
+free_references_p (ttl_il_node node, ttl_function function)
+{
+  if (!node)
+    return 0;
+
+  switch (node->kind)
+    {
+    case il_pair:
+      return free_references_p (node->d.pair.car, function) ||
+	free_references_p (node->d.pair.cdr, function);
+
+    case il_variable:
+      if (node->d.variable.variable &&
+	  node->d.variable.variable->kind != variable_global)
+	return !nested_in_p (node->d.variable.variable->defining, function);
+      return 0;
+
+    case il_function:
+      {
+	ttl_function f = node->d.function.function;
+	return f->enclosing && !nested_in_p (f, function);
+      }
+
+    case il_string_const:
+    case il_char_const:
+    case il_int_const:
+    case il_long_const:
+    case il_real_const:
+    case il_bool_const:
+    case il_null_const:
+      return 0;
+
+    case il_binop:
+      return free_references_p (node->d.binop.op0, function) ||
+	free_references_p (node->d.binop.op1, function);
+
+    case il_unop:
+      return free_references_p (node->d.unop.op0, function);
+
+    case il_if:
+      return free_references_p (node->d.ifstmt.cond, function) ||
+	free_references_p (node->d.ifstmt.thenstmt, function) ||
+	free_references_p (node->d.ifstmt.elsestmt, function);
+
+    case il_while:
+      return free_references_p (node->d.whilestmt.cond, function) ||
+	free_references_p (node->d.whilestmt.dostmt, function);
+
+    case il_in:
+      return free_references_p (node->d.instmt.instmt, function);
+
+    case il_call:
+      return free_references_p (node->d.call.function, function) ||
+	free_references_p (node->d.call.args, function);
+
+    case il_index:
+      return free_references_p (node->d.index.array, function) ||
+	free_references_p (node->d.index.index, function);
+
+    case il_return:
+      return free_references_p (node->d.returnstmt.expr, function);
+
+    case il_array_expr:
+      return free_references_p (node->d.array_expr.elements, function);
+
+    case il_list_expr:
+      return free_references_p (node->d.list_expr.elements, function);
+
+    case il_tuple_expr:
+      return free_references_p (node->d.tuple_expr.elements, function);
+
+    case il_array_constructor:
+      return free_references_p (node->d.array_constructor.size, function) ||
+	free_references_p (node->d.array_constructor.initial, function);
+
+    case il_list_constructor:
+      return free_references_p (node->d.list_constructor.size, function) ||
+	free_references_p (node->d.list_constructor.initial, function);
+
+    case il_string_constructor:
+      return free_references_p (node->d.string_constructor.size,
+				function) ||
+	free_references_p (node->d.string_constructor.initial, function);
+
+    case il_seq:
+      return free_references_p (node->d.seq.stmts, function);
+
+    case il_ann_expr:
+      return free_references_p (node->d.ann_expr.expr, function);
+
+    case il_var_expr:
+      return free_references_p (node->d.var_expr.expr, function);
+
+    case il_deref_expr:
+      return free_references_p (node->d.deref_expr.expr, function);
+
+    default:
+      /* Foreign expressions may access the environment directly, and
+	 constraint code is too hairy to be analyzed here.  */
+      return 1;
+    }
+}
+
+/* Return non-zero if neither `function' nor any of the functions
+   nested inside of it refer to variables or functions outside of
+   `root'.  Such functions do not need a closure, their descriptor can
+   be used as a function value directly.  */
+static int
+closed_function_p (ttl_function function, ttl_function root)
+{
+  ttl_function f;
+
+  if (function->kind != function_function ||
+      function->d.function.handcoded || function->d.function.mapped ||
+      free_references_p ((ttl_il_node) function->d.function.il_code, root))
+    return 0;
+  for (f = function->enclosed; f; f = f->next)
+    if (!closed_function_p (f, root))
+      return 0;
+  return 1;
+}
+
 static void
 compile_function (ttl_compile_state state, ttl_function function)
 {
@@ -4988,8 +5751,21 @@ compile_function (ttl_compile_state state, ttl_function function)
     }
 
   ttl_append_instruction (obj, entry_instr);
+
+  /* The arguments of leaf functions are passed on the stack directly
+     to the C function, there is no need for an environment.  */
+  if (leaf_function_p (function))
+    {
+      append_leaf_call (state, obj, function, NULL);
+      ttl_append_instruction
+	(obj,
+	 ttl_make_instruction (state->pool, op_restore_cont, NULL, NULL,
+			       NULL, -1));
+      function->asm_code = obj;
+      return;
+    }
 #if 1
-  if (!function->enclosing)
+  if (!function->enclosing || function->closed)
     ttl_append_instruction (obj,
 			    ttl_make_instruction (state->pool,
 						  op_null_env_reg,
@@ -5111,6 +5887,9 @@ compile_function (ttl_compile_state state, ttl_function function)
     }
   else
     {
+      if (tail_loop_function_p (state, function))
+	ttl_append_instruction
+	  (obj, ttl_make_label_stmt (state, loop_label (state, function)));
 #if TICKS
       tick_lab = ttl_make_new_label (state);
       append_gc_check (state, obj, 5);
@@ -5150,6 +5929,17 @@ ttl_generate_code (ttl_compile_state state, ttl_module module)
       function = function->next;
     }
 
+  if (state->compile_options->opt_static_closures)
+    {
+      function = module->functions;
+      while (function)
+	{
+	  if (function->enclosing)
+	    function->closed = closed_function_p (function, function);
+	  function = function->total_next;
+	}
+    }
+
   function = module->functions;
   while (function)
     {
@@ -154,7 +154,36 @@ enum ttl_op_kind
    op_variable_set,
    op_coerce_to_constrained_array,
    op_coerce_to_constrained_list,
-   op_load_foreign
+   op_load_foreign,
+   op_load_descr,
+   op_return_values,
+   op_receive_values,
+   op_jump_if_variant,
+   op_jump_if_not_variant,
+   op_leaf_call,
+   op_aload_unchecked,
+   op_astore_unchecked,
+   op_sload_unchecked,
+   op_sstore_unchecked,
+   op_jump_if_equal_int,
+   op_jump_if_not_equal_int,
+   op_jump_if_less_int,
+   op_jump_if_not_less_int,
+   op_jump_if_gtr_int,
+   op_jump_if_not_gtr_int
+  };
+
+/* How `op_jump_if_variant' and `op_jump_if_not_variant' determine
+   the variant of the data value in the accumulator.  */
+enum ttl_variant_test
+  {
+   variant_test_immediate,	/* Variant without fields, compare
+				   with the immediate value.  */
+   variant_test_object,		/* Only variant with fields, check for
+				   object tag.  */
+   variant_test_header,		/* Compare variant from header.  */
+   variant_test_object_header	/* Like above, but value may be
+				   immediate.  */
   };
 
 typedef struct ttl_instruction * ttl_instruction;
@@ -186,6 +215,9 @@ ttl_object ttl_make_object (ttl_pool pool);
 
 void ttl_append_instruction (ttl_object obj, ttl_instruction instr);
 
+/* Return non-zero if `instr' is a conditional jump.  */
+int ttl_conditional_jump_p (ttl_instruction instr);
+
 void ttl_generate_code (ttl_compile_state state, ttl_module module);
 
 #endif /* not TTL_CODEGEN_H */
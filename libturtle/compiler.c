@@ -21,6 +21,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include <version.h>
@@ -35,6 +36,11 @@
 #include "il.h"
 #include "codegen.h"
 #include "emit-c.h"
+#include "inline.h"
+#include "fold.h"
+#include "bounds.h"
+#include "fuse.h"
+#include "profile.h"
 
 
 static int in_lvalue_position = 0;
@@ -50,6 +56,12 @@ already_defined (ttl_compile_state state, ttl_environment env,
 
 static ttl_type translate_type (ttl_compile_state state, ttl_ast_node type);
 static ttl_il_node translate_stmt (ttl_compile_state state, ttl_ast_node stmt);
+static ttl_il_node translate_stmt_list (ttl_compile_state state,
+				       ttl_ast_node stmts);
+static ttl_il_node translate_singleton_expr
+  (ttl_compile_state state, ttl_ast_node expr,
+   int (*type_pred)(ttl_compile_state, ttl_type));
+static int is_current_return_type (ttl_compile_state state, ttl_type type);
 static ttl_binding_list lookup_qualident (ttl_compile_state state,
 					  ttl_module module,
 					  ttl_environment env,
@@ -266,6 +278,336 @@ substitute (ttl_compile_state state, ttl_ast_node formals,
   return type;
 }
 
+/* Return non-zero if `type' may be passed to or returned from a
+   leaf function, that is, if it has a direct C representation.  */
+static int
+leaf_scalar_type_p (ttl_type type, int result_p)
+{
+  switch (type->kind)
+    {
+    case type_void:
+      return result_p;
+    case type_integer:
+    case type_long:
+    case type_real:
+    case type_bool:
+    case type_char:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+/* Return non-zero if the function type `type' is acceptable for a
+   leaf function.  */
+static int
+leaf_function_type_p (ttl_type type)
+{
+  unsigned i;
+
+  for (i = 0; i < type->d.function.param_type_count; i++)
+    if (!leaf_scalar_type_p (type->d.function.param_types[i], 0))
+      return 0;
+  return leaf_scalar_type_p (type->d.function.return_type, 1);
+}
+
+/* Create the parameters of the inlinable imported function `fun' from
+   the parameter names given in its definition `def', and bind them in
+   the current environment.  */
+static ttl_variable
+import_inline_params (ttl_compile_state state, ttl_ast_node def,
+		      ttl_function fun)
+{
+  ttl_ast_node names = def->d.function.inline_params;
+  ttl_variable params = NULL, * pp = &params;
+  unsigned i = 0;
+
+  while (names)
+    {
+      ttl_ast_node name = names->d.pair.car;
+      ttl_variable var =
+	ttl_make_variable (state->pool, variable_param,
+			   fun->type->d.function.param_types[i], 0);
+
+      var->name = name->d.identifier.symbol;
+      var->unique_name = ttl_uniquify_name (state, name);
+      var->index = i;
+      var->defining = fun;
+      ttl_environment_add (state->env,
+			   ttl_make_variable_binding (state->pool, var->name,
+						      var->unique_name, var));
+      *pp = var;
+      pp = &var->next;
+      names = names->d.pair.cdr;
+      i++;
+    }
+  return params;
+}
+
+/* Translate the body of the inlinable imported function `def' into
+   intermediate code and attach it to `fun', so that calls to `fun'
+   can be inlined.  The body is dropped if it does not translate
+   cleanly.  */
+static void
+import_inline_body (ttl_compile_state state, ttl_ast_node def,
+		    ttl_function fun)
+{
+  ttl_environment old_env = state->env;
+  ttl_function old_function = state->current_function;
+  ttl_type old_return_type = state->current_return_type;
+  unsigned old_errors = state->errors;
+  ttl_variable params;
+  ttl_il_node expr;
+
+  if (ttl_ast_length (def->d.function.inline_params) !=
+      fun->type->d.function.param_type_count)
+    return;
+  state->env = ttl_environment_make (state->pool, state->env);
+  params = import_inline_params (state, def, fun);
+  state->current_function = fun;
+  state->current_return_type = fun->type->d.function.return_type;
+  expr = translate_singleton_expr (state, def->d.function.inline_body,
+				   is_current_return_type);
+  if (state->errors == old_errors)
+    {
+      fun->params = params;
+      fun->param_count = fun->type->d.function.param_type_count;
+      fun->d.function.il_code =
+	ttl_make_il_pair (state,
+			  ttl_make_il_return (state, expr, NULL,
+					      -1, -1, -1, -1),
+			  NULL);
+    }
+  else
+    state->errors = old_errors;
+  state->env = old_env;
+  state->current_function = old_function;
+  state->current_return_type = old_return_type;
+}
+
+/* Translate the statements making up the body of the imported
+   function `def' into intermediate code and attach them to `fun', so
+   that calls to `fun' can be inlined or specialized.  The module
+   parameters `formals' are bound to the types `actuals' while
+   translating, and `fun' must already be bound, because the body may
+   call it recursively.  Functions nested in the body only stay
+   reachable from `fun', they are not compiled into the importing
+   module.  The body is dropped if it does not translate cleanly.  */
+static void
+import_inline_stmts (ttl_compile_state state, ttl_ast_node def,
+		     ttl_function fun, ttl_ast_node formals,
+		     ttl_ast_node actuals)
+{
+  ttl_environment old_env = state->env;
+  ttl_function old_function = state->current_function;
+  ttl_ast_node old_function_ast = state->current_function_ast;
+  ttl_type old_return_type = state->current_return_type;
+  int old_tail = state->tail_position;
+  unsigned old_errors = state->errors;
+  ttl_variable params, var;
+  ttl_function * nested;
+  ttl_il_node body;
+  int i;
+
+  if (ttl_ast_length (def->d.function.inline_params) !=
+      fun->type->d.function.param_type_count)
+    return;
+  state->env = ttl_environment_make (state->pool, state->env);
+  while (formals && actuals)
+    {
+      ttl_symbol name = formals->d.pair.car->d.identifier.symbol;
+
+      ttl_environment_add
+	(state->env,
+	 ttl_make_type_binding (state->pool, name, name,
+				translate_type (state, actuals->d.pair.car)));
+      formals = formals->d.pair.cdr;
+      actuals = actuals->d.pair.cdr;
+    }
+  params = import_inline_params (state, def, fun);
+  fun->locals = NULL;
+  fun->enclosed = NULL;
+  nested = &state->current_module->functions;
+  while (*nested)
+    nested = &((*nested)->total_next);
+  state->current_function = fun;
+  state->current_function_ast = def;
+  state->current_return_type = fun->type->d.function.return_type;
+  state->tail_position = 1;
+  state->nesting_level++;
+  body = translate_stmt_list (state, def->d.function.inline_body);
+  state->nesting_level--;
+  *nested = NULL;
+  if (state->errors == old_errors)
+    {
+      i = 0;
+      fun->params = params;
+      for (var = fun->params; var; var = var->next)
+	var->index = i++;
+      fun->param_count = i;
+      for (var = fun->locals; var; var = var->next)
+	{
+	  var->defining = fun;
+	  var->index = i++;
+	}
+      fun->local_count = i - fun->param_count;
+      fun->d.function.il_code = body;
+    }
+  else
+    {
+      state->errors = old_errors;
+      fun->locals = NULL;
+      fun->enclosed = NULL;
+    }
+  state->env = old_env;
+  state->current_function = old_function;
+  state->current_function_ast = old_function_ast;
+  state->current_return_type = old_return_type;
+  state->tail_position = old_tail;
+}
+
+/* Create the function object for the function definition `def' from
+   the interface file of `module', which has the type `type'.  */
+static ttl_function
+import_function (ttl_compile_state state, ttl_ast_node def, ttl_type type,
+		 ttl_module module)
+{
+  ttl_function fun = ttl_make_function (state->pool, function_function,
+					type);
+
+  fun->name = def->d.function.name->d.identifier.symbol;
+  fun->module = module;
+  if (def->d.function.mapped)
+    {
+      fun->d.function.mapped = 1;
+      fun->d.function.leaf = def->d.function.leaf;
+      fun->d.function.alias = def->d.function.alias;
+    }
+  /* The bodies are needed for inlining, and for writing the bodies of
+     functions which call `fun' into the interface file.  */
+  else if (def->d.function.inline_body && !def->d.function.inline_stmts)
+    import_inline_body (state, def, fun);
+  return fun;
+}
+
+static ttl_field_list field_cons (ttl_pool pool, ttl_symbol name,
+				  ttl_ast_node identifier, ttl_type type,
+				  int variant, int offset, int constrainable,
+				  enum ttl_function_kind function_kind,
+				  ttl_field_list next);
+
+/* Create the data type function of type `type' described by `layout',
+   which is the data type function kind, the word `fixed' for accessors
+   of fields which are never changed, the number of variants and of
+   variants without fields, followed by the variant, the field count
+   and the constraint mask for constructors and discriminators, and by
+   the variant, offset and constrainability of each field for accessors
+   and setters.  Return NULL if the layout is not valid.  */
+static ttl_function
+import_data_function (ttl_compile_state state, ttl_ast_node layout,
+		      ttl_type type)
+{
+  static const struct
+  {
+    char * name;
+    enum ttl_function_kind kind;
+  } kinds[] =
+    {{"constructor", function_constructor},
+     {"discriminator", function_discriminator},
+     {"accessor", function_accessor},
+     {"setter", function_setter}};
+  ttl_symbol kind = layout->d.pair.car->d.identifier.symbol;
+  long values[3 * 256 + 2];
+  unsigned fixed = 0, count = 0, i;
+  ttl_function fun;
+
+  for (i = 0; i < sizeof (kinds) / sizeof (kinds[0]); i++)
+    if (kind == ttl_symbol_enter (state->symbol_table, kinds[i].name,
+				  strlen (kinds[i].name)))
+      break;
+  if (i == sizeof (kinds) / sizeof (kinds[0]))
+    return NULL;
+  fun = ttl_make_function (state->pool, kinds[i].kind, type);
+  layout = layout->d.pair.cdr;
+  if (layout && layout->d.pair.car->kind == ast_identifier)
+    {
+      fixed = 1;
+      layout = layout->d.pair.cdr;
+    }
+  for (; layout; layout = layout->d.pair.cdr)
+    {
+      if (count == sizeof (values) / sizeof (values[0]))
+	return NULL;
+      values[count++] = layout->d.pair.car->d.integer.value;
+    }
+  if (count < 5 || (count - 2) % 3 != 0)
+    return NULL;
+  fun->variant_count = values[0];
+  fun->nullary_count = values[1];
+  switch (fun->kind)
+    {
+    case function_constructor:
+    case function_discriminator:
+      if (count != 5)
+	return NULL;
+      fun->d.constr_discrim.variant = values[2];
+      fun->d.constr_discrim.field_count = values[3];
+      fun->d.constr_discrim.constraint_mask = values[4];
+      break;
+    default:
+      fun->d.accessor.fixed = fixed;
+      for (i = count; i > 2; i -= 3)
+	fun->d.accessor.field_list =
+	  field_cons (state->pool, NULL, NULL, type, values[i - 3],
+		      values[i - 2], values[i - 1], fun->kind,
+		      fun->d.accessor.field_list);
+      break;
+    }
+  return fun;
+}
+
+/* Bind the function `def' of type `type' from an interface file, which
+   is only called by the bodies of inlinable functions, in the current
+   environment, which is left when the module is imported.  It is
+   named by its C name and is either a data type function of the
+   module, given by its layout, or a function of another module.  That
+   module is added to the modules imported by the current module, so
+   that the function is declared in the generated code.  */
+static void
+import_hidden_function (ttl_compile_state state, ttl_ast_node def,
+			ttl_type type)
+{
+  ttl_symbol name = def->d.function.name->d.identifier.symbol;
+  ttl_function fun;
+
+  if (def->d.function.external)
+    {
+      ttl_module mod = ttl_module_find (def->d.function.external,
+					state->all_modules);
+
+      if (!mod)
+	return;
+      if (!ttl_module_find (def->d.function.external,
+			    state->current_module->imported))
+	state->current_module->imported =
+	  ttl_module_cons (state->pool, mod,
+			   state->current_module->imported);
+      fun = ttl_make_function (state->pool, function_function, type);
+    }
+  else
+    {
+      fun = import_data_function (state, def->d.function.data_layout,
+				  type);
+      if (!fun)
+	return;
+    }
+  fun->name = name;
+  fun->unique_name = name;
+  ttl_environment_add (state->env,
+		       ttl_make_function_binding (state->pool, name, name,
+						  fun, 1));
+}
+
 /* Instantiate the module `imp_module' with the parameters `actuals'
    and install the resulting module in the environment of
    `main_module'.  `type_bindings' holds a binding list of all types
@@ -544,8 +886,18 @@ import_module (ttl_compile_state state, ttl_module imp_module,
 		tp1 = state->void_type;
 		tp = state->void_type;
 	      }
-	    if (tp->kind != type_error)
+	    if (def->d.function.data_layout || def->d.function.external)
+	      {
+		if (tp->kind != type_error && (do_subst || !formals) &&
+		    (state->compile_options->opt_inline ||
+		     state->compile_options->opt_specialize))
+		  import_hidden_function (state, def, tp);
+	      }
+	    else if (tp->kind != type_error)
 	      {
+		ttl_function fun = import_function (state, def, tp,
+						     imp_module);
+
 		if (tp1->kind == type_error)
 		  tp1 = state->void_type;
 		ttl_environment_add
@@ -554,8 +906,7 @@ import_module (ttl_compile_state state, ttl_module imp_module,
 		   (state->pool,
 		    name->d.identifier.symbol,
 		    ttl_mangle_name (state, mod_name, name, tp1), 
-		    ttl_make_function (state->pool, function_function, tp),
-		    1));
+		    fun, 1));
 		{
 		  ttl_ast_node l = open_list;
 
@@ -573,10 +924,13 @@ import_module (ttl_compile_state state, ttl_module imp_module,
 			   (state->pool,
 			    name->d.identifier.symbol,
 			    ttl_mangle_name (state, mod_name, name, tp1),
-			    ttl_make_function (state->pool, function_function,
-					       tp), 1));
+			    fun, 1));
 		    }
 		}
+		if (def->d.function.inline_stmts && (do_subst || !formals) &&
+		    (state->compile_options->opt_inline ||
+		     state->compile_options->opt_specialize))
+		  import_inline_stmts (state, def, fun, formals, actuals);
 	      }
 	    break;
 	  default:
@@ -590,13 +944,16 @@ import_module (ttl_compile_state state, ttl_module imp_module,
   }
 }
 
+static ttl_module load_module (ttl_compile_state state,
+			       ttl_ast_node mod_name);
+
 /* Load the interface for the module named `mod_name', create a module
    object for the module and add it to the list of loaded modules.  If
    the module already was loaded, the old module object is returned.
    The modules imprted by the module `mod_name' are also loaded
    (transitively), until all required modules are in memory.  */
 static ttl_module
-load_module (ttl_compile_state state, ttl_ast_node mod_name)
+load_module_1 (ttl_compile_state state, ttl_ast_node mod_name)
 {
   char * fname, * p;
   FILE * f;
@@ -765,6 +1122,18 @@ load_module (ttl_compile_state state, ttl_ast_node mod_name)
   return module;
 }
 
+/* Like `load_module_1', but account the time to the interface loading
+   phase.  */
+static ttl_module
+load_module (ttl_compile_state state, ttl_ast_node mod_name)
+{
+  enum ttl_phase previous = ttl_enter_phase (state, phase_load);
+  ttl_module module = load_module_1 (state, mod_name);
+
+  ttl_leave_phase (state, previous);
+  return module;
+}
+
 
 static void
 write_interface (ttl_compile_state state, ttl_ast_node module)
@@ -880,7 +1249,9 @@ write_interface (ttl_compile_state state, ttl_ast_node module)
   }
   fprintf (ifc_f, ")\n");
 
-  fprintf (ifc_f, "\n// Public functions and variables:\n");
+  fprintf (ifc_f, "\n");
+  ttl_inline_print_callees (ifc_f, state, state->current_module);
+  fprintf (ifc_f, "// Public functions and variables:\n");
 
   {
     ttl_function f = state->current_module->toplevel_functions;
@@ -924,6 +1295,17 @@ write_interface (ttl_compile_state state, ttl_ast_node module)
 	    ttl_symbol_print (ifc_f, f->name);
 	    fprintf (ifc_f, " fun ");
 	    ttl_print_type (ifc_f, f->type);
+	    if (f->kind == function_function && f->d.function.leaf)
+	      {
+		fprintf (ifc_f, " = leaf \"");
+		ttl_symbol_print (ifc_f, f->d.function.alias);
+		fprintf (ifc_f, "\"");
+	      }
+	    else if (ttl_inline_exportable_p (state->current_module, f))
+	      {
+		fprintf (ifc_f, " = ");
+		ttl_inline_print_body (ifc_f, f);
+	      }
 	    fprintf (ifc_f, "\n");
 	  }
 	f = f->next;
@@ -1522,13 +1904,26 @@ define_datatype (ttl_compile_state state, ttl_ast_node datatype)
     ttl_ast_node variants = datatype->d.datatype.variants;
     size_t variant_number = 0;
     size_t variant_count = 0;
+    size_t nullary_count = 0;
     ttl_field_list field_list = NULL;
 
     while (variants)
       {
 	variant_count++;
+	if (variants->d.pair.car->d.datatype_variant.fields == NULL)
+	  nullary_count++;
 	variants = variants->d.pair.cdr;
       }
+    /* The variant number is stored in the upper bits of the object
+       header, see TTL_MAKE_DATA_HEADER in libturtlert.h.  */
+    if (variant_count > 256)
+      {
+	state->errors++;
+	ttl_error_print_location (stderr, datatype->d.datatype.name);
+	ttl_error_print_string (stderr, "too many variants in data type: ");
+	ttl_error_print_node (stderr, datatype->d.datatype.name);
+	ttl_error_print_nl (stderr);
+      }
     variants = datatype->d.datatype.variants;
     while (variants)
       {
@@ -1577,6 +1972,7 @@ define_datatype (ttl_compile_state state, ttl_ast_node datatype)
 					     variant_name, type);
 	func->d.constr_discrim.variant = variant_number;
 	func->variant_count = variant_count;
+	func->nullary_count = nullary_count;
 	func->d.constr_discrim.field_count = ttl_ast_length
 	  (variant->d.datatype_variant.fields);
 	func->d.constr_discrim.constraint_mask = variant_mask;
@@ -1631,6 +2027,7 @@ define_datatype (ttl_compile_state state, ttl_ast_node datatype)
 	     type);
 	  func->d.constr_discrim.variant = variant_number;
 	  func->variant_count = variant_count;
+	  func->nullary_count = nullary_count;
 	  func->d.constr_discrim.field_count = ttl_ast_length
 	    (variant->d.datatype_variant.fields);
 	  func->exported = exported;
@@ -1743,7 +2140,8 @@ define_datatype (ttl_compile_state state, ttl_ast_node datatype)
 					       list->identifier, list->type);
 	  func->exported = exported;
 	  /* 	  func->d.accessor.variant = list->variant; */
-	  /* 	  func->variant_count = variant_count; */
+	  func->variant_count = variant_count;
+	  func->nullary_count = nullary_count;
 	  func->d.accessor.field_list = list;
 	  {
 	    ttl_function * fp =
@@ -2295,7 +2693,9 @@ define_fundef (ttl_compile_state state, ttl_ast_node function)
     }
   else
     {
-      if (!state->pragma_handcoded)
+      /* Leaf functions need no implementation file, so they are
+	 allowed in all modules.  */
+      if (!state->pragma_handcoded && !function->d.function.leaf)
 	{
 	  ttl_error_print_location (stderr, function);
 	  ttl_error_print_string
@@ -2319,8 +2719,20 @@ define_fundef (ttl_compile_state state, ttl_ast_node function)
       else
 	{
 	  state->current_function->d.function.mapped = 1;
+	  state->current_function->d.function.leaf =
+	    function->d.function.leaf;
 	  state->current_function->d.function.alias =
 	    function->d.function.alias;
+	  if (function->d.function.leaf &&
+	      !leaf_function_type_p (state->current_function->type))
+	    {
+	      ttl_error_print_location (stderr, function);
+	      ttl_error_print_string
+		(stderr,
+		 "leaf functions may only have int, long, real, char and bool parameters and results");
+	      ttl_error_print_nl (stderr);
+	      state->errors++;
+	    }
 	}
       b = NULL;
     }
@@ -5331,6 +5743,7 @@ make_compile_state (ttl_pool pool, char * filename,
 		    struct ttl_compile_options * options)
 {
   ttl_compile_state state;
+  int i;
 
   state = ttl_malloc (pool, sizeof (struct ttl_compile_state));
   state->errors = 0;
@@ -5377,6 +5790,17 @@ make_compile_state (ttl_pool pool, char * filename,
   state->next_label = 0;
 
   state->complain_unbound_types = 1;
+
+  state->profile = NULL;
+
+  state->phase = phase_setup;
+  state->phase_start = 0.0;
+  state->phase_bytes = 0;
+  for (i = 0; i < phase_count; i++)
+    {
+      state->phase_time[i] = 0.0;
+      state->phase_memory[i] = 0;
+    }
  
   state->compile_options = options;
   return state;
@@ -5447,6 +5871,91 @@ prepare_dependencies (ttl_compile_state state, ttl_ast_node module,
   return 0;
 }
 
+/* Return the current time in milliseconds.  */
+static double
+now_ms (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/* Charge the time and pool memory since the last phase change to the
+   running phase.  */
+static void
+charge_phase (ttl_compile_state state)
+{
+  double now = now_ms ();
+
+  state->phase_time[state->phase] += now - state->phase_start;
+  state->phase_memory[state->phase] +=
+    (long) ttl_allocated_bytes - (long) state->phase_bytes;
+  state->phase_start = now;
+  state->phase_bytes = ttl_allocated_bytes;
+}
+
+enum ttl_phase
+ttl_enter_phase (ttl_compile_state state, enum ttl_phase phase)
+{
+  enum ttl_phase previous = state->phase;
+
+  if (state->compile_options->pragma_time_report)
+    charge_phase (state);
+  state->phase = phase;
+  return previous;
+}
+
+void
+ttl_leave_phase (ttl_compile_state state, enum ttl_phase previous)
+{
+  if (state->compile_options->pragma_time_report)
+    charge_phase (state);
+  state->phase = previous;
+}
+
+static char * phase_names[phase_count] =
+  {
+    "setup",
+    "parsing",
+    "compiling imports",
+    "interface loading",
+    "translation",
+    "optimization",
+    "code generation",
+    "C emission",
+    "gcc compile",
+    "gcc shared library",
+    "gcc link"
+  };
+
+/* Print the time and pool memory spent in each phase of compiling
+   the current file to stderr, for the pragma `time-report'.  Phases
+   which were not entered are left out.  */
+static void
+print_time_report (ttl_compile_state state)
+{
+  double total_time = 0.0;
+  long total_memory = 0;
+  int i;
+
+  charge_phase (state);
+  fprintf (stderr, "time report for %s:\n", state->filename);
+  fprintf (stderr, "  %-20s %12s %12s\n", "phase", "time (ms)",
+	   "memory (KB)");
+  for (i = 0; i < phase_count; i++)
+    {
+      if (state->phase_time[i] == 0.0 && state->phase_memory[i] == 0)
+	continue;
+      fprintf (stderr, "  %-20s %12.2f %12ld\n", phase_names[i],
+	       state->phase_time[i], state->phase_memory[i] / 1024);
+      total_time += state->phase_time[i];
+      total_memory += state->phase_memory[i];
+    }
+  fprintf (stderr, "  %-20s %12.2f %12ld\n", "total", total_time,
+	   total_memory / 1024);
+}
+
 /* Parse the Turtle module from the file `filename', and return the
    abstract syntax tree for it.  If the file cannot be opened or a
    severe parsing error occurs, NULL is returned instead.  */
@@ -5456,6 +5965,7 @@ read_module (ttl_compile_state state, char * filename)
   FILE * f;
   ttl_scanner scanner;
   ttl_ast_node module;
+  enum ttl_phase previous;
 
   f = fopen (filename, "r");
   if (!f)
@@ -5465,8 +5975,10 @@ read_module (ttl_compile_state state, char * filename)
     }
   if (state->compile_options->verbose > 0)
     printf ("parsing...\n");
+  previous = ttl_enter_phase (state, phase_parse);
   scanner = ttl_make_scanner (state->pool, state->symbol_table, f, filename);
   module = ttl_parse_module (state->pool, scanner);
+  ttl_leave_phase (state, previous);
   fclose (f);
   state->errors += scanner->scan_errors + scanner->parse_errors;
   return module;
@@ -5491,10 +6003,15 @@ ttl_compile (char * filename, struct ttl_compile_options * options)
   ttl_compile_state state;
   ttl_ast_node module;
   int exit_code = 0;
+  double start_time = now_ms ();
+  size_t start_bytes = ttl_allocated_bytes;
+  enum ttl_phase previous;
 
   /* Set up global data structures.  */
   pool = ttl_create_pool ();
   state = make_compile_state (pool, filename, options);
+  state->phase_start = start_time;
+  state->phase_bytes = start_bytes;
 
   /* Now read in the program text.  If the input file cannot be
      opened, or not parsed at all, we do not invoke further
@@ -5527,17 +6044,46 @@ ttl_compile (char * filename, struct ttl_compile_options * options)
 	  if (options->verbose > 0)
 	    printf ("determining dependencies...\n");
 
+	  previous = ttl_enter_phase (state, phase_dependencies);
 	  if (prepare_dependencies (state, module, options))
 	    {
+	      ttl_leave_phase (state, previous);
 	      exit_code = 1;
 	      goto free_and_exit;
 	    }
+	  ttl_leave_phase (state, previous);
 
 	  if (options->verbose > 0)
 	    printf ("translating to high-level intermediate code...\n");
+	  previous = ttl_enter_phase (state, phase_translate);
 	  translate_module (state, module, options);
 
 	  create_init_function (state);
+	  ttl_leave_phase (state, previous);
+
+	  previous = ttl_enter_phase (state, phase_optimize);
+	  if (state->errors == 0 && options->profile_use)
+	    {
+	      state->profile = ttl_read_profile (state->pool,
+						 options->profile_use);
+	      if (!state->profile)
+		state->errors++;
+	    }
+	  if (state->errors == 0 && options->opt_fuse_lists)
+	    ttl_fuse_module (state, state->current_module);
+	  if (state->errors == 0 && options->opt_specialize)
+	    ttl_specialize_module (state, state->current_module);
+	  if (state->errors == 0 && options->opt_inline)
+	    {
+	      if (options->verbose > 0)
+		printf ("inlining functions...\n");
+	      ttl_inline_module (state, state->current_module);
+	    }
+	  if (state->errors == 0 && options->opt_fold_constants)
+	    ttl_fold_module (state, state->current_module);
+	  if (state->errors == 0 && options->opt_bounds_checks)
+	    ttl_bounds_module (state, state->current_module);
+	  ttl_leave_phase (state, previous);
 
 #if 0
 	  dump_il_module (stderr, state->current_module);
@@ -5559,10 +6105,14 @@ ttl_compile (char * filename, struct ttl_compile_options * options)
 	    {
 	      if (options->verbose > 0)
 		printf ("translating to low-level intermediate code...\n");
+	      previous = ttl_enter_phase (state, phase_codegen);
 	      ttl_generate_code (state, state->current_module);
+	      ttl_leave_phase (state, previous);
 	      if (options->verbose > 0)
 		printf ("generating C code...\n");
+	      previous = ttl_enter_phase (state, phase_emit);
 	      exit_code = ttl_emit_c (state, state->current_module, options);
+	      ttl_leave_phase (state, previous);
 	      if (options->verbose > 0)
 		printf ("done.\n");
 	    }
@@ -5573,6 +6123,8 @@ ttl_compile (char * filename, struct ttl_compile_options * options)
   else
     exit_code = 1;
  free_and_exit:
+  if (options->pragma_time_report)
+    print_time_report (state);
   ttl_destroy_pool (state->pool);
   /* NOTE: Do not use STATE after here, since its pool has just been
      deallocated.  */
@@ -5593,18 +6145,32 @@ ttl_init_compile_options (struct ttl_compile_options * options)
   options->pragma_turtledoc = 0;
   options->pragma_printdeps = 0;
   options->pragma_printdepsstdout = 0;
+  options->pragma_profile_generate = 0;
+  options->pragma_time_report = 0;
   options->main = 0;
   options->verbose = 0;
   options->opt_local_calls = 1;
   options->opt_local_jumps = 1;
   options->opt_merge_gc_checks = 1;
   options->opt_inline_constructors = 1;
+  options->opt_static_closures = 1;
+  options->opt_multiple_values = 1;
+  options->opt_leaf_calls = 1;
+  options->opt_inline = 0;
+  options->opt_fold_constants = 1;
+  options->opt_bounds_checks = 1;
+  options->opt_tail_loops = 1;
+  options->opt_peephole = 1;
+  options->opt_outline_gc = 1;
+  options->opt_fuse_lists = 0;
+  options->opt_specialize = 0;
   options->opt_gcc_level = 0;
   options->link_static = 0;
   options->program_name = "a.out";
   options->module_path = "";
   options->include_path = "";
   options->library_path = "";
+  options->profile_use = NULL;
 }
 
 /* End of compiler.c.  */
@@ -25,6 +25,24 @@
 #include "env.h"
 #include "types.h"
 
+/* The phases of a compilation, for which the pragma `time-report'
+   reports the time and the pool memory spent.  */
+enum ttl_phase
+  {
+    phase_setup,
+    phase_parse,
+    phase_dependencies,
+    phase_load,
+    phase_translate,
+    phase_optimize,
+    phase_codegen,
+    phase_emit,
+    phase_cc,
+    phase_cc_shared,
+    phase_link,
+    phase_count
+  };
+
 typedef struct ttl_compile_state * ttl_compile_state;
 struct ttl_compile_state
 {
@@ -87,6 +105,18 @@ struct ttl_compile_state
      messages during the parsing of interface files.  */
   unsigned complain_unbound_types;
 
+  void * profile;		/* Execution profile read for
+				   `--profile-use', or NULL.  */
+
+  /* Accounting for the pragma `time-report'.  The time and memory
+     since the last phase change are charged to `phase'.  */
+  enum ttl_phase phase;		/* Currently running phase.  */
+  double phase_start;		/* Time of the last phase change, in
+				   milliseconds.  */
+  size_t phase_bytes;		/* `ttl_allocated_bytes' at that time.  */
+  double phase_time[phase_count]; /* Milliseconds spent per phase.  */
+  long phase_memory[phase_count]; /* Pool bytes allocated per phase.  */
+
   struct ttl_compile_options * compile_options;
 };
 
@@ -102,11 +132,24 @@ struct ttl_compile_options
   unsigned pragma_turtledoc:1;
   unsigned pragma_printdeps:1;
   unsigned pragma_printdepsstdout:1;
+  unsigned pragma_profile_generate:1;
+  unsigned pragma_time_report:1;
   unsigned main:1;
   unsigned opt_local_calls:1;
   unsigned opt_local_jumps:1;
   unsigned opt_merge_gc_checks:1;
   unsigned opt_inline_constructors:1;
+  unsigned opt_static_closures:1;
+  unsigned opt_multiple_values:1;
+  unsigned opt_leaf_calls:1;
+  unsigned opt_inline:1;
+  unsigned opt_fold_constants:1;
+  unsigned opt_bounds_checks:1;
+  unsigned opt_tail_loops:1;
+  unsigned opt_peephole:1;
+  unsigned opt_outline_gc:1;
+  unsigned opt_fuse_lists:1;
+  unsigned opt_specialize:1;
   unsigned opt_gcc_level;
   unsigned link_static:1;
   unsigned verbose;
@@ -114,9 +157,18 @@ struct ttl_compile_options
   char * module_path;
   char * include_path;
   char * library_path;
+  char * profile_use;
 };
 
 void ttl_init_compile_options (struct ttl_compile_options * options);
 int ttl_compile (char * filename, struct ttl_compile_options * options);
 
+/* Switch the phase for the pragma `time-report' to `phase' and return
+   the phase which was running before, which must be passed to
+   `ttl_leave_phase' when `phase' is finished.  Phases can be nested;
+   the time of the inner phase is not charged to the outer one.  */
+enum ttl_phase ttl_enter_phase (ttl_compile_state state,
+				enum ttl_phase phase);
+void ttl_leave_phase (ttl_compile_state state, enum ttl_phase previous);
+
 #endif /* not TTL_COMPILER_H */
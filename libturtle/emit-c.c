@@ -37,6 +37,7 @@
 #include "il.h"
 #include "compiler.h"
 #include "codegen.h"
+#include "profile.h"
 
 
 /* #define this to 1 to automatically link the module `turtle0' into
@@ -93,9 +94,183 @@ emit_operand (FILE * f, ttl_operand operand)
 }
 
 
+/* Return the C type used for passing values of type `type' to and
+   from leaf functions.  */
+static const char *
+leaf_c_type (ttl_type type)
+{
+  switch (type->kind)
+    {
+    case type_void:
+      return "void";
+    case type_long:
+      return "long";
+    case type_real:
+      return "double";
+    default:
+      return "int";
+    }
+}
+
+/* Emit a direct call to the leaf function `name' of type `type'.
+   The arguments are popped off the stack and converted to their C
+   representation, the result is converted back and stored into the
+   accumulator.  */
+static void
+emit_leaf_call (FILE * f, ttl_symbol name, ttl_type type)
+{
+  unsigned count = type->d.function.param_type_count;
+  ttl_type * pt = type->d.function.param_types;
+  ttl_type result = type->d.function.return_type;
+  unsigned i;
+
+  fprintf (f, "\t{\n\t  extern %s ", leaf_c_type (result));
+  ttl_symbol_print (f, name);
+  fprintf (f, " (");
+  if (count == 0)
+    fprintf (f, "void");
+  for (i = 0; i < count; i++)
+    fprintf (f, "%s%s", i > 0 ? ", " : "", leaf_c_type (pt[i]));
+  fprintf (f, ");\n");
+  fprintf (f, "\t  sp -= %u;\n", count);
+  for (i = 0; i < count; i++)
+    if (pt[i]->kind == type_real || pt[i]->kind == type_long)
+      fprintf (f, "\t  if (TTL_UNLIKELY (!sp[%u])) goto raise_null_pointer_exception;\n",
+	       i);
+  switch (result->kind)
+    {
+    case type_void:
+      fprintf (f, "\t  ");
+      break;
+    case type_integer:
+      fprintf (f, "\t  acc = TTL_INT_TO_VALUE (");
+      break;
+    case type_char:
+      fprintf (f, "\t  acc = TTL_CHAR_TO_VALUE (");
+      break;
+    case type_bool:
+      fprintf (f, "\t  acc = TTL_BOOL_TO_VALUE (");
+      break;
+    case type_long:
+      fprintf (f, "\t  TTL_MAKE_LONG (");
+      break;
+    case type_real:
+      fprintf (f, "\t  TTL_MAKE_REAL (");
+      break;
+    default:
+      fprintf (stderr, "emit_leaf_call: invalid result type\n");
+      abort ();
+    }
+  ttl_symbol_print (f, name);
+  fprintf (f, " (");
+  for (i = 0; i < count; i++)
+    {
+      if (i > 0)
+	fprintf (f, ", ");
+      switch (pt[i]->kind)
+	{
+	case type_integer:
+	  fprintf (f, "TTL_VALUE_TO_INT (sp[%u])", i);
+	  break;
+	case type_char:
+	  fprintf (f, "TTL_VALUE_TO_CHAR (sp[%u])", i);
+	  break;
+	case type_bool:
+	  fprintf (f, "TTL_VALUE_TO_BOOL (sp[%u])", i);
+	  break;
+	case type_long:
+	  fprintf (f, "TTL_VALUE_TO_OBJ (ttl_long, sp[%u])->value", i);
+	  break;
+	case type_real:
+	  fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, sp[%u])->value", i);
+	  break;
+	default:
+	  fprintf (stderr, "emit_leaf_call: invalid parameter type\n");
+	  abort ();
+	}
+    }
+  if (result->kind == type_void)
+    fprintf (f, ");\n\t}");
+  else
+    fprintf (f, "));\n\t}");
+}
+
+/* Number of GC checks emitted with `TTL_GC_CHECK_STUB', used for
+   making their return labels unique.  */
+static unsigned gc_stub_count = 0;
+
+/* Conditional jumps with fewer executions in the profile are not
+   annotated as likely or unlikely.  */
+#define PROFILE_MIN_BRANCH_COUNT 16
+
+/* Number of conditional jumps emitted for the current module and for
+   the function `profile_function', used for indexing the profile
+   counters and looking up the counts of a given profile.  */
+static unsigned branch_count = 0;
+static unsigned function_branch_count = 0;
+static ttl_function profile_function = NULL;
+
+/* Non-zero if `profile_function' never ran when the profile was
+   taken.  */
+static int profile_cold = 0;
+
+/* Name of the current module as used in profiles.  */
+static char * profile_module = NULL;
+
+/* Text closing the condition opened by `emit_branch_start'.  */
+static char * branch_close = "";
+
+/* Emit the start of the `if' statement of a conditional jump to `f',
+   indented by `indent'.  The caller emits the condition, followed by
+   a call to `emit_branch_end'.  When instrumenting, the condition is
+   wrapped by the profiling macro; when compiling with a profile,
+   strongly biased jumps are marked as likely or unlikely, so that the
+   C compiler moves the rarely executed code out of the way.  */
+static void
+emit_branch_start (FILE * f, ttl_compile_state state, char * indent)
+{
+  unsigned long taken, not_taken;
+
+  fprintf (f, "%sif (", indent);
+  branch_close = "";
+  if (state->compile_options->pragma_profile_generate)
+    {
+      fprintf (f, "TTL_PROFILE_BRANCH (profile_branches, %u, ",
+	       branch_count);
+      branch_close = ")";
+    }
+  else if (state->profile && profile_function &&
+	   ttl_profile_branch (state->profile, profile_module,
+			       profile_function, function_branch_count,
+			       &taken, &not_taken) &&
+	   taken + not_taken >= PROFILE_MIN_BRANCH_COUNT)
+    {
+      if (taken >= 9 * not_taken)
+	{
+	  fprintf (f, "TTL_LIKELY (");
+	  branch_close = ")";
+	}
+      else if (not_taken >= 9 * taken)
+	{
+	  fprintf (f, "TTL_UNLIKELY (");
+	  branch_close = ")";
+	}
+    }
+  branch_count++;
+  function_branch_count++;
+}
+
+/* Close the condition of a conditional jump started with
+   `emit_branch_start'.  The caller emits the target label.  */
+static void
+emit_branch_end (FILE * f)
+{
+  fprintf (f, "%s) goto ", branch_close);
+}
+
 /* Emit the instruction `instr' to the C code file `f'.  */
 static void
-emit_instruction (FILE * f, ttl_instruction instr)
+emit_instruction (FILE * f, ttl_compile_state state, ttl_instruction instr)
 {
   if (instr->filename)
     {
@@ -108,6 +283,11 @@ emit_instruction (FILE * f, ttl_instruction instr)
 	       (int)(instr->op0->data));
       break;
       
+    case op_load_descr:
+      fprintf (f, "\tacc = TTL_OBJ_TO_VALUE (descriptors + %d);",
+	       (int)(instr->op0->data));
+      break;
+
     case op_macro_call:
       fprintf (f, "\t");
       emit_operand (f, instr->op0);
@@ -162,6 +342,28 @@ emit_instruction (FILE * f, ttl_instruction instr)
 #endif
       break;
 
+    /* Accesses which have been proven to be in range by the bounds
+       check elimination.  */
+    case op_sload_unchecked:
+      fprintf (f, "\t--sp;\n");
+      fprintf (f, "\tacc = TTL_CHAR_TO_VALUE (TTL_VALUE_TO_OBJ (ttl_string, *sp)->data[TTL_VALUE_TO_INT (acc)]);");
+      break;
+
+    case op_sstore_unchecked:
+      fprintf (f, "\t{\n\t  ttl_value arr = *(--sp);\n");
+      fprintf (f, "\t  TTL_VALUE_TO_OBJ (ttl_string, arr)->data[TTL_VALUE_TO_INT (acc)] = TTL_VALUE_TO_CHAR (*--sp);\n\t}");
+      break;
+
+    case op_aload_unchecked:
+      fprintf (f, "\t--sp;\n");
+      fprintf (f, "\tacc = TTL_VALUE_TO_OBJ (ttl_array, *sp)->data[TTL_VALUE_TO_INT (acc)];");
+      break;
+
+    case op_astore_unchecked:
+      fprintf (f, "\t{\n\t  ttl_value arr = *(--sp);\n");
+      fprintf (f, "\t  TTL_VALUE_TO_OBJ (ttl_array, arr)->data[TTL_VALUE_TO_INT (acc)] = *(--sp);\n\t}");
+      break;
+
     case op_tuple_ref:
       fprintf (f, "\tTTL_TUPLE_REF (%d);", (int) instr->op0->data);
       break;
@@ -259,24 +461,78 @@ emit_instruction (FILE * f, ttl_instruction instr)
       }
       break;
 
+    case op_return_values:
+      {
+	unsigned count = (unsigned) instr->op0->data;
+	unsigned i = count;
+	fprintf (f, "\tif (TTL_VALUES_WANTED_P ())\n\t  {\n");
+	while (i-- > 0)
+	  {
+#if OLD_SP
+	    fprintf (f, "\t    ttl_values[%d] = ttl_stack[--sp];\n", i);
+#else
+	    fprintf (f, "\t    ttl_values[%d] = *(--sp);\n", i);
+#endif
+	  }
+	fprintf (f, "\t    acc = TTL_VALUES_MARKER;\n\t  }\n\telse\n\t  {\n");
+	fprintf (f, "\t    TTL_GC_CHECK (%d);\n", (count + 2) & ~1);
+	fprintf (f, "\t    TTL_MAKE_UNINITIALIZED_ARRAY (%d);\n", count);
+	i = count;
+	while (i-- > 0)
+	  {
+#if OLD_SP
+	    fprintf (f,
+		     "\t    TTL_VALUE_TO_OBJ (ttl_array, acc)->data[%d] = ttl_stack[--sp];\n",
+		     i);
+#else
+	    fprintf (f,
+		     "\t    TTL_VALUE_TO_OBJ (ttl_array, acc)->data[%d] = *(--sp);\n",
+		     i);
+#endif
+	  }
+	fprintf (f, "\t  }");
+      }
+      break;
+
+    case op_receive_values:
+      {
+	unsigned count = (unsigned) instr->op0->data;
+	unsigned i = count;
+	fprintf (f, "\tif (acc == TTL_VALUES_MARKER)\n\t  {\n");
+	while (i-- > 0)
+	  {
+#if OLD_SP
+	    fprintf (f, "\t    ttl_stack[sp++] = ttl_values[%d];\n", i);
+#else
+	    fprintf (f, "\t    *sp++ = ttl_values[%d];\n", i);
+#endif
+	  }
+	fprintf (f, "\t  }\n\telse\n\t  {\n");
+	fprintf (f, "\t    if (TTL_UNLIKELY (!acc)) goto raise_null_pointer_exception;\n");
+	i = count;
+	while (i-- > 0)
+	  fprintf (f, "\t    TTL_TUPLE_REF (%d);\n", i);
+	fprintf (f, "\t  }");
+      }
+      break;
+
     case op_make_data:
       {
 	unsigned count = (unsigned) instr->op0->data;
 	unsigned mask = (unsigned) instr->op1->data;
 	unsigned variant = instr->op0->unsigned_data;
+	if (count == 0)
+	  {
+	    fprintf (f, "\tacc = TTL_NULLARY_DATA (%d);", variant);
+	    break;
+	  }
 #if OLD_SP
-	fprintf (f, "\tTTL_MAKE_UNINITIALIZED_ARRAY (%d);\n", count + 1);
-#if 0
-	fprintf (f, "\tTTL_SAVE_REGISTERS;\n");
-	fprintf (f, "\tttl_global_acc = ttl_unsafe_alloc_array (%d);\n",
-		 count + 1);
-	fprintf (f, "\tTTL_RESTORE_REGISTERS;\n");
-#endif
+	fprintf (f, "\tTTL_MAKE_UNINITIALIZED_DATA (%d, %d);\n", variant, count);
 	while (count-- > 0)
 	  {
 	    fprintf (f,
 		     "\tTTL_VALUE_TO_OBJ (ttl_array, acc)->data[%d] = ttl_stack[--sp];\n",
-		     count + 1);
+		     count);
 	  }
 	count = 0;
 	while (count < (unsigned) instr->op0->data)
@@ -284,28 +540,25 @@ emit_instruction (FILE * f, ttl_instruction instr)
 	    if (mask & 1)
 	      {
 		fprintf (f, "\tTTL_PUSH();\n");
-		fprintf (f, "\tacc = TTL_VALUE_TO_OBJ (ttl_array, ttl_stack[sp - 1])->data[%d];\n", count + 1);
+		fprintf (f, "\tacc = TTL_VALUE_TO_OBJ (ttl_array, ttl_stack[sp - 1])->data[%d];\n", count);
 		fprintf (f,
 			 "\tTTL_VALUE_TO_OBJ (ttl_array, ttl_stack[sp - 1])->data[%d] = ttl_alloc_constrainable_variable ();\n",
-			 count + 1);
+			 count);
 		fprintf (f,
 			 "\tTTL_VALUE_TO_OBJ (ttl_constrainable_variable, TTL_VALUE_TO_OBJ (ttl_array, ttl_stack[sp - 1])->data[%d])->value = acc;\n",
-			 count + 1);
+			 count);
 		fprintf (f, "\tTTL_POP();\n");
 	      }
 	    mask = mask >> 1;
 	    count++;
 	  }
-	fprintf (f,
-		 "\tTTL_VALUE_TO_OBJ (ttl_array, acc)->data[0] = TTL_INT_TO_VALUE (%d);\n",
-		 variant);
 #else
-	fprintf (f, "\tTTL_MAKE_UNINITIALIZED_ARRAY (%d);\n", count + 1);
+	fprintf (f, "\tTTL_MAKE_UNINITIALIZED_DATA (%d, %d);\n", variant, count);
 	while (count-- > 0)
 	  {
 	    fprintf (f,
 		     "\tTTL_VALUE_TO_OBJ (ttl_array, acc)->data[%d] = *(--sp);\n",
-		     count + 1);
+		     count);
 	  }
 	count = 0;
 	while (count < (unsigned) instr->op0->data)
@@ -313,28 +566,29 @@ emit_instruction (FILE * f, ttl_instruction instr)
 	    if (mask & 1)
 	      {
 		fprintf (f, "\tTTL_PUSH();\n");
-		fprintf (f, "\tacc = TTL_VALUE_TO_OBJ (ttl_array, *(sp - 1))->data[%d];\n", count + 1);
+		fprintf (f, "\tacc = TTL_VALUE_TO_OBJ (ttl_array, *(sp - 1))->data[%d];\n", count);
 		fprintf (f,
 			 "\tTTL_VALUE_TO_OBJ (ttl_array, *(sp - 1))->data[%d] = ttl_alloc_constrainable_variable ();\n",
-			 count + 1);
+			 count);
 		fprintf (f,
 			 "\tTTL_VALUE_TO_OBJ (ttl_constrainable_variable, TTL_VALUE_TO_OBJ (ttl_array, *(sp - 1))->data[%d])->value = acc;\n",
-			 count + 1);
+			 count);
 		fprintf (f, "\tTTL_POP();\n");
 	      }
 	    mask = mask >> 1;
 	    count++;
 	  }
-	fprintf (f,
-		 "\tTTL_VALUE_TO_OBJ (ttl_array, acc)->data[0] = TTL_INT_TO_VALUE (%d);\n",
-		 variant);
 #endif
       }
       break;
 
     case op_gc_check:
-      fprintf (f, "\tTTL_GC_CHECK (%d);",
-	       (int) (instr->op0->data));
+      if (state->compile_options->opt_outline_gc)
+	fprintf (f, "\tTTL_GC_CHECK_STUB (%d, %u);",
+		 (int) (instr->op0->data), gc_stub_count++);
+      else
+	fprintf (f, "\tTTL_GC_CHECK (%d);",
+		 (int) (instr->op0->data));
       break;
 
     case op_null_env_reg:
@@ -356,6 +610,10 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "    case %d:\n", (int) instr->op0->data);
       emit_operand (f, instr->op0);
       fprintf (f, ":");
+      if (state->compile_options->pragma_profile_generate)
+	fprintf (f, "\n\tprofile_calls[%d]++;", (int) instr->op0->data);
+      else if (profile_cold)
+	fprintf (f, " TTL_COLD_LABEL");
       break;
     case op_note_label:
       fprintf (f, "\tpc = descriptors + %d;", (int) instr->op0->data);
@@ -697,22 +955,30 @@ emit_instruction (FILE * f, ttl_instruction instr)
       break;
 
     case op_jump_if_false:
-      fprintf (f, "\tif (acc == TTL_FALSE) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "acc == TTL_FALSE");
+      emit_branch_end (f);
       emit_operand (f, instr->op0);
       fprintf (f, ";");
       break;
 
     case op_jump_if_true:
-      fprintf (f, "\tif (acc == TTL_TRUE) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "acc == TTL_TRUE");
+      emit_branch_end (f);
       emit_operand (f, instr->op0);
       fprintf (f, ";");
       break;
 
     case op_jump_if_equal:
 #if OLD_SP
-      fprintf (f, "\tif (ttl_stack[--sp] == acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "ttl_stack[--sp] == acc");
+      emit_branch_end (f);
 #else
-      fprintf (f, "\tif (*(--sp) == acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "*(--sp) == acc");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";");
@@ -720,19 +986,61 @@ emit_instruction (FILE * f, ttl_instruction instr)
 
     case op_jump_if_not_equal:
 #if OLD_SP
-      fprintf (f, "\tif (ttl_stack[--sp] != acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "ttl_stack[--sp] != acc");
+      emit_branch_end (f);
 #else
-      fprintf (f, "\tif (*(--sp) != acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "*(--sp) != acc");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";");
       break;
 
+    case op_jump_if_variant:
+    case op_jump_if_not_variant:
+      {
+	unsigned variant = (unsigned) instr->op1->data;
+	char * neg = instr->op == op_jump_if_not_variant ? "!" : "";
+	switch (instr->op1->unsigned_data)
+	  {
+	  case variant_test_immediate:
+	    emit_branch_start (f, state, "\t");
+	    fprintf (f, "%s(acc == TTL_NULLARY_DATA (%d))", neg, variant);
+	    emit_branch_end (f);
+	    break;
+	  case variant_test_object:
+	    emit_branch_start (f, state, "\t");
+	    fprintf (f, "%sTTL_OBJECT_P (acc)", neg);
+	    emit_branch_end (f);
+	    break;
+	  case variant_test_header:
+	    emit_branch_start (f, state, "\t");
+	    fprintf (f, "%s(TTL_DATA_VARIANT (acc) == %d)", neg, variant);
+	    emit_branch_end (f);
+	    break;
+	  case variant_test_object_header:
+	    emit_branch_start (f, state, "\t");
+	    fprintf (f, "%s(TTL_OBJECT_P (acc) && "
+		     "TTL_DATA_VARIANT (acc) == %d)", neg, variant);
+	    emit_branch_end (f);
+	    break;
+	  }
+	emit_operand (f, instr->op0);
+	fprintf (f, ";");
+      }
+      break;
+
     case op_jump_if_less:
 #if OLD_SP
-      fprintf (f, "\tif ((int) ttl_stack[--sp] < (int) acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "(int) ttl_stack[--sp] < (int) acc");
+      emit_branch_end (f);
 #else
-      fprintf (f, "\tif ((int) *(--sp) < (int) acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "(int) *(--sp) < (int) acc");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";");
@@ -740,9 +1048,13 @@ emit_instruction (FILE * f, ttl_instruction instr)
 
     case op_jump_if_not_less:
 #if OLD_SP
-      fprintf (f, "\tif ((int) ttl_stack[--sp] >= (int) acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "(int) ttl_stack[--sp] >= (int) acc");
+      emit_branch_end (f);
 #else
-      fprintf (f, "\tif ((int) *(--sp) >= (int) acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "(int) *(--sp) >= (int) acc");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";");
@@ -750,9 +1062,13 @@ emit_instruction (FILE * f, ttl_instruction instr)
 
     case op_jump_if_gtr:
 #if OLD_SP
-      fprintf (f, "\tif ((int) ttl_stack[--sp] > (int) acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "(int) ttl_stack[--sp] > (int) acc");
+      emit_branch_end (f);
 #else
-      fprintf (f, "\tif ((int) *(--sp) > (int) acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "(int) *(--sp) > (int) acc");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";");
@@ -760,14 +1076,58 @@ emit_instruction (FILE * f, ttl_instruction instr)
 
     case op_jump_if_not_gtr:
 #if OLD_SP
-      fprintf (f, "\tif ((int) ttl_stack[--sp] <= (int) acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "(int) ttl_stack[--sp] <= (int) acc");
+      emit_branch_end (f);
 #else
-      fprintf (f, "\tif ((int) *(--sp) <= (int) acc) goto ");
+      emit_branch_start (f, state, "\t");
+      fprintf (f, "(int) *(--sp) <= (int) acc");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";");
       break;
 
+    /* Comparisons of the accumulator with an integer constant, fused
+       by the peephole optimizer.  */
+    case op_jump_if_equal_int:
+    case op_jump_if_not_equal_int:
+    case op_jump_if_less_int:
+    case op_jump_if_not_less_int:
+    case op_jump_if_gtr_int:
+    case op_jump_if_not_gtr_int:
+      {
+	char * cmp;
+	switch (instr->op)
+	  {
+	  case op_jump_if_equal_int:
+	    cmp = "==";
+	    break;
+	  case op_jump_if_not_equal_int:
+	    cmp = "!=";
+	    break;
+	  case op_jump_if_less_int:
+	    cmp = "<";
+	    break;
+	  case op_jump_if_not_less_int:
+	    cmp = ">=";
+	    break;
+	  case op_jump_if_gtr_int:
+	    cmp = ">";
+	    break;
+	  default:
+	    cmp = "<=";
+	    break;
+	  }
+	emit_branch_start (f, state, "\t");
+	fprintf (f, "(int) acc %s (int) TTL_INT_TO_VALUE (%d)",
+		 cmp, (int) instr->op1->data);
+	emit_branch_end (f);
+	emit_operand (f, instr->op0);
+	fprintf (f, ";");
+      }
+      break;
+
     case op_jump_if_fequal:
 #if OLD_SP
       fprintf (f, "\t{\n\t  double r;\n");
@@ -775,14 +1135,18 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = ttl_stack[--sp];\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value == r) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value == r");
+      emit_branch_end (f);
 #else
       fprintf (f, "\t{\n\t  double r;\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = *(--sp);\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value == r) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value == r");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
@@ -795,14 +1159,18 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = ttl_stack[--sp];\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value != r) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value != r");
+      emit_branch_end (f);
 #else
       fprintf (f, "\t{\n\t  double r;\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = *(--sp);\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value != r) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value != r");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
@@ -815,14 +1183,18 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = ttl_stack[--sp];\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value < r) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value < r");
+      emit_branch_end (f);
 #else
       fprintf (f, "\t{\n\t  double r;\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = *(--sp);\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value < r) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value < r");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
@@ -835,14 +1207,18 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = ttl_stack[--sp];\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value >= r) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value >= r");
+      emit_branch_end (f);
 #else
       fprintf (f, "\t{\n\t  double r;\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = *(--sp);\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value >= r) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value >= r");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
@@ -855,14 +1231,18 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = ttl_stack[--sp];\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value > r) goto ");      
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value > r");
+      emit_branch_end (f);
 #else
       fprintf (f, "\t{\n\t  double r;\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = *(--sp);\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value > r) goto ");      
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value > r");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
@@ -875,14 +1255,18 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = ttl_stack[--sp];\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value <= r) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value <= r");
+      emit_branch_end (f);
 #else
       fprintf (f, "\t{\n\t  double r;\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
       fprintf (f, "\t  r = TTL_VALUE_TO_OBJ (ttl_real, acc)->value;\n");
       fprintf (f, "\t  acc = *(--sp);\n");
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_real, acc)->value <= r) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_real, acc)->value <= r");
+      emit_branch_end (f);
 #endif
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
@@ -898,7 +1282,9 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  acc = *(--sp);\n");
 #endif
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_long, acc)->value == l) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_long, acc)->value == l");
+      emit_branch_end (f);
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
       break;
@@ -913,7 +1299,9 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  acc = *(--sp);\n");
 #endif
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_long, acc)->value != l) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_long, acc)->value != l");
+      emit_branch_end (f);
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
       break;
@@ -928,7 +1316,9 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  acc = *(--sp);\n");
 #endif
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_long, acc)->value < l) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_long, acc)->value < l");
+      emit_branch_end (f);
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
       break;
@@ -943,7 +1333,9 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  acc = *(--sp);\n");
 #endif
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_long, acc)->value >= l) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_long, acc)->value >= l");
+      emit_branch_end (f);
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
       break;
@@ -958,7 +1350,9 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  acc = *(--sp);\n");
 #endif
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_long, acc)->value > l) goto ");      
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_long, acc)->value > l");
+      emit_branch_end (f);
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
       break;
@@ -973,7 +1367,9 @@ emit_instruction (FILE * f, ttl_instruction instr)
       fprintf (f, "\t  acc = *(--sp);\n");
 #endif
       fprintf (f, "\t  TTL_NULL_CHECK;\n");
-      fprintf (f, "\t  if (TTL_VALUE_TO_OBJ (ttl_long, acc)->value <= l) goto ");
+      emit_branch_start (f, state, "\t  ");
+      fprintf (f, "TTL_VALUE_TO_OBJ (ttl_long, acc)->value <= l");
+      emit_branch_end (f);
       emit_operand (f, instr->op0);
       fprintf (f, ";\n\t}");
       break;
@@ -1051,6 +1447,11 @@ emit_instruction (FILE * f, ttl_instruction instr)
       }
       break;
 
+    case op_leaf_call:
+      emit_leaf_call (f, (ttl_symbol) instr->op0->data,
+		      (ttl_type) instr->op1->data);
+      break;
+
     case op_raise:
 #if 0
       fprintf (f, "\tTTL_RAISE (acc);\n\tbreak;");
@@ -1059,15 +1460,15 @@ emit_instruction (FILE * f, ttl_instruction instr)
       break;
 
     case op_concat:
-      fprintf (f, "\tif (!acc) goto raise_null_pointer_exception;\n");
+      fprintf (f, "\tif (TTL_UNLIKELY (!acc)) goto raise_null_pointer_exception;\n");
 #if OLD_SP
       fprintf
 	(f,
-	 "\tif (!ttl_stack[sp - 1]) goto raise_null_pointer_exception;\n");
+	 "\tif (TTL_UNLIKELY (!ttl_stack[sp - 1])) goto raise_null_pointer_exception;\n");
 #else
       fprintf
 	(f,
-	 "\tif (!*(sp - 1)) goto raise_null_pointer_exception;\n");
+	 "\tif (TTL_UNLIKELY (!*(sp - 1))) goto raise_null_pointer_exception;\n");
 #endif
       fprintf (f, "\tTTL_SAVE_REGISTERS;\n");
       fprintf (f, "\tttl_global_acc = ttl_append_strings (ttl_stack[ttl_global_sp - 1], ttl_global_acc);\n");
@@ -1076,7 +1477,7 @@ emit_instruction (FILE * f, ttl_instruction instr)
       break;
 
     case op_null_check:
-      fprintf (f, "\tif (!acc) goto raise_null_pointer_exception;");
+      fprintf (f, "\tif (TTL_UNLIKELY (!acc)) goto raise_null_pointer_exception;");
       break;
       
     case op_add_int_constraint:
@@ -1112,7 +1513,7 @@ emit_instruction (FILE * f, ttl_instruction instr)
       break;
 
     case op_tick:
-      fprintf (f, "\tif (--ttl_time_slice < 0)\n");
+      fprintf (f, "\tif (TTL_UNLIKELY (--ttl_time_slice < 0))\n");
       fprintf (f, "\t  {\n\t    TTL_SAVE_CONT (descriptors + %d, 0);\n",
 	       (int) instr->op0->data);
       fprintf (f, "\t    goto save_regs_and_return_tick;\n");
@@ -1168,12 +1569,12 @@ emit_instruction (FILE * f, ttl_instruction instr)
 /* Emit all instructions of the code object `obj' to the C source code
    file `f'.  */
 static void
-emit_object (FILE * f, ttl_object obj)
+emit_object (FILE * f, ttl_compile_state state, ttl_object obj)
 {
   ttl_instruction instr = obj->first;
   while (instr)
     {
-      emit_instruction (f, instr);
+      emit_instruction (f, state, instr);
       instr = instr->next;
     }
 }
@@ -1191,7 +1592,13 @@ emit_function (FILE * code_f, ttl_compile_state state, ttl_function function)
   ttl_print_type (code_f, function->type);
   fprintf (code_f, ".  */\n");
 
-  emit_object (code_f, (ttl_object) function->asm_code);
+  profile_function = function;
+  function_branch_count = 0;
+  profile_cold = state->profile &&
+    ttl_profile_frequency (state->profile, profile_module, function) == 0;
+  emit_object (code_f, state, (ttl_object) function->asm_code);
+  profile_function = NULL;
+  profile_cold = 0;
   fprintf (code_f, "\n");
 }
 
@@ -1236,7 +1643,7 @@ emit_header_file (ttl_compile_state state, ttl_module module,
 	  ttl_print_type (header_f, variable->type);
 	  fprintf (header_f, ".  */\n");
 
-	  fprintf (header_f, "ttl_value ");
+	  fprintf (header_f, "extern TTL_THREAD_LOCAL ttl_value ");
 	  ttl_symbol_print (header_f, variable->unique_name);
 	  fprintf (header_f, ";\n\n");
 	}
@@ -1366,6 +1773,19 @@ append_library_dirs (char * buf, char * module_path)
     }
 }
 
+/* Append the options for the profile-directed optimizations of the C
+   compiler to `buf'.  The C compiler keeps its own profile data (in
+   `.gcda' files next to the object files), which is produced by the
+   same training run as the Turtle profile.  */
+static void
+append_profile_flags (char * buf, struct ttl_compile_options * options)
+{
+  if (options->pragma_profile_generate)
+    strcat (buf, " -fprofile-generate");
+  else if (options->profile_use)
+    strcat (buf, " -fprofile-use -fprofile-correction");
+}
+
 /* Run the C compiler on the produced C source code.  Return 0 on
    success, != 0 if an error occurs.  */
 static int
@@ -1378,6 +1798,7 @@ c_compile (ttl_compile_state state, ttl_module module,
   char * base_name;
   static char buf[1024 * 4];
   int ret;
+  enum ttl_phase previous;
 
   base_name = ttl_basename (state->pool, state->filename);
   c_name = ttl_replace_file_ext (state->pool, base_name, ".c");
@@ -1395,12 +1816,16 @@ c_compile (ttl_compile_state state, ttl_module module,
 	     options->opt_gcc_level);
   else
     sprintf (buf + strlen (buf), " -O%d", options->opt_gcc_level);
+  append_profile_flags (buf, options);
 
   sprintf (buf + strlen (buf), " '%s' -o '%s'", c_name, o_name);
 
   if (options->verbose > 0)
     fprintf (stderr, "[%s]\n", buf);
-  if (system (buf) != 0)
+  previous = ttl_enter_phase (state, phase_cc);
+  ret = system (buf);
+  ttl_leave_phase (state, previous);
+  if (ret != 0)
     {
       state->errors++;
       ttl_error_print_string (stderr, "turtle: cannot run the C compiler (");
@@ -1425,6 +1850,7 @@ c_compile (ttl_compile_state state, ttl_module module,
 	       options->opt_gcc_level);
     else
       sprintf (buf + strlen (buf), " -O%d", options->opt_gcc_level);
+    append_profile_flags (buf, options);
 
     sprintf (buf + strlen (buf), " '%s' -o '%s'", c_name, so_name);
 
@@ -1438,10 +1864,16 @@ c_compile (ttl_compile_state state, ttl_module module,
 #endif
 #if HAVE_LIBDL
       p = ttl_string_append (state->pool, p, " -ldl");
+#endif
+#if HAVE_LIBPTHREAD
+      p = ttl_string_append (state->pool, p, " -lpthread");
 #endif
       if (options->verbose > 0)
 	fprintf (stderr, "[%s]\n", p);
-      if (system (p) != 0)
+      previous = ttl_enter_phase (state, phase_cc_shared);
+      ret = system (p);
+      ttl_leave_phase (state, previous);
+      if (ret != 0)
 	{
 	  state->errors++;
 	  ttl_error_print_string (stderr, "turtle: cannot run the C compiler (");
@@ -1480,6 +1912,7 @@ c_compile (ttl_compile_state state, ttl_module module,
 	       "gcc %s-g '%s' -lturtlert -L%s -o '%s' ",
 	       options->link_static ? "-static " : "",
 	       o_name, hackdir ? hackdir : LIBRARY_DIR, exe_name);
+      append_profile_flags (buf, options);
 #if LINK_TURTLE0
       {
 	char * p;
@@ -1510,10 +1943,16 @@ c_compile (ttl_compile_state state, ttl_module module,
 #endif
 #if HAVE_LIBDL
 	p = ttl_string_append (state->pool, p, " -ldl");
+#endif
+#if HAVE_LIBPTHREAD
+	p = ttl_string_append (state->pool, p, " -lpthread");
 #endif
 	if (options->verbose > 0)
 	  fprintf (stderr, "[%s]\n", p);
-	if (system (p) != 0)
+	previous = ttl_enter_phase (state, phase_link);
+	ret = system (p);
+	ttl_leave_phase (state, previous);
+	if (ret != 0)
 	  {
 	    state->errors++;
 	    ttl_error_print_string
@@ -1607,6 +2046,44 @@ copy_handcoded_part (ttl_compile_state state, FILE * code_f, ttl_module module)
   return 0;
 }
 
+/* Emit the profile counters for the functions and conditional jumps
+   of module `module', and the `struct ttl_profile_info' describing
+   them.  The conditional jumps are numbered in the order in which
+   `emit_function' emits them.  */
+static void
+emit_profile_counters (FILE * code_f, ttl_compile_state state,
+		       ttl_module module)
+{
+  ttl_function function;
+  ttl_instruction instr;
+  unsigned count = 0;
+
+  fprintf (code_f, "static unsigned long profile_calls[%d];\n",
+	   state->label_count);
+  fprintf (code_f, "static unsigned profile_branch_functions[] =\n  {");
+  for (function = module->functions; function;
+       function = function->total_next)
+    for (instr = ((ttl_object) function->asm_code)->first; instr;
+	 instr = instr->next)
+      if (ttl_conditional_jump_p (instr))
+	{
+	  fprintf (code_f, "%s%s%u", count > 0 ? "," : "",
+		   count % 12 == 0 ? "\n    " : " ", function->index);
+	  count++;
+	}
+  /* Avoid empty arrays.  */
+  if (count == 0)
+    fprintf (code_f, "0");
+  fprintf (code_f, "\n  };\n");
+  fprintf (code_f, "static unsigned long profile_branches[%u];\n",
+	   count > 0 ? 2 * count : 1);
+  fprintf (code_f,
+	   "static struct ttl_profile_info profile_info =\n"
+	   "  {NULL, \"%s\", descriptors, %d, profile_calls, %u,\n"
+	   "   profile_branches, profile_branch_functions};\n\n",
+	   profile_module, state->label_count, count);
+}
+
 /* Emit the compiled code of module `module' as C source code,
    producing the `.h' and `.c' files necessary for the module, then
    invoke the C compiler to produce the object and (if requested) the
@@ -1623,6 +2100,10 @@ ttl_emit_c (ttl_compile_state state, ttl_module module,
   char * code_name;
   int ret;
 
+  profile_module = ttl_qualident_to_c_ident
+    (state->pool, ttl_strip_annotation (module->module_ast_name));
+  branch_count = 0;
+
   code_name = ttl_basename (state->pool, state->filename);
   code_name = ttl_replace_file_ext (state->pool, code_name, ".c");
   code_f = fopen (code_name, "w");
@@ -1668,9 +2149,11 @@ ttl_emit_c (ttl_compile_state state, ttl_module module,
       ttl_print_type (code_f, variable->type);
       fprintf (code_f, ".  */\n");
 
+      /* Each virtual machine has its own copy of the module
+	 variables.  */
       if (!variable->exported)
 	fprintf (code_f, "static ");
-      fprintf (code_f, "ttl_value ");
+      fprintf (code_f, "TTL_THREAD_LOCAL ttl_value ");
       ttl_symbol_print (code_f, variable->unique_name);
       fprintf (code_f, ";\n\n");
 
@@ -1727,11 +2210,16 @@ ttl_emit_c (ttl_compile_state state, ttl_module module,
     int i = 0;
     int last_index = module->functions ? module->functions->index : -1;
     int line = -1;
+    int values;
     while (i < state->label_count)
       {
 	line = -1;
+	values = 0;
 	if (((ttl_instruction *)state->mapping)[i])
 	  {
+	    ttl_instruction label = ((ttl_instruction *)state->mapping)[i];
+	    if (label->op == op_cont_label && label->op0->unsigned_data)
+	      values = 1;
 	    int j = i;
 	    line = ((ttl_instruction *)state->mapping)[j]->line;
 	    while (j > 0 && line < 0)
@@ -1751,15 +2239,15 @@ ttl_emit_c (ttl_compile_state state, ttl_module module,
 	  {
 	    fprintf
 	      (code_f,
-	       "    {TTL_DESCRIPTOR_HEADER, host_procedure, &func_info%d, %d} /* %d */",
-	       last_index, line, i);
+	       "    {TTL_DESCRIPTOR_HEADER, host_procedure, &func_info%d, %d, %d} /* %d */",
+	       last_index, line, values, i);
 	  }
 	else
 	  {
 	    fprintf
 	      (code_f,
-	       "    {TTL_DESCRIPTOR_HEADER, host_procedure, NULL, %d} /* %d */", 
-	       line, i);
+	       "    {TTL_DESCRIPTOR_HEADER, host_procedure, NULL, %d, %d} /* %d */", 
+	       line, values, i);
 	  }
 	i++;
 	if (i < state->label_count)
@@ -1771,6 +2259,9 @@ ttl_emit_c (ttl_compile_state state, ttl_module module,
     fprintf (code_f, "  };\n\n");
   }
 
+  if (options->pragma_profile_generate)
+    emit_profile_counters (code_f, state, module);
+
 
   fprintf (code_f, "\nstatic int\n"
 	   "host_procedure (void)\n"
@@ -1780,7 +2271,10 @@ ttl_emit_c (ttl_compile_state state, ttl_module module,
 	   "  ttl_value * alloc;\n"
 	   "  ttl_environment env;\n"
 	   "  ttl_descr pc;\n"
-	   "  ttl_closure self = NULL;\n\n"
+	   "  ttl_closure self = NULL;\n");
+  if (options->opt_outline_gc)
+    fprintf (code_f, "  TTL_GC_STUB_REGISTERS\n");
+  fprintf (code_f, "\n"
 	   "  TTL_RESTORE_REGISTERS;\n"
 	   " L_jump:\n"
 	   "  switch (pc - descriptors)\n"
@@ -1829,15 +2323,19 @@ ttl_emit_c (ttl_compile_state state, ttl_module module,
 	   "  acc = ttl_subscript_exception;\n"
 	   "  goto raise_exception;\n"
 	   "raise_exception:\n"
-	   "  TTL_RAISE (acc);\n"
-	   "}\n\n");
+	   "  TTL_RAISE (acc);\n");
+  /* `TTL_RAISE' never falls through, so the GC stub is only entered
+     by jumps from the GC checks.  */
+  if (options->opt_outline_gc)
+    fprintf (code_f, "  TTL_GC_STUB\n");
+  fprintf (code_f, "}\n\n");
 
   fprintf (code_f, "void\n_init_%s", 
 	   ttl_qualident_to_c_ident
 	   (state->pool,
 	    ttl_strip_annotation (module->module_ast_name)));
   fprintf (code_f,
-	   " (void)\n{\n  static int initialize = 1;\n\n"
+	   " (void)\n{\n  static TTL_THREAD_LOCAL int initialize = 1;\n\n"
 	   "  if (initialize)\n    {\n      initialize = 0;\n");
 #if LINK_TURTLE0
   if (options->main)
@@ -1855,6 +2353,8 @@ ttl_emit_c (ttl_compile_state state, ttl_module module,
 		ttl_strip_annotation (mod->module_ast_name)));
       module_list = module_list->next;
     }
+  if (options->pragma_profile_generate)
+    fprintf (code_f, "      ttl_register_profile (&profile_info);\n");
 #if 0
   function = module->toplevel_functions;
   while (function)
@@ -1923,8 +2423,12 @@ ttl_emit_c (ttl_compile_state state, ttl_module module,
       fprintf (code_f,
 	       "  ttl_initialize (argc, argv);\n");
       fprintf (code_f,
+	       "  ttl_register_initializer (_init_%s);\n"
 	       "  _init_%s ();\n",
 	       ttl_qualident_to_c_ident
+	       (state->pool,
+		ttl_strip_annotation (module->module_ast_name)),
+	       ttl_qualident_to_c_ident
 	       (state->pool,
 		ttl_strip_annotation (module->module_ast_name)));
 
@@ -223,6 +223,7 @@ ttl_make_function (ttl_pool pool, enum ttl_function_kind kind,
   fun->locals = NULL;
   fun->enclosing = NULL;
   fun->enclosed = NULL;
+  fun->closed = 0;
   fun->next = NULL;
   fun->total_next = NULL;
 /*   fun->variant = 0; */
@@ -242,6 +243,7 @@ ttl_make_function (ttl_pool pool, enum ttl_function_kind kind,
 /*   fun->nesting_level = 0; */
 /*   fun->il_code = NULL; */
   fun->asm_code = NULL;
+  fun->loop_label = NULL;
   fun->documentation = NULL;
   return fun;
 }
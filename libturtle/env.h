@@ -100,10 +100,13 @@ struct ttl_function
   ttl_variable locals;		/* Local variables. */
   ttl_function enclosing;	/* Enclosing function.  */
   ttl_function enclosed;	/* Enclosed function(s).  */
+  unsigned closed;		/* Non-zero if nested, but without free
+				   variables.  */
   ttl_function next;		/* Next function in same scope.  */
   ttl_function total_next;	/* Next function in module.  */
 
   unsigned variant_count;	/* How many variants are there?  */
+  unsigned nullary_count;	/* How many of them have no fields?  */
   union {
     struct {
       unsigned field_count;	/* Number of fields in variant.  */
@@ -112,6 +115,8 @@ struct ttl_function
     } constr_discrim;
     struct {
       ttl_field_list field_list; /* Fields in function.  */
+      unsigned fixed;		/* Non-zero if the fields are never
+				   changed after construction.  */
 #if 0
       int constrainable;       /* True iff field is constrainable.  */
 #endif
@@ -119,6 +124,9 @@ struct ttl_function
     struct {
       unsigned handcoded;	/* Non-zero if implemented in C.  */
       unsigned mapped;		/* Non-zero if mapped to C function.  */
+      unsigned leaf;		/* Non-zero if the C function neither
+				   allocates nor calls back into Turtle
+				   code.  */
       ttl_symbol alias;		/* Name of the mapped function.  */
 
       /* fixme: Make the following type-safe!  */
@@ -128,8 +136,12 @@ struct ttl_function
   } d;
 
   void * asm_code;		/* Same in assembly language.  */
+  void * loop_label;		/* Label after the environment setup,
+				   target of tail calls compiled into
+				   jumps.  */
 
   ttl_variable variable;	/* Variable holding this function's value.  */
+  struct ttl_module * module;	/* Defining module of imported functions.  */
 
 
   unsigned exported;		/* Non-zero if mentioned in export clause.  */
@@ -0,0 +1,510 @@
+/* libturtle/fold.c -- Constant folding and dead code elimination.
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fold.h"
+#include "il.h"
+#include "util.h"
+
+/* Integers are represented as immediate values with two tag bits, so
+   the generated code computes modulo 2^30.  Wrap the value `v' in the
+   same way, so that folded expressions have the same result as the
+   code generated for `op_add', `op_mul' etc.  */
+static long
+wrap_int (long v)
+{
+  v &= 0x3fffffffL;
+  if (v & 0x20000000L)
+    v -= 0x40000000L;
+  return v;
+}
+
+static ttl_il_node
+make_int (ttl_compile_state state, long value, ttl_il_node node)
+{
+  return ttl_make_il_integer (state, wrap_int (value), node->filename,
+			      node->start_line, node->start_column,
+			      node->end_line, node->end_column);
+}
+
+static ttl_il_node
+make_bool (ttl_compile_state state, int value, ttl_il_node node)
+{
+  return ttl_make_il_bool (state, value, node->filename,
+			   node->start_line, node->start_column,
+			   node->end_line, node->end_column);
+}
+
+/* Fold the binary operation `node', whose operands are both integer
+   constants.  Return `node' unchanged if the operation would trap at
+   run time.  */
+static ttl_il_node
+fold_int_binop (ttl_compile_state state, ttl_il_node node)
+{
+  long a = wrap_int (node->d.binop.op0->d.integer.value);
+  long b = wrap_int (node->d.binop.op1->d.integer.value);
+
+  switch (node->d.binop.op)
+    {
+    case il_binop_add:
+      return make_int (state, a + b, node);
+    case il_binop_sub:
+      return make_int (state, a - b, node);
+    case il_binop_mul:
+      return make_int (state, a * b, node);
+    case il_binop_div:
+      if (b == 0)
+	return node;
+      return make_int (state, a / b, node);
+    case il_binop_mod:
+      if (b == 0)
+	return node;
+      return make_int (state, a % b, node);
+    case il_binop_eq:
+      return make_bool (state, a == b, node);
+    case il_binop_ne:
+      return make_bool (state, a != b, node);
+    case il_binop_lt:
+      return make_bool (state, a < b, node);
+    case il_binop_le:
+      return make_bool (state, a <= b, node);
+    case il_binop_gt:
+      return make_bool (state, a > b, node);
+    case il_binop_ge:
+      return make_bool (state, a >= b, node);
+    default:
+      return node;
+    }
+}
+
+/* Fold comparisons of character or boolean constants, whose values
+   are stored in `a' and `b'.  */
+static ttl_il_node
+fold_compare (ttl_compile_state state, ttl_il_node node, int a, int b)
+{
+  switch (node->d.binop.op)
+    {
+    case il_binop_eq:
+      return make_bool (state, a == b, node);
+    case il_binop_ne:
+      return make_bool (state, a != b, node);
+    case il_binop_lt:
+      return make_bool (state, a < b, node);
+    case il_binop_le:
+      return make_bool (state, a <= b, node);
+    case il_binop_gt:
+      return make_bool (state, a > b, node);
+    case il_binop_ge:
+      return make_bool (state, a >= b, node);
+    default:
+      return node;
+    }
+}
+
+static ttl_il_node
+fold_binop (ttl_compile_state state, ttl_il_node node)
+{
+  ttl_il_node op0 = node->d.binop.op0;
+  ttl_il_node op1 = node->d.binop.op1;
+
+  switch (node->d.binop.op)
+    {
+    case il_binop_assign:
+    case il_binop_cons:
+      return node;
+
+    case il_binop_and:
+      /* The right operand is only evaluated if the left one is true,
+	 so the left operand decides whether the whole expression can
+	 be replaced.  */
+      if (op0->kind == il_bool_const)
+	return op0->d.bool.value ? op1 : op0;
+      return node;
+
+    case il_binop_or:
+      if (op0->kind == il_bool_const)
+	return op0->d.bool.value ? op0 : op1;
+      return node;
+
+    default:
+      if (op0->kind == il_int_const && op1->kind == il_int_const)
+	return fold_int_binop (state, node);
+      else if (op0->kind == il_char_const && op1->kind == il_char_const)
+	return fold_compare (state, node, op0->d.character.value,
+			     op1->d.character.value);
+      else if (op0->kind == il_bool_const && op1->kind == il_bool_const &&
+	       (node->d.binop.op == il_binop_eq ||
+		node->d.binop.op == il_binop_ne))
+	return fold_compare (state, node, op0->d.bool.value,
+			     op1->d.bool.value);
+      return node;
+    }
+}
+
+static ttl_il_node
+fold_unop (ttl_compile_state state, ttl_il_node node)
+{
+  ttl_il_node op0 = node->d.unop.op0;
+
+  switch (node->d.unop.op)
+    {
+    case il_unop_neg:
+      if (op0->kind == il_int_const)
+	return make_int (state, -wrap_int (op0->d.integer.value), node);
+      return node;
+    case il_unop_not:
+      if (op0->kind == il_bool_const)
+	return make_bool (state, !op0->d.bool.value, node);
+      if (op0->kind == il_unop && op0->d.unop.op == il_unop_not)
+	return op0->d.unop.op0;
+      return node;
+    default:
+      return node;
+    }
+}
+
+/* Fold all constant subexpressions of the expression `node' and return
+   the resulting expression.  */
+static ttl_il_node
+fold_expr (ttl_compile_state state, ttl_il_node node)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return NULL;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    *slots[i] = fold_expr (state, *slots[i]);
+  switch (node->kind)
+    {
+    case il_binop:
+      return fold_binop (state, node);
+    case il_unop:
+      return fold_unop (state, node);
+    default:
+      return node;
+    }
+}
+
+static ttl_il_node fold_stmt_list (ttl_compile_state state, ttl_il_node list);
+
+/* Fold the statement `node'.  Return the statements which replace it,
+   as an `il_seq' node, or NULL if the statement can be removed
+   completely.  */
+static ttl_il_node
+fold_stmt (ttl_compile_state state, ttl_il_node node)
+{
+  switch (node->kind)
+    {
+    case il_if:
+      node->d.ifstmt.cond = fold_expr (state, node->d.ifstmt.cond);
+      node->d.ifstmt.thenstmt = fold_stmt_list (state,
+						node->d.ifstmt.thenstmt);
+      node->d.ifstmt.elsestmt = fold_stmt_list (state,
+						node->d.ifstmt.elsestmt);
+      if (node->d.ifstmt.cond->kind == il_bool_const)
+	{
+	  ttl_il_node taken = node->d.ifstmt.cond->d.bool.value ?
+	    node->d.ifstmt.thenstmt : node->d.ifstmt.elsestmt;
+	  return taken ? ttl_make_il_seq (state, taken) : NULL;
+	}
+      return node;
+
+    case il_while:
+      node->d.whilestmt.cond = fold_expr (state, node->d.whilestmt.cond);
+      if (node->d.whilestmt.cond->kind == il_bool_const &&
+	  !node->d.whilestmt.cond->d.bool.value)
+	return NULL;
+      node->d.whilestmt.dostmt = fold_stmt_list (state,
+						 node->d.whilestmt.dostmt);
+      return node;
+
+    case il_in:
+      node->d.instmt.instmt = fold_stmt_list (state, node->d.instmt.instmt);
+      return node;
+
+    case il_require:
+      node->d.require.expr = fold_expr (state, node->d.require.expr);
+      node->d.require.stmt = fold_stmt_list (state, node->d.require.stmt);
+      return node;
+
+    case il_seq:
+      node->d.seq.stmts = fold_stmt_list (state, node->d.seq.stmts);
+      return node->d.seq.stmts ? node : NULL;
+
+    default:
+      return fold_expr (state, node);
+    }
+}
+
+/* Return non-zero if control never reaches the statement following
+   `node'.  */
+static int
+terminates_p (ttl_il_node node)
+{
+  if (node->kind == il_return)
+    return 1;
+  else if (node->kind == il_seq)
+    {
+      ttl_il_node l = node->d.seq.stmts;
+      while (l)
+	{
+	  if (terminates_p (l->d.pair.car))
+	    return 1;
+	  l = l->d.pair.cdr;
+	}
+    }
+  else if (node->kind == il_if)
+    {
+      ttl_il_node t = node->d.ifstmt.thenstmt;
+      ttl_il_node e = node->d.ifstmt.elsestmt;
+      int t_term = 0, e_term = 0;
+
+      while (t)
+	{
+	  t_term |= terminates_p (t->d.pair.car);
+	  t = t->d.pair.cdr;
+	}
+      while (e)
+	{
+	  e_term |= terminates_p (e->d.pair.car);
+	  e = e->d.pair.cdr;
+	}
+      return t_term && e_term;
+    }
+  return 0;
+}
+
+/* Fold all statements in `list', remove statements which have become
+   empty and statements which follow a statement which always
+   returns.  */
+static ttl_il_node
+fold_stmt_list (ttl_compile_state state, ttl_il_node list)
+{
+  ttl_il_node l = list, * p = &list;
+
+  while (l)
+    {
+      ttl_il_node stmt = fold_stmt (state, l->d.pair.car);
+
+      if (stmt)
+	{
+	  l->d.pair.car = stmt;
+	  if (terminates_p (stmt))
+	    {
+	      l->d.pair.cdr = NULL;
+	      break;
+	    }
+	  p = &l->d.pair.cdr;
+	  l = l->d.pair.cdr;
+	}
+      else
+	{
+	  l = l->d.pair.cdr;
+	  *p = l;
+	}
+    }
+  return list;
+}
+
+
+/* Constant propagation.  A local variable which is assigned exactly
+   once, by an assignment of a constant in the straight-line part of a
+   function body, is replaced by that constant in all statements
+   following the assignment.  */
+
+/* Return non-zero if `node' is a constant which can be duplicated
+   freely.  */
+static int
+propagatable_p (ttl_il_node node)
+{
+  return node->kind == il_int_const || node->kind == il_char_const ||
+    node->kind == il_bool_const;
+}
+
+/* Return the number of references to the variable `var' in `node'.  */
+static int
+count_references (ttl_il_node node, ttl_variable var)
+{
+  ttl_il_node * slots[3];
+  int i, n, count = 0;
+
+  if (!node)
+    return 0;
+  if (node->kind == il_variable)
+    return node->d.variable.variable == var;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    count += count_references (*slots[i], var);
+  return count;
+}
+
+/* Count the assignments to the variable `var' in `node'.  Uses of the
+   variable other than as a simple value, as in `var x', are counted
+   as assignments, too.  */
+static int
+count_assignments (ttl_il_node node, ttl_variable var)
+{
+  ttl_il_node * slots[3];
+  int i, n, count = 0;
+
+  if (!node)
+    return 0;
+
+  /* Any reference on the left hand side of an assignment, as in tuple
+     assignments, is counted.  */
+  if (node->kind == il_binop && node->d.binop.op == il_binop_assign)
+    return count_references (node->d.binop.op0, var) +
+      count_assignments (node->d.binop.op1, var);
+  else if ((node->kind == il_var_expr || node->kind == il_in ||
+	    node->kind == il_require) && count_references (node, var) > 0)
+    return 2;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    count += count_assignments (*slots[i], var);
+  return count;
+}
+
+/* Replace all references to `var' in `node' by copies of `value'.  */
+static ttl_il_node
+substitute (ttl_compile_state state, ttl_il_node node, ttl_variable var,
+	    ttl_il_node value)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return NULL;
+  if (node->kind == il_variable && node->d.variable.variable == var)
+    {
+      ttl_il_node copy = ttl_malloc (state->pool,
+				     sizeof (struct ttl_il_node));
+      *copy = *value;
+      return copy;
+    }
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    *slots[i] = substitute (state, *slots[i], var, value);
+  return node;
+}
+
+/* Substitute `value' for `var' in all statements of `list' and in the
+   statements following the enclosing `il_seq' nodes, which are
+   recorded in `rest'.  */
+typedef struct fold_rest * fold_rest;
+struct fold_rest
+{
+  fold_rest next;
+  ttl_il_node list;
+};
+
+static void
+propagate (ttl_compile_state state, ttl_il_node list, fold_rest rest,
+	   ttl_variable var, ttl_il_node value)
+{
+  while (list)
+    {
+      list->d.pair.car = substitute (state, list->d.pair.car, var, value);
+      list = list->d.pair.cdr;
+    }
+  if (rest)
+    propagate (state, rest->list, rest->next, var, value);
+}
+
+/* Propagate the constant assignments in the straight-line statement
+   list `list' of `function'.  The right hand sides of assignments are
+   folded on the way, so that constants propagated into them are
+   propagated further.  */
+static void
+propagate_list (ttl_compile_state state, ttl_function function,
+		ttl_il_node list, fold_rest rest)
+{
+  while (list)
+    {
+      ttl_il_node stmt = list->d.pair.car;
+
+      if (stmt->kind == il_seq)
+	{
+	  struct fold_rest r;
+
+	  r.next = rest;
+	  r.list = list->d.pair.cdr;
+	  propagate_list (state, function, stmt->d.seq.stmts, &r);
+	}
+      else if (stmt->kind == il_binop && stmt->d.binop.op == il_binop_assign &&
+	       stmt->d.binop.op0->kind == il_variable &&
+	       propagatable_p (stmt->d.binop.op1 =
+			       fold_expr (state, stmt->d.binop.op1)))
+	{
+	  ttl_variable var = stmt->d.binop.op0->d.variable.variable;
+
+	  if (var && var->kind == variable_local && var->defining == function &&
+	      ttl_types_equal (var->type, stmt->d.binop.op1->type) &&
+	      count_assignments (function->d.function.il_code, var) == 1)
+	    {
+	      propagate (state, list->d.pair.cdr, rest, var,
+			 stmt->d.binop.op1);
+
+	      /* Remove the assignment if the variable is not referenced
+		 anymore.  The empty sequence is removed by folding.  */
+	      if (count_references (function->d.function.il_code, var) == 1)
+		list->d.pair.car = ttl_make_il_seq (state, NULL);
+	    }
+	}
+      list = list->d.pair.cdr;
+    }
+}
+
+void
+ttl_fold_module (ttl_compile_state state, ttl_module module)
+{
+  ttl_function function;
+
+  for (function = module->functions; function;
+       function = function->total_next)
+    {
+      if (function->kind != function_function ||
+	  function->d.function.handcoded || function->d.function.mapped ||
+	  !function->d.function.il_code)
+	continue;
+      function->d.function.il_code =
+	fold_stmt_list (state, function->d.function.il_code);
+
+      /* Nested functions may assign to the local variables of their
+	 enclosing functions, so do not propagate constants out of
+	 functions with nested functions.  Propagated constants may
+	 enable further folding.  */
+      if (!function->enclosed && function->d.function.il_code)
+	{
+	  propagate_list (state, function, function->d.function.il_code,
+			  NULL);
+	  function->d.function.il_code =
+	    fold_stmt_list (state, function->d.function.il_code);
+	}
+      if (!function->d.function.il_code)
+	function->d.function.il_code =
+	  ttl_make_il_pair (state, ttl_make_il_seq (state, NULL), NULL);
+    }
+}
+
+/* End of fold.c.  */
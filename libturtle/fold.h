@@ -0,0 +1,33 @@
+/* libturtle/fold.h - constant folding and dead code elimination
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+#ifndef TTL_FOLD_H
+#define TTL_FOLD_H
+
+#include "env.h"
+#include "compiler.h"
+
+/* Simplify the intermediate code of all functions in `module'.
+   Operators applied to constants are evaluated at compile time, local
+   variables which are initialized with a constant and never modified
+   are replaced by the constant, and statements which can never be
+   executed are removed.  */
+void ttl_fold_module (ttl_compile_state state, ttl_module module);
+
+#endif /* not TTL_FOLD_H */
@@ -0,0 +1,611 @@
+/* libturtle/fuse.c -- Fusion of list and array pipelines.
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fuse.h"
+#include "il.h"
+#include "util.h"
+
+/* A pipeline like
+
+     listfold.ifoldl (add, 0, lists.filter (even?,
+                                            listmap.map (square,
+                                                         lists.iota (n))))
+
+   is compiled into a single loop, where every element is passed
+   through all stages before the next element is produced:
+
+     f := add; acc := 0; f1 := even?; f2 := square; count := n; i := 0;
+     while i < count do
+       x := i; i := i + 1;
+       x1 := f2 (x);
+       if f1 (x1) then
+         acc := f (acc, x1);
+       end;
+     end;
+
+   Note that this changes the order in which the functions passed to
+   the stages are called.  The transformation is therefore only
+   performed when requested with the `-O L' option.  */
+
+/* Maximal number of `map' and `filter' stages in one loop.  Further
+   stages are evaluated normally and their result is used as the
+   source of the loop.  */
+#define FUSE_MAX_STAGES 16
+
+enum fuse_kind
+  {
+    fuse_none,
+    fuse_iota,			/* Source.  */
+    fuse_map,			/* Stages.  */
+    fuse_filter,
+    fuse_array_map,
+    fuse_foreach,		/* Consumers.  */
+    fuse_array_foreach,
+    fuse_foldl,
+    fuse_ifoldl,
+    fuse_reducel
+  };
+
+/* The library functions known to this pass, identified by their
+   mangled names.  `source' is the index of the list or array
+   argument.  */
+static struct
+{
+  char * mangled_name;
+  enum fuse_kind kind;
+  int source;
+} fuse_functions[] =
+  {
+    {"lists_iota_pF1pI_pLpI", fuse_iota, -1},
+    {"listmap_map_pF2pF1uA_uBpLuA_pLuB", fuse_map, 1},
+    {"lists_filter_pF2pF1uA_pBpLuA_pLuA", fuse_filter, 1},
+    {"arraymap_map_pF2pF1uA_uBpAuA_pAuB", fuse_array_map, 1},
+    {"lists_foreach_pF2pF1uA_pVpLuA_pV", fuse_foreach, 1},
+    {"arrays_foreach_pF2pF1uA_pVpAuA_pV", fuse_array_foreach, 1},
+    {"listfold_foldl_pF2pF2uAuA_uApLuA_uA", fuse_foldl, 1},
+    {"listfold_ifoldl_pF3pF2uAuA_uAuApLuA_uA", fuse_ifoldl, 2},
+    {"listreduce_reducel_pF3pF2ufromuto_utoutopLufrom_uto",
+     fuse_reducel, 2},
+    {NULL, fuse_none, -1}
+  };
+
+/* A recognized pipeline.  */
+typedef struct fuse_pipeline * fuse_pipeline;
+struct fuse_pipeline
+{
+  enum fuse_kind consumer;
+  ttl_il_node call;		/* Call of the consumer.  */
+  int stage_count;
+  ttl_il_node stages[FUSE_MAX_STAGES]; /* Calls of the stages, the
+					  outermost first.  */
+  ttl_il_node source;		/* Source list or array expression, or
+				   call of `lists.iota'.  */
+  int iota;			/* Non-zero if `source' calls `iota'.  */
+};
+
+/* A function argument of a stage or consumer, which is either a
+   known function or has been stored into a temporary variable.  */
+typedef struct fuse_value * fuse_value;
+struct fuse_value
+{
+  ttl_il_node function;
+  ttl_variable var;
+};
+
+/* The function currently transformed.  */
+static ttl_function fuse_function = NULL;
+
+/* The call of the consumer currently transformed.  Its source
+   location is used for all generated code.  */
+static ttl_il_node fuse_site = NULL;
+
+#define SITE fuse_site->filename, fuse_site->start_line, \
+  fuse_site->start_column, fuse_site->end_line, fuse_site->end_column
+
+/* Return the kind of the library function called by `node', or
+   `fuse_none' if `node' is no call of a known function.  */
+static enum fuse_kind
+call_kind (ttl_il_node node)
+{
+  ttl_symbol name;
+  int i;
+
+  if (!node || node->kind != il_call ||
+      node->d.call.function->kind != il_function)
+    return fuse_none;
+  name = node->d.call.function->d.function.mangled_name;
+  for (i = 0; fuse_functions[i].mangled_name; i++)
+    if (name->length == strlen (fuse_functions[i].mangled_name) &&
+	!memcmp (name->text, fuse_functions[i].mangled_name, name->length))
+      return fuse_functions[i].kind;
+  return fuse_none;
+}
+
+/* Return the `n'th argument of the call `call'.  */
+static ttl_il_node
+call_arg (ttl_il_node call, int n)
+{
+  ttl_il_node args = call->d.call.args;
+
+  while (n-- > 0)
+    args = args->d.pair.cdr;
+  return args->d.pair.car;
+}
+
+/* Return the list or array argument of the call `call' of a known
+   function.  */
+static ttl_il_node
+source_arg (ttl_il_node call)
+{
+  enum fuse_kind kind = call_kind (call);
+  int i = 0;
+
+  while (fuse_functions[i].kind != kind)
+    i++;
+  return call_arg (call, fuse_functions[i].source);
+}
+
+/* Fill in `p' if `call' is the call of a consumer whose argument is
+   built by at least one stage or by `iota'.  Return non-zero on
+   success.  */
+static int
+find_pipeline (ttl_il_node call, fuse_pipeline p)
+{
+  enum fuse_kind kind = call_kind (call), stage;
+  ttl_il_node node;
+  int array;
+
+  switch (kind)
+    {
+    case fuse_foreach:
+    case fuse_array_foreach:
+    case fuse_foldl:
+    case fuse_ifoldl:
+    case fuse_reducel:
+      break;
+    default:
+      return 0;
+    }
+  array = kind == fuse_array_foreach;
+  p->consumer = kind;
+  p->call = call;
+  p->stage_count = 0;
+  node = source_arg (call);
+  while (p->stage_count < FUSE_MAX_STAGES)
+    {
+      stage = call_kind (node);
+      if (array ? stage != fuse_array_map :
+	  stage != fuse_map && stage != fuse_filter)
+	break;
+      p->stages[p->stage_count++] = node;
+      node = source_arg (node);
+    }
+  p->source = node;
+  p->iota = !array && call_kind (node) == fuse_iota;
+  return p->stage_count > 0 || p->iota;
+}
+
+/* Create a new local variable of the current function.  */
+static ttl_variable
+make_temp (ttl_compile_state state, char * name, ttl_type type)
+{
+  ttl_variable var = ttl_make_variable (state->pool, variable_local,
+					type, 0);
+  ttl_variable * vp = &fuse_function->locals;
+
+  var->name = ttl_symbol_enter (state->symbol_table, name, strlen (name));
+  var->unique_name =
+    ttl_uniquify_name (state, ttl_make_ast_identifier (state->pool,
+							var->name, NULL,
+							-1, -1, -1, -1));
+  var->defining = fuse_function;
+  var->index = fuse_function->param_count + fuse_function->local_count;
+  fuse_function->local_count++;
+  while (*vp)
+    vp = &((*vp)->next);
+  *vp = var;
+  return var;
+}
+
+/* Return a reference to the variable `var'.  */
+static ttl_il_node
+make_ref (ttl_compile_state state, ttl_variable var, unsigned lvalue)
+{
+  ttl_il_node ref = ttl_make_il_variable (state, NULL, var->unique_name,
+					  var->type, lvalue, NULL,
+					  -1, -1, -1, -1);
+  ref->d.variable.variable = var;
+  return ref;
+}
+
+static ttl_il_node
+make_assignment (ttl_compile_state state, ttl_variable var,
+		 ttl_il_node value)
+{
+  return ttl_make_il_binop (state, il_binop_assign,
+			    make_ref (state, var, 1), value,
+			    state->void_type, SITE);
+}
+
+/* Append `stmt' to the statement list ending in `*tail'.  */
+static void
+append (ttl_compile_state state, ttl_il_node ** tail, ttl_il_node stmt)
+{
+  **tail = ttl_make_il_pair (state, stmt, NULL);
+  *tail = &((**tail)->d.pair.cdr);
+}
+
+/* Evaluate the function argument `expr' into `value'.  Known
+   functions are called directly, everything else is stored into a
+   temporary, so that it is evaluated only once and in the original
+   order.  */
+static void
+bind_value (ttl_compile_state state, ttl_il_node expr, ttl_il_node ** tail,
+	    fuse_value value)
+{
+  if (expr->kind == il_function)
+    {
+      value->function = expr;
+      value->var = NULL;
+    }
+  else
+    {
+      value->function = NULL;
+      value->var = make_temp (state, "f", expr->type);
+      append (state, tail, make_assignment (state, value->var, expr));
+    }
+}
+
+/* Return a call of `value' with one or two arguments.  */
+static ttl_il_node
+make_call (ttl_compile_state state, fuse_value value, ttl_il_node arg0,
+	   ttl_il_node arg1, ttl_type type)
+{
+  ttl_il_node func, args;
+
+  if (value->function)
+    func = ttl_make_il_function (state, value->function->d.function.name,
+				 value->function->d.function.mangled_name,
+				 value->function->type,
+				 value->function->d.function.function);
+  else
+    func = make_ref (state, value->var, 0);
+  args = arg1 ? ttl_make_il_pair (state, arg1, NULL) : NULL;
+  args = ttl_make_il_pair (state, arg0, args);
+  return ttl_make_il_call (state, func, args, type, SITE);
+}
+
+/* Return the element type of the list or array type `type'.  */
+static ttl_type
+element_type (ttl_type type)
+{
+  if (type->kind == type_array)
+    return type->d.array.element;
+  return type->d.list.element;
+}
+
+/* Return the statements replacing the statement `stmt', which
+   contains the consumer call of the pipeline `p'.  */
+static ttl_il_node
+fuse (ttl_compile_state state, fuse_pipeline p, ttl_il_node stmt)
+{
+  ttl_il_node call = p->call;
+  ttl_il_node stmts = NULL, * sp = &stmts;
+  ttl_il_node body = NULL, * bp = &body;
+  ttl_il_node cond, elem_expr;
+  struct fuse_value consumer_fn, stage_fn[FUSE_MAX_STAGES];
+  ttl_variable acc = NULL, first = NULL, src = NULL, index = NULL;
+  ttl_variable elem;
+  int i;
+
+  fuse_site = call;
+
+  /* Evaluate all arguments in the order of the original calls.  */
+  bind_value (state, call_arg (call, 0), &sp, &consumer_fn);
+  if (p->consumer == fuse_ifoldl || p->consumer == fuse_reducel)
+    {
+      acc = make_temp (state, "acc", call->type);
+      append (state, &sp, make_assignment (state, acc, call_arg (call, 1)));
+    }
+  else if (p->consumer == fuse_foldl)
+    {
+      acc = make_temp (state, "acc", call->type);
+      first = make_temp (state, "first", state->bool_type);
+      append (state, &sp,
+	      make_assignment (state, first,
+			       ttl_make_il_bool (state, 1, SITE)));
+    }
+  for (i = 0; i < p->stage_count; i++)
+    bind_value (state, call_arg (p->stages[i], 0), &sp, &stage_fn[i]);
+
+  /* Loop over the source.  */
+  if (p->iota)
+    {
+      ttl_variable count = make_temp (state, "count", state->int_type);
+
+      append (state, &sp,
+	      make_assignment (state, count, call_arg (p->source, 0)));
+      index = make_temp (state, "i", state->int_type);
+      cond = ttl_make_il_binop (state, il_binop_lt,
+				make_ref (state, index, 0),
+				make_ref (state, count, 0),
+				state->bool_type, SITE);
+      elem = make_temp (state, "x", state->int_type);
+      elem_expr = make_ref (state, index, 0);
+    }
+  else
+    {
+      ttl_type type = element_type (p->source->type);
+
+      src = make_temp (state, "src", p->source->type);
+      append (state, &sp, make_assignment (state, src, p->source));
+      elem = make_temp (state, "x", type);
+      if (p->source->type->kind == type_array)
+	{
+	  index = make_temp (state, "i", state->int_type);
+	  cond = ttl_make_il_binop
+	    (state, il_binop_lt, make_ref (state, index, 0),
+	     ttl_make_il_unop (state, il_unop_sizeof,
+			       make_ref (state, src, 0), state->int_type,
+			       SITE),
+	     state->bool_type, SITE);
+	  elem_expr = ttl_make_il_index (state, make_ref (state, src, 0),
+					 make_ref (state, index, 0), type,
+					 SITE);
+	}
+      else
+	{
+	  cond = ttl_make_il_binop (state, il_binop_ne,
+				    make_ref (state, src, 0),
+				    ttl_make_il_null (state, SITE),
+				    state->bool_type, SITE);
+	  elem_expr = ttl_make_il_unop (state, il_unop_hd,
+					make_ref (state, src, 0), type, SITE);
+	}
+    }
+  if (index)
+    append (state, &sp,
+	    make_assignment (state, index,
+			     ttl_make_il_integer (state, 0, SITE)));
+  append (state, &bp, make_assignment (state, elem, elem_expr));
+  if (index)
+    append (state, &bp,
+	    make_assignment (state, index,
+			     ttl_make_il_binop
+			     (state, il_binop_add, make_ref (state, index, 0),
+			      ttl_make_il_integer (state, 1, SITE),
+			      state->int_type, SITE)));
+  else if (src)
+    append (state, &bp,
+	    make_assignment (state, src,
+			     ttl_make_il_unop (state, il_unop_tl,
+					       make_ref (state, src, 0),
+					       src->type, SITE)));
+
+  /* Pass the element through the stages, the innermost first.  */
+  for (i = p->stage_count - 1; i >= 0; i--)
+    {
+      if (call_kind (p->stages[i]) == fuse_filter)
+	{
+	  ttl_il_node test =
+	    ttl_make_il_if (state,
+			    make_call (state, &stage_fn[i],
+				       make_ref (state, elem, 0), NULL,
+				       state->bool_type),
+			    NULL, NULL, SITE);
+	  append (state, &bp, test);
+	  bp = &test->d.ifstmt.thenstmt;
+	}
+      else
+	{
+	  ttl_type type = element_type (p->stages[i]->type);
+	  ttl_variable next = make_temp (state, "x", type);
+
+	  append (state, &bp,
+		  make_assignment (state, next,
+				   make_call (state, &stage_fn[i],
+					      make_ref (state, elem, 0),
+					      NULL, type)));
+	  elem = next;
+	}
+    }
+
+  /* Consume it.  */
+  switch (p->consumer)
+    {
+    case fuse_foreach:
+    case fuse_array_foreach:
+      append (state, &bp,
+	      make_call (state, &consumer_fn, make_ref (state, elem, 0), NULL,
+			 state->void_type));
+      break;
+    case fuse_ifoldl:
+      append (state, &bp,
+	      make_assignment (state, acc,
+			       make_call (state, &consumer_fn,
+					  make_ref (state, acc, 0),
+					  make_ref (state, elem, 0),
+					  acc->type)));
+      break;
+    case fuse_reducel:
+      append (state, &bp,
+	      make_assignment (state, acc,
+			       make_call (state, &consumer_fn,
+					  make_ref (state, elem, 0),
+					  make_ref (state, acc, 0),
+					  acc->type)));
+      break;
+    case fuse_foldl:
+      {
+	ttl_il_node init = NULL, * ip = &init;
+	ttl_il_node step = NULL, * tp = &step;
+
+	append (state, &ip,
+		make_assignment (state, first,
+				 ttl_make_il_bool (state, 0, SITE)));
+	append (state, &ip,
+		make_assignment (state, acc, make_ref (state, elem, 0)));
+	append (state, &tp,
+		make_assignment (state, acc,
+				 make_call (state, &consumer_fn,
+					    make_ref (state, acc, 0),
+					    make_ref (state, elem, 0),
+					    acc->type)));
+	append (state, &bp,
+		ttl_make_il_if (state, make_ref (state, first, 0), init, step,
+				SITE));
+	break;
+      }
+    default:
+      fprintf (stderr, "fuse: invalid consumer encountered\n");
+      abort ();
+    }
+  append (state, &sp, ttl_make_il_while (state, cond, body, SITE));
+
+  /* `foldl' takes the head of an empty list, which raises an
+     exception.  */
+  if (p->consumer == fuse_foldl)
+    {
+      ttl_il_node empty = ttl_make_il_null (state, SITE);
+      ttl_il_node raise = NULL, * rp = &raise;
+
+      empty->type = ttl_make_list_type (state->pool, acc->type);
+      append (state, &rp,
+	      make_assignment (state, acc,
+			       ttl_make_il_unop (state, il_unop_hd, empty,
+						 acc->type, SITE)));
+      append (state, &sp,
+	      ttl_make_il_if (state, make_ref (state, first, 0), raise, NULL,
+			      SITE));
+    }
+
+  if (stmt->kind == il_binop)
+    append (state, &sp,
+	    ttl_make_il_binop (state, il_binop_assign, stmt->d.binop.op0,
+			       make_ref (state, acc, 0), state->void_type,
+			       stmt->filename, stmt->start_line,
+			       stmt->start_column, stmt->end_line,
+			       stmt->end_column));
+  else if (stmt->kind == il_return)
+    append (state, &sp,
+	    ttl_make_il_return (state, make_ref (state, acc, 0),
+				stmt->filename, stmt->start_line,
+				stmt->start_column, stmt->end_line,
+				stmt->end_column));
+
+  if (state->compile_options->verbose >= 1)
+    {
+      if (call->filename)
+	printf ("%s:%d: ", call->filename, call->start_line + 1);
+      printf ("fusing %d stage%s into a loop in ", p->stage_count,
+	      p->stage_count == 1 ? "" : "s");
+      if (fuse_function->name)
+	ttl_symbol_print (stdout, fuse_function->name);
+      else
+	printf ("<anonymous>");
+      printf ("\n");
+    }
+  return ttl_make_il_seq (state, stmts);
+}
+
+static void fuse_stmt_list (ttl_compile_state state, ttl_il_node list);
+
+/* Return the replacement of the statement `node'.  Pipelines are
+   recognized as expression statements, as the right hand side of
+   assignments to variables and as return values.  */
+static ttl_il_node
+fuse_stmt (ttl_compile_state state, ttl_il_node node)
+{
+  struct fuse_pipeline p;
+
+  if (!node)
+    return NULL;
+  switch (node->kind)
+    {
+    case il_call:
+      if (find_pipeline (node, &p))
+	return fuse (state, &p, node);
+      return node;
+
+    case il_binop:
+      if (node->d.binop.op == il_binop_assign &&
+	  node->d.binop.op0->kind == il_variable &&
+	  find_pipeline (node->d.binop.op1, &p))
+	return fuse (state, &p, node);
+      return node;
+
+    case il_return:
+      if (node->d.returnstmt.expr &&
+	  find_pipeline (node->d.returnstmt.expr, &p))
+	return fuse (state, &p, node);
+      return node;
+
+    case il_if:
+      fuse_stmt_list (state, node->d.ifstmt.thenstmt);
+      fuse_stmt_list (state, node->d.ifstmt.elsestmt);
+      return node;
+
+    case il_while:
+      fuse_stmt_list (state, node->d.whilestmt.dostmt);
+      return node;
+
+    case il_seq:
+      fuse_stmt_list (state, node->d.seq.stmts);
+      return node;
+
+    default:
+      return node;
+    }
+}
+
+static void
+fuse_stmt_list (ttl_compile_state state, ttl_il_node list)
+{
+  while (list)
+    {
+      list->d.pair.car = fuse_stmt (state, list->d.pair.car);
+      list = list->d.pair.cdr;
+    }
+}
+
+void
+ttl_fuse_module (ttl_compile_state state, ttl_module module)
+{
+  ttl_function function;
+
+  for (function = module->functions; function;
+       function = function->total_next)
+    {
+      if (function->kind != function_function ||
+	  function->d.function.handcoded || function->d.function.mapped ||
+	  !function->d.function.il_code)
+	continue;
+      fuse_function = function;
+      fuse_stmt_list (state, (ttl_il_node) function->d.function.il_code);
+    }
+  fuse_function = NULL;
+  fuse_site = NULL;
+}
+
+/* End of fuse.c.  */
@@ -0,0 +1,34 @@
+/* libturtle/fuse.h - fusion of list and array pipelines
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+#ifndef TTL_FUSE_H
+#define TTL_FUSE_H
+
+#include "env.h"
+#include "compiler.h"
+
+/* Replace chains of calls to the list and array functions of the
+   standard library (`lists.iota', `listmap.map', `lists.filter',
+   `arraymap.map', consumed by `lists.foreach', `arrays.foreach',
+   `listfold.foldl', `listfold.ifoldl' or `listreduce.reducel') in all
+   functions of `module' by single loops, which do not construct the
+   intermediate lists and arrays.  */
+void ttl_fuse_module (ttl_compile_state state, ttl_module module);
+
+#endif /* not TTL_FUSE_H */
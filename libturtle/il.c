@@ -380,6 +380,7 @@ ttl_make_il_index (ttl_compile_state state, ttl_il_node array,
 				       beg_line, beg_col, end_line, end_col);
   node->d.index.array = array;
   node->d.index.index = index;
+  node->d.index.unchecked = 0;
   return node;
 }
 
@@ -816,6 +817,87 @@ ttl_il_reverse (ttl_compile_state state, ttl_il_node list)
   return res;
 }
 
+int
+ttl_il_child_slots (ttl_il_node node, ttl_il_node * slots[])
+{
+  switch (node->kind)
+    {
+    case il_pair:
+      slots[0] = &node->d.pair.car;
+      slots[1] = &node->d.pair.cdr;
+      return 2;
+    case il_binop:
+      slots[0] = &node->d.binop.op0;
+      slots[1] = &node->d.binop.op1;
+      return 2;
+    case il_unop:
+      slots[0] = &node->d.unop.op0;
+      return 1;
+    case il_if:
+      slots[0] = &node->d.ifstmt.cond;
+      slots[1] = &node->d.ifstmt.thenstmt;
+      slots[2] = &node->d.ifstmt.elsestmt;
+      return 3;
+    case il_while:
+      slots[0] = &node->d.whilestmt.cond;
+      slots[1] = &node->d.whilestmt.dostmt;
+      return 2;
+    case il_in:
+      slots[0] = &node->d.instmt.instmt;
+      return 1;
+    case il_call:
+      slots[0] = &node->d.call.function;
+      slots[1] = &node->d.call.args;
+      return 2;
+    case il_index:
+      slots[0] = &node->d.index.array;
+      slots[1] = &node->d.index.index;
+      return 2;
+    case il_return:
+      slots[0] = &node->d.returnstmt.expr;
+      return 1;
+    case il_require:
+      slots[0] = &node->d.require.expr;
+      slots[1] = &node->d.require.stmt;
+      return 2;
+    case il_array_expr:
+      slots[0] = &node->d.array_expr.elements;
+      return 1;
+    case il_list_expr:
+      slots[0] = &node->d.list_expr.elements;
+      return 1;
+    case il_tuple_expr:
+      slots[0] = &node->d.tuple_expr.elements;
+      return 1;
+    case il_array_constructor:
+      slots[0] = &node->d.array_constructor.size;
+      slots[1] = &node->d.array_constructor.initial;
+      return 2;
+    case il_list_constructor:
+      slots[0] = &node->d.list_constructor.size;
+      slots[1] = &node->d.list_constructor.initial;
+      return 2;
+    case il_string_constructor:
+      slots[0] = &node->d.string_constructor.size;
+      slots[1] = &node->d.string_constructor.initial;
+      return 2;
+    case il_seq:
+      slots[0] = &node->d.seq.stmts;
+      return 1;
+    case il_ann_expr:
+      slots[0] = &node->d.ann_expr.expr;
+      return 1;
+    case il_var_expr:
+      slots[0] = &node->d.var_expr.expr;
+      return 1;
+    case il_deref_expr:
+      slots[0] = &node->d.deref_expr.expr;
+      return 1;
+    default:
+      return 0;
+    }
+}
+
 static void
 dump_il_function (FILE * f, ttl_compile_state state, ttl_function function)
 {
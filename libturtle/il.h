@@ -231,6 +231,8 @@ struct ttl_il_index
 {
   ttl_il_node array;
   ttl_il_node index;
+  unsigned unchecked;		/* Non-zero if the index is known to be
+				   in range.  */
 };
 
 struct ttl_il_return
@@ -484,6 +486,12 @@ int ttl_il_print (FILE * f, ttl_il_node node, int indent);
 
 ttl_il_node ttl_il_reverse (ttl_compile_state state, ttl_il_node list);
 
+/* Store pointers to the fields of `node' which hold child nodes into
+   `slots' and return their number, which is at most 3.  This allows
+   passes over the intermediate code to traverse and rewrite the tree
+   without knowing about every node kind.  */
+int ttl_il_child_slots (ttl_il_node node, ttl_il_node * slots[]);
+
 void ttl_dump_il_module (FILE * f, ttl_compile_state state, ttl_module module);
 
 void ttl_il_print_list (FILE * f, ttl_il_node_list l);
@@ -0,0 +1,2615 @@
+/* libturtle/inline.c -- Inlining of small functions.
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "inline.h"
+#include "il.h"
+#include "util.h"
+#include "profile.h"
+
+/* Functions with more HIL nodes in their body are not inlined.  */
+#define INLINE_MAX_SIZE 24
+
+/* Limit for functions called from hot functions, when compiling with
+   an execution profile.  A function is hot if its execution frequency
+   is at least 1/INLINE_HOT_RATIO of the highest frequency in the
+   module.  */
+#define INLINE_HOT_MAX_SIZE 64
+#define INLINE_HOT_RATIO 10
+
+/* Maximal nesting of inlined function bodies.  This also stops the
+   expansion of mutually recursive functions.  */
+#define INLINE_MAX_DEPTH 4
+
+/* Functions with more HIL nodes in their body are neither specialized
+   nor written to interface files as statement lists.  */
+#define SPECIALIZE_MAX_SIZE 200
+
+/* Maximal number of specialized copies created for one module.  */
+#define SPECIALIZE_MAX_COPIES 32
+
+/* Calls with more arguments are not replaced by the body of the
+   called function in interface files.  */
+#define EXPAND_MAX_ARGS 8
+
+/* The shapes of function bodies which can be inlined.  */
+enum inline_kind
+  {inline_none,			/* Cannot be inlined.  */
+   inline_expr,			/* Body is a single `return EXPR'.  */
+   inline_proc};		/* Procedure body without `return'.  */
+
+/* Maps a parameter or local variable of an inlined function to the
+   expression or the variable of the caller which replaces it.  */
+typedef struct inline_subst * inline_subst;
+struct inline_subst
+{
+  inline_subst next;
+  ttl_variable from;
+  ttl_il_node expr;		/* Replacing expression, or NULL.  */
+  ttl_variable to;		/* Replacing variable otherwise.  */
+};
+
+/* Maps a function nested inside of a specialized function to its
+   copy.  */
+typedef struct function_map * function_map;
+struct function_map
+{
+  function_map next;
+  ttl_function from;
+  ttl_function to;
+};
+
+/* The function whose code is currently transformed.  New local
+   variables are allocated in this function.  */
+static ttl_function inline_caller = NULL;
+
+/* The functions which are currently being expanded.  */
+static ttl_function inline_active[INLINE_MAX_DEPTH];
+static int inline_depth = 0;
+
+/* Size limit for the functions inlined into `inline_caller'.  */
+static int inline_max_size = INLINE_MAX_SIZE;
+
+/* The expression evaluated first by the statement which is currently
+   transformed, or NULL if no statements may be inserted in front of
+   it.  Statements binding arguments to new variables are appended to
+   the list ending in `*inline_hoist_tail'.  */
+static ttl_il_node inline_hoist_root = NULL;
+static ttl_il_node ** inline_hoist_tail = NULL;
+
+/* The module whose interface file is currently written.  */
+static ttl_module export_module = NULL;
+
+/* The nested functions copied along with the function whose body is
+   currently copied by `specialize'.  */
+static function_map copied_functions = NULL;
+
+
+/* Return the number of HIL nodes in `node', not counting list
+   cells.  */
+static int
+il_size (ttl_il_node node)
+{
+  ttl_il_node * slots[3];
+  int i, n, size;
+
+  if (!node)
+    return 0;
+  size = (node->kind == il_pair || node->kind == il_seq) ? 0 : 1;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    size += il_size (*slots[i]);
+  return size;
+}
+
+/* Return the number of HIL nodes in the body of `function' and in the
+   bodies of the functions nested inside of it.  */
+static int
+function_size (ttl_function function)
+{
+  ttl_function f;
+  int size = il_size (function->d.function.il_code);
+
+  for (f = function->enclosed; f; f = f->next)
+    size += function_size (f);
+  return size;
+}
+
+/* Return non-zero if `node' contains only nodes which can be copied
+   into another function.  Return statements are only allowed if
+   `returns' is non-zero.  */
+static int
+copyable_p (ttl_il_node node, int returns)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return 1;
+  switch (node->kind)
+    {
+    case il_error:
+    case il_module:
+    case il_in:
+    case il_require:
+    case il_ann_expr:
+    case il_foreign_expr:
+    case il_var_expr:
+    case il_deref_expr:
+      return 0;
+    case il_return:
+      if (!returns)
+	return 0;
+      break;
+    default:
+      break;
+    }
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (!copyable_p (*slots[i], returns))
+      return 0;
+  return 1;
+}
+
+/* Return non-zero if `node' contains a function call.  */
+static int
+contains_call_p (ttl_il_node node)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return 0;
+  if (node->kind == il_call)
+    return 1;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (contains_call_p (*slots[i]))
+      return 1;
+  return 0;
+}
+
+/* Return the number of references to the variable `var' in `node'.  */
+static int
+count_uses (ttl_il_node node, ttl_variable var)
+{
+  ttl_il_node * slots[3];
+  int i, n, uses = 0;
+
+  if (!node)
+    return 0;
+  if (node->kind == il_variable)
+    return node->d.variable.variable == var;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    uses += count_uses (*slots[i], var);
+  return uses;
+}
+
+/* Return non-zero if `node' references a local variable (not a
+   parameter) of `function'.  */
+static int
+uses_locals_p (ttl_il_node node, ttl_function function)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return 0;
+  if (node->kind == il_variable)
+    return node->d.variable.variable &&
+      node->d.variable.variable->kind == variable_local &&
+      node->d.variable.variable->defining == function;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (uses_locals_p (*slots[i], function))
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if the variable `var' is assigned to in `node'.  */
+static int
+assigned_p (ttl_il_node node, ttl_variable var)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return 0;
+  if (node->kind == il_binop && node->d.binop.op == il_binop_assign &&
+      count_uses (node->d.binop.op0, var) > 0)
+    return 1;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (assigned_p (*slots[i], var))
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if the variable `var' is assigned to in the body of
+   `function' or of the functions nested inside of it.  */
+static int
+assigned_in_p (ttl_function function, ttl_variable var)
+{
+  ttl_function f;
+
+  if (assigned_p (function->d.function.il_code, var))
+    return 1;
+  for (f = function->enclosed; f; f = f->next)
+    if (assigned_in_p (f, var))
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if the variable `var' is the first value which is
+   evaluated when the expression `node' is evaluated.  */
+static int
+first_evaluated_p (ttl_il_node node, ttl_variable var)
+{
+  switch (node->kind)
+    {
+    case il_variable:
+      return node->d.variable.variable == var;
+    case il_binop:
+      return node->d.binop.op != il_binop_assign &&
+	first_evaluated_p (node->d.binop.op0, var);
+    case il_unop:
+      return first_evaluated_p (node->d.unop.op0, var);
+    case il_index:
+      return first_evaluated_p (node->d.index.array, var);
+    default:
+      return 0;
+    }
+}
+
+/* Search the expression `node' in evaluation order for the call
+   `call'.  Return 1 if it is found and only constants and function
+   references are evaluated before it, so that its arguments may be
+   evaluated before `node'.  Return -1 if anything else is evaluated
+   first, and 0 if `call' does not occur in `node'.  */
+static int
+hoist_point_p (ttl_il_node node, ttl_il_node call)
+{
+  ttl_il_node * slots[3];
+  int i, n, r;
+
+  if (!node)
+    return 0;
+  if (node == call)
+    return 1;
+  switch (node->kind)
+    {
+    case il_int_const:
+    case il_char_const:
+    case il_bool_const:
+    case il_null_const:
+    case il_function:
+      return 0;
+    case il_binop:
+      /* The second operand of `and' and `or' is evaluated
+	 conditionally.  */
+      if (node->d.binop.op == il_binop_and ||
+	  node->d.binop.op == il_binop_or)
+	{
+	  r = hoist_point_p (node->d.binop.op0, call);
+	  return r ? r : -1;
+	}
+      /* Fall through.  */
+    case il_pair:
+    case il_unop:
+    case il_index:
+    case il_call:
+    case il_array_expr:
+    case il_list_expr:
+    case il_tuple_expr:
+      n = ttl_il_child_slots (node, slots);
+      for (i = 0; i < n; i++)
+	if ((r = hoist_point_p (*slots[i], call)) != 0)
+	  return r;
+      /* Operators and calls may raise exceptions or have side
+	 effects.  */
+      if (node->kind == il_pair || node->kind == il_array_expr ||
+	  node->kind == il_list_expr || node->kind == il_tuple_expr)
+	return 0;
+      return -1;
+    default:
+      return -1;
+    }
+}
+
+/* Return non-zero if `node' is a constant without side effects.  */
+static int
+constant_p (ttl_il_node node)
+{
+  switch (node->kind)
+    {
+    case il_int_const:
+    case il_char_const:
+    case il_bool_const:
+    case il_null_const:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+static int
+constrained_variables_p (ttl_variable var)
+{
+  while (var)
+    {
+      if (var->type->kind == type_constrained)
+	return 1;
+      var = var->next;
+    }
+  return 0;
+}
+
+/* Return non-zero if `function' is `ancestor' or nested inside of
+   it.  */
+static int
+nested_in_p (ttl_function function, ttl_function ancestor)
+{
+  while (function && function != ancestor)
+    function = function->enclosing;
+  return function != NULL;
+}
+
+/* Return the expression of the single return statement making up the
+   body of `function'.  */
+static ttl_il_node
+body_expr (ttl_function function)
+{
+  ttl_il_node body = function->d.function.il_code;
+  return body->d.pair.car->d.returnstmt.expr;
+}
+
+/* Determine whether the body of `function' has a shape which allows
+   inlining, and is not larger than `max_size' nodes.  */
+static enum inline_kind
+body_kind (ttl_function function, int max_size)
+{
+  ttl_il_node body = function->d.function.il_code;
+
+  if (function->kind != function_function ||
+      function->d.function.handcoded || function->d.function.mapped ||
+      !body || function->enclosed ||
+      constrained_variables_p (function->params) ||
+      constrained_variables_p (function->locals) ||
+      il_size (body) > max_size)
+    return inline_none;
+  if (!body->d.pair.cdr && body->d.pair.car->kind == il_return &&
+      body->d.pair.car->d.returnstmt.expr &&
+      copyable_p (body->d.pair.car->d.returnstmt.expr, 0) &&
+      !uses_locals_p (body->d.pair.car->d.returnstmt.expr, function))
+    return inline_expr;
+  if (function->type->d.function.return_type->kind == type_void &&
+      copyable_p (body, 0))
+    return inline_proc;
+  return inline_none;
+}
+
+static void
+print_function_name (ttl_function function)
+{
+  if (function->name)
+    ttl_symbol_print (stdout, function->name);
+  else
+    printf ("<anonymous>");
+}
+
+/* Report an inlining decision for the call `call' to `callee', if
+   requested by the verbosity level.  Successful inlinings are
+   reported with level 1, refusals with level 2.  */
+static void
+report (ttl_compile_state state, ttl_il_node call, ttl_function callee,
+	char * reason)
+{
+  if (state->compile_options->verbose < (reason ? 2 : 1))
+    return;
+  if (call->filename)
+    printf ("%s:%d: ", call->filename, call->start_line + 1);
+  if (reason)
+    printf ("not inlining ");
+  else
+    printf ("inlining ");
+  print_function_name (callee);
+  printf (" into ");
+  print_function_name (inline_caller);
+  if (reason)
+    printf (": %s", reason);
+  printf ("\n");
+}
+
+/* Return the function called by `call', if it may be inlined at this
+   point, and store the shape of its body into `kind'.  */
+static ttl_function
+inline_candidate (ttl_compile_state state, ttl_il_node call,
+		  enum inline_kind * kind)
+{
+  ttl_function callee;
+  int i;
+
+  if (call->d.call.function->kind != il_function)
+    return NULL;
+  callee = call->d.call.function->d.function.function;
+  if (!callee || callee->kind != function_function ||
+      callee->d.function.handcoded || callee->d.function.mapped)
+    return NULL;
+  if (callee == inline_caller)
+    {
+      report (state, call, callee, "recursive call");
+      return NULL;
+    }
+  for (i = 0; i < inline_depth; i++)
+    if (inline_active[i] == callee)
+      {
+	report (state, call, callee, "recursive call");
+	return NULL;
+      }
+  if (inline_depth >= INLINE_MAX_DEPTH)
+    {
+      report (state, call, callee, "nesting too deep");
+      return NULL;
+    }
+  if (callee->enclosing && !callee->closed &&
+      !nested_in_p (inline_caller, callee->enclosing))
+    return NULL;
+  *kind = body_kind (callee, inline_max_size);
+  if (*kind == inline_none)
+    {
+      if (!callee->d.function.il_code)
+	report (state, call, callee, "body not available");
+      else
+	report (state, call, callee, "body too large or complex");
+      return NULL;
+    }
+  return callee;
+}
+
+/* Return non-zero if the parameters of `callee' can be replaced by the
+   argument expressions `args' in the body expression `expr' without
+   changing the evaluation order of side effects.  */
+static int
+substitutable_args_p (ttl_function callee, ttl_il_node expr,
+		      ttl_il_node args)
+{
+  ttl_variable param = callee->params;
+  int calls = contains_call_p (expr);
+  int variables = 0, complex = 0;
+
+  while (args)
+    {
+      ttl_il_node arg = args->d.pair.car;
+
+      if (!ttl_types_equal (arg->type, param->type))
+	return 0;
+      if (constant_p (arg))
+	;
+      else if (arg->kind == il_variable && !calls)
+	variables++;
+      else if (complex == 0 && !calls &&
+	       count_uses (expr, param) == 1 &&
+	       first_evaluated_p (expr, param))
+	complex++;
+      else
+	return 0;
+      args = args->d.pair.cdr;
+      param = param->next;
+    }
+  return complex == 0 || variables == 0;
+}
+
+/* Create a new local variable in the current caller, which replaces
+   the variable `proto' of an inlined function.  */
+static ttl_variable
+make_local (ttl_compile_state state, ttl_variable proto)
+{
+  ttl_variable var = ttl_make_variable (state->pool, variable_local,
+					proto->type, 0);
+  ttl_variable * vp = &inline_caller->locals;
+
+  var->name = proto->name;
+  var->unique_name =
+    ttl_uniquify_name (state, ttl_make_ast_identifier (state->pool,
+							proto->name, NULL,
+							-1, -1, -1, -1));
+  var->defining = inline_caller;
+  var->index = inline_caller->param_count + inline_caller->local_count;
+  inline_caller->local_count++;
+  while (*vp)
+    vp = &((*vp)->next);
+  *vp = var;
+  return var;
+}
+
+/* Create a statement assigning `value' to the variable `var'.  */
+static ttl_il_node
+make_assignment (ttl_compile_state state, ttl_variable var,
+		 ttl_il_node value, ttl_il_node call)
+{
+  ttl_il_node ref = ttl_make_il_variable (state, NULL, var->unique_name,
+					  var->type, 1, NULL,
+					  -1, -1, -1, -1);
+  ref->d.variable.variable = var;
+  return ttl_make_il_binop (state, il_binop_assign, ref, value,
+			    state->void_type, call->filename,
+			    call->start_line, call->start_column,
+			    call->end_line, call->end_column);
+}
+
+static inline_subst
+make_subst (ttl_compile_state state, ttl_variable from, ttl_il_node expr,
+	    ttl_variable to, inline_subst next)
+{
+  inline_subst s = ttl_malloc (state->pool, sizeof (struct inline_subst));
+  s->next = next;
+  s->from = from;
+  s->expr = expr;
+  s->to = to;
+  return s;
+}
+
+/* Return a copy of `node', where all variables are replaced as
+   specified by `subst', and references to the functions in
+   `copied_functions' by their copies.  */
+static ttl_il_node
+copy_il (ttl_compile_state state, ttl_il_node node, inline_subst subst)
+{
+  ttl_il_node copy;
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return NULL;
+  if (node->kind == il_variable)
+    {
+      inline_subst s = subst;
+      while (s && s->from != node->d.variable.variable)
+	s = s->next;
+      if (s && s->expr)
+	return copy_il (state, s->expr, NULL);
+      copy = ttl_malloc (state->pool, sizeof (struct ttl_il_node));
+      *copy = *node;
+      if (s)
+	{
+	  copy->d.variable.variable = s->to;
+	  copy->d.variable.mangled_name = s->to->unique_name;
+	}
+      return copy;
+    }
+  copy = ttl_malloc (state->pool, sizeof (struct ttl_il_node));
+  *copy = *node;
+  if (node->kind == il_function)
+    {
+      function_map m = copied_functions;
+      while (m && m->from != node->d.function.function)
+	m = m->next;
+      if (m)
+	{
+	  copy->d.function.function = m->to;
+	  copy->d.function.mangled_name = m->to->unique_name;
+	}
+    }
+  n = ttl_il_child_slots (copy, slots);
+  for (i = 0; i < n; i++)
+    *slots[i] = copy_il (state, *slots[i], subst);
+  return copy;
+}
+
+static ttl_il_node inline_expr_node (ttl_compile_state state,
+				     ttl_il_node node);
+static void inline_stmt_list (ttl_compile_state state, ttl_il_node list);
+
+/* Run the inliner over the copied body `body' of `callee', so that
+   calls in the inlined code get inlined, too.  */
+static ttl_il_node
+inline_nested (ttl_compile_state state, ttl_function callee,
+	       ttl_il_node body, int stmts)
+{
+  ttl_il_node saved_root = inline_hoist_root;
+
+  /* The copied body is not yet part of the current statement.  */
+  inline_hoist_root = NULL;
+  inline_active[inline_depth++] = callee;
+  if (stmts)
+    inline_stmt_list (state, body);
+  else
+    body = inline_expr_node (state, body);
+  inline_depth--;
+  inline_hoist_root = saved_root;
+  return body;
+}
+
+/* Bind the arguments `args' of a call to `callee' to fresh local
+   variables of the caller, except for constants which are never
+   assigned to, which are substituted directly.  Local variables of
+   `callee' are replaced by fresh local variables, too.  The
+   statements initializing the new variables are stored into
+   `*stmts', the substitution is returned.  */
+static inline_subst
+bind_arguments (ttl_compile_state state, ttl_il_node call,
+		ttl_function callee, ttl_il_node ** stmts)
+{
+  ttl_il_node args = call->d.call.args;
+  ttl_il_node body = callee->d.function.il_code;
+  ttl_variable var = callee->params;
+  inline_subst subst = NULL;
+
+  while (args)
+    {
+      ttl_il_node arg = args->d.pair.car;
+
+      if (constant_p (arg) && ttl_types_equal (arg->type, var->type) &&
+	  !assigned_p (body, var))
+	subst = make_subst (state, var, arg, NULL, subst);
+      else
+	{
+	  ttl_variable tmp = make_local (state, var);
+	  **stmts = ttl_make_il_pair (state,
+				      make_assignment (state, tmp, arg, call),
+				      NULL);
+	  *stmts = &((**stmts)->d.pair.cdr);
+	  subst = make_subst (state, var, NULL, tmp, subst);
+	}
+      args = args->d.pair.cdr;
+      var = var->next;
+    }
+  for (var = callee->locals; var; var = var->next)
+    {
+      ttl_variable tmp = make_local (state, var);
+
+      /* Local variables start out as null on every call.  */
+      **stmts = ttl_make_il_pair
+	(state,
+	 make_assignment (state, tmp,
+			  ttl_make_il_null (state, NULL, -1, -1, -1, -1),
+			  call),
+	 NULL);
+      *stmts = &((**stmts)->d.pair.cdr);
+      subst = make_subst (state, var, NULL, tmp, subst);
+    }
+  return subst;
+}
+
+/* Expand the call `call' of the procedure `callee' in statement
+   position.  */
+static ttl_il_node
+expand_proc (ttl_compile_state state, ttl_il_node call, ttl_function callee)
+{
+  ttl_il_node stmts = NULL, * sp = &stmts;
+  inline_subst subst = bind_arguments (state, call, callee, &sp);
+
+  *sp = inline_nested (state, callee,
+		       copy_il (state, callee->d.function.il_code, subst), 1);
+  report (state, call, callee, NULL);
+  return ttl_make_il_seq (state, stmts);
+}
+
+/* Expand the call in `*slot' of the function `callee', whose body is
+   a single return statement.  `stmt' is the assignment or return
+   statement containing the call.  */
+static ttl_il_node
+expand_expr_stmt (ttl_compile_state state, ttl_il_node stmt,
+		  ttl_il_node * slot, ttl_function callee)
+{
+  ttl_il_node call = *slot;
+  ttl_il_node stmts = NULL, * sp = &stmts;
+  ttl_il_node expr = body_expr (callee);
+  inline_subst subst = bind_arguments (state, call, callee, &sp);
+
+  *slot = inline_nested (state, callee, copy_il (state, expr, subst), 0);
+  *sp = ttl_make_il_pair (state, stmt, NULL);
+  report (state, call, callee, NULL);
+  return ttl_make_il_seq (state, stmts);
+}
+
+/* Inline calls in the expression `node' and return the transformed
+   expression.  The arguments are substituted for the parameters
+   directly if this does not change the evaluation order.  Otherwise
+   they are bound to new variables in front of the current statement,
+   if the call is evaluated before anything else with side effects.  */
+static ttl_il_node
+inline_expr_node (ttl_compile_state state, ttl_il_node node)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return NULL;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    *slots[i] = inline_expr_node (state, *slots[i]);
+  if (node->kind == il_call)
+    {
+      enum inline_kind kind;
+      ttl_function callee = inline_candidate (state, node, &kind);
+
+      if (callee && kind == inline_expr)
+	{
+	  ttl_il_node expr = body_expr (callee);
+	  ttl_il_node args = node->d.call.args;
+	  ttl_variable param = callee->params;
+	  inline_subst subst = NULL;
+
+	  if (!substitutable_args_p (callee, expr, args))
+	    {
+	      if (!inline_hoist_root ||
+		  hoist_point_p (inline_hoist_root, node) <= 0)
+		{
+		  report (state, node, callee, "arguments not substitutable");
+		  return node;
+		}
+	      subst = bind_arguments (state, node, callee, inline_hoist_tail);
+	      report (state, node, callee, NULL);
+	      return inline_nested (state, callee,
+				    copy_il (state, expr, subst), 0);
+	    }
+	  while (args)
+	    {
+	      subst = make_subst (state, param, args->d.pair.car, NULL,
+				  subst);
+	      args = args->d.pair.cdr;
+	      param = param->next;
+	    }
+	  report (state, node, callee, NULL);
+	  return inline_nested (state, callee, copy_il (state, expr, subst),
+				0);
+	}
+    }
+  return node;
+}
+
+/* Return the call in `*slot', if it calls a function whose body is a
+   single return statement, and which may be inlined.  */
+static ttl_function
+expr_candidate (ttl_compile_state state, ttl_il_node * slot)
+{
+  enum inline_kind kind;
+  ttl_function callee;
+
+  if (!*slot || (*slot)->kind != il_call)
+    return NULL;
+  callee = inline_candidate (state, *slot, &kind);
+  if (callee && kind == inline_expr)
+    return callee;
+  return NULL;
+}
+
+/* Inline calls in the expression `expr', which is evaluated first by
+   the current statement.  Statements binding arguments to new
+   variables are appended to the list ending in `*stmts'.  */
+static ttl_il_node
+inline_first_expr (ttl_compile_state state, ttl_il_node expr,
+		   ttl_il_node ** stmts)
+{
+  ttl_il_node saved_root = inline_hoist_root;
+  ttl_il_node ** saved_tail = inline_hoist_tail;
+
+  inline_hoist_root = expr;
+  inline_hoist_tail = stmts;
+  expr = inline_expr_node (state, expr);
+  inline_hoist_root = saved_root;
+  inline_hoist_tail = saved_tail;
+  return expr;
+}
+
+/* Return the statement `node', preceded by the statements `stmts'
+   whose list ends in `*tail', if there are any.  */
+static ttl_il_node
+prepend_stmts (ttl_compile_state state, ttl_il_node stmts,
+	       ttl_il_node * tail, ttl_il_node node)
+{
+  if (!stmts)
+    return node;
+  *tail = ttl_make_il_pair (state, node, NULL);
+  return ttl_make_il_seq (state, stmts);
+}
+
+/* Inline calls in the statement `node' and return the transformed
+   statement.  */
+static ttl_il_node
+inline_stmt (ttl_compile_state state, ttl_il_node node)
+{
+  ttl_function callee;
+  ttl_il_node stmts = NULL, * sp = &stmts;
+
+  if (!node)
+    return NULL;
+  switch (node->kind)
+    {
+    case il_call:
+      {
+	enum inline_kind kind;
+
+	node->d.call.args = inline_first_expr (state, node->d.call.args,
+					       &sp);
+	callee = inline_candidate (state, node, &kind);
+	if (callee && kind == inline_proc)
+	  node = expand_proc (state, node, callee);
+	return prepend_stmts (state, stmts, sp, node);
+      }
+
+    case il_binop:
+      if (node->d.binop.op != il_binop_assign)
+	return node;
+      if (node->d.binop.op0->kind == il_index)
+	{
+	  ttl_il_node lhs = node->d.binop.op0;
+	  lhs->d.index.array = inline_expr_node (state, lhs->d.index.array);
+	  lhs->d.index.index = inline_expr_node (state, lhs->d.index.index);
+	}
+      /* The right hand side is evaluated before the left hand
+	 side.  */
+      node->d.binop.op1 = inline_first_expr (state, node->d.binop.op1, &sp);
+      callee = expr_candidate (state, &node->d.binop.op1);
+      if (callee)
+	node = expand_expr_stmt (state, node, &node->d.binop.op1, callee);
+      return prepend_stmts (state, stmts, sp, node);
+
+    case il_return:
+      node->d.returnstmt.expr =
+	inline_first_expr (state, node->d.returnstmt.expr, &sp);
+      callee = expr_candidate (state, &node->d.returnstmt.expr);
+      if (callee)
+	node = expand_expr_stmt (state, node, &node->d.returnstmt.expr,
+				 callee);
+      return prepend_stmts (state, stmts, sp, node);
+
+    case il_if:
+      node->d.ifstmt.cond = inline_first_expr (state, node->d.ifstmt.cond,
+					       &sp);
+      inline_stmt_list (state, node->d.ifstmt.thenstmt);
+      inline_stmt_list (state, node->d.ifstmt.elsestmt);
+      return prepend_stmts (state, stmts, sp, node);
+
+    case il_while:
+      node->d.whilestmt.cond =
+	inline_expr_node (state, node->d.whilestmt.cond);
+      inline_stmt_list (state, node->d.whilestmt.dostmt);
+      return node;
+
+    case il_seq:
+      inline_stmt_list (state, node->d.seq.stmts);
+      return node;
+
+    default:
+      return node;
+    }
+}
+
+static void
+inline_stmt_list (ttl_compile_state state, ttl_il_node list)
+{
+  while (list)
+    {
+      list->d.pair.car = inline_stmt (state, list->d.pair.car);
+      list = list->d.pair.cdr;
+    }
+}
+
+void
+ttl_inline_module (ttl_compile_state state, ttl_module module)
+{
+  ttl_function function;
+  char * module_name = NULL;
+  long max_frequency = -1;
+
+  if (state->profile)
+    {
+      module_name = ttl_qualident_to_c_ident
+	(state->pool, ttl_strip_annotation (module->module_ast_name));
+      max_frequency = ttl_profile_max_frequency (state->profile,
+						 module_name);
+    }
+  for (function = module->functions; function;
+       function = function->total_next)
+    {
+      if (function->kind != function_function ||
+	  function->d.function.handcoded || function->d.function.mapped ||
+	  !function->d.function.il_code)
+	continue;
+      inline_caller = function;
+      inline_depth = 0;
+      inline_max_size = INLINE_MAX_SIZE;
+      if (max_frequency > 0)
+	{
+	  long frequency = ttl_profile_frequency (state->profile,
+						  module_name, function);
+	  /* Code which never ran when the profile was taken is kept
+	     small.  */
+	  if (frequency == 0)
+	    {
+	      if (state->compile_options->verbose >= 2)
+		{
+		  printf ("not inlining into ");
+		  print_function_name (function);
+		  printf (": never executed\n");
+		}
+	      continue;
+	    }
+	  if (frequency * INLINE_HOT_RATIO >= max_frequency)
+	    inline_max_size = INLINE_HOT_MAX_SIZE;
+	}
+      inline_stmt_list (state, (ttl_il_node) function->d.function.il_code);
+    }
+  inline_caller = NULL;
+}
+
+
+/* A function stored in a data argument which is known at compile
+   time: the accessor `accessor', applied to the parameter with the
+   number `index', returns the function `value'.  */
+typedef struct known_field * known_field;
+struct known_field
+{
+  known_field next;
+  int index;
+  ttl_function accessor;
+  ttl_il_node value;
+};
+
+/* A copy of the function `original', in which the parameters with
+   non-null entries in `known' have been replaced by the functions
+   given there, and the reads of the fields in `fields' by the
+   functions stored in them.  */
+typedef struct specialization * specialization;
+struct specialization
+{
+  specialization next;
+  ttl_function original;
+  ttl_il_node * known;		/* Function argument for each parameter,
+				   or NULL.  */
+  known_field fields;
+  ttl_function copy;
+};
+
+/* The specialized copies created for the current module.  */
+static specialization specializations = NULL;
+static int specialization_count = 0;
+
+/* The function whose calls are currently specialized.  */
+static ttl_function specialize_caller = NULL;
+
+/* Return non-zero if `function' is a specialized copy, or nested
+   inside of one.  */
+static int
+specialized_p (ttl_function function)
+{
+  specialization s;
+
+  while (function->enclosing)
+    function = function->enclosing;
+  for (s = specializations; s; s = s->next)
+    if (s->copy == function)
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if `node' only refers to global variables,
+   toplevel functions, and the variables of `function' and `function'
+   itself.  */
+static int
+closed_p (ttl_il_node node, ttl_function function)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return 1;
+  switch (node->kind)
+    {
+    case il_variable:
+      return !node->d.variable.variable ||
+	node->d.variable.variable->kind == variable_global ||
+	node->d.variable.variable->defining == function;
+    case il_function:
+      return !node->d.function.function->enclosing ||
+	node->d.function.function == function;
+    default:
+      break;
+    }
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (!closed_p (*slots[i], function))
+      return 0;
+  return 1;
+}
+
+/* Return non-zero if `function' can be referenced from any function of
+   the module without building a closure.  For nested functions, this
+   is the case if they do not refer to variables or functions of the
+   enclosing functions; these are marked as closed.  */
+static int
+known_function_p (ttl_function function)
+{
+  ttl_il_node body;
+
+  if (!function->enclosing || function->closed)
+    return 1;
+  body = function->d.function.il_code;
+  if (function->kind != function_function ||
+      function->d.function.handcoded || function->d.function.mapped ||
+      !body || function->enclosed || !copyable_p (body, 1) ||
+      !closed_p (body, function))
+    return 0;
+  function->closed = 1;
+  return 1;
+}
+
+/* Return non-zero if `function' and the functions nested inside of it
+   can be copied.  */
+static int
+copyable_function_p (ttl_function function)
+{
+  ttl_il_node body = function->d.function.il_code;
+  ttl_function f;
+
+  if (function->kind != function_function ||
+      function->d.function.handcoded || function->d.function.mapped ||
+      !body || constrained_variables_p (function->params) ||
+      constrained_variables_p (function->locals) || !copyable_p (body, 1))
+    return 0;
+  for (f = function->enclosed; f; f = f->next)
+    if (!copyable_function_p (f))
+      return 0;
+  return 1;
+}
+
+/* Return non-zero if `node' contains the node `target'.  */
+static int
+contains_p (ttl_il_node node, ttl_il_node target)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return 0;
+  if (node == target)
+    return 1;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (contains_p (*slots[i], target))
+      return 1;
+  return 0;
+}
+
+/* Return the number of assignments to the variable `var' in `node'.
+   Stores into the elements of an array held in `var' do not count,
+   they leave the value of `var' unchanged.  */
+static int
+count_assignments (ttl_il_node node, ttl_variable var)
+{
+  ttl_il_node * slots[3];
+  int i, n, count = 0;
+
+  if (!node)
+    return 0;
+  if (node->kind == il_binop && node->d.binop.op == il_binop_assign &&
+      node->d.binop.op0->kind == il_variable &&
+      node->d.binop.op0->d.variable.variable == var)
+    count++;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    count += count_assignments (*slots[i], var);
+  return count;
+}
+
+/* Return the number of assignments to the variable `var' in the body
+   of `function' and of the functions nested inside of it.  */
+static int
+function_assignments (ttl_function function, ttl_variable var)
+{
+  ttl_function f;
+  int count = count_assignments (function->d.function.il_code, var);
+
+  for (f = function->enclosed; f; f = f->next)
+    count += function_assignments (f, var);
+  return count;
+}
+
+/* Search the statement list `list' and the sequences in it for the
+   statement which contains `node', and set `*def' to the expression
+   assigned to `var' by the last statement before it which is an
+   assignment to `var'.  Return non-zero if `node' was found.  */
+static int
+find_definition (ttl_il_node list, ttl_variable var, ttl_il_node node,
+		 ttl_il_node * def)
+{
+  ttl_il_node stmt;
+
+  for (; list; list = list->d.pair.cdr)
+    {
+      stmt = list->d.pair.car;
+      if (!stmt)
+	continue;
+      if (stmt->kind == il_seq)
+	{
+	  if (find_definition (stmt->d.seq.stmts, var, node, def))
+	    return 1;
+	  continue;
+	}
+      if (contains_p (stmt, node))
+	return 1;
+      if (stmt->kind == il_binop && stmt->d.binop.op == il_binop_assign &&
+	  stmt->d.binop.op0->kind == il_variable &&
+	  stmt->d.binop.op0->d.variable.variable == var)
+	*def = stmt->d.binop.op1;
+    }
+  return 0;
+}
+
+/* Return the value of the local variable `var' of `function' when
+   `node' is evaluated.  This is known if `var' is assigned only once,
+   by a statement which is not nested in a loop or conditional and
+   precedes the statement containing `node'.  Return NULL if it is
+   not known.  */
+static ttl_il_node
+definition (ttl_function function, ttl_variable var, ttl_il_node node)
+{
+  ttl_il_node def = NULL;
+
+  if (var->kind != variable_local || var->defining != function ||
+      function_assignments (function, var) != 1 ||
+      !find_definition (function->d.function.il_code, var, node, &def))
+    return NULL;
+  return def;
+}
+
+/* Return the number of return statements in `node'.  */
+static int
+count_returns (ttl_il_node node)
+{
+  ttl_il_node * slots[3];
+  int i, n, count;
+
+  if (!node)
+    return 0;
+  count = node->kind == il_return;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    count += count_returns (*slots[i]);
+  return count;
+}
+
+/* Return the constructor call whose value `function' returns, or NULL.
+   The last statement of the body must be the only return statement,
+   and return either a constructor call or a local variable which is
+   known to be the value of one.  */
+static ttl_il_node
+constructed_result (ttl_function function)
+{
+  ttl_il_node list = function->d.function.il_code, stmt, expr;
+
+  if (!list || count_returns (list) != 1)
+    return NULL;
+  while (list->d.pair.cdr)
+    list = list->d.pair.cdr;
+  stmt = list->d.pair.car;
+  if (!stmt || stmt->kind != il_return || !stmt->d.returnstmt.expr)
+    return NULL;
+  expr = stmt->d.returnstmt.expr;
+  if (expr->kind == il_variable)
+    expr = definition (function, expr->d.variable.variable, stmt);
+  if (!expr || expr->kind != il_call ||
+      expr->d.call.function->kind != il_function ||
+      !expr->d.call.function->d.function.function ||
+      expr->d.call.function->d.function.function->kind !=
+      function_constructor)
+    return NULL;
+  return expr;
+}
+
+/* Return the argument number `index' of the call `call'.  */
+static ttl_il_node
+nth_arg (ttl_il_node call, int index)
+{
+  ttl_il_node args = call->d.call.args;
+
+  while (args && index-- > 0)
+    args = args->d.pair.cdr;
+  return args ? args->d.pair.car : NULL;
+}
+
+/* Return the function which the accessor `accessor' returns for the
+   argument `arg' of the call `call' in `specialize_caller', if it is
+   known at compile time.  This is the case if `arg' is a variable
+   whose value is the result of a function which stores a known
+   function in the field read by `accessor', and that field is never
+   changed after construction.  */
+static ttl_il_node
+known_field_value (ttl_il_node call, ttl_il_node arg, ttl_function accessor)
+{
+  ttl_il_node def, cons, value;
+  ttl_function maker, constructor;
+  ttl_field_list field;
+
+  if (arg->kind != il_variable || !arg->d.variable.variable ||
+      !accessor->d.accessor.fixed)
+    return NULL;
+  def = definition (specialize_caller, arg->d.variable.variable, call);
+  if (!def || def->kind != il_call ||
+      def->d.call.function->kind != il_function)
+    return NULL;
+  maker = def->d.call.function->d.function.function;
+  if (!maker || maker->kind != function_function ||
+      !maker->d.function.il_code ||
+      !(cons = constructed_result (maker)))
+    return NULL;
+  constructor = cons->d.call.function->d.function.function;
+  if (!ttl_types_equal (constructor->type->d.function.return_type,
+			accessor->type->d.function.param_types[0]))
+    return NULL;
+  for (field = accessor->d.accessor.field_list; field; field = field->next)
+    if (field->variant == (int) constructor->d.constr_discrim.variant)
+      break;
+  if (!field || !(value = nth_arg (cons, field->offset)))
+    return NULL;
+  if (value->kind == il_variable && value->d.variable.variable &&
+      value->d.variable.variable->kind == variable_param &&
+      value->d.variable.variable->defining == maker &&
+      function_assignments (maker, value->d.variable.variable) == 0)
+    value = nth_arg (def, value->d.variable.variable->index);
+  if (!value || value->kind != il_function ||
+      !known_function_p (value->d.function.function))
+    return NULL;
+  return value;
+}
+
+/* Add the fields read in `node' by fixed accessors returning
+   functions from the parameter `param' with the number `index', whose
+   values are known for the call `call', to the list `*fields', unless
+   they are already on it.  */
+static void
+collect_known_fields (ttl_compile_state state, ttl_il_node node,
+		      ttl_variable param, int index, ttl_il_node call,
+		      known_field * fields)
+{
+  ttl_il_node * slots[3];
+  ttl_function accessor;
+  ttl_il_node value;
+  known_field * f;
+  int i, n;
+
+  if (!node)
+    return;
+  if (node->kind == il_call && node->d.call.function->kind == il_function &&
+      (accessor = node->d.call.function->d.function.function) &&
+      accessor->kind == function_accessor &&
+      accessor->type->d.function.return_type->kind == type_function &&
+      node->d.call.args &&
+      node->d.call.args->d.pair.car->kind == il_variable &&
+      node->d.call.args->d.pair.car->d.variable.variable == param)
+    {
+      for (f = fields; *f; f = &(*f)->next)
+	if ((*f)->index == index && (*f)->accessor == accessor)
+	  break;
+      if (!*f &&
+	  (value = known_field_value (call, nth_arg (call, index), accessor)))
+	{
+	  *f = ttl_malloc (state->pool, sizeof (struct known_field));
+	  (*f)->next = NULL;
+	  (*f)->index = index;
+	  (*f)->accessor = accessor;
+	  (*f)->value = value;
+	}
+    }
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    collect_known_fields (state, *slots[i], param, index, call, fields);
+}
+
+/* Collect the known fields of the parameter `param' of `function' for
+   the call `call', in the body of `function' and of the functions
+   nested inside of it, as for `collect_known_fields'.  */
+static void
+collect_function_fields (ttl_compile_state state, ttl_function function,
+			 ttl_variable param, int index, ttl_il_node call,
+			 known_field * fields)
+{
+  ttl_function f;
+
+  collect_known_fields (state, function->d.function.il_code, param, index,
+			call, fields);
+  for (f = function->enclosed; f; f = f->next)
+    collect_function_fields (state, f, param, index, call, fields);
+}
+
+/* Return non-zero if the known fields `a' and `b' are the same.  */
+static int
+same_fields_p (known_field a, known_field b)
+{
+  while (a && b)
+    {
+      if (a->index != b->index || a->accessor != b->accessor ||
+	  a->value->d.function.function != b->value->d.function.function)
+	return 0;
+      a = a->next;
+      b = b->next;
+    }
+  return a == b;
+}
+
+/* Replace the reads of the known fields `fields' of the parameters
+   `params' of a specialized copy in `*slot' by the functions stored in
+   them.  */
+static void
+replace_fields (ttl_compile_state state, ttl_il_node * slot,
+		ttl_variable params, known_field fields)
+{
+  ttl_il_node * slots[3];
+  ttl_il_node node = *slot;
+  ttl_variable param;
+  known_field f;
+  int i, n;
+
+  if (!node)
+    return;
+  if (node->kind == il_call && node->d.call.function->kind == il_function &&
+      node->d.call.args &&
+      node->d.call.args->d.pair.car->kind == il_variable)
+    for (f = fields; f; f = f->next)
+      {
+	for (param = params, i = 0; param && i < f->index;
+	     param = param->next, i++)
+	  ;
+	if (node->d.call.function->d.function.function == f->accessor &&
+	    node->d.call.args->d.pair.car->d.variable.variable == param)
+	  {
+	    *slot = copy_il (state, f->value, NULL);
+	    return;
+	  }
+      }
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    replace_fields (state, slots[i], params, fields);
+}
+
+/* Replace the reads of known fields in the body of `function' and of
+   the functions nested inside of it, as for `replace_fields'.  */
+static void
+replace_function_fields (ttl_compile_state state, ttl_function function,
+			 ttl_variable params, known_field fields)
+{
+  ttl_function f;
+
+  replace_fields (state, (ttl_il_node *) &function->d.function.il_code,
+		  params, fields);
+  for (f = function->enclosed; f; f = f->next)
+    replace_function_fields (state, f, params, fields);
+}
+
+/* Return non-zero if copies of `function' may be made.  */
+static int
+specializable_p (ttl_function function)
+{
+  return !function->enclosing && copyable_function_p (function) &&
+    function_size (function) <= SPECIALIZE_MAX_SIZE &&
+    !specialized_p (function);
+}
+
+/* Add `function' to the functions of `module', in front of the
+   initialization function, which must stay the last one.  Nested
+   functions are not added to the toplevel functions.  */
+static void
+add_function (ttl_compile_state state, ttl_module module,
+	      ttl_function function)
+{
+  ttl_function * f;
+
+  f = &module->functions;
+  while (*f && !(state->has_init_stmts && !(*f)->total_next))
+    f = &((*f)->total_next);
+  function->total_next = *f;
+  *f = function;
+  if (function->enclosing)
+    return;
+  f = &module->toplevel_functions;
+  while (*f && !(state->has_init_stmts && !(*f)->next))
+    f = &((*f)->next);
+  function->next = *f;
+  *f = function;
+}
+
+/* Create a variable of `copy' which replaces the variable `proto' of
+   the copied function.  */
+static ttl_variable
+copy_variable (ttl_compile_state state, ttl_function copy,
+	       ttl_variable proto)
+{
+  ttl_variable var = ttl_make_variable (state->pool, proto->kind,
+					proto->type, 0);
+
+  var->name = proto->name;
+  var->unique_name =
+    ttl_uniquify_name (state, ttl_make_ast_identifier (state->pool,
+							proto->name, NULL,
+							-1, -1, -1, -1));
+  var->defining = copy;
+  var->index = proto->index;
+  return var;
+}
+
+/* Create variables of `copy' which replace the variables `vars' of
+   the copied function, add them to `*subst' and return them as a
+   list.  */
+static ttl_variable
+copy_variables (ttl_compile_state state, ttl_function copy,
+		ttl_variable vars, inline_subst * subst)
+{
+  ttl_variable list = NULL, * vp = &list;
+
+  for (; vars; vars = vars->next)
+    {
+      *vp = copy_variable (state, copy, vars);
+      *subst = make_subst (state, vars, NULL, *vp, *subst);
+      vp = &((*vp)->next);
+    }
+  return list;
+}
+
+/* Create copies of the functions nested inside of `original' for its
+   copy `copy', with new variables which are added to `*subst'.  The
+   copies are recorded in `copied_functions' and added to `module',
+   their bodies are copied later, when all variables are known.  */
+static void
+copy_nested (ttl_compile_state state, ttl_module module,
+	     ttl_function original, ttl_function copy, inline_subst * subst)
+{
+  ttl_function nested, * fp = &copy->enclosed;
+
+  for (nested = original->enclosed; nested; nested = nested->next)
+    {
+      ttl_function n = ttl_make_function (state->pool, function_function,
+					  nested->type);
+      function_map m = ttl_malloc (state->pool,
+				   sizeof (struct function_map));
+      inline_subst s = *subst;
+
+      n->name = nested->name;
+      n->unique_name =
+	ttl_uniquify_name (state,
+			   ttl_make_ast_identifier (state->pool, nested->name,
+						    NULL, -1, -1, -1, -1));
+      n->enclosing = copy;
+      n->d.function.nesting_level = nested->d.function.nesting_level;
+      while (s && s->from != nested->variable)
+	s = s->next;
+      n->variable = s ? s->to : NULL;
+      n->params = copy_variables (state, n, nested->params, subst);
+      n->locals = copy_variables (state, n, nested->locals, subst);
+      n->param_count = nested->param_count;
+      n->local_count = nested->local_count;
+      *fp = n;
+      fp = &n->next;
+      m->from = nested;
+      m->to = n;
+      m->next = copied_functions;
+      copied_functions = m;
+      add_function (state, module, n);
+      copy_nested (state, module, nested, n, subst);
+    }
+}
+
+/* Copy the bodies of the functions nested inside of `original' into
+   their copies nested inside of `copy'.  */
+static void
+copy_nested_bodies (ttl_compile_state state, ttl_function original,
+		    ttl_function copy, inline_subst subst)
+{
+  ttl_function nested, n;
+
+  for (nested = original->enclosed, n = copy->enclosed; nested;
+       nested = nested->next, n = n->next)
+    {
+      n->d.function.il_code =
+	copy_il (state, nested->d.function.il_code, subst);
+      copy_nested_bodies (state, nested, n, subst);
+    }
+}
+
+static void specialize_node (ttl_compile_state state, ttl_module module,
+			     ttl_il_node node);
+
+/* Specialize the calls in the body of `function' and in the functions
+   nested inside of it.  */
+static void
+specialize_function (ttl_compile_state state, ttl_module module,
+		     ttl_function function)
+{
+  ttl_function saved = specialize_caller;
+  ttl_function f;
+
+  specialize_caller = function;
+  specialize_node (state, module, function->d.function.il_code);
+  specialize_caller = saved;
+  for (f = function->enclosed; f; f = f->next)
+    specialize_function (state, module, f);
+}
+
+/* Create a copy of `original', in which the parameters are replaced by
+   the functions in `known', the reads of the fields in `fields' by
+   their values, and which is added to `module'.  Nested functions are
+   copied along, so that they refer to the variables of the copy.  The
+   calls in the copy are specialized in turn, so that recursive calls
+   pass the function arguments on to the copy itself.  */
+static specialization
+specialize (ttl_compile_state state, ttl_module module,
+	    ttl_function original, ttl_il_node * known, known_field fields)
+{
+  specialization s = ttl_malloc (state->pool,
+				 sizeof (struct specialization));
+  ttl_function copy = ttl_make_function (state->pool, function_function,
+					 original->type);
+  ttl_variable var, * vp;
+  inline_subst subst = NULL;
+  int i = 0;
+
+  copy->name = original->name;
+  copy->unique_name =
+    ttl_uniquify_name (state, ttl_make_ast_identifier (state->pool,
+							original->name, NULL,
+							-1, -1, -1, -1));
+  vp = &copy->params;
+  for (var = original->params; var; var = var->next, i++)
+    {
+      *vp = copy_variable (state, copy, var);
+      if (known[i])
+	subst = make_subst (state, var, known[i], NULL, subst);
+      else
+	subst = make_subst (state, var, NULL, *vp, subst);
+      vp = &((*vp)->next);
+    }
+  copy->locals = copy_variables (state, copy, original->locals, &subst);
+  copy->param_count = original->param_count;
+  copy->local_count = original->local_count;
+  add_function (state, module, copy);
+  copied_functions = NULL;
+  copy_nested (state, module, original, copy, &subst);
+  copy->d.function.il_code =
+    copy_il (state, original->d.function.il_code, subst);
+  copy_nested_bodies (state, original, copy, subst);
+  copied_functions = NULL;
+  replace_function_fields (state, copy, copy->params, fields);
+
+  s->original = original;
+  s->known = known;
+  s->fields = fields;
+  s->copy = copy;
+  s->next = specializations;
+  specializations = s;
+  specialization_count++;
+
+  specialize_function (state, module, copy);
+  return s;
+}
+
+/* Redirect the call `call' to a copy of the called function, if some
+   of its arguments are functions known at compile time, or data
+   objects with function fields known at compile time.  */
+static void
+specialize_call (ttl_compile_state state, ttl_module module,
+		 ttl_il_node call)
+{
+  ttl_function callee;
+  ttl_variable param;
+  ttl_il_node args, * known;
+  known_field fields = NULL, f;
+  specialization s;
+  int i, n, found = 0;
+
+  if (call->d.call.function->kind != il_function)
+    return;
+  callee = call->d.call.function->d.function.function;
+  if (!callee || !specializable_p (callee))
+    return;
+  n = callee->type->d.function.param_type_count;
+  known = ttl_malloc (state->pool, (n + 1) * sizeof (ttl_il_node));
+  for (i = 0, args = call->d.call.args, param = callee->params;
+       args && param;
+       i++, args = args->d.pair.cdr, param = param->next)
+    {
+      ttl_il_node arg = args->d.pair.car;
+
+      known[i] = NULL;
+      if (param->type->kind == type_function && arg->kind == il_function &&
+	  known_function_p (arg->d.function.function) &&
+	  !assigned_in_p (callee, param))
+	{
+	  known[i] = arg;
+	  found = 1;
+	}
+      else if (param->type->kind == type_sum &&
+	       function_assignments (callee, param) == 0)
+	collect_function_fields (state, callee, param, i, call, &fields);
+    }
+  if ((!found && !fields) || i != n)
+    return;
+  for (s = specializations; s; s = s->next)
+    {
+      if (s->original != callee || !same_fields_p (s->fields, fields))
+	continue;
+      for (i = 0; i < n; i++)
+	if ((s->known[i] == NULL) != (known[i] == NULL) ||
+	    (known[i] && s->known[i]->d.function.function !=
+	     known[i]->d.function.function))
+	  break;
+      if (i == n)
+	break;
+    }
+  if (!s)
+    {
+      if (specialization_count >= SPECIALIZE_MAX_COPIES)
+	return;
+      if (state->compile_options->verbose >= 1)
+	{
+	  if (call->filename)
+	    printf ("%s:%d: ", call->filename, call->start_line + 1);
+	  printf ("specializing ");
+	  print_function_name (callee);
+	  printf (" for");
+	  for (i = 0; i < n; i++)
+	    if (known[i])
+	      {
+		printf (" ");
+		print_function_name (known[i]->d.function.function);
+	      }
+	  for (f = fields; f; f = f->next)
+	    {
+	      printf (" ");
+	      print_function_name (f->value->d.function.function);
+	    }
+	  printf ("\n");
+	}
+      s = specialize (state, module, callee, known, fields);
+    }
+  call->d.call.function =
+    ttl_make_il_function (state, call->d.call.function->d.function.name,
+			  s->copy->unique_name, s->copy->type, s->copy);
+}
+
+static void
+specialize_node (ttl_compile_state state, ttl_module module,
+		 ttl_il_node node)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    specialize_node (state, module, *slots[i]);
+  if (node->kind == il_call)
+    specialize_call (state, module, node);
+}
+
+void
+ttl_specialize_module (ttl_compile_state state, ttl_module module)
+{
+  ttl_function function;
+
+  specializations = NULL;
+  specialization_count = 0;
+  for (function = module->functions; function;
+       function = function->total_next)
+    {
+      if (function->kind != function_function ||
+	  function->d.function.handcoded || function->d.function.mapped ||
+	  !function->d.function.il_code || specialized_p (function))
+	continue;
+      specialize_caller = function;
+      specialize_node (state, module,
+		       (ttl_il_node) function->d.function.il_code);
+    }
+  specializations = NULL;
+}
+
+
+/* Return non-zero if the type `type' can be written to an interface
+   file and be read back by an importing module.  Besides the
+   predefined types, only the parameters of the defining module may be
+   used.  */
+static int
+portable_type_p (ttl_type type)
+{
+  unsigned i;
+
+  switch (type->kind)
+    {
+    case type_integer:
+    case type_long:
+    case type_real:
+    case type_bool:
+    case type_char:
+    case type_string:
+      return 1;
+    case type_list:
+      return portable_type_p (type->d.list.element);
+    case type_array:
+      return portable_type_p (type->d.array.element);
+    case type_function:
+      for (i = 0; i < type->d.function.param_type_count; i++)
+	if (!portable_type_p (type->d.function.param_types[i]))
+	  return 0;
+      return type->d.function.return_type->kind == type_void ||
+	portable_type_p (type->d.function.return_type);
+    case type_sum:
+      if (type->d.sum.full_name->kind == ast_identifier)
+	return type->d.sum.type_count == 0;
+      for (i = 0; i < type->d.sum.type_count; i++)
+	if (!portable_type_p (type->d.sum.types[i]))
+	  return 0;
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+/* Return non-zero if `function' is one of the functions of
+   `module'.  */
+static int
+module_function_p (ttl_module module, ttl_function function)
+{
+  ttl_function f;
+
+  for (f = module->functions; f; f = f->total_next)
+    if (f == function)
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if `node' refers to the function `function'.  */
+static int
+references_p (ttl_il_node node, ttl_function function)
+{
+  ttl_il_node * slots[3];
+  int i, n;
+
+  if (!node)
+    return 0;
+  if (node->kind == il_function)
+    return node->d.function.function == function;
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (references_p (*slots[i], function))
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if the setter `setter' changes one of the fields read
+   by the accessor `accessor'.  */
+static int
+same_field_p (ttl_function accessor, ttl_function setter)
+{
+  ttl_field_list a, b;
+
+  if (!ttl_types_equal (accessor->type->d.function.param_types[0],
+			setter->type->d.function.param_types[0]))
+    return 0;
+  for (a = accessor->d.accessor.field_list; a; a = a->next)
+    for (b = setter->d.accessor.field_list; b; b = b->next)
+      if (a->variant == b->variant && a->offset == b->offset)
+	return 1;
+  return 0;
+}
+
+/* Return non-zero if the fields read by the accessor `accessor' of the
+   module whose interface is written are never changed after their
+   data object has been constructed.  This is the case if no setter of
+   these fields is exported or called in the module.  */
+static int
+fixed_field_p (ttl_function accessor)
+{
+  ttl_function setter, f;
+
+  for (setter = export_module->functions; setter;
+       setter = setter->total_next)
+    {
+      if (setter->kind != function_setter ||
+	  !same_field_p (accessor, setter))
+	continue;
+      if (setter->exported)
+	return 0;
+      for (f = export_module->functions; f; f = f->total_next)
+	if (f->kind == function_function &&
+	    references_p (f->d.function.il_code, setter))
+	  return 0;
+    }
+  return 1;
+}
+
+/* Return non-zero if `callee', which is called by a function whose
+   body is written to the interface file, is written as an entry of its
+   own, because importing modules do not know it otherwise.  These are
+   the private data type functions of the module and the functions of
+   other modules.  Such entries are named by the C name of the
+   function.  */
+static int
+hidden_callee_p (ttl_function callee)
+{
+  if (callee->enclosing || !portable_type_p (callee->type))
+    return 0;
+  switch (callee->kind)
+    {
+    case function_function:
+      return callee->module && !callee->d.function.mapped &&
+	!callee->d.function.handcoded;
+    case function_constraint:
+      return 0;
+    default:
+      return !callee->exported && module_function_p (export_module, callee);
+    }
+}
+
+static int portable_p (ttl_il_node node, ttl_function function, int code);
+
+/* Return non-zero if the call `call' can be replaced by the body
+   expression of the called function when it is printed.  This is
+   possible if the body only uses operators, constants and parameters,
+   as for the functions imported with their bodies, and all arguments
+   are variables or constants, so that their evaluation may be
+   repeated or dropped.  */
+static int
+expandable_call_p (ttl_il_node call)
+{
+  ttl_function callee;
+  ttl_il_node args;
+
+  if (call->d.call.function->kind != il_function)
+    return 0;
+  callee = call->d.call.function->d.function.function;
+  if (!callee || callee->enclosing ||
+      callee->param_count > EXPAND_MAX_ARGS ||
+      body_kind (callee, INLINE_MAX_SIZE) != inline_expr ||
+      !portable_p (body_expr (callee), callee, 0))
+    return 0;
+  for (args = call->d.call.args; args; args = args->d.pair.cdr)
+    if (args->d.pair.car->kind != il_variable &&
+	!constant_p (args->d.pair.car))
+      return 0;
+  return 1;
+}
+
+/* Return non-zero if the function expression `node' of a call in the
+   body of `function' can be printed by `print_portable'.  This is the
+   case for parameters and local variables, which include the
+   closures of nested functions, for portable calls returning
+   functions, for the toplevel function `function' is nested in and
+   exported functions defined before it in the same module, because
+   these are known when the interface file is read back, and for the
+   functions which are written as entries of their own.  */
+static int
+portable_callee_p (ttl_il_node node, ttl_function function)
+{
+  ttl_function callee, root, f;
+  ttl_variable param;
+
+  if (node->kind == il_variable || node->kind == il_call)
+    return portable_p (node, function, 1);
+  if (node->kind != il_function)
+    return 0;
+  callee = node->d.function.function;
+  if (!callee || callee->enclosing)
+    return 0;
+  if (hidden_callee_p (callee))
+    return 1;
+  if (!callee->name)
+    return 0;
+  for (root = function; root->enclosing; root = root->enclosing)
+    ;
+  for (param = root->params; param; param = param->next)
+    if (param->name == callee->name)
+      return 0;
+  if (callee == root)
+    return 1;
+  if (!callee->exported)
+    return 0;
+  for (f = callee->next; f && f != root; f = f->next)
+    ;
+  return f != NULL;
+}
+
+/* Return non-zero if the expression `node' only references parameters
+   of `function' and of the functions it is nested in, and only
+   contains constructs which can be printed by `print_portable' below.
+   If `code' is non-zero, local variables, function calls and array
+   constructors are allowed, too.  */
+static int
+portable_p (ttl_il_node node, ttl_function function, int code)
+{
+  ttl_il_node args;
+
+  switch (node->kind)
+    {
+    case il_variable:
+      return node->d.variable.variable &&
+	nested_in_p (function, node->d.variable.variable->defining) &&
+	(node->d.variable.variable->kind == variable_param ||
+	 (code && node->d.variable.variable->kind == variable_local));
+    case il_int_const:
+    case il_long_const:
+    case il_bool_const:
+    case il_null_const:
+      return 1;
+    case il_char_const:
+      return node->d.character.value >= ' ' &&
+	node->d.character.value < 127 &&
+	node->d.character.value != '\'' && node->d.character.value != '\\';
+    case il_binop:
+      return node->d.binop.op != il_binop_assign &&
+	portable_p (node->d.binop.op0, function, code) &&
+	portable_p (node->d.binop.op1, function, code);
+    case il_unop:
+      return portable_p (node->d.unop.op0, function, code);
+    case il_index:
+      return (node->d.index.array->kind == il_variable ||
+	      node->d.index.array->kind == il_call) &&
+	portable_p (node->d.index.array, function, code) &&
+	portable_p (node->d.index.index, function, code);
+    case il_call:
+      if (!code ||
+	  (!expandable_call_p (node) &&
+	   !portable_callee_p (node->d.call.function, function)))
+	return 0;
+      for (args = node->d.call.args; args; args = args->d.pair.cdr)
+	if (!portable_p (args->d.pair.car, function, code))
+	  return 0;
+      return 1;
+    case il_array_constructor:
+      return code &&
+	portable_p (node->d.array_constructor.size, function, code) &&
+	portable_p (node->d.array_constructor.initial, function, code);
+    default:
+      return 0;
+    }
+}
+
+static int portable_stmt_p (ttl_il_node node, ttl_function function);
+static int portable_function_p (ttl_function function);
+
+/* Return non-zero if all expressions in the list `list' are portable
+   in `function'.  If `targets' is non-zero, they must be variables or
+   indexed arrays, which can be assigned to.  */
+static int
+portable_list_p (ttl_il_node list, ttl_function function, int targets)
+{
+  while (list)
+    {
+      ttl_il_node expr = list->d.pair.car;
+
+      if ((targets && expr->kind != il_variable && expr->kind != il_index) ||
+	  !portable_p (expr, function, 1))
+	return 0;
+      list = list->d.pair.cdr;
+    }
+  return 1;
+}
+
+/* Return non-zero if the assignment `node' is the definition of a
+   function nested inside of `function', which stores its closure into
+   the variable created for it, and that function can be printed with
+   its body.  */
+static int
+portable_fundef_p (ttl_il_node node, ttl_function function)
+{
+  ttl_function nested = node->d.binop.op1->d.function.function;
+  ttl_type type = nested->type->d.function.return_type;
+
+  return nested->enclosing == function && nested->variable &&
+    node->d.binop.op0->kind == il_variable &&
+    node->d.binop.op0->d.variable.variable == nested->variable &&
+    (type->kind == type_void || portable_type_p (type)) &&
+    portable_function_p (nested);
+}
+
+/* Return non-zero if all statements in the list `list' can be printed
+   by `print_portable_stmts'.  */
+static int
+portable_stmts_p (ttl_il_node list, ttl_function function)
+{
+  while (list)
+    {
+      if (!portable_stmt_p (list->d.pair.car, function))
+	return 0;
+      list = list->d.pair.cdr;
+    }
+  return 1;
+}
+
+static int
+portable_stmt_p (ttl_il_node node, ttl_function function)
+{
+  if (!node)
+    return 1;
+  switch (node->kind)
+    {
+    case il_binop:
+      if (node->d.binop.op != il_binop_assign)
+	return 0;
+      if (node->d.binop.op1->kind == il_function)
+	return portable_fundef_p (node, function);
+      if (node->d.binop.op0->kind == il_tuple_expr)
+	return node->d.binop.op1->kind == il_tuple_expr &&
+	  portable_list_p (node->d.binop.op0->d.tuple_expr.elements,
+			   function, 1) &&
+	  portable_list_p (node->d.binop.op1->d.tuple_expr.elements,
+			   function, 0);
+      return (node->d.binop.op0->kind == il_variable ||
+	      node->d.binop.op0->kind == il_index) &&
+	portable_p (node->d.binop.op0, function, 1) &&
+	portable_p (node->d.binop.op1, function, 1);
+    case il_call:
+      return portable_p (node, function, 1);
+    case il_if:
+      return portable_p (node->d.ifstmt.cond, function, 1) &&
+	portable_stmts_p (node->d.ifstmt.thenstmt, function) &&
+	portable_stmts_p (node->d.ifstmt.elsestmt, function);
+    case il_while:
+      return portable_p (node->d.whilestmt.cond, function, 1) &&
+	portable_stmts_p (node->d.whilestmt.dostmt, function);
+    case il_return:
+      return !node->d.returnstmt.expr ||
+	portable_p (node->d.returnstmt.expr, function, 1);
+    case il_seq:
+      return portable_stmts_p (node->d.seq.stmts, function);
+    default:
+      return 0;
+    }
+}
+
+/* Return non-zero if `function' is exported with its body expression,
+   as described for `ttl_inline_exportable_p'.  */
+static int
+exportable_expr_p (ttl_function function)
+{
+  return body_kind (function, INLINE_MAX_SIZE) == inline_expr &&
+    portable_p (body_expr (function), function, 0);
+}
+
+/* Return non-zero if the variables and the body of `function' can be
+   printed by `print_portable_function'.  */
+static int
+portable_function_p (ttl_function function)
+{
+  ttl_variable var;
+
+  if (function->kind != function_function ||
+      function->d.function.handcoded || function->d.function.mapped ||
+      !function->d.function.il_code)
+    return 0;
+  for (var = function->params; var; var = var->next)
+    if (!portable_type_p (var->type))
+      return 0;
+  for (var = function->locals; var; var = var->next)
+    if (!portable_type_p (var->type))
+      return 0;
+  return portable_stmts_p (function->d.function.il_code, function);
+}
+
+/* Return non-zero if `node' calls an accessor of the module on the
+   parameter `param', which reads a function field that is never
+   changed after construction.  */
+static int
+reads_fixed_function_p (ttl_il_node node, ttl_variable param)
+{
+  ttl_il_node * slots[3];
+  ttl_function callee;
+  int i, n;
+
+  if (!node)
+    return 0;
+  if (node->kind == il_call && node->d.call.function->kind == il_function &&
+      node->d.call.args &&
+      node->d.call.args->d.pair.car->kind == il_variable &&
+      node->d.call.args->d.pair.car->d.variable.variable == param)
+    {
+      callee = node->d.call.function->d.function.function;
+      if (callee && callee->kind == function_accessor &&
+	  callee->type->d.function.return_type->kind == type_function &&
+	  module_function_p (export_module, callee) &&
+	  fixed_field_p (callee))
+	return 1;
+    }
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    if (reads_fixed_function_p (*slots[i], param))
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if the body of `function' or of a function nested
+   inside of it reads a fixed function field of `param', as described
+   for `reads_fixed_function_p'.  */
+static int
+function_reads_fixed_function_p (ttl_function function, ttl_variable param)
+{
+  ttl_function f;
+
+  if (reads_fixed_function_p (function->d.function.il_code, param))
+    return 1;
+  for (f = function->enclosed; f; f = f->next)
+    if (function_reads_fixed_function_p (f, param))
+      return 1;
+  return 0;
+}
+
+/* Return non-zero if `function' takes a function parameter, or a data
+   object whose function fields it calls, and its body can be written
+   to the interface file as a statement list, so that importing modules
+   can specialize it for the functions they pass.  The body may define
+   nested functions, which are written along with it.  */
+static int
+exportable_stmts_p (ttl_function function)
+{
+  ttl_variable var;
+  int functional = 0;
+
+  for (var = function->params; var; var = var->next)
+    if (var->type->kind == type_function ||
+	(var->type->kind == type_sum &&
+	 function_reads_fixed_function_p (function, var)))
+      functional = 1;
+  return functional && portable_function_p (function) &&
+    function_size (function) <= SPECIALIZE_MAX_SIZE;
+}
+
+int
+ttl_inline_exportable_p (ttl_module module, ttl_function function)
+{
+  export_module = module;
+  return !function->enclosing &&
+    (exportable_expr_p (function) || exportable_stmts_p (function));
+}
+
+/* Parameters of the function whose body expression is currently
+   printed in place of a call, mapped to the arguments.  */
+static inline_subst print_subst = NULL;
+
+static char * binop_names[] =
+  {"+", "-", "or", "and", "*", "/", "%", ":=", "=", "<>", "<", "<=",
+   ">", ">=", "::"};
+static char * unop_names[] =
+  {"-", "not", "hd", "tl", "sizeof"};
+
+/* Print the portable expression `node' in Turtle syntax.  Local
+   variables and the parameters of nested functions are printed with
+   their unique names, so that variables of nested blocks cannot clash
+   when they are declared at the start of the body.  */
+static void
+print_portable (FILE * f, ttl_il_node node)
+{
+  ttl_il_node args;
+
+  switch (node->kind)
+    {
+    case il_variable:
+      {
+	inline_subst s = print_subst;
+
+	while (s && s->from != node->d.variable.variable)
+	  s = s->next;
+	if (s)
+	  {
+	    inline_subst saved = print_subst;
+
+	    /* The arguments belong to the caller.  */
+	    print_subst = NULL;
+	    print_portable (f, s->expr);
+	    print_subst = saved;
+	    break;
+	  }
+      }
+      if (node->d.variable.variable->kind == variable_local ||
+	  node->d.variable.variable->defining->enclosing)
+	ttl_symbol_print (f, node->d.variable.variable->unique_name);
+      else
+	ttl_symbol_print (f, node->d.variable.variable->name);
+      break;
+    case il_function:
+      if (hidden_callee_p (node->d.function.function))
+	ttl_symbol_print (f, node->d.function.mangled_name);
+      else
+	ttl_symbol_print (f, node->d.function.function->name);
+      break;
+    case il_int_const:
+      if (node->d.integer.value < 0)
+	fprintf (f, "(-%ld)", -node->d.integer.value);
+      else
+	fprintf (f, "%ld", node->d.integer.value);
+      break;
+    case il_long_const:
+      if (node->d.longint.value < 0)
+	fprintf (f, "(-%ldL)", -node->d.longint.value);
+      else
+	fprintf (f, "%ldL", node->d.longint.value);
+      break;
+    case il_bool_const:
+      fprintf (f, node->d.bool.value ? "true" : "false");
+      break;
+    case il_null_const:
+      fprintf (f, "null");
+      break;
+    case il_char_const:
+      fprintf (f, "'%c'", node->d.character.value);
+      break;
+    case il_binop:
+      fprintf (f, "(");
+      print_portable (f, node->d.binop.op0);
+      fprintf (f, " %s ", binop_names[node->d.binop.op]);
+      print_portable (f, node->d.binop.op1);
+      fprintf (f, ")");
+      break;
+    case il_unop:
+      fprintf (f, "(%s ", unop_names[node->d.unop.op]);
+      print_portable (f, node->d.unop.op0);
+      fprintf (f, ")");
+      break;
+    case il_index:
+      print_portable (f, node->d.index.array);
+      fprintf (f, "[");
+      print_portable (f, node->d.index.index);
+      fprintf (f, "]");
+      break;
+    case il_call:
+      if (expandable_call_p (node))
+	{
+	  ttl_function callee = node->d.call.function->d.function.function;
+	  ttl_variable param = callee->params;
+	  struct inline_subst substs[EXPAND_MAX_ARGS];
+	  int i = 0;
+
+	  for (args = node->d.call.args; args;
+	       args = args->d.pair.cdr, param = param->next, i++)
+	    {
+	      substs[i].next = i > 0 ? &substs[i - 1] : NULL;
+	      substs[i].from = param;
+	      substs[i].expr = args->d.pair.car;
+	      substs[i].to = NULL;
+	    }
+	  print_subst = i > 0 ? &substs[i - 1] : NULL;
+	  print_portable (f, body_expr (callee));
+	  print_subst = NULL;
+	  break;
+	}
+      print_portable (f, node->d.call.function);
+      fprintf (f, " (");
+      for (args = node->d.call.args; args; args = args->d.pair.cdr)
+	{
+	  print_portable (f, args->d.pair.car);
+	  if (args->d.pair.cdr)
+	    fprintf (f, ", ");
+	}
+      fprintf (f, ")");
+      break;
+    case il_array_constructor:
+      fprintf (f, "(array ");
+      print_portable (f, node->d.array_constructor.size);
+      fprintf (f, " of ");
+      print_portable (f, node->d.array_constructor.initial);
+      fprintf (f, ")");
+      break;
+    default:
+      fprintf (stderr, "print_portable: invalid HIL node encountered\n");
+      abort ();
+    }
+}
+
+/* Print the expressions in `list', separated by commas.  */
+static void
+print_portable_list (FILE * f, ttl_il_node list)
+{
+  while (list)
+    {
+      print_portable (f, list->d.pair.car);
+      list = list->d.pair.cdr;
+      if (list)
+	fprintf (f, ", ");
+    }
+}
+
+static void print_portable_stmt (FILE * f, ttl_il_node node);
+
+static void
+print_portable_stmts (FILE * f, ttl_il_node list)
+{
+  while (list)
+    {
+      print_portable_stmt (f, list->d.pair.car);
+      list = list->d.pair.cdr;
+    }
+}
+
+/* Print the declarations of the local variables of `function', except
+   for the variables holding the closures of nested functions, which
+   are declared by the function definitions.  */
+static void
+print_portable_locals (FILE * f, ttl_function function)
+{
+  ttl_variable var;
+  ttl_function nested;
+
+  for (var = function->locals; var; var = var->next)
+    {
+      for (nested = function->enclosed; nested; nested = nested->next)
+	if (nested->variable == var)
+	  break;
+      if (nested)
+	continue;
+      fprintf (f, "var ");
+      ttl_symbol_print (f, var->unique_name);
+      fprintf (f, ": ");
+      ttl_print_type (f, var->type);
+      fprintf (f, "; ");
+    }
+}
+
+/* Print the definition of the nested function `function', named by
+   the unique name of its closure variable.  */
+static void
+print_portable_function (FILE * f, ttl_function function)
+{
+  ttl_variable var;
+
+  fprintf (f, "fun ");
+  ttl_symbol_print (f, function->variable->unique_name);
+  fprintf (f, " (");
+  for (var = function->params; var; var = var->next)
+    {
+      ttl_symbol_print (f, var->unique_name);
+      fprintf (f, ": ");
+      ttl_print_type (f, var->type);
+      if (var->next)
+	fprintf (f, ", ");
+    }
+  fprintf (f, ")");
+  if (function->type->d.function.return_type->kind != type_void)
+    {
+      fprintf (f, ": ");
+      ttl_print_type (f, function->type->d.function.return_type);
+    }
+  fprintf (f, " ");
+  print_portable_locals (f, function);
+  print_portable_stmts (f, function->d.function.il_code);
+  fprintf (f, "end; ");
+}
+
+/* Print the portable statement `node' in Turtle syntax, followed by a
+   semicolon.  */
+static void
+print_portable_stmt (FILE * f, ttl_il_node node)
+{
+  if (!node)
+    return;
+  switch (node->kind)
+    {
+    case il_binop:
+      if (node->d.binop.op1->kind == il_function)
+	{
+	  print_portable_function (f, node->d.binop.op1->d.function.function);
+	  break;
+	}
+      if (node->d.binop.op0->kind == il_tuple_expr)
+	{
+	  print_portable_list (f, node->d.binop.op0->d.tuple_expr.elements);
+	  fprintf (f, " := ");
+	  print_portable_list (f, node->d.binop.op1->d.tuple_expr.elements);
+	}
+      else
+	{
+	  print_portable (f, node->d.binop.op0);
+	  fprintf (f, " := ");
+	  print_portable (f, node->d.binop.op1);
+	}
+      fprintf (f, "; ");
+      break;
+    case il_call:
+      print_portable (f, node);
+      fprintf (f, "; ");
+      break;
+    case il_if:
+      fprintf (f, "if ");
+      print_portable (f, node->d.ifstmt.cond);
+      fprintf (f, " then ");
+      print_portable_stmts (f, node->d.ifstmt.thenstmt);
+      if (node->d.ifstmt.elsestmt)
+	{
+	  fprintf (f, "else ");
+	  print_portable_stmts (f, node->d.ifstmt.elsestmt);
+	}
+      fprintf (f, "end; ");
+      break;
+    case il_while:
+      fprintf (f, "while ");
+      print_portable (f, node->d.whilestmt.cond);
+      fprintf (f, " do ");
+      print_portable_stmts (f, node->d.whilestmt.dostmt);
+      fprintf (f, "end; ");
+      break;
+    case il_return:
+      fprintf (f, "return");
+      if (node->d.returnstmt.expr)
+	{
+	  fprintf (f, " ");
+	  print_portable (f, node->d.returnstmt.expr);
+	}
+      fprintf (f, "; ");
+      break;
+    case il_seq:
+      print_portable_stmts (f, node->d.seq.stmts);
+      break;
+    default:
+      fprintf (stderr,
+	       "print_portable_stmt: invalid HIL node encountered\n");
+      abort ();
+    }
+}
+
+void
+ttl_inline_print_body (FILE * f, ttl_function function)
+{
+  ttl_variable var = function->params;
+
+  fprintf (f, "inline (");
+  while (var)
+    {
+      ttl_symbol_print (f, var->name);
+      var = var->next;
+      if (var)
+	fprintf (f, ", ");
+    }
+  fprintf (f, ") ");
+  if (exportable_expr_p (function))
+    print_portable (f, body_expr (function));
+  else
+    {
+      fprintf (f, "do ");
+      print_portable_locals (f, function);
+      print_portable_stmts (f, function->d.function.il_code);
+      fprintf (f, "end");
+    }
+}
+
+/* A function which is called by exported bodies and written as an
+   entry of its own, named `name'.  */
+typedef struct hidden_callee * hidden_callee;
+struct hidden_callee
+{
+  hidden_callee next;
+  ttl_symbol name;
+  ttl_function function;
+};
+
+/* Append the functions called in `node' which are written as entries
+   of their own to the list `*list', unless they are already on it.
+   Calls which are printed as the body of the called function are
+   skipped.  */
+static void
+collect_callees (ttl_compile_state state, ttl_il_node node,
+		 hidden_callee * list)
+{
+  ttl_il_node * slots[3];
+  ttl_il_node args;
+  ttl_function callee;
+  int i, n;
+
+  if (!node)
+    return;
+  if (node->kind == il_call && expandable_call_p (node))
+    {
+      for (args = node->d.call.args; args; args = args->d.pair.cdr)
+	collect_callees (state, args->d.pair.car, list);
+      return;
+    }
+  if (node->kind == il_function)
+    {
+      callee = node->d.function.function;
+      if (!callee || !hidden_callee_p (callee))
+	return;
+      while (*list && (*list)->function != callee)
+	list = &(*list)->next;
+      if (!*list)
+	{
+	  *list = ttl_malloc (state->pool, sizeof (struct hidden_callee));
+	  (*list)->next = NULL;
+	  (*list)->name = node->d.function.mangled_name;
+	  (*list)->function = callee;
+	}
+      return;
+    }
+  n = ttl_il_child_slots (node, slots);
+  for (i = 0; i < n; i++)
+    collect_callees (state, *slots[i], list);
+}
+
+/* Collect the functions called by `function' and the functions nested
+   inside of it, as for `collect_callees'.  */
+static void
+collect_function_callees (ttl_compile_state state, ttl_function function,
+			  hidden_callee * list)
+{
+  ttl_function f;
+
+  collect_callees (state, function->d.function.il_code, list);
+  for (f = function->enclosed; f; f = f->next)
+    collect_function_callees (state, f, list);
+}
+
+static char * data_function_kinds[] =
+  {"function", "constraint", "constructor", "accessor", "setter",
+   "discriminator"};
+
+void
+ttl_inline_print_callees (FILE * f, ttl_compile_state state,
+			  ttl_module module)
+{
+  hidden_callee list = NULL, h;
+  ttl_function function;
+  ttl_field_list field;
+
+  for (function = module->toplevel_functions; function;
+       function = function->next)
+    if (function->exported && ttl_inline_exportable_p (module, function))
+      collect_function_callees (state, function, &list);
+  if (list)
+    fprintf (f, "// Functions called by inline bodies:\n");
+  for (h = list; h; h = h->next)
+    {
+      function = h->function;
+      ttl_symbol_print (f, h->name);
+      fprintf (f, " fun ");
+      ttl_print_type (f, function->type);
+      switch (function->kind)
+	{
+	case function_function:
+	  fprintf (f, " = extern ");
+	  ttl_ast_print (f, ttl_strip_annotation
+			 (function->module->module_ast_name), 0);
+	  break;
+	case function_constructor:
+	case function_discriminator:
+	  fprintf (f, " = data %s %u %u %u %u %u",
+		   data_function_kinds[function->kind],
+		   function->variant_count, function->nullary_count,
+		   function->d.constr_discrim.variant,
+		   function->d.constr_discrim.field_count,
+		   function->d.constr_discrim.constraint_mask);
+	  break;
+	default:
+	  fprintf (f, " = data %s%s %u %u",
+		   data_function_kinds[function->kind],
+		   (function->kind == function_accessor &&
+		    fixed_field_p (function)) ? " fixed" : "",
+		   function->variant_count, function->nullary_count);
+	  for (field = function->d.accessor.field_list; field;
+	       field = field->next)
+	    fprintf (f, " %d %d %d", field->variant, field->offset,
+		     field->constrainable);
+	  break;
+	}
+      fprintf (f, "\n");
+    }
+  if (list)
+    fprintf (f, "\n");
+}
+
+/* End of inline.c.  */
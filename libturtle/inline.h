@@ -0,0 +1,67 @@
+/* libturtle/inline.h - inlining of small functions
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+#ifndef TTL_INLINE_H
+#define TTL_INLINE_H
+
+#include <stdio.h>
+
+#include "env.h"
+#include "compiler.h"
+
+/* Replace calls to small functions in all functions of `module' by
+   the bodies of the called functions.  This works on the high-level
+   intermediate code and must be run before code generation.  With an
+   execution profile (`state->profile'), larger functions are inlined
+   into hot functions, and none into functions which never ran.  */
+void ttl_inline_module (ttl_compile_state state, ttl_module module);
+
+/* Redirect calls which pass toplevel functions or closed function
+   expressions as arguments to copies of the called functions, in
+   which these arguments are known.  Calls through these arguments
+   can then be inlined by `ttl_inline_module'.  Functions of other
+   modules are copied if their interface file contains their body.  */
+void ttl_specialize_module (ttl_compile_state state, ttl_module module);
+
+/* Return non-zero if the body of `function' of `module' may be
+   written to the interface file, so that the function can be inlined
+   or specialized in other modules.  This is possible for functions
+   which return an expression made up only of operators, constants and
+   parameters, and for functions with function parameters, or with
+   data parameters whose function fields they call, whose body only
+   uses simple statements, their own variables and the functions
+   exported before them or listed by `ttl_inline_print_callees'.  */
+int ttl_inline_exportable_p (ttl_module module, ttl_function function);
+
+/* Print entries for the functions called by the exportable functions
+   of `module' which importing modules do not know otherwise to `f'.
+   These are the private data type functions of `module', with their
+   kind and the layout of their data type, and the functions of other
+   modules, with the name of their module.  The entries are named by
+   the C names of the functions and must precede the bodies in the
+   interface file.  */
+void ttl_inline_print_callees (FILE * f, ttl_compile_state state,
+			       ttl_module module);
+
+/* Print the parameter names and the body expression or statements of
+   the exportable function `function' to `f', in the format expected by
+   the interface file parser.  */
+void ttl_inline_print_body (FILE * f, ttl_function function);
+
+#endif /* not TTL_INLINE_H */
@@ -17,13 +17,23 @@
   Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
   MA 02111-1307, USA.  */
 
+#if HAVE_CONFIG_H
+# include <config.h>
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
+#include <errno.h>
 
 #include <signal.h>
 #include <time.h>
 #include <sys/time.h>
 #include <sys/times.h>
+#include <pthread.h>
+#include <poll.h>
+#if HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 
 #include "version.h"
 #include "libturtlert.h"
@@ -49,13 +59,194 @@ static FILE * dribble;
 
 /* This structure collects all statistics gathered during run
    time.  */
-struct ttl_statistics ttl_stats;
+TTL_THREAD_LOCAL struct ttl_statistics ttl_stats;
 
 /* These are set by the startup code when the user specifies the -:s
-   or -:g options.  */
+   (-:S for machine-readable output) or -:g options.  */
 static int print_stats_on_exit = 0;
+static int print_stats_machine_readable = 0;
 static int print_gc_messages = 0;
 
+/* The name of the program, from which the names of profile files are
+   derived.  */
+static char * program_name = NULL;
+
+/* Return the time of a monotonic clock in nanoseconds.  The origin is
+   unspecified, so only differences are meaningful.  Systems without
+   `clock_gettime' fall back to the time of day.  */
+ttl_nanoseconds
+ttl_monotonic_time (void)
+{
+#if defined (CLOCK_MONOTONIC)
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ttl_nanoseconds) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return (ttl_nanoseconds) tv.tv_sec * 1000000000 + tv.tv_usec * 1000;
+#endif
+}
+
+
+/* The slot of the virtual machine running in the current thread in
+   the table of machines, 0 for the main machine.  See the section on
+   virtual machines below.  */
+static TTL_THREAD_LOCAL int current_vm = 0;
+
+
+/* Event tracing, enabled with `-:t'.  ========== */
+
+/* Begin and end events of garbage collections, timer interrupts and
+   constraint solver calls, and instant events for signals and heap
+   resizes are recorded into a ring buffer which is allocated at
+   startup, so that the newest events survive when the buffer fills
+   up.  Events are recorded from signal handlers, too, so each event
+   reserves its slot with a single atomic increment and no locks are
+   taken and no memory is allocated while recording.  All virtual
+   machines record into the same buffer, each event is shown on the
+   track of the machine which recorded it.  On exit, the buffer is
+   written to `PROGRAM.trace.json' in the trace event format which is
+   understood by the Chrome trace viewer.  */
+
+/* The default number of events in the ring buffer, must be a power of
+   two.  */
+#define TRACE_DEFAULT_EVENTS 65536
+
+#if defined (__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+# define TRACE_RESERVE() __sync_fetch_and_add (&trace_next, 1)
+#else
+# define TRACE_RESERVE() (trace_next++)
+#endif
+
+struct trace_event
+{
+  const char * name;		/* Static string, never freed.  */
+  const char * arg_name;	/* NULL if the event has no argument.  */
+  long arg;
+  ttl_nanoseconds time;		/* Time of `ttl_monotonic_time'.  */
+  int vm;			/* Slot of the recording machine.  */
+  char phase;			/* `B', `E' or `i'.  */
+};
+
+static struct trace_event * trace_buffer = NULL;
+static unsigned trace_size = 0;
+static volatile unsigned trace_next = 0;
+static int trace_events = 0;	/* Set by `-:tNUM'.  */
+static ttl_nanoseconds trace_origin;
+
+/* Record an event with phase `phase' and the optional argument `arg'
+   called `arg_name'.  */
+static void
+trace_event (const char * name, char phase, const char * arg_name, long arg)
+{
+  struct trace_event * e;
+
+  if (!trace_buffer)
+    return;
+  e = trace_buffer + (TRACE_RESERVE () & (trace_size - 1));
+  e->arg_name = arg_name;
+  e->arg = arg;
+  e->time = ttl_monotonic_time ();
+  e->vm = current_vm;
+  e->phase = phase;
+  /* Stored last, so that `trace_write' skips events which are only
+     partially written.  */
+  e->name = name;
+}
+
+#define TRACE_BEGIN(name) trace_event ((name), 'B', NULL, 0)
+#define TRACE_END(name) trace_event ((name), 'E', NULL, 0)
+
+/* Allocate a ring buffer for at least `events' events.  */
+static void
+trace_start (unsigned events)
+{
+  trace_size = 1;
+  while (trace_size < events)
+    trace_size <<= 1;
+  trace_buffer = malloc (trace_size * sizeof (struct trace_event));
+  if (!trace_buffer)
+    {
+      fprintf (stderr, "turtle rt: cannot allocate trace buffer\n");
+      trace_size = 0;
+      return;
+    }
+  memset (trace_buffer, 0, trace_size * sizeof (struct trace_event));
+  trace_origin = ttl_monotonic_time ();
+}
+
+/* Write the events in the ring buffer to `PROGRAM.trace.json', oldest
+   first.  The buffer is not freed, since other virtual machines may
+   still be recording into it until the process exits.  */
+static void
+trace_write (void)
+{
+  struct trace_event * buffer = trace_buffer;
+  unsigned next = trace_next, first, count, i;
+  const char * separator = "";
+  char * filename;
+  FILE * f;
+
+  if (!buffer || !program_name)
+    return;
+  /* Stop recording, events from signal handlers would be lost
+     anyway.  */
+  trace_buffer = NULL;
+  if (next > trace_size)
+    {
+      first = next;
+      count = trace_size;
+    }
+  else
+    {
+      first = 0;
+      count = next;
+    }
+
+  filename = malloc (strlen (program_name) + 12);
+  if (!filename)
+    {
+      fprintf (stderr, "turtle rt: cannot write trace: out of memory\n");
+      return;
+    }
+  strcpy (filename, program_name);
+  strcat (filename, ".trace.json");
+  f = fopen (filename, "w");
+  if (!f)
+    {
+      fprintf (stderr, "turtle rt: cannot write trace: %s\n", filename);
+      free (filename);
+      return;
+    }
+  fprintf (f, "{\"traceEvents\":[\n");
+  for (i = 0; i < count; i++)
+    {
+      struct trace_event * e = buffer + ((first + i) & (trace_size - 1));
+      double ts = (e->time - trace_origin) / 1000.0;
+
+      /* Skip slots which another machine has reserved, but not yet
+	 filled.  */
+      if (!e->name)
+	continue;
+      fprintf (f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.0f,"
+	       "\"pid\":1,\"tid\":%d", separator, e->name, e->phase, ts,
+	       e->vm);
+      if (e->phase == 'i')
+	fprintf (f, ",\"s\":\"g\"");
+      if (e->arg_name)
+	fprintf (f, ",\"args\":{\"%s\":%ld}", e->arg_name, e->arg);
+      fprintf (f, "}");
+      separator = ",\n";
+    }
+  fprintf (f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  if (fclose (f) != 0)
+    fprintf (stderr, "turtle rt: cannot write trace: %s\n", filename);
+  free (filename);
+}
+
 
 /* Memory-management related definitions and variables.  ========== */
 
@@ -91,48 +282,51 @@ static int print_gc_messages = 0;
    specifies the -:hNUM option.  */
 static unsigned heap_size_in_bytes = TTL_INITIAL_IN_BYTES;
 
+/* Each virtual machine has a heap of its own, described by the
+   thread-local variables below.  */
+
 /* The number of words allocated to each semi-space.  */
-static unsigned semi_space_in_words;
+static TTL_THREAD_LOCAL unsigned semi_space_in_words;
 
 /* Origin of memory area for space 0.  */
-static ttl_value * space0orig;
+static TTL_THREAD_LOCAL ttl_value * space0orig;
 
 /* The above, rounded up to 8-byte boundary.  */
-static ttl_value * space0;
+static TTL_THREAD_LOCAL ttl_value * space0;
 
 /* Pointer to first word after space 0.  */
-static ttl_value * space0limit;
+static TTL_THREAD_LOCAL ttl_value * space0limit;
 
 /* Origin of memory area for space 1.  */
-static ttl_value * space1orig;
+static TTL_THREAD_LOCAL ttl_value * space1orig;
 
 /* The above, rounded up to 8-byte boundary.  */
-static ttl_value * space1;
+static TTL_THREAD_LOCAL ttl_value * space1;
 
 /* Pointer to first word after space 1.  */
-static ttl_value * space1limit;
+static TTL_THREAD_LOCAL ttl_value * space1limit;
 
 /* The number of the current allocation space, must be 0 or 1.  */
-static int current_space;
+static TTL_THREAD_LOCAL int current_space;
 
 /* Base of current from-space, either space0 or space1.  */
-static ttl_value * from_space;
+static TTL_THREAD_LOCAL ttl_value * from_space;
 
 /* Limit of current from-space, either space0limit or space1limit.  */
-static ttl_value * from_space_limit;
+static TTL_THREAD_LOCAL ttl_value * from_space_limit;
 
 /* Base of current to-space, either space0 or space1.  */
-static ttl_value * to_space;
+static TTL_THREAD_LOCAL ttl_value * to_space;
 
 /* Limit of current to-space, either space0limit or space1limit.  */
-static ttl_value * to_space_limit;
+static TTL_THREAD_LOCAL ttl_value * to_space_limit;
 
 /* A garbage collection sets this to non-zero, if a collection did not
    yield enough free memory and thus the heap should be resized.
    Since we cannot resize the area we have just copied to, from-space
    is resized and the resize of to-space is deferred to the next
    collection, when it is empty.  */
-static int heap_needs_resize = 0;
+static TTL_THREAD_LOCAL int heap_needs_resize = 0;
 
 /* Limit of the global variables a program can have.  */
 /* XXX: This should be a dynamic array, which can be resized.  Do it
@@ -143,42 +337,47 @@ static int heap_needs_resize = 0;
 /* This array holds the addresses of the global variables of a
    program, which should be considered roots for garbage
    collection.  */ 
-static ttl_value * global_roots[MAX_GLOBAL_ROOTS];
+static TTL_THREAD_LOCAL ttl_value * global_roots[MAX_GLOBAL_ROOTS];
 
 /* Number of valid entries in the array above.  */
-static int global_root_count;
+static TTL_THREAD_LOCAL int global_root_count;
 
 /* This is the maximum size for the evaluation stack.  Since the stack
    is copied to a continuation on each nested function call, this
    should be enough for a while.  */
 #define TTL_STACK_SIZE 1024
 
-/* Registers of the Turtle machine.  */
-ttl_value * ttl_alloc_ptr;	/* Points to the next free heap cell.  */
-ttl_value * ttl_alloc_limit;	/* Points behind the last heap cell.  */
-ttl_value ttl_global_pc;	/* Points to the code to be executed.  */
-ttl_value ttl_global_acc;	/* Holds intermediate results.  */
-ttl_value ttl_global_env;	/* Points to the current environment.  */
-ttl_value ttl_global_cont;	/* Points to the current continuation.  */
-ttl_value ttl_stack[TTL_STACK_SIZE]; /* Evaluation stack.  */
-int ttl_global_sp = 0;		/* Top of the above stack.  */
-
-/* The list of exception handlers.  It is currently maintained by
-   library functions. */
-ttl_value ttl_exception_handler;
-
-/* When an exception is raised, the current chain of continuations is
-   saved in this variable.  The standard exception handler uses it to
-   display a backtrace.  */
-ttl_value ttl_saved_continuations;
+/* Registers of the Turtle machine running in the current thread.  */
+TTL_THREAD_LOCAL ttl_value * ttl_alloc_ptr;	/* Next free heap cell.  */
+TTL_THREAD_LOCAL ttl_value * ttl_alloc_limit;	/* Behind the last heap cell.  */
+TTL_THREAD_LOCAL ttl_value ttl_global_pc;	/* Code to be executed.  */
+TTL_THREAD_LOCAL ttl_value ttl_global_acc;	/* Intermediate results.  */
+TTL_THREAD_LOCAL ttl_value ttl_global_env;	/* Current environment.  */
+TTL_THREAD_LOCAL ttl_value ttl_global_cont;	/* Current continuation.  */
+TTL_THREAD_LOCAL ttl_value ttl_stack[TTL_STACK_SIZE]; /* Evaluation stack.  */
+TTL_THREAD_LOCAL int ttl_global_sp = 0;	/* Top of the above stack.  */
+
+/* The stack of exception handlers.  Entries are pushed by library
+   functions and popped when an exception is raised.  */
+TTL_THREAD_LOCAL struct ttl_handler ttl_handlers[TTL_MAX_HANDLERS];
+TTL_THREAD_LOCAL int ttl_handler_count = 0;
+
+/* When an exception is raised, the raise point and the current chain
+   of continuations are saved in these variables.  The standard
+   exception handler uses them to display a backtrace.  */
+TTL_THREAD_LOCAL ttl_descr ttl_raise_pc;
+TTL_THREAD_LOCAL ttl_value ttl_saved_continuations;
 
 /* The following hold pre-allocated strings describing the exceptions
    which are raised by the runtime system or the virtual machine.  */
-ttl_value ttl_null_pointer_exception;
-ttl_value ttl_subscript_exception;
-ttl_value ttl_out_of_range_exception;
-ttl_value ttl_wrong_variant_exception;
-ttl_value ttl_require_exception;
+TTL_THREAD_LOCAL ttl_value ttl_null_pointer_exception;
+TTL_THREAD_LOCAL ttl_value ttl_subscript_exception;
+TTL_THREAD_LOCAL ttl_value ttl_out_of_range_exception;
+TTL_THREAD_LOCAL ttl_value ttl_wrong_variant_exception;
+TTL_THREAD_LOCAL ttl_value ttl_require_exception;
+
+/* Value registers for returning tuples without allocating them.  */
+TTL_THREAD_LOCAL ttl_value ttl_values[TTL_MAX_VALUES];
 
 
 /* Timer and signal handling.  */
@@ -188,20 +387,48 @@ ttl_value ttl_require_exception;
 
 /* This is the value which is used to initialize `ttl_time_slice'
    after each interrupt.  */
-int ttl_time_quantum;
+TTL_THREAD_LOCAL int ttl_time_quantum;
 
 /* This variable holds the number of ticks remaining until the next
    interrupt.  Signal handlers set this to 0 so that an interrupt will
    occur on the next checkpoint.  */
-int ttl_time_slice;
+TTL_THREAD_LOCAL int ttl_time_slice;
 
 #define MAX_SIGNAL 64
-static ttl_value timer_interrupt;
-static ttl_value timer_handler;
-static ttl_value signal_handler;
-static int signals_pending = 0;
-static int signal_mask[MAX_SIGNAL];
-static ttl_value signal_handlers[MAX_SIGNAL];
+static TTL_THREAD_LOCAL ttl_value timer_interrupt;
+static TTL_THREAD_LOCAL ttl_value timer_handler;
+static TTL_THREAD_LOCAL ttl_value signal_handler;
+static TTL_THREAD_LOCAL int signals_pending = 0;
+static TTL_THREAD_LOCAL int signal_mask[MAX_SIGNAL];
+static TTL_THREAD_LOCAL ttl_value signal_handlers[MAX_SIGNAL];
+
+/* The running thread, or TTL_NULL as long as the program did not use
+   threads, and the queue of runnable threads.  See the section on
+   green threads below.  */
+static TTL_THREAD_LOCAL ttl_value current_thread = TTL_NULL;
+static TTL_THREAD_LOCAL ttl_value run_queue_head = TTL_NULL;
+static TTL_THREAD_LOCAL ttl_value run_queue_tail = TTL_NULL;
+
+/* Threads waiting for file descriptors, an array indexed by file
+   descriptor, and their number.  */
+static TTL_THREAD_LOCAL ttl_value io_waiters = TTL_NULL;
+static TTL_THREAD_LOCAL int io_wait_count = 0;
+static void io_poll (int timeout);
+
+/* Live statistics.  Unless the program installs its own handler,
+   SIGUSR1 makes the runtime print the statistics and the heap
+   occupancy at the next checkpoint and continue.  With the option
+   `-:iSECS[,FD]', a one-line summary is written to file descriptor
+   FD (default 2) every SECS seconds.  The interval is checked on
+   timer interrupts, so no line is written while the program is
+   blocked in a system call.  */
+#define STATS_SIGNAL SIGUSR1
+static int stats_interval = 0;
+static int stats_fd = 2;
+static FILE * stats_file = NULL;
+/* Time of the next summary line, in nanoseconds of
+   `ttl_monotonic_time'.  */
+static ttl_nanoseconds stats_next_time = 0;
 
 static char * tc_names[] =
   {
@@ -217,10 +444,15 @@ static char * tc_names[] =
     "environment",
     "variable",
     "constraint",
-    "long"
+    "long",
+    "variable",
+    "method",
+    "constrainable variable",
+    "data"
   };
 
 static void ttl_exit (int code);
+static void finish_vm (void);
 
 #if TTL_PROFILE_MEMORY
 
@@ -415,6 +647,17 @@ walk (ttl_value v, int depth)
 	    break;
 	  }
 
+	case TTL_TC_DATA:
+	  {
+	    ttl_array a = TTL_VALUE_TO_OBJ (ttl_array, v);
+	    unsigned i;
+
+	    fprintf (dribble, " (%s)\n", space_name[space]);
+	    for (i = 0; i < TTL_DATA_SIZE (v); i++)
+	      walk (a->data[i], depth + 1);
+	    break;
+	  }
+
 	case TTL_TC_NONTRACED_ARRAY:
 	  {
 	    fprintf (dribble, " (%s)\n", space_name[space]);
@@ -667,6 +910,24 @@ copy (ttl_value v)
 	    return nv;
 	  }
 
+	case TTL_TC_DATA:
+	  {
+	    ttl_array a = TTL_VALUE_TO_OBJ (ttl_array, v);
+	    ttl_array na;
+	    ttl_value nv;
+	    unsigned i;
+	    size = TTL_DATA_SIZE (v);
+	    na = (ttl_array) ttl_gc_alloc (1 + size);
+	    nv = TTL_OBJ_TO_VALUE (na);
+	    na->header = a->header;
+	    for (i = 0; i < size; i++)
+	      na->data[i] = a->data[i];
+	    heart->header = TTL_MAKE_HEADER (TTL_TC_BROKEN_HEART, 1);
+	    heart->forward = nv;
+	    ttl_stats.forwarded_words += 1 + size;
+	    return nv;
+	  }
+
 	case TTL_TC_NONTRACED_ARRAY:
 	  {
 	    ttl_array a = TTL_VALUE_TO_OBJ (ttl_array, v);
@@ -1017,6 +1278,18 @@ trace (void)
 		break;
 	      }
 
+	    case TTL_TC_DATA:
+	      {
+		ttl_array a = TTL_VALUE_TO_OBJ (ttl_array, v);
+		unsigned i;
+
+		size = TTL_DATA_SIZE (v);
+		for (i = 0; i < size; i++)
+		  a->data[i] = check(copy (a->data[i]));
+		tracep += ROUND_TO_EVEN (1 + size);
+		break;
+	      }
+
 	    case TTL_TC_NONTRACED_ARRAY:
 	      {
 		ttl_array a = TTL_VALUE_TO_OBJ (ttl_array, v);
@@ -1153,10 +1426,13 @@ flip (void)
 static void
 garbage_collect (int required)
 {
-  static struct tms begin_tms, end_tms;
+  static TTL_THREAD_LOCAL struct tms begin_tms, end_tms;
   unsigned gc_time;
+  unsigned long bytes_copied;
+  ttl_nanoseconds begin_nsecs = ttl_monotonic_time ();
   int i;
   times (&begin_tms);
+  TRACE_BEGIN ("garbage_collect");
 
 /*   fprintf (stderr, "\n**GC***\n"); */
   /* Do some statistics.  */
@@ -1237,8 +1513,12 @@ garbage_collect (int required)
     fprintf (stderr, "}\n");
 #endif
 
-  /* Copy the exception indicator strings.  */
-  ttl_exception_handler = check (copy (ttl_exception_handler));
+  /* Copy the exception handlers and indicator strings.  */
+  for (i = 0; i < ttl_handler_count; i++)
+    {
+      ttl_handlers[i].cont = check (copy (ttl_handlers[i].cont));
+      ttl_handlers[i].handler = check (copy (ttl_handlers[i].handler));
+    }
   ttl_saved_continuations = check (copy (ttl_saved_continuations));
   ttl_null_pointer_exception = check (copy (ttl_null_pointer_exception));
   ttl_subscript_exception = check (copy (ttl_subscript_exception));
@@ -1260,10 +1540,16 @@ garbage_collect (int required)
     }
   if (timer_handler)
     timer_handler = check (copy (timer_handler));
+  current_thread = check (copy (current_thread));
+  run_queue_head = check (copy (run_queue_head));
+  run_queue_tail = check (copy (run_queue_tail));
+  io_waiters = check (copy (io_waiters));
 
   /* Trace phase, walk through to-space and copy all values reachable
      from to-space objects.  */
   trace ();
+  bytes_copied = (ttl_alloc_ptr - (current_space == 0 ? space0 : space1))
+    * sizeof (ttl_value);
 
 /*   memset (from_space, 0xff, */
 /* 	  (from_space_limit - from_space) * sizeof (ttl_value)); */
@@ -1330,6 +1616,8 @@ garbage_collect (int required)
 		 (1024 * 1024));
 #endif
 	heap_needs_resize = 1;
+	trace_event ("heap_resize", 'i', "heap_bytes",
+		     semi_space_in_words * 2 * sizeof (ttl_value));
 	if (current_space == 1)
 	  {
 	    ttl_value * heap;
@@ -1391,6 +1679,8 @@ garbage_collect (int required)
   if (gc_time > ttl_stats.max_gc_time)
     ttl_stats.max_gc_time = gc_time;
   ttl_stats.total_gc_time += gc_time;
+  ttl_stats.total_gc_nsecs += ttl_monotonic_time () - begin_nsecs;
+  trace_event ("garbage_collect", 'E', "bytes_copied", bytes_copied);
 }
 
 /* Register the location pointed to by `root' as a root for garbage
@@ -1627,6 +1917,22 @@ ttl_unsafe_alloc_array (unsigned size)
   return v;
 }
 
+/* WILL NOT GC.  */
+ttl_value
+ttl_unsafe_alloc_data (unsigned variant, unsigned size)
+{
+  ttl_array a = (ttl_array) ttl_unsafe_alloc (size + 1);
+  unsigned i;
+
+  ttl_stats.allocations++;
+  ttl_stats.alloced_words += ROUND_TO_EVEN (size + 1);
+
+  a->header = TTL_MAKE_DATA_HEADER (variant, size);
+  for (i = 0; i < size; i++)
+    a->data[i] = TTL_FALSE;
+  return TTL_OBJ_TO_VALUE (a);
+}
+
 /* MAY GC.  */
 ttl_value
 ttl_alloc_nontraced_array (unsigned size)
@@ -2178,12 +2484,21 @@ static struct ttl_descr descriptors[] =
     {TTL_DESCRIPTOR_HEADER, host_procedure, &func_info, -1},
     /* Signal entry point.  + 3 */
     {TTL_DESCRIPTOR_HEADER, host_procedure, &func_info, -1},
+    /* Return from `ttl_init_dispatcher'.  + 4 */
     {TTL_DESCRIPTOR_HEADER, host_procedure, &func_info, -1},
+    /* Start of a thread.  + 5 */
     {TTL_DESCRIPTOR_HEADER, host_procedure, &func_info, -1},
+    /* End of a thread.  + 6 */
     {TTL_DESCRIPTOR_HEADER, host_procedure, &func_info, -1}
   };
 
+/* Set when the continuation pushed by `ttl_init_dispatcher' is
+   resumed.  */
+static TTL_THREAD_LOCAL int init_dispatcher_returned = 0;
+
 static void print_string (FILE * f, ttl_value v);
+static void print_live_stats (void);
+static void print_stats_line (void);
 
 static void
 c_signal_handler (int no)
@@ -2193,6 +2508,7 @@ c_signal_handler (int no)
       signals_pending++;
       signal_mask[no]++;
       ttl_time_slice = 0;	/* Force immediate handling. */
+      trace_event ("signal", 'i', "signal", no);
       signal (no, c_signal_handler);
     }
   else
@@ -2203,10 +2519,18 @@ c_signal_handler (int no)
 void
 ttl_install_signal_handler (int no, ttl_value handler)
 {
+  /* Signals are only delivered to the thread of the main virtual
+     machine.  */
+  if (current_vm != 0)
+    {
+      fprintf (stderr, "turtle rt: signal handlers can only be installed "
+	       "by the main virtual machine\n");
+      ttl_exit (1);
+    }
   if (no >= 0 && no < MAX_SIGNAL)
     {
       signal_handlers[no] = handler;
-      if (handler)
+      if (handler || no == STATS_SIGNAL)
 	signal (no, c_signal_handler);
       else
 	signal (no, SIG_DFL);
@@ -2221,131 +2545,904 @@ ttl_install_timer_handler (ttl_value handler)
 }
 
 
+/* Return non-zero if the continuation `cont' is part of the current
+   chain of continuations.  */
 static int
-host_procedure (void)
+live_continuation_p (ttl_value cont)
 {
-  ttl_value acc;
-  ttl_value * sp;
-  ttl_value cont;
-  ttl_value * alloc;
-  ttl_value * alloc_limit;
+  ttl_value c = ttl_global_cont;
 
-  ttl_environment env;
-  ttl_descr pc;
-  ttl_closure self = NULL;
+  if (cont == TTL_NULL)
+    return 1;
+  /* The bottom of the chain is the continuation of the root
+     continuation, which is the (tagged) null pointer.  */
+  while (c != TTL_NULL && c != TTL_OBJ_TO_VALUE (NULL))
+    {
+      if (c == cont)
+	return 1;
+      c = TTL_VALUE_TO_OBJ (ttl_continuation, c)->cont;
+    }
+  return 0;
+}
 
-  TTL_RESTORE_REGISTERS;
- L_jump:
-  switch (pc - descriptors)
+
+struct ttl_handler *
+ttl_find_handler (void)
+{
+  while (ttl_handler_count > 1 &&
+	 !live_continuation_p (ttl_handlers[ttl_handler_count - 1].cont))
+    ttl_handler_count--;
+  if (ttl_handler_count == 1)
+    return &ttl_handlers[0];
+  return &ttl_handlers[--ttl_handler_count];
+}
+
+
+void
+ttl_prune_handlers (void)
+{
+  int i, j = 1;
+
+  for (i = 1; i < ttl_handler_count; i++)
+    if (live_continuation_p (ttl_handlers[i].cont))
+      ttl_handlers[j++] = ttl_handlers[i];
+  ttl_handler_count = j;
+  if (ttl_handler_count == TTL_MAX_HANDLERS)
     {
-    case 0:
-      TTL_SAVE_REGISTERS;
-      ttl_exit (TTL_VALUE_TO_INT (ttl_global_acc));
-      break;
+      fprintf (stderr, "turtle rt: too many exception handlers\n");
+      abort ();
+    }
+}
 
-    case 1:
-      {
-	ttl_value exc = *(--sp);
-	if (exc == ttl_null_pointer_exception)
-	  {
-	    fprintf (stderr,
-		     "\n\nturtle exception: null pointer\n");
-	  }
-	else if (exc == ttl_subscript_exception)
-	  {
-	    fprintf (stderr, "\n\nturtle exception: index out of bounds\n");
-	  }
-	else if (exc == ttl_out_of_range_exception)
-	  {
-	    fprintf (stderr, "\n\nturtle exception: value out of range\n");
-	  }
-	else if (exc == ttl_wrong_variant_exception)
-	  {
-	    fprintf (stderr, "\n\nturtle exception: wrong variant\n");
-	  }
-	else if (exc == ttl_require_exception)
-	  {
-	    fprintf (stderr,
-		     "\n\nturtle exception: required expression failed\n");
-	  }
-	else
-	  {
-	    fprintf (stderr, "\n\nturtle exception: unknown exception: ");
-	    print_string (stderr, exc);
-	    fprintf (stderr, "\n");
-	  }
-	{
-	  ttl_continuation c = TTL_VALUE_TO_OBJ (ttl_continuation,
-						 ttl_saved_continuations);
-	  struct ttl_function_info * last_function_info = NULL;
-	  int last_line = -1;
-	  int first = 1;
 
-	  while (c)
-	    {
-	      if (c->pc && c->pc->line >= 0)
-		{
-		  if (c->pc->function_info != last_function_info ||
-		      c->pc->line != last_line)
-		    {
-#if 0
-		      if (first)
-			fprintf (stderr, "         In line: ");
-		      else
-			fprintf (stderr, "     called from: ");
-		      fprintf (stderr, "%s:%d",
-			       c->pc->function_info->filename, 
-			       c->pc->line + 1);
-		      if (c->pc && c->pc->function_info->function)
-			{
-			  if (c->pc->function_info != last_function_info)
-			    fprintf (stderr, " (function %s)",
-				     c->pc->function_info->function);
-			}
-#else
-		      if (first)
-			fprintf (stderr, "     In function: ");
-		      else
-			fprintf (stderr, "     called from: ");
-		      fprintf (stderr, "%s", c->pc->function_info->module);
-		      fprintf (stderr, ".");
-		      fprintf (stderr, "%s", c->pc->function_info->function);
-		      {
-			int i = strlen (c->pc->function_info->module)
-			  + strlen (c->pc->function_info->function) + 18;
-			while (i++ < 36)
-			  fprintf (stderr, " ");
-		      }
-		      fprintf (stderr, " (%s:%d)",
-			       c->pc->function_info->filename, 
-			       c->pc->line + 1);
-#endif
-		      fprintf (stderr, "\n");
-		      last_function_info = c->pc->function_info;
-		      last_line = c->pc->line;
-		      first = 0;
-		    }
-		}
-	      c = TTL_VALUE_TO_OBJ (ttl_continuation, c->cont);
-	    }
-	}
-	fprintf (stderr, "Program halted.\n");
-	TTL_SAVE_REGISTERS;
-	ttl_exit (1);
-	break;
-      }
+/* Green threads.  ========== */
+
+/* Threads are scheduled by the runtime system on top of the
+   continuations.  A thread which is not running is represented by its
+   chain of continuations; switching threads means saving
+   `ttl_global_cont' into the current thread and resuming the topmost
+   continuation of the next one.  Threads switch when they block in
+   one of the functions below, and when the time slice expires in
+   `tick_function', so that a running thread is preempted at the next
+   checkpoint (function entry or loop head).  Since the counter in
+   `ttl_time_slice' runs out only after many checkpoints, a timer of
+   processor time forces ticks every `thread_slice_ms' milliseconds
+   while there are threads, like the profiler does.
+
+   Thread records, mutexes and channels are traced arrays with the
+   layouts below.  Queues of threads are linked through the
+   THREAD_NEXT field, so that a thread can be in at most one queue,
+   which is either the run queue or the queue of the mutex, channel,
+   thread or file descriptor it waits for.  */
+
+#define THREAD_CONT     0	/* Continuations while not running.  */
+#define THREAD_VALUE    1	/* Accumulator when resumed.  */
+#define THREAD_STATE    2
+#define THREAD_NEXT     3
+#define THREAD_JOINERS  4	/* Threads waiting for this one.  */
+#define THREAD_HANDLERS 5	/* Exception handlers while not running.  */
+#define THREAD_ID       6
+#define THREAD_SIZE     7
+
+#define THREAD_RUNNING  0
+#define THREAD_RUNNABLE 1
+#define THREAD_BLOCKED  2
+#define THREAD_FINISHED 3
+
+#define MUTEX_OWNER     0
+#define MUTEX_HEAD      1	/* Threads waiting for the mutex.  */
+#define MUTEX_TAIL      2
+#define MUTEX_SIZE      3
+
+#define CHANNEL_BUFFER      0
+#define CHANNEL_START       1	/* Index of the oldest value.  */
+#define CHANNEL_COUNT       2	/* Number of buffered values.  */
+#define CHANNEL_RECV_HEAD   3	/* Threads waiting for values.  */
+#define CHANNEL_RECV_TAIL   4
+#define CHANNEL_SEND_HEAD   5	/* Threads waiting for room.  */
+#define CHANNEL_SEND_TAIL   6
+#define CHANNEL_SIZE        7
+
+#define FIELD(v, i) (TTL_VALUE_TO_OBJ (ttl_array, (v))->data[(i)])
+
+#define THREAD_DEFAULT_SLICE_MS 10
+
+static TTL_THREAD_LOCAL int next_thread_id = 0;
+
+static int thread_slice_ms = THREAD_DEFAULT_SLICE_MS;
+static TTL_THREAD_LOCAL int preempt_timer_running = 0;
+static TTL_THREAD_LOCAL volatile sig_atomic_t preempt_pending = 0;
 
-    case 2:
-      /* Timer interrupt.  */
-      if (timer_handler)
+static void
+preempt_signal_handler (int no)
+{
+  preempt_pending = 1;
+  ttl_time_slice = 0;
+  signal (SIGVTALRM, preempt_signal_handler);
+}
+
+static void
+preempt_timer_start (void)
+{
+  struct itimerval value;
+
+  value.it_interval.tv_sec = thread_slice_ms / 1000;
+  value.it_interval.tv_usec = (thread_slice_ms % 1000) * 1000;
+  value.it_value = value.it_interval;
+  signal (SIGVTALRM, preempt_signal_handler);
+  if (setitimer (ITIMER_VIRTUAL, &value, NULL))
+    perror ("turtle rt: setitimer");
+  preempt_timer_running = 1;
+}
+
+/* Append the thread `t' to the queue starting at `*head'.  */
+static void
+queue_append (ttl_value * head, ttl_value * tail, ttl_value t)
+{
+  FIELD (t, THREAD_NEXT) = TTL_NULL;
+  if (*head == TTL_NULL)
+    *head = t;
+  else
+    FIELD (*tail, THREAD_NEXT) = t;
+  *tail = t;
+}
+
+/* Remove the first thread from the queue starting at `*head' and
+   return it, or TTL_NULL if the queue is empty.  */
+static ttl_value
+queue_remove (ttl_value * head, ttl_value * tail)
+{
+  ttl_value t = *head;
+
+  if (t != TTL_NULL)
+    {
+      *head = FIELD (t, THREAD_NEXT);
+      if (*head == TTL_NULL)
+	*tail = TTL_NULL;
+      FIELD (t, THREAD_NEXT) = TTL_NULL;
+    }
+  return t;
+}
+
+static void
+make_runnable (ttl_value t)
+{
+  FIELD (t, THREAD_STATE) = TTL_INT_TO_VALUE (THREAD_RUNNABLE);
+  queue_append (&run_queue_head, &run_queue_tail, t);
+}
+
+/* MAY GC.  */
+static ttl_value
+alloc_thread (int state)
+{
+  ttl_value t = ttl_alloc_array (THREAD_SIZE);
+
+  FIELD (t, THREAD_STATE) = TTL_INT_TO_VALUE (state);
+  FIELD (t, THREAD_ID) = TTL_INT_TO_VALUE (next_thread_id++);
+  return t;
+}
+
+/* Create the record for the thread running the main function, unless
+   that was already done.  MAY GC.  */
+static void
+ensure_main_thread (void)
+{
+  if (current_thread == TTL_NULL)
+    current_thread = alloc_thread (THREAD_RUNNING);
+}
+
+/* Save the state of the running thread into its record, including the
+   exception handlers it installed, which would look dead to the other
+   threads.  MAY GC.  */
+static void
+suspend_current_thread (void)
+{
+  ttl_value h = TTL_NULL;
+  int i, n;
+
+  if (ttl_handler_count > 1)
+    ttl_prune_handlers ();
+  n = ttl_handler_count - 1;
+  if (n > 0)
+    {
+      h = ttl_alloc_array (2 * n);
+      for (i = 0; i < n; i++)
 	{
-	  /* If a timer handler is installed, tail-call it.  */
-	  pc = TTL_VALUE_TO_OBJ (ttl_descr, timer_handler);
-	  goto save_regs_and_return;
+	  TTL_VALUE_TO_OBJ (ttl_array, h)->data[2 * i] =
+	    ttl_handlers[i + 1].cont;
+	  TTL_VALUE_TO_OBJ (ttl_array, h)->data[2 * i + 1] =
+	    ttl_handlers[i + 1].handler;
 	}
-      else
-	TTL_RESTORE_CONT;
-      break;
+    }
+  ttl_handler_count = 1;
+  FIELD (current_thread, THREAD_HANDLERS) = h;
+  FIELD (current_thread, THREAD_CONT) = ttl_global_cont;
+  FIELD (current_thread, THREAD_VALUE) = ttl_global_acc;
+}
+
+/* Make the first thread in the run queue the running thread.  Its
+   continuation becomes the current one, and its saved value is
+   stored into the accumulator, so that it is resumed by restoring the
+   current continuation.  WILL NOT GC.  */
+static void
+run_next_thread (void)
+{
+  ttl_value t;
+  ttl_value h;
+  int i, n;
+
+  /* Wait for a file descriptor if all threads are blocked and some
+     of them wait for input or output.  */
+  while (run_queue_head == TTL_NULL && io_wait_count > 0)
+    io_poll (-1);
+  t = queue_remove (&run_queue_head, &run_queue_tail);
+  if (t == TTL_NULL)
+    {
+      fprintf (stderr, "turtle rt: deadlock, all threads are blocked\n");
+      ttl_exit (1);
+    }
+  current_thread = t;
+  FIELD (t, THREAD_STATE) = TTL_INT_TO_VALUE (THREAD_RUNNING);
+  ttl_global_cont = FIELD (t, THREAD_CONT);
+  ttl_global_acc = FIELD (t, THREAD_VALUE);
+  FIELD (t, THREAD_CONT) = TTL_NULL;
+  FIELD (t, THREAD_VALUE) = TTL_NULL;
+
+  h = FIELD (t, THREAD_HANDLERS);
+  if (h != TTL_NULL)
+    {
+      n = TTL_SIZE (h) / 2;
+      for (i = 0; i < n; i++)
+	{
+	  ttl_handlers[i + 1].cont = TTL_VALUE_TO_OBJ (ttl_array, h)->data[2 * i];
+	  ttl_handlers[i + 1].handler =
+	    TTL_VALUE_TO_OBJ (ttl_array, h)->data[2 * i + 1];
+	}
+      ttl_handler_count = n + 1;
+      FIELD (t, THREAD_HANDLERS) = TTL_NULL;
+    }
+  ttl_stats.thread_switch_count++;
+  trace_event ("thread_switch", 'i', "thread",
+	       TTL_VALUE_TO_INT (FIELD (t, THREAD_ID)));
+}
+
+/* Block the running thread and run the next one.  The caller pushes
+   the mutex or channel to wait for onto `ttl_stack', where it is
+   popped from after the thread record was saved, and `head_index'
+   and `tail_index' are the fields holding the queue.  `value' is
+   stored in the thread record; a thread waiting on a full channel
+   keeps the value to send there.  MAY GC.  */
+static void
+block_current_thread (int head_index, int tail_index, ttl_value value)
+{
+  ttl_value q;
+
+  ttl_stack[ttl_global_sp++] = value;
+  suspend_current_thread ();
+  value = ttl_stack[--ttl_global_sp];
+  q = ttl_stack[--ttl_global_sp];
+  FIELD (current_thread, THREAD_STATE) = TTL_INT_TO_VALUE (THREAD_BLOCKED);
+  FIELD (current_thread, THREAD_VALUE) = value;
+  queue_append (&FIELD (q, head_index), &FIELD (q, tail_index),
+		current_thread);
+  run_next_thread ();
+}
+
+/* Switch to the next runnable thread at the end of a time slice.
+   MAY GC.  */
+static void
+preempt_current_thread (void)
+{
+  suspend_current_thread ();
+  make_runnable (current_thread);
+  run_next_thread ();
+}
+
+/* The function of the running thread returned.  Wake up the threads
+   waiting for it and run the next thread.  WILL NOT GC.  */
+static void
+finish_current_thread (void)
+{
+  ttl_value t = current_thread;
+
+  FIELD (t, THREAD_STATE) = TTL_INT_TO_VALUE (THREAD_FINISHED);
+  while (FIELD (t, THREAD_JOINERS) != TTL_NULL)
+    {
+      ttl_value j = FIELD (t, THREAD_JOINERS);
+      FIELD (t, THREAD_JOINERS) = FIELD (j, THREAD_NEXT);
+      make_runnable (j);
+    }
+  ttl_handler_count = 1;
+  run_next_thread ();
+}
+
+ttl_value
+ttl_thread_spawn (ttl_value thunk)
+{
+  ttl_continuation c;
+  ttl_value t;
+
+  /* Keep the function and the new thread on the stack while
+     allocating.  */
+  ttl_stack[ttl_global_sp++] = thunk;
+  ensure_main_thread ();
+  t = alloc_thread (THREAD_RUNNABLE);
+  ttl_stack[ttl_global_sp++] = t;
+
+  /* The bottom continuation finishes the thread when the function
+     returns, the top one calls the function with an empty stack.  */
+  c = (ttl_continuation) ttl_alloc (5);
+  c->cont = TTL_OBJ_TO_VALUE (NULL);
+  c->pc = descriptors + 6;
+  c->env = TTL_OBJ_TO_VALUE (NULL);
+  c->sp = 0;
+  c->header = TTL_MAKE_HEADER (TTL_TC_CONTINUATION, 4);
+  FIELD (ttl_stack[ttl_global_sp - 1], THREAD_CONT) = TTL_OBJ_TO_VALUE (c);
+
+  c = (ttl_continuation) ttl_alloc (6);
+  t = ttl_stack[--ttl_global_sp];
+  thunk = ttl_stack[--ttl_global_sp];
+  c->cont = FIELD (t, THREAD_CONT);
+  c->pc = descriptors + 5;
+  c->env = TTL_OBJ_TO_VALUE (NULL);
+  c->sp = 1;
+  c->stack[0] = thunk;
+  c->header = TTL_MAKE_HEADER (TTL_TC_CONTINUATION, 5);
+  FIELD (t, THREAD_CONT) = TTL_OBJ_TO_VALUE (c);
+
+  ttl_stats.allocations += 2;
+  ttl_stats.alloced_words += 11;
+
+  make_runnable (t);
+  if (thread_slice_ms > 0 && !preempt_timer_running && current_vm == 0)
+    preempt_timer_start ();
+  return t;
+}
+
+ttl_value
+ttl_thread_current (void)
+{
+  ensure_main_thread ();
+  return current_thread;
+}
+
+int
+ttl_thread_id (ttl_value thread)
+{
+  return TTL_VALUE_TO_INT (FIELD (thread, THREAD_ID));
+}
+
+int
+ttl_thread_finished_p (ttl_value thread)
+{
+  return FIELD (thread, THREAD_STATE) == TTL_INT_TO_VALUE (THREAD_FINISHED);
+}
+
+void
+ttl_thread_yield (void)
+{
+  if (io_wait_count > 0)
+    io_poll (0);
+  if (run_queue_head != TTL_NULL)
+    preempt_current_thread ();
+}
+
+void
+ttl_thread_join (ttl_value thread)
+{
+  if (ttl_thread_finished_p (thread))
+    return;
+  /* The joiners are a stack, not a queue, because they are all woken
+     up at once.  */
+  ttl_stack[ttl_global_sp++] = thread;
+  suspend_current_thread ();
+  thread = ttl_stack[--ttl_global_sp];
+  FIELD (current_thread, THREAD_STATE) = TTL_INT_TO_VALUE (THREAD_BLOCKED);
+  FIELD (current_thread, THREAD_NEXT) = FIELD (thread, THREAD_JOINERS);
+  FIELD (thread, THREAD_JOINERS) = current_thread;
+  run_next_thread ();
+}
+
+ttl_value
+ttl_make_mutex (void)
+{
+  ensure_main_thread ();
+  return ttl_alloc_array (MUTEX_SIZE);
+}
+
+void
+ttl_mutex_lock (ttl_value mutex)
+{
+  if (FIELD (mutex, MUTEX_OWNER) == TTL_NULL)
+    FIELD (mutex, MUTEX_OWNER) = current_thread;
+  else
+    {
+      /* `ttl_mutex_unlock' hands the mutex over to this thread before
+	 waking it up.  */
+      ttl_stack[ttl_global_sp++] = mutex;
+      block_current_thread (MUTEX_HEAD, MUTEX_TAIL, TTL_NULL);
+    }
+}
+
+int
+ttl_mutex_try_lock (ttl_value mutex)
+{
+  if (FIELD (mutex, MUTEX_OWNER) != TTL_NULL)
+    return 0;
+  FIELD (mutex, MUTEX_OWNER) = current_thread;
+  return 1;
+}
+
+void
+ttl_mutex_unlock (ttl_value mutex)
+{
+  ttl_value t;
+
+  if (FIELD (mutex, MUTEX_OWNER) != current_thread)
+    {
+      fprintf (stderr, "turtle rt: unlocking a mutex which is not locked "
+	       "by the current thread\n");
+      ttl_exit (1);
+    }
+  t = queue_remove (&FIELD (mutex, MUTEX_HEAD), &FIELD (mutex, MUTEX_TAIL));
+  FIELD (mutex, MUTEX_OWNER) = t;
+  if (t != TTL_NULL)
+    make_runnable (t);
+}
+
+ttl_value
+ttl_make_channel (int capacity)
+{
+  ttl_value buffer;
+  ttl_value channel;
+
+  if (capacity < 1)
+    capacity = 1;
+  ensure_main_thread ();
+  buffer = ttl_alloc_array (capacity);
+  ttl_stack[ttl_global_sp++] = buffer;
+  channel = ttl_alloc_array (CHANNEL_SIZE);
+  FIELD (channel, CHANNEL_BUFFER) = ttl_stack[--ttl_global_sp];
+  FIELD (channel, CHANNEL_START) = TTL_INT_TO_VALUE (0);
+  FIELD (channel, CHANNEL_COUNT) = TTL_INT_TO_VALUE (0);
+  return channel;
+}
+
+int
+ttl_channel_count (ttl_value channel)
+{
+  return TTL_VALUE_TO_INT (FIELD (channel, CHANNEL_COUNT));
+}
+
+/* Append `value' to the buffer of `channel', which must not be
+   full.  */
+static void
+channel_put (ttl_value channel, ttl_value value)
+{
+  ttl_value buffer = FIELD (channel, CHANNEL_BUFFER);
+  int start = TTL_VALUE_TO_INT (FIELD (channel, CHANNEL_START));
+  int count = TTL_VALUE_TO_INT (FIELD (channel, CHANNEL_COUNT));
+
+  FIELD (buffer, (start + count) % TTL_SIZE (buffer)) = value;
+  FIELD (channel, CHANNEL_COUNT) = TTL_INT_TO_VALUE (count + 1);
+}
+
+void
+ttl_channel_send (ttl_value channel, ttl_value value)
+{
+  ttl_value t = queue_remove (&FIELD (channel, CHANNEL_RECV_HEAD),
+			      &FIELD (channel, CHANNEL_RECV_TAIL));
+
+  if (t != TTL_NULL)
+    {
+      /* A receiver is waiting, so the buffer is empty.  Hand the
+	 value over directly.  */
+      FIELD (t, THREAD_VALUE) = value;
+      make_runnable (t);
+    }
+  else if (ttl_channel_count (channel) <
+	   TTL_SIZE (FIELD (channel, CHANNEL_BUFFER)))
+    channel_put (channel, value);
+  else
+    {
+      /* The buffer is full.  The value is stored in the thread record
+	 until a receiver makes room for it.  */
+      ttl_stack[ttl_global_sp++] = channel;
+      block_current_thread (CHANNEL_SEND_HEAD, CHANNEL_SEND_TAIL, value);
+    }
+}
+
+void
+ttl_channel_receive (ttl_value channel)
+{
+  if (ttl_channel_count (channel) > 0)
+    {
+      ttl_value buffer = FIELD (channel, CHANNEL_BUFFER);
+      int start = TTL_VALUE_TO_INT (FIELD (channel, CHANNEL_START));
+      ttl_value t;
+
+      ttl_global_acc = FIELD (buffer, start);
+      FIELD (buffer, start) = TTL_NULL;
+      FIELD (channel, CHANNEL_START) =
+	TTL_INT_TO_VALUE ((start + 1) % TTL_SIZE (buffer));
+      FIELD (channel, CHANNEL_COUNT) =
+	TTL_INT_TO_VALUE (ttl_channel_count (channel) - 1);
+
+      /* Move the value of the first blocked sender into the free
+	 place.  */
+      t = queue_remove (&FIELD (channel, CHANNEL_SEND_HEAD),
+			&FIELD (channel, CHANNEL_SEND_TAIL));
+      if (t != TTL_NULL)
+	{
+	  channel_put (channel, FIELD (t, THREAD_VALUE));
+	  FIELD (t, THREAD_VALUE) = TTL_NULL;
+	  make_runnable (t);
+	}
+    }
+  else
+    {
+      /* The sender stores the value into the thread record, from
+	 where it is restored into the accumulator.  */
+      ttl_stack[ttl_global_sp++] = channel;
+      block_current_thread (CHANNEL_RECV_HEAD, CHANNEL_RECV_TAIL, TTL_NULL);
+    }
+}
+
+
+/* Waiting for input and output.  A thread which would block in a
+   system call waits in `ttl_io_wait' until the file descriptor is
+   ready, while the other threads run.  The waiting threads are kept
+   in `io_waiters', in one list per file descriptor, linked through
+   the THREAD_NEXT field, and each holds the events it waits for in
+   its THREAD_VALUE field.  The runtime asks the operating system for
+   ready file descriptors when no thread is runnable, and otherwise
+   without waiting at every tick and when a thread yields, so that
+   thousands of connections can be served by one process.  With
+   epoll(7), the file descriptors are registered for one event each
+   time a thread starts waiting, otherwise poll(2) is called with all
+   of them.  Both report readiness, so a thread woken up may still
+   block if another one consumed the input first.  */
+
+#define IO_MAX_EVENTS 64
+
+#if HAVE_SYS_EPOLL_H
+static TTL_THREAD_LOCAL int io_epoll_fd = -1;
+#else
+static TTL_THREAD_LOCAL struct pollfd * io_pollfds = NULL;
+static TTL_THREAD_LOCAL int io_pollfds_size = 0;
+#endif
+
+static int
+io_poll_events (int events)
+{
+  return ((events & TTL_IO_READ) ? POLLIN : 0) |
+    ((events & TTL_IO_WRITE) ? POLLOUT : 0);
+}
+
+/* Return non-zero if `fd' is ready for one of `events' without
+   waiting.  Errors count as ready, so that the following system call
+   reports them.  */
+static int
+io_ready (int fd, int events)
+{
+  struct pollfd p;
+
+  p.fd = fd;
+  p.events = io_poll_events (events);
+  p.revents = 0;
+  return poll (&p, 1, 0) != 0;
+}
+
+/* Make the threads waiting for `fd' runnable which wait for one of
+   the events in `ready', and return the events the others still wait
+   for.  WILL NOT GC.  */
+static int
+io_wake (int fd, int ready)
+{
+  ttl_value * p = &FIELD (io_waiters, fd);
+  int rest = 0;
+
+  while (*p != TTL_NULL)
+    {
+      ttl_value t = *p;
+      int events = TTL_VALUE_TO_INT (FIELD (t, THREAD_VALUE));
+
+      if (events & ready)
+	{
+	  *p = FIELD (t, THREAD_NEXT);
+	  FIELD (t, THREAD_VALUE) = TTL_NULL;
+	  io_wait_count--;
+	  make_runnable (t);
+	}
+      else
+	{
+	  rest |= events;
+	  p = &FIELD (t, THREAD_NEXT);
+	}
+    }
+  return rest;
+}
+
+#if HAVE_SYS_EPOLL_H
+/* Register `fd' for the next of `events' with the epoll instance of
+   this virtual machine.  Return -1 if the file descriptor cannot be
+   waited for, which is the case for regular files.  */
+static int
+io_arm (int fd, int events)
+{
+  struct epoll_event ev;
+
+  if (io_epoll_fd < 0)
+    {
+      io_epoll_fd = epoll_create (IO_MAX_EVENTS);
+      if (io_epoll_fd < 0)
+	{
+	  perror ("turtle rt: epoll_create");
+	  ttl_exit (1);
+	}
+    }
+  ev.events = EPOLLONESHOT |
+    ((events & TTL_IO_READ) ? EPOLLIN : 0) |
+    ((events & TTL_IO_WRITE) ? EPOLLOUT : 0);
+  ev.data.fd = fd;
+  if (epoll_ctl (io_epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0)
+    return 0;
+  if (errno != ENOENT)
+    return -1;
+  return epoll_ctl (io_epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+#endif
+
+/* Wake up the threads whose file descriptors are ready, waiting at
+   most `timeout' milliseconds, or until one is ready if `timeout' is
+   negative.  WILL NOT GC.  */
+static void
+io_poll (int timeout)
+{
+  int i, n;
+#if HAVE_SYS_EPOLL_H
+  struct epoll_event events[IO_MAX_EVENTS];
+  int ready, rest;
+
+  n = epoll_wait (io_epoll_fd, events, IO_MAX_EVENTS, timeout);
+  for (i = 0; i < n; i++)
+    {
+      ready = 0;
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+	ready |= TTL_IO_READ;
+      if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+	ready |= TTL_IO_WRITE;
+      rest = io_wake (events[i].data.fd, ready);
+      if (rest != 0)
+	io_arm (events[i].data.fd, rest);
+    }
+#else
+  ttl_value t;
+  int fd, events;
+
+  if (io_pollfds_size < io_wait_count)
+    {
+      io_pollfds_size = io_wait_count * 2;
+      io_pollfds = realloc (io_pollfds,
+			    io_pollfds_size * sizeof (struct pollfd));
+      if (!io_pollfds)
+	{
+	  fprintf (stderr, "turtle rt: cannot allocate poll set\n");
+	  ttl_exit (1);
+	}
+    }
+  n = 0;
+  for (fd = 0; fd < TTL_SIZE (io_waiters); fd++)
+    {
+      events = 0;
+      for (t = FIELD (io_waiters, fd); t != TTL_NULL;
+	   t = FIELD (t, THREAD_NEXT))
+	events |= TTL_VALUE_TO_INT (FIELD (t, THREAD_VALUE));
+      if (events != 0)
+	{
+	  io_pollfds[n].fd = fd;
+	  io_pollfds[n].events = io_poll_events (events);
+	  io_pollfds[n].revents = 0;
+	  n++;
+	}
+    }
+  if (poll (io_pollfds, n, timeout) <= 0)
+    return;
+  for (i = 0; i < n; i++)
+    {
+      events = 0;
+      if (io_pollfds[i].revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL))
+	events |= TTL_IO_READ;
+      if (io_pollfds[i].revents & (POLLOUT | POLLHUP | POLLERR | POLLNVAL))
+	events |= TTL_IO_WRITE;
+      if (events != 0)
+	io_wake (io_pollfds[i].fd, events);
+    }
+#endif
+}
+
+void
+ttl_io_wait (int fd, int events)
+{
+  ttl_value t;
+  int i, size;
+
+  /* Without another thread to run, the caller may as well block in
+     the system call.  */
+  if ((run_queue_head == TTL_NULL && io_wait_count == 0) || fd < 0 ||
+      io_ready (fd, events))
+    return;
+
+  if (io_waiters == TTL_NULL || fd >= TTL_SIZE (io_waiters))
+    {
+      size = io_waiters == TTL_NULL ? IO_MAX_EVENTS : TTL_SIZE (io_waiters);
+      while (size <= fd)
+	size *= 2;
+      t = ttl_alloc_array (size);
+      for (i = 0; i < size; i++)
+	FIELD (t, i) = io_waiters != TTL_NULL && i < TTL_SIZE (io_waiters) ?
+	  FIELD (io_waiters, i) : TTL_NULL;
+      io_waiters = t;
+    }
+
+#if HAVE_SYS_EPOLL_H
+  {
+    /* Register the file descriptor for the events of all threads
+       waiting for it.  */
+    int waiting = events;
+
+    for (t = FIELD (io_waiters, fd); t != TTL_NULL;
+	 t = FIELD (t, THREAD_NEXT))
+      waiting |= TTL_VALUE_TO_INT (FIELD (t, THREAD_VALUE));
+    if (io_arm (fd, waiting) < 0)
+      return;
+  }
+#endif
+
+  ensure_main_thread ();
+  suspend_current_thread ();
+  t = current_thread;
+  FIELD (t, THREAD_STATE) = TTL_INT_TO_VALUE (THREAD_BLOCKED);
+  FIELD (t, THREAD_VALUE) = TTL_INT_TO_VALUE (events);
+  FIELD (t, THREAD_NEXT) = FIELD (io_waiters, fd);
+  FIELD (io_waiters, fd) = t;
+  io_wait_count++;
+  run_next_thread ();
+}
+
+
+static int
+host_procedure (void)
+{
+  ttl_value acc;
+  ttl_value * sp;
+  ttl_value cont;
+  ttl_value * alloc;
+  ttl_value * alloc_limit;
+
+  ttl_environment env;
+  ttl_descr pc;
+  ttl_closure self = NULL;
+
+  TTL_RESTORE_REGISTERS;
+ L_jump:
+  switch (pc - descriptors)
+    {
+    case 0:
+      /* The main function returned, or the function of a virtual
+	 machine other than the main one.  */
+      TTL_SAVE_REGISTERS;
+      if (current_vm != 0)
+	finish_vm ();
+      ttl_exit (TTL_VALUE_TO_INT (ttl_global_acc));
+      break;
+
+    case 1:
+      {
+	ttl_value exc = *(--sp);
+	if (exc == ttl_null_pointer_exception)
+	  {
+	    fprintf (stderr,
+		     "\n\nturtle exception: null pointer\n");
+	  }
+	else if (exc == ttl_subscript_exception)
+	  {
+	    fprintf (stderr, "\n\nturtle exception: index out of bounds\n");
+	  }
+	else if (exc == ttl_out_of_range_exception)
+	  {
+	    fprintf (stderr, "\n\nturtle exception: value out of range\n");
+	  }
+	else if (exc == ttl_wrong_variant_exception)
+	  {
+	    fprintf (stderr, "\n\nturtle exception: wrong variant\n");
+	  }
+	else if (exc == ttl_require_exception)
+	  {
+	    fprintf (stderr,
+		     "\n\nturtle exception: required expression failed\n");
+	  }
+	else
+	  {
+	    fprintf (stderr, "\n\nturtle exception: unknown exception: ");
+	    print_string (stderr, exc);
+	    fprintf (stderr, "\n");
+	  }
+	{
+	  ttl_value c = ttl_saved_continuations;
+	  ttl_descr d = ttl_raise_pc;
+	  struct ttl_function_info * last_function_info = NULL;
+	  int last_line = -1;
+	  int first = 1;
+
+	  for (;;)
+	    {
+	      if (d && d->line >= 0)
+		{
+		  if (d->function_info != last_function_info ||
+		      d->line != last_line)
+		    {
+#if 0
+		      if (first)
+			fprintf (stderr, "         In line: ");
+		      else
+			fprintf (stderr, "     called from: ");
+		      fprintf (stderr, "%s:%d",
+			       d->function_info->filename, 
+			       d->line + 1);
+		      if (d && d->function_info->function)
+			{
+			  if (d->function_info != last_function_info)
+			    fprintf (stderr, " (function %s)",
+				     d->function_info->function);
+			}
+#else
+		      if (first)
+			fprintf (stderr, "     In function: ");
+		      else
+			fprintf (stderr, "     called from: ");
+		      fprintf (stderr, "%s", d->function_info->module);
+		      fprintf (stderr, ".");
+		      fprintf (stderr, "%s", d->function_info->function);
+		      {
+			int i = strlen (d->function_info->module)
+			  + strlen (d->function_info->function) + 18;
+			while (i++ < 36)
+			  fprintf (stderr, " ");
+		      }
+		      fprintf (stderr, " (%s:%d)",
+			       d->function_info->filename, 
+			       d->line + 1);
+#endif
+		      fprintf (stderr, "\n");
+		      last_function_info = d->function_info;
+		      last_line = d->line;
+		      first = 0;
+		    }
+		}
+	      if (c == TTL_NULL || c == TTL_OBJ_TO_VALUE (NULL))
+		break;
+	      d = TTL_VALUE_TO_OBJ (ttl_continuation, c)->pc;
+	      c = TTL_VALUE_TO_OBJ (ttl_continuation, c)->cont;
+	    }
+	}
+	fprintf (stderr, "Program halted.\n");
+	TTL_SAVE_REGISTERS;
+	ttl_exit (1);
+	break;
+      }
+
+    case 2:
+      /* Timer interrupt.  */
+      if (timer_handler)
+	{
+	  /* If a timer handler is installed, tail-call it.  */
+	  pc = TTL_VALUE_TO_OBJ (ttl_descr, timer_handler);
+	  goto save_regs_and_return;
+	}
+      else
+	TTL_RESTORE_CONT;
+      break;
 
     case 3:
       /* Signal handler.  */
@@ -2380,6 +3477,25 @@ host_procedure (void)
       ttl_exit (2);
       break;
 
+    case 4:
+      /* The function called by `ttl_init_dispatcher' returned.  */
+      init_dispatcher_returned = 1;
+      goto save_regs_and_return;
+
+    case 5:
+      /* Start of a thread, call its function with an empty stack.  */
+      pc = TTL_VALUE_TO_OBJ (ttl_descr, *(--sp));
+      goto save_regs_and_return;
+
+    case 6:
+      /* The function of a thread returned, continue with the next
+	 thread.  */
+      TTL_SAVE_REGISTERS;
+      finish_current_thread ();
+      TTL_RESTORE_REGISTERS;
+      TTL_RESTORE_CONT;
+      break;
+
     default:
       if (pc->host == host_procedure)
 	{
@@ -2421,7 +3537,401 @@ write_samples (void)
 #endif /* TTL_PROFILE_MEMORY */
 
 
-static struct tms last_tick_tms;
+/* Statistical profiler, enabled with `-:p'.  ========== */
+
+/* The signal handler for the profiling timer does not look at the
+   machine state itself, because the host procedures keep the program
+   counter in a local variable and the continuation chain may be in
+   the middle of being updated or copied by the collector.  Instead it
+   forces a tick, like the handler for user signals, and the sample is
+   taken in `tick_function'.  At that point the tick check of the
+   interrupted function (at every function entry and loop head) has
+   saved a continuation, whose descriptor gives the exact location,
+   and the continuations below it give the callers.  Afterwards the
+   interrupted code is resumed with the rest of its time slice.  */
+
+#define PROFILER_DEFAULT_HZ 1000
+
+/* Only this many of the innermost frames of each sample are kept.  */
+#define PROFILER_MAX_DEPTH 64
+
+#define PROFILER_TABLE_SIZE 1021
+
+/* A sampled call stack, innermost frame first, and the number of
+   samples in which it was found.  */
+struct profiler_stack
+{
+  struct profiler_stack * next;
+  unsigned long count;
+  unsigned depth;
+  ttl_descr frames[1];
+};
+
+/* Samples per function, computed from the stacks on exit.  `self'
+   counts the samples in which the function was the innermost frame,
+   `total' those in which it was anywhere on the stack.  */
+struct profiler_function
+{
+  struct profiler_function * next;
+  struct ttl_function_info * info;
+  unsigned long self;
+  unsigned long total;
+  struct profiler_stack * last_stack;
+};
+
+/* Samples per source line of the innermost frame.  */
+struct profiler_line
+{
+  struct profiler_line * next;
+  struct ttl_function_info * info;
+  int line;
+  unsigned long count;
+};
+
+static int profiler_hz = 0;
+static struct profiler_stack * profiler_stacks[PROFILER_TABLE_SIZE];
+static unsigned long profiler_sample_count = 0;
+static unsigned long profiler_lost_count = 0;
+static TTL_THREAD_LOCAL volatile sig_atomic_t profiler_pending = 0;
+static TTL_THREAD_LOCAL volatile int profiler_saved_slice = 0;
+
+static void
+profiler_signal_handler (int no)
+{
+  if (!profiler_pending)
+    {
+      profiler_saved_slice = ttl_time_slice;
+      profiler_pending = 1;
+      ttl_time_slice = 0;
+    }
+  signal (SIGPROF, profiler_signal_handler);
+}
+
+/* Start the profiling timer with `hz' samples per second of
+   processor time.  */
+static void
+profiler_start (int hz)
+{
+  struct itimerval value;
+
+  profiler_hz = hz;
+  value.it_interval.tv_sec = 0;
+  value.it_interval.tv_usec = 1000000 / hz;
+  value.it_value = value.it_interval;
+  signal (SIGPROF, profiler_signal_handler);
+  if (setitimer (ITIMER_PROF, &value, NULL))
+    {
+      perror ("turtle rt: setitimer");
+      profiler_hz = 0;
+    }
+}
+
+static void
+profiler_stop (void)
+{
+  struct itimerval value;
+
+  value.it_interval.tv_sec = 0;
+  value.it_interval.tv_usec = 0;
+  value.it_value = value.it_interval;
+  setitimer (ITIMER_PROF, &value, NULL);
+  signal (SIGPROF, SIG_IGN);
+}
+
+/* Record the current continuation chain as one sample.  The frames of
+   the runtime system itself are left out.  */
+static void
+profiler_sample (void)
+{
+  ttl_descr frames[PROFILER_MAX_DEPTH];
+  unsigned depth = 0, i;
+  unsigned long hash = 0;
+  ttl_value c = ttl_global_cont;
+  struct profiler_stack * stack;
+
+  /* The chain ends in the null object pointer which `setup_registers'
+     puts into the continuation register.  */
+  while (c != TTL_NULL && c != TTL_OBJ_TO_VALUE (NULL) &&
+	 depth < PROFILER_MAX_DEPTH)
+    {
+      ttl_descr d = TTL_VALUE_TO_OBJ (ttl_continuation, c)->pc;
+      if (d->function_info && d->function_info != &func_info)
+	{
+	  frames[depth++] = d;
+	  hash = hash * 31 + ((unsigned long) d >> 3);
+	}
+      c = TTL_VALUE_TO_OBJ (ttl_continuation, c)->cont;
+    }
+  if (depth == 0)
+    return;
+  profiler_sample_count++;
+  hash %= PROFILER_TABLE_SIZE;
+  for (stack = profiler_stacks[hash]; stack; stack = stack->next)
+    if (stack->depth == depth &&
+	!memcmp (stack->frames, frames, depth * sizeof (ttl_descr)))
+      {
+	stack->count++;
+	return;
+      }
+  stack = malloc (sizeof (struct profiler_stack) +
+		  (depth - 1) * sizeof (ttl_descr));
+  if (!stack)
+    {
+      profiler_lost_count++;
+      return;
+    }
+  stack->count = 1;
+  stack->depth = depth;
+  for (i = 0; i < depth; i++)
+    stack->frames[i] = frames[i];
+  stack->next = profiler_stacks[hash];
+  profiler_stacks[hash] = stack;
+}
+
+static int
+compare_profiler_functions (const void * a, const void * b)
+{
+  const struct profiler_function * fa =
+    *(const struct profiler_function **) a;
+  const struct profiler_function * fb =
+    *(const struct profiler_function **) b;
+
+  if (fa->self != fb->self)
+    return fa->self < fb->self ? 1 : -1;
+  if (fa->total != fb->total)
+    return fa->total < fb->total ? 1 : -1;
+  return 0;
+}
+
+static int
+compare_profiler_lines (const void * a, const void * b)
+{
+  const struct profiler_line * la = *(const struct profiler_line **) a;
+  const struct profiler_line * lb = *(const struct profiler_line **) b;
+
+  if (la->count != lb->count)
+    return la->count < lb->count ? 1 : -1;
+  return 0;
+}
+
+/* Free the per-function and per-line summaries built by
+   `profiler_write'.  */
+static void
+profiler_free_summary (struct profiler_function ** functions,
+		       struct profiler_line ** lines)
+{
+  unsigned h;
+
+  for (h = 0; h < PROFILER_TABLE_SIZE; h++)
+    {
+      while (functions[h])
+	{
+	  struct profiler_function * fun = functions[h];
+	  functions[h] = fun->next;
+	  free (fun);
+	}
+      while (lines[h])
+	{
+	  struct profiler_line * l = lines[h];
+	  lines[h] = l->next;
+	  free (l);
+	}
+    }
+}
+
+/* Write the flat profile to `PROGRAM.prof' and the sampled stacks in
+   the folded format of flame graph tools (one line per stack, the
+   frames from the outermost to the innermost separated by `;',
+   followed by the number of samples) to `PROGRAM.folded'.  */
+static void
+profiler_write (void)
+{
+  struct profiler_function * functions[PROFILER_TABLE_SIZE];
+  struct profiler_line * lines[PROFILER_TABLE_SIZE];
+  struct profiler_function ** function_array;
+  struct profiler_line ** line_array;
+  unsigned function_count = 0, line_count = 0;
+  struct profiler_stack * stack;
+  int incomplete = 0;
+  char * filename;
+  FILE * f;
+  unsigned h, i, j;
+
+  profiler_stop ();
+  if (!program_name)
+    return;
+  filename = malloc (strlen (program_name) + 8);
+  if (!filename)
+    {
+      fprintf (stderr, "turtle rt: cannot write profile: out of memory\n");
+      return;
+    }
+
+  /* Sum up the samples per function and per line.  */
+  for (h = 0; h < PROFILER_TABLE_SIZE; h++)
+    {
+      functions[h] = NULL;
+      lines[h] = NULL;
+    }
+  for (h = 0; h < PROFILER_TABLE_SIZE; h++)
+    for (stack = profiler_stacks[h]; stack; stack = stack->next)
+      {
+	ttl_descr top = stack->frames[0];
+	struct profiler_line * l;
+
+	for (i = 0; i < stack->depth; i++)
+	  {
+	    struct ttl_function_info * info;
+	    struct profiler_function * fun;
+	    unsigned fh;
+
+	    info = stack->frames[i]->function_info;
+	    fh = ((unsigned long) info >> 3) % PROFILER_TABLE_SIZE;
+
+	    for (fun = functions[fh]; fun; fun = fun->next)
+	      if (fun->info == info)
+		break;
+	    if (!fun)
+	      {
+		fun = malloc (sizeof (struct profiler_function));
+		if (!fun)
+		  {
+		    incomplete = 1;
+		    continue;
+		  }
+		fun->info = info;
+		fun->self = 0;
+		fun->total = 0;
+		fun->last_stack = NULL;
+		fun->next = functions[fh];
+		functions[fh] = fun;
+		function_count++;
+	      }
+	    if (i == 0)
+	      fun->self += stack->count;
+	    /* Count recursive functions only once per stack.  */
+	    if (fun->last_stack != stack)
+	      {
+		fun->total += stack->count;
+		fun->last_stack = stack;
+	      }
+	  }
+
+	j = (((unsigned long) top->function_info >> 3) + top->line)
+	  % PROFILER_TABLE_SIZE;
+	for (l = lines[j]; l; l = l->next)
+	  if (l->info == top->function_info && l->line == top->line)
+	    break;
+	if (!l)
+	  {
+	    l = malloc (sizeof (struct profiler_line));
+	    if (!l)
+	      {
+		incomplete = 1;
+		continue;
+	      }
+	    l->info = top->function_info;
+	    l->line = top->line;
+	    l->count = 0;
+	    l->next = lines[j];
+	    lines[j] = l;
+	    line_count++;
+	  }
+	l->count += stack->count;
+      }
+
+  function_array = malloc ((function_count + 1) *
+			   sizeof (struct profiler_function *));
+  line_array = malloc ((line_count + 1) * sizeof (struct profiler_line *));
+  if (!function_array || !line_array)
+    {
+      fprintf (stderr, "turtle rt: cannot write profile: out of memory\n");
+      free (function_array);
+      free (line_array);
+      profiler_free_summary (functions, lines);
+      free (filename);
+      return;
+    }
+  if (incomplete)
+    fprintf (stderr, "turtle rt: profile incomplete: out of memory\n");
+  i = 0;
+  j = 0;
+  for (h = 0; h < PROFILER_TABLE_SIZE; h++)
+    {
+      struct profiler_function * fun;
+      struct profiler_line * l;
+      for (fun = functions[h]; fun; fun = fun->next)
+	function_array[i++] = fun;
+      for (l = lines[h]; l; l = l->next)
+	line_array[j++] = l;
+    }
+  qsort (function_array, function_count, sizeof (struct profiler_function *),
+	 compare_profiler_functions);
+  qsort (line_array, line_count, sizeof (struct profiler_line *),
+	 compare_profiler_lines);
+
+  strcpy (filename, program_name);
+  strcat (filename, ".prof");
+  f = fopen (filename, "w");
+  if (!f)
+    fprintf (stderr, "turtle rt: cannot write profile: %s\n", filename);
+  else
+    {
+      unsigned long n = profiler_sample_count ? profiler_sample_count : 1;
+
+      fprintf (f, "Flat profile of %s: %lu samples at %d Hz",
+	       program_name, profiler_sample_count, profiler_hz);
+      if (profiler_lost_count > 0)
+	fprintf (f, " (%lu lost)", profiler_lost_count);
+      fprintf (f, "\n\n   self%%  total%%     self    total  function\n");
+      for (i = 0; i < function_count; i++)
+	{
+	  struct profiler_function * fun = function_array[i];
+	  fprintf (f, "  %6.2f  %6.2f %8lu %8lu  %s.%s (%s)\n",
+		   100.0 * fun->self / n, 100.0 * fun->total / n,
+		   fun->self, fun->total, fun->info->module,
+		   fun->info->function, fun->info->filename);
+	}
+      fprintf (f, "\n   self%%     self  line\n");
+      for (j = 0; j < line_count; j++)
+	{
+	  struct profiler_line * l = line_array[j];
+	  fprintf (f, "  %6.2f %8lu  %s:%d (%s.%s)\n",
+		   100.0 * l->count / n, l->count, l->info->filename,
+		   l->line + 1, l->info->module, l->info->function);
+	}
+      if (fclose (f) != 0)
+	fprintf (stderr, "turtle rt: cannot write profile: %s\n", filename);
+    }
+
+  strcpy (filename, program_name);
+  strcat (filename, ".folded");
+  f = fopen (filename, "w");
+  if (!f)
+    fprintf (stderr, "turtle rt: cannot write profile: %s\n", filename);
+  else
+    {
+      for (h = 0; h < PROFILER_TABLE_SIZE; h++)
+	for (stack = profiler_stacks[h]; stack; stack = stack->next)
+	  {
+	    i = stack->depth;
+	    while (i-- > 0)
+	      fprintf (f, "%s.%s%s", stack->frames[i]->function_info->module,
+		       stack->frames[i]->function_info->function,
+		       i > 0 ? ";" : "");
+	    fprintf (f, " %lu\n", stack->count);
+	  }
+      if (fclose (f) != 0)
+	fprintf (stderr, "turtle rt: cannot write profile: %s\n", filename);
+    }
+  free (function_array);
+  free (line_array);
+  profiler_free_summary (functions, lines);
+  free (filename);
+}
+
+
+static TTL_THREAD_LOCAL struct tms last_tick_tms;
 
 /* This function gets called by the dispatch loops whenever a host
    procedure ran out of its timeslice.  It determines whether this was
@@ -2433,6 +3943,23 @@ tick_function (void)
   struct tms now_tms;
   int elapsed;
 
+  TRACE_BEGIN ("tick_function");
+  if (profiler_pending)
+    {
+      profiler_pending = 0;
+      profiler_sample ();
+      /* If the tick was only forced by the profiler, resume the
+	 interrupted code with the rest of its time slice.  */
+      if (signals_pending == 0 && profiler_saved_slice > 0 &&
+	  !preempt_pending)
+	{
+	  ttl_time_slice = profiler_saved_slice;
+	  restore_cont ();
+	  TRACE_END ("tick_function");
+	  return;
+	}
+    }
+
   times (&now_tms);
 
   elapsed = (now_tms.tms_utime + now_tms.tms_stime)
@@ -2442,6 +3969,30 @@ tick_function (void)
 
   ttl_time_slice = ttl_time_quantum;
 
+  /* Print the statistics when SIGUSR1 arrived and the program has no
+     handler of its own for it.  If no other signal is pending, the
+     interrupted code is simply resumed.  */
+  if (signal_mask[STATS_SIGNAL] && !signal_handlers[STATS_SIGNAL])
+    {
+      sigset_t set, old_set;
+
+      sigemptyset (&set);
+      sigaddset (&set, STATS_SIGNAL);
+      sigprocmask (SIG_BLOCK, &set, &old_set);
+      signals_pending -= signal_mask[STATS_SIGNAL];
+      signal_mask[STATS_SIGNAL] = 0;
+      sigprocmask (SIG_SETMASK, &old_set, NULL);
+
+      ttl_stats.signal_count++;
+      print_live_stats ();
+      if (signals_pending == 0)
+	{
+	  restore_cont ();
+	  TRACE_END ("tick_function");
+	  return;
+	}
+    }
+
   if (signals_pending > 0)
     {
       ttl_stats.signal_count++;
@@ -2452,9 +4003,24 @@ tick_function (void)
 #if TTL_PROFILE_MEMORY
       write_samples ();
 #endif /* TTL_PROFILE_MEMORY */
+      if (stats_interval > 0 && current_vm == 0 &&
+	  ttl_monotonic_time () >= stats_next_time)
+	{
+	  print_stats_line ();
+	  stats_next_time = ttl_monotonic_time () +
+	    (ttl_nanoseconds) stats_interval * 1000000000;
+	}
       ttl_stats.tick_count++;
+      /* The time slice of the running thread is over.  The timer
+	 handler is then called in the next thread.  */
+      preempt_pending = 0;
+      if (io_wait_count > 0)
+	io_poll (0);
+      if (run_queue_head != TTL_NULL)
+	preempt_current_thread ();
       ttl_global_pc = timer_interrupt;
     }
+  TRACE_END ("tick_function");
 }
 
 
@@ -2474,20 +4040,23 @@ ttl_dispatcher (ttl_value main)
 void
 ttl_init_dispatcher (ttl_value init)
 {
-  ttl_value start_cont = ttl_global_cont;
+  int outer_returned = init_dispatcher_returned;
+
   ttl_global_pc = init;
-  /* Push a dummy continuation, so that we can detect when it was
-     popped.  */
-  save_cont (descriptors + 0, ttl_global_sp);
-  while (1)
+  /* Push a continuation which sets `init_dispatcher_returned' when it
+     is resumed.  Comparing `ttl_global_cont' against its value on
+     entry does not work, because the garbage collector moves
+     continuations.  */
+  init_dispatcher_returned = 0;
+  save_cont (descriptors + 4, ttl_global_sp);
+  while (!init_dispatcher_returned)
     {
       ttl_descr pc = TTL_VALUE_TO_OBJ (ttl_descr, ttl_global_pc);
       ttl_stats.dispatch_call_count++;
       if (pc->host ())
 	tick_function ();
-      if (ttl_global_cont == start_cont)
-	break;
     }
+  init_dispatcher_returned = outer_returned;
 }
 
 static void
@@ -2504,43 +4073,134 @@ print_string (FILE * f, ttl_value v)
       fprintf (f, "\\%d", s->data[i]);
 }
 
+/* Return the number of words in use in the current allocation
+   space.  */
+static unsigned
+heap_words_in_use (void)
+{
+  return ttl_alloc_ptr - (current_space == 0 ? space0 : space1);
+}
+
 static void
-print_stats (void)
+print_stats (FILE * f)
 {
   double secs;
 
-  fprintf (stderr, "dispatch calls:  %10u  direct calls:       %10u\n",
+  fprintf (f, "dispatch calls:  %10u  direct calls:       %10u\n",
 	   ttl_stats.dispatch_call_count, ttl_stats.direct_call_count);
-  fprintf (stderr, "local calls:     %10u  closure calls:      %10u\n",
+  fprintf (f, "local calls:     %10u  closure calls:      %10u\n",
 	   ttl_stats.local_call_count, ttl_stats.closure_call_count);
-  fprintf (stderr, "GC checks:       %10u  GC calls:           %10u\n",
+  fprintf (f, "GC checks:       %10u  GC calls:           %10u\n",
 	   ttl_stats.gc_checks, ttl_stats.gc_calls);
-  fprintf (stderr, "GC grows:        %10u  GC retries:         %10u\n",
+  fprintf (f, "GC grows:        %10u  GC retries:         %10u\n",
 	   ttl_stats.gc_grows, ttl_stats.gc_retries);
-  fprintf (stderr, "allocations:     %10u\n", ttl_stats.allocations);
-  fprintf (stderr, "allocated words: %10u (%u MB)\n",
+  fprintf (f, "allocations:     %10u\n", ttl_stats.allocations);
+  fprintf (f, "allocated words: %10u (%u MB)\n",
 	   ttl_stats.alloced_words, (ttl_stats.alloced_words * 4) /
 	   (1024*1024));
-  fprintf (stderr, "forwarded words: %10u  forwarded/GC:       %10u\n",
+  fprintf (f, "forwarded words: %10u  forwarded/GC:       %10u\n",
 	   ttl_stats.forwarded_words,
 	   ttl_stats.gc_calls > 0 ?
 	   ttl_stats.forwarded_words / ttl_stats.gc_calls : 0);
-  fprintf (stderr, "tick count:      %10u  signal count:       %10u\n",
+  fprintf (f, "heap in use:     %10u words of %u (%u%%)\n",
+	   heap_words_in_use (), semi_space_in_words,
+	   (unsigned) (100.0 * heap_words_in_use () / semi_space_in_words));
+  fprintf (f, "tick count:      %10u  signal count:       %10u\n",
 	   ttl_stats.tick_count, ttl_stats.signal_count);
-  fprintf (stderr, "save cont count: %10u  restore cont count: %10u\n\n",
+  fprintf (f, "save cont count: %10u  restore cont count: %10u\n",
 	   ttl_stats.save_cont_count, ttl_stats.restore_cont_count);
-  fprintf (stderr, "time:  total: %u  gc: %u (%u min/%u max)\n",
+  fprintf (f, "thread switches: %10u\n\n", ttl_stats.thread_switch_count);
+  fprintf (f, "time:  total: %u  gc: %u (%u min/%u max)\n",
 	   ttl_stats.total_run_time, ttl_stats.total_gc_time,
 	   ttl_stats.min_gc_time, ttl_stats.max_gc_time);
   if (ttl_stats.total_run_time)
     {
       secs = ((double) ttl_stats.total_run_time) / CLOCKS_PER_SEC;
-      fprintf (stderr, "allocation rate: %gMB/sec\n",
+      fprintf (f, "allocation rate: %gMB/sec\n",
 	       ((ttl_stats.alloced_words * 4) / (double) (1024 * 1024)) /
 	       secs);
     }
   else
-    fprintf (stderr, "allocation rate: N/A\n");
+    fprintf (f, "allocation rate: N/A\n");
+}
+
+static struct tms begin_tms, end_tms;
+static struct timeval begin_time;
+
+/* Print the statistics as lines of the form `stat NAME VALUE', for
+   processing by scripts like bench/run-bench.sh.  Times are in
+   milliseconds.  */
+static void
+print_stats_machine (FILE * f)
+{
+  struct timeval now;
+  long clock_ticks = sysconf (_SC_CLK_TCK);
+
+  gettimeofday (&now, NULL);
+  fprintf (f, "stat wall_time %.3f\n",
+	   (now.tv_sec - begin_time.tv_sec) * 1000.0 +
+	   (now.tv_usec - begin_time.tv_usec) / 1000.0);
+  fprintf (f, "stat run_time %.3f\n",
+	   ttl_stats.total_run_time * 1000.0 / clock_ticks);
+  fprintf (f, "stat gc_time %.3f\n",
+	   ttl_stats.total_gc_time * 1000.0 / clock_ticks);
+  fprintf (f, "stat gc_calls %u\n", ttl_stats.gc_calls);
+  fprintf (f, "stat gc_grows %u\n", ttl_stats.gc_grows);
+  fprintf (f, "stat allocations %u\n", ttl_stats.allocations);
+  fprintf (f, "stat allocated_words %u\n", ttl_stats.alloced_words);
+  fprintf (f, "stat forwarded_words %u\n", ttl_stats.forwarded_words);
+  fprintf (f, "stat dispatch_calls %u\n", ttl_stats.dispatch_call_count);
+  fprintf (f, "stat direct_calls %u\n", ttl_stats.direct_call_count);
+  fprintf (f, "stat local_calls %u\n", ttl_stats.local_call_count);
+  fprintf (f, "stat closure_calls %u\n", ttl_stats.closure_call_count);
+  fprintf (f, "stat save_conts %u\n", ttl_stats.save_cont_count);
+  fprintf (f, "stat restore_conts %u\n", ttl_stats.restore_cont_count);
+  fprintf (f, "stat ticks %u\n", ttl_stats.tick_count);
+  fprintf (f, "stat signals %u\n", ttl_stats.signal_count);
+  fprintf (f, "stat thread_switches %u\n", ttl_stats.thread_switch_count);
+}
+
+/* Update the run time in the statistics to the current time.  */
+static void
+update_run_time (void)
+{
+  times (&end_tms);
+  ttl_stats.total_run_time = (end_tms.tms_utime + end_tms.tms_stime)
+    - (begin_tms.tms_utime + begin_tms.tms_stime);
+}
+
+/* Print all statistics of the running program, as requested by
+   SIGUSR1.  */
+static void
+print_live_stats (void)
+{
+  FILE * f = stats_file ? stats_file : stderr;
+
+  update_run_time ();
+  fprintf (f, "turtle rt: statistics of process %d:\n", (int) getpid ());
+  print_stats (f);
+  fflush (f);
+}
+
+/* Write the one-line summary for `-:i'.  */
+static void
+print_stats_line (void)
+{
+  long clock_ticks = sysconf (_SC_CLK_TCK);
+
+  if (!stats_file)
+    return;
+  update_run_time ();
+  fprintf (stats_file, "turtle rt: pid %d time %.2fs gc %u (%.2fs) "
+	   "heap %u/%u words allocated %u words ticks %u signals %u\n",
+	   (int) getpid (),
+	   (double) ttl_stats.total_run_time / clock_ticks,
+	   ttl_stats.gc_calls,
+	   (double) ttl_stats.total_gc_time / clock_ticks,
+	   heap_words_in_use (), semi_space_in_words,
+	   ttl_stats.alloced_words, ttl_stats.tick_count,
+	   ttl_stats.signal_count);
+  fflush (stats_file);
 }
 
 /* Reset the statistic counters.  */
@@ -2566,6 +4226,7 @@ reset_stats (void)
   ttl_stats.max_gc_time = 0;
   ttl_stats.tick_count = 0;
   ttl_stats.signal_count = 0;
+  ttl_stats.thread_switch_count = 0;
 }
 
 static void
@@ -2649,7 +4310,645 @@ setup_heap (void)
 #endif
 }
 
-static struct tms begin_tms, end_tms;
+/* Set up the registers, the heap, the exception handlers and the
+   timer of the virtual machine running in the current thread.  */
+static void
+setup_machine (void)
+{
+  setup_registers ();
+  setup_heap ();
+  reset_stats ();
+  /* Install root continuation, which exits the program.  */
+  save_cont (descriptors + 0, 0);
+
+  /* Set up exception handling.  */
+  ttl_null_pointer_exception = ttl_string_to_value ("null-pointer-exception",
+						    -1);
+  ttl_subscript_exception = ttl_string_to_value ("subscript-exception", -1);
+  ttl_out_of_range_exception = ttl_string_to_value ("out-of-range-exception",
+						    -1);
+  ttl_wrong_variant_exception = ttl_string_to_value ("wrong-variant", -1);
+  ttl_handlers[0].cont = TTL_NULL;
+  ttl_handlers[0].handler = TTL_OBJ_TO_VALUE (descriptors + 1);
+  ttl_handler_count = 1;
+
+  ttl_time_quantum = TTL_DEFAULT_TIME_QUANTUM;
+  ttl_time_slice = ttl_time_quantum;
+  timer_interrupt = TTL_OBJ_TO_VALUE (descriptors + 2);
+  signal_handler = TTL_OBJ_TO_VALUE (descriptors + 3);
+  times (&last_tick_tms);
+}
+
+/* The profile counters of the modules compiled with the pragma
+   `profile-generate'.  */
+static struct ttl_profile_info * profiles = NULL;
+
+void
+ttl_register_profile (struct ttl_profile_info * info)
+{
+  /* The counters are shared by all virtual machines.  */
+  if (current_vm != 0)
+    return;
+  info->next = profiles;
+  profiles = info;
+}
+
+/* Write the counts of all registered profile counters to the file
+   `PROGRAM.tprof', in the format read by `turtle --profile-use'.
+   Functions are identified by the index of their entry descriptor and
+   their `ttl_function_info', conditional jumps by the function
+   containing them and their number within that function.  */
+static void
+write_profile (void)
+{
+  struct ttl_profile_info * info;
+  char * filename;
+  FILE * f;
+
+  if (!profiles || !program_name)
+    return;
+  filename = malloc (strlen (program_name) + 7);
+  if (!filename)
+    return;
+  strcpy (filename, program_name);
+  strcat (filename, ".tprof");
+  f = fopen (filename, "w");
+  if (!f)
+    {
+      fprintf (stderr, "turtle rt: cannot write profile: %s\n", filename);
+      free (filename);
+      return;
+    }
+  fprintf (f, ";; Turtle execution profile of %s\n", program_name);
+  for (info = profiles; info; info = info->next)
+    {
+      struct ttl_function_info * last_function_info = NULL;
+      unsigned i, number = 0;
+
+      fprintf (f, "module %s\n", info->module);
+      /* Consecutive descriptors of the same function share their
+	 function info, so the first descriptor with a new one is the
+	 entry point of a function.  */
+      for (i = 0; i < info->descriptor_count; i++)
+	{
+	  struct ttl_function_info * fi = info->descriptors[i].function_info;
+	  if (fi && fi != last_function_info)
+	    fprintf (f, "function %u %s %lu\n", i, fi->function,
+		     info->calls[i]);
+	  last_function_info = fi;
+	}
+      for (i = 0; i < info->branch_count; i++)
+	{
+	  if (i > 0 &&
+	      info->branch_functions[i] == info->branch_functions[i - 1])
+	    number++;
+	  else
+	    number = 0;
+	  fprintf (f, "branch %u %u %lu %lu\n", info->branch_functions[i],
+		   number, info->branches[2 * i], info->branches[2 * i + 1]);
+	}
+    }
+  fclose (f);
+  free (filename);
+}
+
+/* Virtual machines.  ========== */
+
+/* Every virtual machine runs in an operating system thread of its
+   own, with its own registers, heap and module variables, which are
+   all thread-local.  Machines share no heap objects, they only
+   exchange messages, which are deep copies of values.  A message is
+   built in memory allocated with malloc() by the sending thread, with
+   the same layout as on the heap, and copied into the heap of the
+   receiving machine when it is received, so that no machine ever
+   touches the heap of another.  Pointers in a message are stored as
+   offsets from its start and relocated by the receiver.
+
+   The table of machines and all mailboxes are protected by `vm_lock'.
+   The main machine, which runs `main', is in slot 0 and has number 0.
+   A slot is reused when the machine in it has finished and has been
+   joined, with the number increased by MAX_VMS, so that stale numbers
+   refer to no machine.  */
+
+#define MAX_VMS 64
+
+#define VM_FREE     0
+#define VM_RUNNING  1
+#define VM_FINISHED 2
+
+struct vm_message
+{
+  struct vm_message * next;
+  ttl_value root;		/* The value, relocated like a pointer in
+				   `words' if `relocate_root' is set.  */
+  int relocate_root;
+  unsigned word_count;
+  ttl_value * words;		/* The copied objects.  */
+  unsigned reloc_count;
+  unsigned * relocs;		/* Indices of the pointers in `words'.  */
+};
+
+struct vm
+{
+  int id;
+  int state;
+  int uses;			/* Number of machines run in this slot.  */
+  int joiners;			/* Threads waiting for the machine.  */
+  struct vm_message * start;	/* The function of the machine.  */
+  struct vm_message * head;	/* Received messages, oldest first.  */
+  struct vm_message * tail;
+  int pending;
+  pthread_cond_t changed;	/* Signalled on new messages and when the
+				   machine finishes.  */
+};
+
+static struct vm vms[MAX_VMS];
+static pthread_mutex_t vm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The initialization function of the main module, which every
+   machine calls to initialize its copy of the module variables.  */
+static void (* vm_initializer) (void) = NULL;
+
+void
+ttl_register_initializer (void (* init) (void))
+{
+  vm_initializer = init;
+}
+
+static void
+vm_error (const char * message)
+{
+  fprintf (stderr, "turtle rt: %s\n", message);
+  ttl_exit (1);
+}
+
+static void *
+vm_malloc (size_t size)
+{
+  void * p = malloc (size);
+  if (!p)
+    vm_error ("out of virtual memory");
+  return p;
+}
+
+static void
+free_message (struct vm_message * msg)
+{
+  free (msg->words);
+  free (msg->relocs);
+  free (msg);
+}
+
+/* State while building a message.  `seen' is a hash table with open
+   addressing which maps the addresses of the objects copied so far to
+   their offsets in the message, so that shared and cyclic structures
+   are copied only once.  */
+struct message_builder
+{
+  struct vm_message * msg;
+  unsigned words_size;		/* Allocated entries of `msg->words'.  */
+  unsigned relocs_size;		/* Allocated entries of `msg->relocs'.  */
+  ttl_value ** seen;
+  unsigned * seen_offsets;
+  unsigned seen_size;		/* A power of two.  */
+  unsigned seen_count;
+};
+
+static unsigned
+seen_hash (struct message_builder * b, ttl_value * raw)
+{
+  return (unsigned) (((ttl_word) raw >> 3) * 2654435761UL)
+    & (b->seen_size - 1);
+}
+
+static void
+seen_insert (struct message_builder * b, ttl_value * raw, unsigned offset)
+{
+  unsigned h = seen_hash (b, raw);
+
+  while (b->seen[h])
+    h = (h + 1) & (b->seen_size - 1);
+  b->seen[h] = raw;
+  b->seen_offsets[h] = offset;
+  b->seen_count++;
+}
+
+static void
+seen_grow (struct message_builder * b)
+{
+  ttl_value ** old = b->seen;
+  unsigned * old_offsets = b->seen_offsets;
+  unsigned old_size = b->seen_size;
+  unsigned i;
+
+  b->seen_size = old_size * 2;
+  b->seen = vm_malloc (b->seen_size * sizeof (ttl_value *));
+  b->seen_offsets = vm_malloc (b->seen_size * sizeof (unsigned));
+  memset (b->seen, 0, b->seen_size * sizeof (ttl_value *));
+  b->seen_count = 0;
+  for (i = 0; i < old_size; i++)
+    if (old[i])
+      seen_insert (b, old[i], old_offsets[i]);
+  free (old);
+  free (old_offsets);
+}
+
+/* Return the number of words the object `v' occupies on the heap,
+   like `trace' counts them.  Objects which cannot be sent to another
+   machine halt the program.  */
+static unsigned
+message_object_words (ttl_value v)
+{
+  unsigned size;
+
+  if (TTL_PAIR_P (v))
+    return 2;
+  size = TTL_SIZE (v);
+  switch (TTL_TYPE_CODE (v))
+    {
+    case TTL_TC_CLOSURE:
+    case TTL_TC_REAL:
+    case TTL_TC_LONG:
+    case TTL_TC_ARRAY:
+    case TTL_TC_NONTRACED_ARRAY:
+    case TTL_TC_ENVIRONMENT:
+      return ROUND_TO_EVEN (1 + size);
+    case TTL_TC_DATA:
+      return ROUND_TO_EVEN (1 + TTL_DATA_SIZE (v));
+    case TTL_TC_STRING:
+      return ROUND_TO_EVEN
+	(1 + (size + sizeof (unsigned short) - 1) / sizeof (unsigned short));
+    case TTL_TC_BINARY_ARRAY:
+      return ROUND_TO_EVEN
+	(1 + (size + (sizeof (ttl_value) - 1)) / sizeof (ttl_value));
+    default:
+      fprintf (stderr, "turtle rt: cannot send a value of type `%s' to "
+	       "another virtual machine\n", tc_names[TTL_TYPE_CODE (v)]);
+      ttl_exit (1);
+      return 0;
+    }
+}
+
+/* Translate the value `v' for the message, copying the object it
+   points to unless that was already done.  Return non-zero if the
+   result is an offset which must be relocated.  */
+static int
+message_translate (struct message_builder * b, ttl_value * v)
+{
+  struct vm_message * msg = b->msg;
+  ttl_value * raw;
+  unsigned h, offset, words;
+
+  if (TTL_IMMEDIATE_P (*v))
+    return 0;
+  raw = (ttl_value *) (((ttl_word) *v) & ~TTL_MASK);
+  /* Procedure descriptors are static, so all machines share them.  */
+  if (raw == NULL ||
+      (TTL_OBJECT_P (*v) && TTL_TYPE_CODE (*v) == TTL_TC_PROCEDURE))
+    return 0;
+
+  for (h = seen_hash (b, raw); b->seen[h]; h = (h + 1) & (b->seen_size - 1))
+    if (b->seen[h] == raw)
+      {
+	offset = b->seen_offsets[h];
+	goto found;
+      }
+
+  words = message_object_words (*v);
+  offset = msg->word_count;
+  if (offset + words > b->words_size)
+    {
+      while (offset + words > b->words_size)
+	b->words_size *= 2;
+      msg->words = realloc (msg->words, b->words_size * sizeof (ttl_value));
+      if (!msg->words)
+	vm_error ("out of virtual memory");
+    }
+  memcpy (msg->words + offset, raw, words * sizeof (ttl_value));
+  msg->word_count += words;
+  if (2 * (b->seen_count + 1) > b->seen_size)
+    seen_grow (b);
+  seen_insert (b, raw, offset);
+
+ found:
+  *v = (ttl_value) ((offset * sizeof (ttl_value)) |
+		    (((ttl_word) *v) & TTL_MASK));
+  return 1;
+}
+
+/* Translate the word at index `i' of the message.  */
+static void
+message_field (struct message_builder * b, unsigned i)
+{
+  ttl_value v = b->msg->words[i];
+
+  if (message_translate (b, &v))
+    {
+      /* `message_translate' may have moved the words.  */
+      b->msg->words[i] = v;
+      if (b->msg->reloc_count == b->relocs_size)
+	{
+	  b->relocs_size *= 2;
+	  b->msg->relocs = realloc (b->msg->relocs,
+				    b->relocs_size * sizeof (unsigned));
+	  if (!b->msg->relocs)
+	    vm_error ("out of virtual memory");
+	}
+      b->msg->relocs[b->msg->reloc_count++] = i;
+    }
+}
+
+/* Build a message holding a deep copy of `value'.  The objects are
+   copied breadth-first like the garbage collector does, scanning the
+   message for the pointers still to be translated.  */
+/* WILL NOT GC.  */
+static struct vm_message *
+value_to_message (ttl_value value)
+{
+  struct message_builder b;
+  struct vm_message * msg = vm_malloc (sizeof (struct vm_message));
+  unsigned scan = 0;
+
+  msg->next = NULL;
+  msg->word_count = 0;
+  msg->reloc_count = 0;
+  b.msg = msg;
+  b.words_size = 64;
+  b.relocs_size = 64;
+  msg->words = vm_malloc (b.words_size * sizeof (ttl_value));
+  msg->relocs = vm_malloc (b.relocs_size * sizeof (unsigned));
+  b.seen_size = 64;
+  b.seen_count = 0;
+  b.seen = vm_malloc (b.seen_size * sizeof (ttl_value *));
+  b.seen_offsets = vm_malloc (b.seen_size * sizeof (unsigned));
+  memset (b.seen, 0, b.seen_size * sizeof (ttl_value *));
+
+  msg->root = value;
+  msg->relocate_root = message_translate (&b, &msg->root);
+
+  while (scan < msg->word_count)
+    {
+      ttl_word header = (ttl_word) msg->words[scan];
+      unsigned size = header >> 8, i;
+
+      if (!TTL_HEADER_P (header))
+	{
+	  /* A pair.  */
+	  message_field (&b, scan);
+	  message_field (&b, scan + 1);
+	  scan += 2;
+	  continue;
+	}
+      switch ((header >> 2) & 0x3f)
+	{
+	case TTL_TC_CLOSURE:
+	  /* The host procedure is a C function.  */
+	  message_field (&b, scan + 2);
+	  message_field (&b, scan + 3);
+	  break;
+	case TTL_TC_DATA:
+	  size &= TTL_DATA_MAX_FIELDS;
+	  /* Fall through.  */
+	case TTL_TC_ARRAY:
+	case TTL_TC_ENVIRONMENT:
+	  for (i = 1; i <= size; i++)
+	    message_field (&b, scan + i);
+	  break;
+	}
+      scan += message_object_words
+	(TTL_OBJ_TO_VALUE (msg->words + scan));
+    }
+  free (b.seen);
+  free (b.seen_offsets);
+  return msg;
+}
+
+/* Copy the value in the message `msg' to the heap and return it.  */
+/* MAY GC.  */
+static ttl_value
+message_to_value (struct vm_message * msg)
+{
+  ttl_value * dest;
+  unsigned i;
+
+  if (msg->word_count == 0)
+    return msg->root;
+  dest = (ttl_value *) ttl_alloc (msg->word_count);
+  memcpy (dest, msg->words, msg->word_count * sizeof (ttl_value));
+  for (i = 0; i < msg->reloc_count; i++)
+    dest[msg->relocs[i]] =
+      (ttl_value) (((char *) dest) + (ttl_word) dest[msg->relocs[i]]);
+  ttl_stats.allocations++;
+  ttl_stats.alloced_words += msg->word_count;
+  if (msg->relocate_root)
+    return (ttl_value) (((char *) dest) + (ttl_word) msg->root);
+  return msg->root;
+}
+
+/* Return the machine with number `id', or NULL if there is none.
+   Must be called with `vm_lock' held.  */
+static struct vm *
+find_vm (int id)
+{
+  struct vm * vm;
+
+  if (id < 0)
+    return NULL;
+  vm = vms + id % MAX_VMS;
+  if (vm->state == VM_FREE || vm->id != id)
+    return NULL;
+  return vm;
+}
+
+static void
+setup_vms (void)
+{
+  vms[0].id = 0;
+  vms[0].state = VM_RUNNING;
+  vms[0].uses = 1;
+  pthread_cond_init (&vms[0].changed, NULL);
+}
+
+/* Body of the thread of a virtual machine.  */
+static void *
+vm_thread (void * arg)
+{
+  struct vm * vm = arg;
+  ttl_value thunk;
+
+  current_vm = vm - vms;
+  setup_machine ();
+  vm_initializer ();
+  thunk = message_to_value (vm->start);
+  free_message (vm->start);
+  vm->start = NULL;
+  ttl_dispatcher (thunk);
+  return NULL;
+}
+
+/* End the virtual machine running in the current thread.  This is
+   called when its function returns.  */
+static void
+finish_vm (void)
+{
+  struct vm * vm = vms + current_vm;
+  struct vm_message * msg;
+
+  free (space0orig);
+  free (space1orig);
+#if HAVE_SYS_EPOLL_H
+  if (io_epoll_fd >= 0)
+    close (io_epoll_fd);
+#endif
+  pthread_mutex_lock (&vm_lock);
+  while ((msg = vm->head) != NULL)
+    {
+      vm->head = msg->next;
+      free_message (msg);
+    }
+  vm->tail = NULL;
+  vm->pending = 0;
+  vm->state = VM_FINISHED;
+  pthread_cond_broadcast (&vm->changed);
+  pthread_mutex_unlock (&vm_lock);
+  pthread_exit (NULL);
+}
+
+int
+ttl_vm_spawn (ttl_value thunk)
+{
+  struct vm_message * start;
+  struct vm * vm = NULL;
+  pthread_attr_t attr;
+  pthread_t thread;
+  sigset_t all, old;
+  int slot, id;
+
+  if (!TTL_HAVE_THREAD_LOCAL || !vm_initializer)
+    vm_error ("virtual machines are not supported by this program");
+  start = value_to_message (thunk);
+
+  pthread_mutex_lock (&vm_lock);
+  for (slot = 1; slot < MAX_VMS; slot++)
+    if (vms[slot].state == VM_FREE)
+      {
+	vm = vms + slot;
+	break;
+      }
+  if (!vm)
+    {
+      pthread_mutex_unlock (&vm_lock);
+      vm_error ("too many virtual machines");
+    }
+  id = vm->uses++ * MAX_VMS + slot;
+  vm->id = id;
+  vm->state = VM_RUNNING;
+  vm->joiners = 0;
+  vm->start = start;
+  vm->head = vm->tail = NULL;
+  vm->pending = 0;
+  pthread_cond_init (&vm->changed, NULL);
+  pthread_mutex_unlock (&vm_lock);
+
+  /* Signals are handled by the main machine only, so the new thread
+     starts with all signals blocked.  */
+  sigfillset (&all);
+  pthread_sigmask (SIG_BLOCK, &all, &old);
+  pthread_attr_init (&attr);
+  pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+  if (pthread_create (&thread, &attr, vm_thread, vm))
+    vm_error ("cannot create thread for virtual machine");
+  pthread_attr_destroy (&attr);
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+  return id;
+}
+
+int
+ttl_vm_self (void)
+{
+  return vms[current_vm].id;
+}
+
+void
+ttl_vm_send (int id, ttl_value value)
+{
+  struct vm_message * msg = value_to_message (value);
+  struct vm * vm;
+
+  pthread_mutex_lock (&vm_lock);
+  vm = find_vm (id);
+  if (!vm || vm->state != VM_RUNNING)
+    {
+      /* Messages to finished machines are dropped.  */
+      pthread_mutex_unlock (&vm_lock);
+      free_message (msg);
+      return;
+    }
+  if (vm->tail)
+    vm->tail->next = msg;
+  else
+    vm->head = msg;
+  vm->tail = msg;
+  vm->pending++;
+  pthread_cond_broadcast (&vm->changed);
+  pthread_mutex_unlock (&vm_lock);
+}
+
+void
+ttl_vm_receive (void)
+{
+  struct vm * vm = vms + current_vm;
+  struct vm_message * msg;
+
+  pthread_mutex_lock (&vm_lock);
+  while (!vm->head)
+    pthread_cond_wait (&vm->changed, &vm_lock);
+  msg = vm->head;
+  vm->head = msg->next;
+  if (!vm->head)
+    vm->tail = NULL;
+  vm->pending--;
+  pthread_mutex_unlock (&vm_lock);
+
+  ttl_global_acc = message_to_value (msg);
+  free_message (msg);
+}
+
+int
+ttl_vm_pending (void)
+{
+  int pending;
+
+  pthread_mutex_lock (&vm_lock);
+  pending = vms[current_vm].pending;
+  pthread_mutex_unlock (&vm_lock);
+  return pending;
+}
+
+void
+ttl_vm_join (int id)
+{
+  struct vm * vm;
+
+  if (id == vms[current_vm].id)
+    vm_error ("a virtual machine cannot join itself");
+  pthread_mutex_lock (&vm_lock);
+  vm = find_vm (id);
+  if (vm)
+    {
+      vm->joiners++;
+      while (vm->state != VM_FINISHED)
+	pthread_cond_wait (&vm->changed, &vm_lock);
+      /* The last thread which stops waiting frees the slot.  */
+      if (--vm->joiners == 0)
+	{
+	  pthread_cond_destroy (&vm->changed);
+	  vm->state = VM_FREE;
+	}
+    }
+  pthread_mutex_unlock (&vm_lock);
+}
+
 
 /* This function gets called by the main modules right at the
    beginning of `main ()', before doing anything else.  */
@@ -2658,12 +4957,15 @@ ttl_initialize (int argc, char * argv[])
 {
   char * argv0 = argv[0];
 
+  program_name = argv0;
+
 #if DRIBBLE
   dribble = fopen ("dribble", "w");
 #endif
 
   /* Remember the start time, for timing the program run.  */  
   times (&begin_tms);
+  gettimeofday (&begin_time, NULL);
 
 #if TTL_PROFILE_MEMORY
   {
@@ -2695,7 +4997,27 @@ ttl_initialize (int argc, char * argv[])
 	      fprintf (stderr, "Options common to all Turtle programs:\n\n");
 	      fprintf (stderr, "  -:hNUM   set heap size to NUM megabytes\n");
 	      fprintf (stderr, "  -:s      print statistics on exit\n");
+	      fprintf (stderr, "  -:S      print statistics on exit in "
+		       "machine-readable form\n");
 	      fprintf (stderr, "  -:g      switch on GC messages\n");
+	      fprintf (stderr, "  -:p[HZ]  sample where the program spends "
+		       "its time, HZ times per\n"
+		       "           second (default 1000), and write "
+		       "PROGRAM.prof and\n"
+		       "           PROGRAM.folded on exit\n");
+	      fprintf (stderr, "  -:iSECS[,FD]\n"
+		       "           write a line of statistics to FD (default 2) "
+		       "every SECS\n"
+		       "           seconds; SIGUSR1 prints all statistics\n");
+	      fprintf (stderr, "  -:t[NUM] record the last NUM (default %d) "
+		       "runtime events and\n"
+		       "           write them to PROGRAM.trace.json on exit\n",
+		       TRACE_DEFAULT_EVENTS);
+	      fprintf (stderr, "  -:qMSECS switch threads every MSECS "
+		       "(default %d) milliseconds of\n"
+		       "           processor time, 0 switches only when "
+		       "the tick counter expires\n",
+		       THREAD_DEFAULT_SLICE_MS);
 	      exit (0);
 	      break;
 
@@ -2717,10 +5039,53 @@ ttl_initialize (int argc, char * argv[])
 	      fprintf (stderr, "turtle rt: switching on statistics\n");
 	      break;
 
+	    case 'S':
+	      print_stats_machine_readable = 1;
+	      break;
+
 	    case 'g':
 	      print_gc_messages = 1;
 	      fprintf (stderr, "turtle rt: switching on GC messages\n");
 	      break;
+
+	    case 'p':
+	      {
+		int hz = atoi (argv[0] + 3);
+		if (hz <= 0)
+		  hz = PROFILER_DEFAULT_HZ;
+		else if (hz > 1000000)
+		  hz = 1000000;
+		profiler_hz = hz;
+	      }
+	      break;
+
+	    case 'i':
+	      {
+		char * comma = strchr (argv[0] + 3, ',');
+		stats_interval = atoi (argv[0] + 3);
+		if (stats_interval <= 0)
+		  stats_interval = 1;
+		if (comma)
+		  stats_fd = atoi (comma + 1);
+	      }
+	      break;
+
+	    case 't':
+	      {
+		int events = atoi (argv[0] + 3);
+		if (events <= 0)
+		  events = TRACE_DEFAULT_EVENTS;
+		else if (events > 16 * 1024 * 1024)
+		  events = 16 * 1024 * 1024;
+		trace_events = events;
+	      }
+	      break;
+
+	    case 'q':
+	      thread_slice_ms = atoi (argv[0] + 3);
+	      if (thread_slice_ms < 0)
+		thread_slice_ms = 0;
+	      break;
 	    }
 	  argc--;
 	  argv++;
@@ -2729,29 +5094,25 @@ ttl_initialize (int argc, char * argv[])
 	break;
     }
 
-  setup_registers ();
-  setup_heap ();
-  reset_stats ();
-  /* Install root continuation, which exits the program.  */
-  save_cont (descriptors + 0, 0);
+  if (trace_events > 0)
+    trace_start (trace_events);
+  setup_machine ();
   setup_command_line (argv0, argc, argv);
+  setup_vms ();
 
-  /* Set up exception handling.  */
-  ttl_null_pointer_exception = ttl_string_to_value ("null-pointer-exception",
-						    -1);
-  ttl_subscript_exception = ttl_string_to_value ("subscript-exception", -1);
-  ttl_out_of_range_exception = ttl_string_to_value ("out-of-range-exception",
-						    -1);
-  ttl_wrong_variant_exception = ttl_string_to_value ("wrong-variant", -1);
-  ttl_exception_handler = ttl_cons
-    (ttl_cons (TTL_NULL, TTL_OBJ_TO_VALUE (descriptors + 1)),
-     TTL_NULL);
+  signal (STATS_SIGNAL, c_signal_handler);
+  if (stats_interval > 0)
+    {
+      stats_file = stats_fd == 2 ? stderr : fdopen (stats_fd, "a");
+      if (!stats_file)
+	fprintf (stderr, "turtle rt: cannot write statistics to fd %d\n",
+		 stats_fd);
+      stats_next_time = ttl_monotonic_time () +
+	(ttl_nanoseconds) stats_interval * 1000000000;
+    }
 
-  ttl_time_quantum = TTL_DEFAULT_TIME_QUANTUM;
-  ttl_time_slice = ttl_time_quantum;
-  timer_interrupt = TTL_OBJ_TO_VALUE (descriptors + 2);
-  signal_handler = TTL_OBJ_TO_VALUE (descriptors + 3);
-  times (&last_tick_tms);
+  if (profiler_hz > 0)
+    profiler_start (profiler_hz);
 }
 
 /* Terminate the process with exit code `code', printing statistics if
@@ -2767,12 +5128,16 @@ ttl_exit (int code)
   write_samples ();
   fclose (prof_file);
 #endif /* TTL_PROFILE_MEMORY */
-  times (&end_tms);
-  ttl_stats.total_run_time = (end_tms.tms_utime + end_tms.tms_stime)
-    - (begin_tms.tms_utime + begin_tms.tms_stime);
+  write_profile ();
+  if (profiler_hz > 0)
+    profiler_write ();
+  trace_write ();
+  update_run_time ();
 
   if (print_stats_on_exit)
-    print_stats ();
+    print_stats (stderr);
+  if (print_stats_machine_readable)
+    print_stats_machine (stderr);
   exit (code);
 }
 
@@ -2905,7 +5270,7 @@ ttl_examine (void)
   
 }
 
-static idg_constraint_list all_constraints = NULL;
+static TTL_THREAD_LOCAL idg_constraint_list all_constraints = NULL;
 
 static idg_constraint_list
 addc (idg_constraint_list ls, idg_constraint c)
@@ -2975,6 +5340,7 @@ ttl_real_resolve (void)
 {
   int i;
   idg_constraint_list l;
+  TRACE_BEGIN ("ttl_real_resolve");
   idg_solve (all_constraints);
   l = all_constraints;
   while (l)
@@ -3005,9 +5371,10 @@ ttl_real_resolve (void)
 	}
       l = l->next;
     }
+  TRACE_END ("ttl_real_resolve");
 }
 
-static fd_constraint_list all_fd_constraints = NULL;
+static TTL_THREAD_LOCAL fd_constraint_list all_fd_constraints = NULL;
 
 void
 ttl_add_fd_constraint (int type, int variable_count)
@@ -3076,6 +5443,7 @@ ttl_fd_resolve (void)
 {
   int i;
   fd_constraint_list l;
+  TRACE_BEGIN ("ttl_fd_resolve");
   fd_solve (all_fd_constraints);
   l = all_fd_constraints;
   while (l)
@@ -3090,6 +5458,7 @@ ttl_fd_resolve (void)
 	}
       l = l->next;
     }
+  TRACE_END ("ttl_fd_resolve");
 }
 
 /* End of libturtlert.c.  */
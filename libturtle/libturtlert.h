@@ -27,6 +27,24 @@
 #include <string.h>
 
 
+/* The state of the virtual machine, that is the registers, the heap
+   and the module variables, is kept separately for each operating
+   system thread, so that several virtual machines can run in parallel
+   (see `ttl_vm_spawn').  Without compiler support for thread-local
+   variables, only one virtual machine can exist.  */
+#if defined (__GNUC__)
+# define TTL_THREAD_LOCAL __thread __attribute__ ((tls_model ("initial-exec")))
+# define TTL_HAVE_THREAD_LOCAL 1
+#else
+# define TTL_THREAD_LOCAL
+# define TTL_HAVE_THREAD_LOCAL 0
+#endif
+
+
+/* Times in nanoseconds.  A 32-bit `long' overflows after about two
+   seconds, so these are always 64 bits wide.  */
+typedef long long ttl_nanoseconds;
+
 /* The Turtle runtime system collects various statistics while a
    Turtle program is running.  All these statistics are collected in a
    variable of the following structure.  */
@@ -53,12 +71,14 @@ struct ttl_statistics
   unsigned total_gc_time;	/* Garbage collection in clock ticks.  */
   unsigned min_gc_time;		/* Minimum garbage collection duration.  */
   unsigned max_gc_time;		/* Maximum garbage collection duration.  */
+  ttl_nanoseconds total_gc_nsecs; /* Garbage collection in nanoseconds.  */
 
   unsigned tick_count;		/* Number of tick timeouts.  */
   unsigned signal_count;	/* Number of signal handler calls.  */
+  unsigned thread_switch_count;	/* Number of thread switches.  */
 };
 
-extern struct ttl_statistics ttl_stats;
+extern TTL_THREAD_LOCAL struct ttl_statistics ttl_stats;
 
 /* Basic data type.  A word must be at least as large as a pointer, so
    that pointers can be stored in words.  */
@@ -141,11 +161,24 @@ typedef ttl_word * ttl_value;
 #define TTL_TC_VARIABLE               13
 #define TTL_TC_METHOD                 14
 #define TTL_TC_CONSTRAINABLE_VARIABLE 15
+#define TTL_TC_DATA                   16
 
 /* Given a type code and a size value, create a valid header word.  */
 #define TTL_MAKE_HEADER(tc, size) ((((ttl_word) (size)) << 8) | \
                                    (((ttl_word) (tc)) << 2) | TTL_HEADER_TAG)
 
+/* Values of user-defined data types.  Variants with fields are stored
+   as objects of type TTL_TC_DATA, with the variant number in the upper
+   bits of the size field of the header.  Variants without fields are
+   represented by the immediate value returned by TTL_NULLARY_DATA,
+   which is never equal to TTL_NULL.  */
+#define TTL_DATA_MAX_FIELDS 0xffff
+#define TTL_MAKE_DATA_HEADER(variant, size) \
+  TTL_MAKE_HEADER (TTL_TC_DATA, (((ttl_word) (variant)) << 16) | (size))
+#define TTL_DATA_VARIANT(v)      (TTL_SIZE (v) >> 16)
+#define TTL_DATA_SIZE(v)         (TTL_SIZE (v) & TTL_DATA_MAX_FIELDS)
+#define TTL_NULLARY_DATA(variant) TTL_INT_TO_VALUE ((variant) + 1)
+
 /* Convert a object pointer to a raw pointer and vice versa.  This may
    only be called iff TTL_OBJECT_P(v) is true.  */
 #define TTL_VALUE_TO_OBJ(t, v) ((t) (((char *) (v)) - TTL_OBJECT_TAG))
@@ -163,7 +196,7 @@ typedef ttl_word * ttl_value;
 
 /* This is the header field which is stored into the
    compiler-generated procedure descriptors.  */
-#define TTL_DESCRIPTOR_HEADER TTL_MAKE_HEADER(TTL_TC_PROCEDURE, 3)
+#define TTL_DESCRIPTOR_HEADER TTL_MAKE_HEADER(TTL_TC_PROCEDURE, 4)
 
 /* This structure represents a pair object.  Note that these are the
    only objects which do not have a header field.  */
@@ -270,7 +303,7 @@ struct ttl_function_info
 };
 
 /* TTL_SIZEOF_* constants are without the header!  */
-#define TTL_SIZEOF_DESCR 3
+#define TTL_SIZEOF_DESCR 4
 
 /* For functions, the compiler generates objects of this kind.  They
    are always statically allocated and thus don't need to get
@@ -279,7 +312,9 @@ struct ttl_function_info
    executing the function described by this object, `function_info'
    points to the `struct ttl_function_info' associated to the function
    to which this descriptor belongs and `line' is the source code line
-   associated with this descriptor.  */
+   associated with this descriptor.  `values' is non-zero for
+   continuation entry points which immediately take apart a returned
+   tuple and therefore accept the tuple elements in `ttl_values'.  */
 typedef struct ttl_descr * ttl_descr;
 struct ttl_descr
 {
@@ -287,6 +322,27 @@ struct ttl_descr
   int (* host)(void);
   struct ttl_function_info * function_info;
   int line;
+  int values;
+};
+
+/* Modules compiled with the pragma `profile-generate' count how often
+   their functions are entered and how often each conditional jump is
+   taken, and register a structure of this type with the runtime,
+   which writes the counts to a profile file on exit.  `calls' has one
+   entry per descriptor in `descriptors', but only the entries of
+   function entry points are counted.  `branches' holds the taken and
+   not-taken counts of each conditional jump, and `branch_functions'
+   the descriptor index of the function containing it.  */
+struct ttl_profile_info
+{
+  struct ttl_profile_info * next;
+  char * module;		/* Name of the module as C identifier.  */
+  struct ttl_descr * descriptors;
+  unsigned descriptor_count;
+  unsigned long * calls;
+  unsigned branch_count;
+  unsigned long * branches;
+  unsigned * branch_functions;
 };
 
 /* TTL_SIZEOF_* constants are without the header!  */
@@ -425,31 +481,100 @@ struct ttl_method
 };
 
 /* Registers for the Turtle machine.  */
-extern ttl_value ttl_global_pc;
-extern ttl_value ttl_global_acc;
-extern ttl_value ttl_global_env;
-extern ttl_value ttl_global_cont;
-extern ttl_value * ttl_alloc_ptr;
-extern ttl_value * ttl_alloc_limit;
-extern int ttl_global_sp;
-extern ttl_value ttl_stack[];
-
-/* List of currently active exception handlers.  When an exception
-   occurs, the first one is taken from the list and invoked.  */
-extern ttl_value ttl_exception_handler;
-
-/* When an exception occurs, the current chain of continuations is
-   stored in this variable, so that it can later be examined, for
-   example for printing a backtrace.  */
-extern ttl_value ttl_saved_continuations;
+extern TTL_THREAD_LOCAL ttl_value ttl_global_pc;
+extern TTL_THREAD_LOCAL ttl_value ttl_global_acc;
+extern TTL_THREAD_LOCAL ttl_value ttl_global_env;
+extern TTL_THREAD_LOCAL ttl_value ttl_global_cont;
+extern TTL_THREAD_LOCAL ttl_value * ttl_alloc_ptr;
+extern TTL_THREAD_LOCAL ttl_value * ttl_alloc_limit;
+extern TTL_THREAD_LOCAL int ttl_global_sp;
+extern TTL_THREAD_LOCAL ttl_value ttl_stack[];
+
+/* Stack of installed exception handlers.  Each entry records the
+   handler procedure and the continuation which was current when it
+   was installed.  An entry is only active while that continuation is
+   part of the current continuation chain, so handlers need not be
+   removed when the protected code returns normally.  The bottom entry
+   is the default handler of the runtime system.  */
+#define TTL_MAX_HANDLERS 256
+struct ttl_handler
+{
+  ttl_value cont;
+  ttl_value handler;
+};
+extern TTL_THREAD_LOCAL struct ttl_handler ttl_handlers[TTL_MAX_HANDLERS];
+extern TTL_THREAD_LOCAL int ttl_handler_count;
+
+/* When an exception occurs, the descriptor active at the raise point
+   and the current chain of continuations are stored in these
+   variables, so that they can later be examined, for example for
+   printing a backtrace.  */
+extern TTL_THREAD_LOCAL ttl_descr ttl_raise_pc;
+extern TTL_THREAD_LOCAL ttl_value ttl_saved_continuations;
+
+/* Remove dead entries from the handler stack, making room for a new
+   one.  */
+void ttl_prune_handlers (void);
+
+/* Pop the topmost exception handler whose continuation is still
+   live, together with all dead handlers above it, and return it.  The
+   default handler is never popped.  */
+struct ttl_handler * ttl_find_handler (void);
 
 /* These variables hold pre-defined exception names which might be
    raised by the runtime system of the virtual machine.  */
-extern ttl_value ttl_null_pointer_exception;
-extern ttl_value ttl_subscript_exception;
-extern ttl_value ttl_out_of_range_exception;
-extern ttl_value ttl_wrong_variant_exception;
-extern ttl_value ttl_require_exception;
+extern TTL_THREAD_LOCAL ttl_value ttl_null_pointer_exception;
+extern TTL_THREAD_LOCAL ttl_value ttl_subscript_exception;
+extern TTL_THREAD_LOCAL ttl_value ttl_out_of_range_exception;
+extern TTL_THREAD_LOCAL ttl_value ttl_wrong_variant_exception;
+extern TTL_THREAD_LOCAL ttl_value ttl_require_exception;
+
+/* Maximum number of tuple elements which can be returned in the value
+   registers.  Must match MAX_VALUE_REGISTERS in codegen.c.  */
+#define TTL_MAX_VALUES 8
+
+/* Value registers.  A function returning a tuple to a continuation
+   which accepts multiple values stores the tuple elements into these
+   registers instead of allocating a tuple, and sets the accumulator to
+   TTL_VALUES_MARKER.  The registers are not GC roots, because no
+   allocation happens between the return and the point where the
+   continuation has moved the values to the stack.  */
+extern TTL_THREAD_LOCAL ttl_value ttl_values[TTL_MAX_VALUES];
+
+/* Header tags never appear in the accumulator, so this cannot be
+   confused with a tuple.  */
+#define TTL_VALUES_MARKER ((ttl_value) TTL_HEADER_TAG)
+
+/* Non-zero iff the current continuation accepts multiple values.  */
+#define TTL_VALUES_WANTED_P()						\
+  (TTL_VALUE_TO_OBJ (ttl_continuation, ttl_global_cont)->pc->values)
+
+
+/* Branch prediction hints for the C compiler.  The slow paths for
+   garbage collection and exceptions are marked as unlikely, so that
+   the compiler keeps them out of the way of the fast paths.  */
+#if defined (__GNUC__) && __GNUC__ >= 3
+# define TTL_LIKELY(cond)   __builtin_expect (!!(cond), 1)
+# define TTL_UNLIKELY(cond) __builtin_expect (!!(cond), 0)
+#else
+# define TTL_LIKELY(cond)   (cond)
+# define TTL_UNLIKELY(cond) (cond)
+#endif
+
+/* Placed after a label, this tells the C compiler that the code
+   following it is rarely executed.  The compiler emits it for
+   functions which never ran while an execution profile was taken.  */
+#if defined (__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))
+# define TTL_COLD_LABEL __attribute__ ((cold));
+#else
+# define TTL_COLD_LABEL ;
+#endif
+
+/* Evaluate the branch condition `cond' of conditional jump number `n'
+   and count the outcome in the array `counts' (see `struct
+   ttl_profile_info').  */
+#define TTL_PROFILE_BRANCH(counts, n, cond)				\
+  ((cond) ? ((counts)[2 * (n)]++, 1) : ((counts)[2 * (n) + 1]++, 0))
 
 
 /* This macro stores all locally cached virtual machine registers to
@@ -488,7 +613,7 @@ do {								\
 #define TTL_GC_CHECK(words)				\
 do {							\
   ttl_stats.gc_checks++;				\
-  if (alloc + (((words) + 1) & ~1) > ttl_alloc_limit)	\
+  if (TTL_UNLIKELY (alloc + (((words) + 1) & ~1) > ttl_alloc_limit))	\
     {							\
       TTL_SAVE_REGISTERS;				\
       ttl_garbage_collect (words);			\
@@ -497,6 +622,40 @@ do {							\
 } while (0)
 
 
+/* Like `TTL_GC_CHECK', but instead of saving the registers and
+   calling the garbage collector in place, jump to the stub
+   `TTL_GC_STUB', which is shared by all checks of a host procedure
+   and returns to the check afterwards.  `n' must be unique in the
+   host procedure.  The stub needs the GNU C extension for label
+   values, so other compilers get the inline version.  */
+#if defined (__GNUC__)
+# define TTL_GC_STUB_REGISTERS			\
+  int gc_words = 0;				\
+  void * gc_return = NULL;
+# define TTL_GC_CHECK_STUB(words, n)				\
+do {								\
+  ttl_stats.gc_checks++;					\
+  if (TTL_UNLIKELY (alloc + (((words) + 1) & ~1) > ttl_alloc_limit))	\
+    {								\
+      gc_words = (words);					\
+      gc_return = &&gc_return_##n;				\
+      goto gc_stub;						\
+    }								\
+ gc_return_##n: ;						\
+} while (0)
+# define TTL_GC_STUB				\
+ gc_stub:					\
+  TTL_SAVE_REGISTERS;				\
+  ttl_garbage_collect (gc_words);		\
+  TTL_RESTORE_REGISTERS;			\
+  goto *gc_return;
+#else
+# define TTL_GC_STUB_REGISTERS
+# define TTL_GC_CHECK_STUB(words, n) TTL_GC_CHECK (words)
+# define TTL_GC_STUB
+#endif
+
+
 /* Allocate `words' words on the heap and store a pointer to the
    beginning of the allocated area into `var'.  `Words' is rounded up
    to the next even value for the reasons described above.  */
@@ -555,6 +714,18 @@ do {							\
 } while (0)
 
 
+/* Allocate a value of a user-defined data type with `len' fields and
+   store a reference to it in `acc'.  The fields are not
+   initialized.  */
+#define TTL_MAKE_UNINITIALIZED_DATA(variant, len)		\
+do {								\
+  ttl_array a;							\
+  TTL_ALLOC (a, (len) + 1);					\
+  a->header = TTL_MAKE_DATA_HEADER ((variant), (len));		\
+  acc = TTL_OBJ_TO_VALUE (a);					\
+} while (0)
+
+
 /* Make a closure and store a reference in `acc'.  The descriptor to
    be called when the closure is invoked is given in `descriptor'.  */
 #define TTL_MAKE_CLOSURE(descriptor)					\
@@ -677,20 +848,33 @@ do {								\
 } while (0)
 
 
-/* Save the current continuation stack in the global variable
-   `ttl_saved_continuation' (for later examination), push the
-   exception name `exception' onto the stack and call the topmost
-   exception handler.  */
+/* Install `proc' as exception handler for the code called with the
+   current continuation.  This does not allocate.  */
+#define TTL_PUSH_HANDLER(proc)					\
+do {								\
+  if (TTL_UNLIKELY (ttl_handler_count == TTL_MAX_HANDLERS))	\
+    ttl_prune_handlers ();					\
+  ttl_handlers[ttl_handler_count].cont = ttl_global_cont;	\
+  ttl_handlers[ttl_handler_count].handler = (proc);		\
+  ttl_handler_count++;						\
+} while (0)
+
+/* Remember the raise point and the continuation chain in
+   `ttl_raise_pc' and `ttl_saved_continuations' (for later
+   examination), discard the evaluation stack, push the exception name
+   `exception' onto the stack and call the topmost live exception
+   handler.  */
 #define TTL_RAISE(exception)						\
 do {									\
-  TTL_GC_CHECK (TTL_SIZEOF_CONTINUATION + 1 + (sp - ttl_stack));	\
-  TTL_SAVE_CONT (pc, (sp - ttl_stack));					\
+  ttl_value _exc = (exception);						\
+  struct ttl_handler * _h;						\
+  ttl_raise_pc = pc;							\
   ttl_saved_continuations = ttl_global_cont;				\
-  *sp++ = (exception);					\
-  pc = TTL_VALUE_TO_OBJ (ttl_descr,					\
-                         TTL_CDR (TTL_CAR (ttl_exception_handler)));	\
-  ttl_global_cont = TTL_CAR (TTL_CAR (ttl_exception_handler));		\
-  ttl_exception_handler = TTL_CDR (ttl_exception_handler);		\
+  _h = ttl_find_handler ();						\
+  pc = TTL_VALUE_TO_OBJ (ttl_descr, _h->handler);			\
+  ttl_global_cont = _h->cont;						\
+  sp = ttl_stack;							\
+  *sp++ = _exc;								\
   goto save_regs_and_return;						\
 } while (0)
 
@@ -699,7 +883,7 @@ do {									\
    raise a `null-pointer' exception if it does.  */
 #define TTL_NULL_CHECK				\
 do {						\
-  if (!acc)					\
+  if (TTL_UNLIKELY (!acc))			\
     goto raise_null_pointer_exception;		\
 } while (0)
 
@@ -709,9 +893,9 @@ do {						\
    is not the case.  */
 #define TTL_RANGE_CHECK(idx, arr)		\
 do {						\
-  if (!arr)					\
+  if (TTL_UNLIKELY (!arr))			\
     goto raise_null_pointer_exception;		\
-  if (idx < 0 || idx >= TTL_SIZE (arr))		\
+  if (TTL_UNLIKELY (idx < 0 || idx >= TTL_SIZE (arr)))	\
     goto raise_subscript_exception;		\
 } while (0)
 
@@ -765,6 +949,17 @@ void ttl_garbage_collect (int required);
    non-immedieate values.  */
 void ttl_register_root (ttl_value * root);
 
+/* Register the profile counters of a module compiled with the pragma
+   `profile-generate'.  The counts of all registered modules are
+   written to the file `PROGRAM.tprof' when the program exits.  */
+void ttl_register_profile (struct ttl_profile_info * info);
+
+/* Register the initialization function of the main module.  Each
+   virtual machine created by `ttl_vm_spawn' calls it to initialize
+   its own copy of the module variables.  The compiler generates a
+   call to this function in `main'.  */
+void ttl_register_initializer (void (* init) (void));
+
 /* The following three functions do not check for heap overflow, so
    make sure that there is enough space before calling them.  */
 ttl_value ttl_unsafe_string_to_value (char * str, int len);
@@ -772,6 +967,9 @@ ttl_value ttl_unsafe_real_to_value (double d);
 ttl_value ttl_unsafe_long_to_value (long l);
 /* This does not initialize the array elements.  */
 ttl_value ttl_unsafe_alloc_array (unsigned size);
+/* Allocate a value of variant `variant' of a user-defined data type
+   with `size' fields.  The fields are initialized to TTL_FALSE.  */
+ttl_value ttl_unsafe_alloc_data (unsigned variant, unsigned size);
 
 /* Similar to the functions above, but these call the garbage
    collector if necessary.  */
@@ -809,6 +1007,10 @@ ttl_value ttl_append_strings (ttl_value s1, ttl_value s2);
    will be initialized to `fill'.  May call the garbage collector.  */
 ttl_value ttl_make_list (unsigned elems, ttl_value fill);
 
+/* Create a list cell with head `car' and tail `cdr'.  May call the
+   garbage collector.  */
+ttl_value ttl_cons (ttl_value car, ttl_value cdr);
+
 /* Return the version number of the Turtle implementation the runtime
    was taken from.  */
 char * ttl_version_string (void);
@@ -824,12 +1026,16 @@ char * ttl_malloc_c_string (ttl_value str);
 char ** ttl_malloc_c_string_array (ttl_value s_arr);
 void ttl_free_c_string_array (char ** arr);
 
+/* Return the time of a monotonic clock in nanoseconds.  Only the
+   difference between two calls is meaningful.  */
+ttl_nanoseconds ttl_monotonic_time (void);
+
 /* The number of ticks remaining for this time slice.  This gets
    decremented at every function entry or at the top of loops, and
    when it falls below zero, a timer function will be called.  It is
    also used for signal handling, since a caught signal will set it to
    0 so that it will be handled at the next checkpoint.  */
-extern int ttl_time_slice;
+extern TTL_THREAD_LOCAL int ttl_time_slice;
 
 /* Install `handler' (a function descriptor or closure) as the signal
    handler for signal number `no'.  */
@@ -839,6 +1045,70 @@ void ttl_install_signal_handler (int no, ttl_value handler);
    function, which gets called whenever a time slice expires.  */
 void ttl_install_timer_handler (ttl_value handler);
 
+/* Green threads.  A thread runs a function without arguments (a
+   function descriptor or closure) and switches to the next runnable
+   thread when it blocks or its time slice expires.  The program ends
+   when the main function returns, even if other threads are still
+   runnable.  All of these functions may allocate memory, so the
+   registers must be saved before calling them and restored
+   afterwards.  The functions which block (`ttl_thread_yield',
+   `ttl_thread_join', `ttl_mutex_lock', `ttl_channel_send' and
+   `ttl_channel_receive') may replace the current continuation with
+   that of another thread, so the caller must return by restoring the
+   current continuation, with the accumulator taken from
+   `ttl_global_acc'.  `ttl_channel_receive' returns the received value
+   in `ttl_global_acc'.  */
+ttl_value ttl_thread_spawn (ttl_value thunk);
+ttl_value ttl_thread_current (void);
+int ttl_thread_id (ttl_value thread);
+int ttl_thread_finished_p (ttl_value thread);
+void ttl_thread_yield (void);
+void ttl_thread_join (ttl_value thread);
+
+ttl_value ttl_make_mutex (void);
+void ttl_mutex_lock (ttl_value mutex);
+int ttl_mutex_try_lock (ttl_value mutex);
+void ttl_mutex_unlock (ttl_value mutex);
+
+/* Channels buffer up to `capacity' (at least 1) values.  Senders
+   block while the buffer is full, receivers while it is empty.  */
+ttl_value ttl_make_channel (int capacity);
+int ttl_channel_count (ttl_value channel);
+void ttl_channel_send (ttl_value channel, ttl_value value);
+void ttl_channel_receive (ttl_value channel);
+
+/* Return when the file descriptor `fd' is ready for reading or
+   writing, depending on `events', so that a following system call
+   does not block.  Meanwhile, the other green threads run.  If no
+   other thread could run, it returns at once and the system call
+   blocks the program as usual.  Like the blocking thread functions,
+   it may allocate memory and replace the current continuation.  */
+#define TTL_IO_READ  1
+#define TTL_IO_WRITE 2
+void ttl_io_wait (int fd, int events);
+
+/* Virtual machines.  Each machine runs in an operating system thread
+   of its own and has its own heap and module variables, so that
+   several machines run in parallel.  Machines communicate only by
+   sending messages, which are deep copies of Turtle values; values
+   containing continuations or constraint objects cannot be sent.
+   Machines are identified by numbers, the main machine has number 0.
+   `ttl_vm_spawn' starts a machine which calls `thunk', a function
+   without arguments, after initializing all modules, and which
+   finishes when the function returns.  Signals are only handled by
+   the main machine, and an uncaught exception in any machine halts
+   the program.  `ttl_vm_receive' waits until a message arrives and
+   returns it in `ttl_global_acc'; it may allocate memory, so the
+   registers must be saved before calling it and restored afterwards.
+   While a machine waits in `ttl_vm_receive' or `ttl_vm_join', its
+   green threads do not run.  */
+int ttl_vm_spawn (ttl_value thunk);
+int ttl_vm_self (void);
+void ttl_vm_send (int vm, ttl_value value);
+void ttl_vm_receive (void);
+int ttl_vm_pending (void);
+void ttl_vm_join (int vm);
+
 
 void ttl_add_real_constraint (int type, int variables);
 void ttl_real_resolve (void);
@@ -1047,9 +1047,38 @@ parse_type (ttl_pool pool, ttl_scanner scanner)
 }
 
 
+/* Parse the C function name of a mapped function, after the `='
+   token.  If the name is preceded by the word `leaf', set `*leaf' to
+   1.  Return NULL on errors.
+
+   Mapping        ::= ['leaf'] StringConst
+*/
+static ttl_symbol
+parse_mapping (ttl_scanner scanner, unsigned * leaf)
+{
+  ttl_ast_node ast_alias;
+
+  *leaf = 0;
+  if (scanner->token_class == token_identifier &&
+      scanner->token_value->d.identifier.symbol ==
+      ttl_symbol_enter (scanner->symbol_table, "leaf", 4))
+    {
+      *leaf = 1;
+      ttl_next_token (scanner);
+    }
+  ast_alias = scanner->token_value;
+  if (!accept_token (scanner, token_string_const))
+    return NULL;
+  return ttl_symbol_enter (scanner->symbol_table,
+			   ast_alias->d.string.value,
+			   ast_alias->d.string.length);
+}
+
+
 /* Parse a function declaration.  
 
-   FunDecl        ::= ['public'] 'fun' Ident ParameterList [':' Type] SubrBody
+   FunDecl        ::= ['public'] 'fun' Ident ParameterList [':' Type]
+                      (SubrBody | '=' Mapping ';' | ';')
 */
 static ttl_ast_node
 parse_fundef (ttl_pool pool, ttl_scanner scanner, int public)
@@ -1058,7 +1087,7 @@ parse_fundef (ttl_pool pool, ttl_scanner scanner, int public)
   ttl_ast_node name, params, type, body;
   unsigned handcoded = 0;
   unsigned mapped = 0;
-  ttl_ast_node ast_alias;
+  unsigned leaf = 0;
   ttl_symbol alias = NULL;
   char * documentation;
 
@@ -1099,12 +1128,9 @@ parse_fundef (ttl_pool pool, ttl_scanner scanner, int public)
       ttl_next_token (scanner);
       body = NULL;
       mapped = 1;
-      ast_alias = scanner->token_value;
-      if (!accept_token (scanner, token_string_const))
+      alias = parse_mapping (scanner, &leaf);
+      if (!alias)
 	return ttl_make_ast_error (pool);
-      alias = ttl_symbol_enter (scanner->symbol_table,
-				ast_alias->d.string.value,
-				ast_alias->d.string.length);
     }
   else
     body = parse_subr_body (pool, scanner);
@@ -1121,6 +1147,7 @@ parse_fundef (ttl_pool pool, ttl_scanner scanner, int public)
 				 scanner->filename,
 				 beg_line, beg_col, end_line, end_col);
     fun->d.function.mapped = mapped;
+    fun->d.function.leaf = leaf;
     fun->d.function.alias = alias;
     return fun;
   }
@@ -2639,6 +2666,97 @@ ttl_parse_module (ttl_pool pool, ttl_scanner scanner)
 }
 
 
+/* Parse the parameter names and the body expression or statements of
+   an inlinable function in an interface file and store them into the
+   function entry `entry'.  The current token is the word `inline'.
+   Return 0 on errors.
+
+   InlineBody ::= 'inline' '(' [Ident {',' Ident}] ')' (Expr
+                                                      | 'do' SubrBody)
+*/
+static int
+parse_inline_body (ttl_pool pool, ttl_scanner scanner, ttl_ast_node entry)
+{
+  ttl_ast_node params = NULL, * pp = &params;
+  ttl_ast_node body;
+
+  ttl_next_token (scanner);
+  if (!accept_token (scanner, token_lparen))
+    return 0;
+  while (scanner->token_class != token_rparen)
+    {
+      ttl_ast_node name = parse_ident (pool, scanner);
+      if (error_node (name))
+	return 0;
+      *pp = ttl_make_ast_pair (pool, name, NULL);
+      pp = &((*pp)->d.pair.cdr);
+      if (scanner->token_class != token_comma)
+	break;
+      ttl_next_token (scanner);
+    }
+  if (!accept_token (scanner, token_rparen))
+    return 0;
+  if (scanner->token_class == token_do)
+    {
+      ttl_next_token (scanner);
+      body = parse_subr_body (pool, scanner);
+      entry->d.function.inline_stmts = 1;
+    }
+  else
+    {
+      body = parse_cons_expr (pool, scanner);
+      if (error_node (body))
+	return 0;
+    }
+  entry->d.function.inline_params = params;
+  entry->d.function.inline_body = body;
+  return 1;
+}
+
+
+/* Parse the kind and the field layout of a data type function in an
+   interface file and store them into the function entry `entry'.
+   Such entries describe the private data type functions called by
+   inlinable functions.  The current token is the word `data'.  Return
+   0 on errors.
+
+   DataLayout ::= 'data' Ident ['fixed'] IntConst {IntConst}
+*/
+static int
+parse_data_layout (ttl_pool pool, ttl_scanner scanner, ttl_ast_node entry)
+{
+  ttl_ast_node layout = NULL, * lp = &layout;
+  ttl_ast_node kind;
+
+  ttl_next_token (scanner);
+  kind = parse_ident (pool, scanner);
+  if (error_node (kind))
+    return 0;
+  *lp = ttl_make_ast_pair (pool, kind, NULL);
+  lp = &((*lp)->d.pair.cdr);
+  if (scanner->token_class == token_identifier &&
+      scanner->token_value->d.identifier.symbol ==
+      ttl_symbol_enter (scanner->symbol_table, "fixed", 5))
+    {
+      *lp = ttl_make_ast_pair (pool, scanner->token_value, NULL);
+      lp = &((*lp)->d.pair.cdr);
+      ttl_next_token (scanner);
+    }
+  do
+    {
+      ttl_ast_node value = scanner->token_value;
+
+      if (!accept_token (scanner, token_int_const))
+	return 0;
+      *lp = ttl_make_ast_pair (pool, value, NULL);
+      lp = &((*lp)->d.pair.cdr);
+    }
+  while (scanner->token_class == token_int_const);
+  entry->d.function.data_layout = layout;
+  return 1;
+}
+
+
 /* Parse an interface file.  We are not wasting too much work on error
    messages, since interface files are compiler-generated anyway.  On
    errors, NULL will be returned.  */
@@ -2762,6 +2880,46 @@ parse_interface (ttl_pool pool, ttl_scanner scanner)
 					 0, /* Not handcoded.  */
 					 NULL, /* No docs. */
 					 NULL, -1, -1, -1, -1);
+	  /* Leaf functions are called directly from other modules, so
+	     their C name is part of the interface.  Small functions
+	     may come with their body, for inlining them, and the
+	     functions called by these bodies which are not public are
+	     described by their layout or by their defining module.  */
+	  if (scanner->token_class == token_eq)
+	    {
+	      ttl_next_token (scanner);
+	      if (scanner->token_class == token_identifier &&
+		  scanner->token_value->d.identifier.symbol ==
+		  ttl_symbol_enter (scanner->symbol_table, "inline", 6))
+		{
+		  if (!parse_inline_body (pool, scanner, entry))
+		    return NULL;
+		}
+	      else if (scanner->token_class == token_identifier &&
+		       scanner->token_value->d.identifier.symbol ==
+		       ttl_symbol_enter (scanner->symbol_table, "data", 4))
+		{
+		  if (!parse_data_layout (pool, scanner, entry))
+		    return NULL;
+		}
+	      else if (scanner->token_class == token_identifier &&
+		       scanner->token_value->d.identifier.symbol ==
+		       ttl_symbol_enter (scanner->symbol_table, "extern", 6))
+		{
+		  ttl_next_token (scanner);
+		  entry->d.function.external = parse_qualident (pool, scanner);
+		  if (error_node (entry->d.function.external))
+		    return NULL;
+		}
+	      else
+		{
+		  entry->d.function.mapped = 1;
+		  entry->d.function.alias =
+		    parse_mapping (scanner, &entry->d.function.leaf);
+		  if (!entry->d.function.alias)
+		    return NULL;
+		}
+	    }
 	  break;
 
 	case token_constraint:
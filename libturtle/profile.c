@@ -0,0 +1,260 @@
+/* libturtle/profile.c -- Reading of execution profiles.
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "error.h"
+
+/* A profile file consists of lines of the following forms, where
+   lines starting with `;' are comments:
+
+     module NAME
+     function INDEX NAME CALLS
+     branch INDEX NUMBER TAKEN NOT-TAKEN
+
+   `function' and `branch' lines belong to the preceding `module'
+   line.  INDEX is the index of the function's entry descriptor in
+   the `descriptors' array of the module, and NUMBER counts the
+   conditional jumps of that function in the order of the generated
+   code.  */
+
+typedef struct profile_function * profile_function;
+struct profile_function
+{
+  profile_function next;
+  unsigned index;
+  char * name;
+  unsigned long calls;
+  unsigned long frequency;	/* Maximum of `calls' and the counts of
+				   the function's branches.  */
+};
+
+typedef struct profile_branch * profile_branch;
+struct profile_branch
+{
+  profile_branch next;
+  unsigned function;		/* Descriptor index of the function.  */
+  unsigned number;
+  unsigned long taken;
+  unsigned long not_taken;
+};
+
+typedef struct profile_module * profile_module;
+struct profile_module
+{
+  profile_module next;
+  char * name;
+  profile_function functions;
+  profile_branch branches;
+  unsigned long max_frequency;
+};
+
+struct ttl_profile
+{
+  profile_module modules;
+};
+
+static char *
+copy_string (ttl_pool pool, char * s)
+{
+  char * p = ttl_malloc (pool, strlen (s) + 1);
+  strcpy (p, s);
+  return p;
+}
+
+/* Compute the frequencies of the functions of `module' once all its
+   entries have been read.  */
+static void
+finish_module (profile_module module)
+{
+  profile_function function;
+  profile_branch branch;
+
+  if (!module)
+    return;
+  for (function = module->functions; function; function = function->next)
+    {
+      function->frequency = function->calls;
+      for (branch = module->branches; branch; branch = branch->next)
+	if (branch->function == function->index &&
+	    branch->taken + branch->not_taken > function->frequency)
+	  function->frequency = branch->taken + branch->not_taken;
+      if (function->frequency > module->max_frequency)
+	module->max_frequency = function->frequency;
+    }
+}
+
+ttl_profile
+ttl_read_profile (ttl_pool pool, char * filename)
+{
+  ttl_profile profile;
+  profile_module module = NULL;
+  FILE * f;
+  char line[1024];
+  char name[1024];
+  int line_no = 0;
+
+  f = fopen (filename, "r");
+  if (!f)
+    {
+      ttl_error_print_string (stderr, "turtle: cannot open profile file: ");
+      ttl_error_print_string (stderr, filename);
+      ttl_error_print_nl (stderr);
+      return NULL;
+    }
+
+  profile = ttl_malloc (pool, sizeof (struct ttl_profile));
+  profile->modules = NULL;
+  while (fgets (line, sizeof (line), f))
+    {
+      unsigned index, number;
+      unsigned long a, b;
+
+      line_no++;
+      if (line[0] == ';' || line[0] == '\n')
+	continue;
+      if (sscanf (line, "module %1023s", name) == 1)
+	{
+	  finish_module (module);
+	  module = ttl_malloc (pool, sizeof (struct profile_module));
+	  module->name = copy_string (pool, name);
+	  module->functions = NULL;
+	  module->branches = NULL;
+	  module->max_frequency = 0;
+	  module->next = profile->modules;
+	  profile->modules = module;
+	}
+      else if (module &&
+	       sscanf (line, "function %u %1023s %lu", &index, name, &a) == 3)
+	{
+	  profile_function function =
+	    ttl_malloc (pool, sizeof (struct profile_function));
+	  function->index = index;
+	  function->name = copy_string (pool, name);
+	  function->calls = a;
+	  function->frequency = a;
+	  function->next = module->functions;
+	  module->functions = function;
+	}
+      else if (module &&
+	       sscanf (line, "branch %u %u %lu %lu", &index, &number,
+		       &a, &b) == 4)
+	{
+	  profile_branch branch =
+	    ttl_malloc (pool, sizeof (struct profile_branch));
+	  branch->function = index;
+	  branch->number = number;
+	  branch->taken = a;
+	  branch->not_taken = b;
+	  branch->next = module->branches;
+	  module->branches = branch;
+	}
+      else
+	{
+	  fprintf (stderr, "%s:%d: malformed profile entry\n", filename,
+		   line_no);
+	  fclose (f);
+	  return NULL;
+	}
+    }
+  finish_module (module);
+  fclose (f);
+  return profile;
+}
+
+static profile_module
+find_module (ttl_profile profile, char * module)
+{
+  profile_module m;
+
+  for (m = profile->modules; m; m = m->next)
+    if (!strcmp (m->name, module))
+      return m;
+  return NULL;
+}
+
+/* Return non-zero if the profile entry `function' describes the
+   function `fun'.  */
+static int
+same_name_p (profile_function function, ttl_function fun)
+{
+  return fun->name && strlen (function->name) == fun->name->length &&
+    !strncmp (function->name, fun->name->text, fun->name->length);
+}
+
+long
+ttl_profile_frequency (ttl_profile profile, char * module,
+		       ttl_function function)
+{
+  profile_module m = find_module (profile, module);
+  profile_function f;
+  long frequency = -1;
+
+  if (!m)
+    return -1;
+  /* Nested functions of the same name cannot be told apart before
+     code generation, so use the highest frequency of all of them.  */
+  for (f = m->functions; f; f = f->next)
+    if (same_name_p (f, function) && (long) f->frequency > frequency)
+      frequency = f->frequency;
+  return frequency;
+}
+
+long
+ttl_profile_max_frequency (ttl_profile profile, char * module)
+{
+  profile_module m = find_module (profile, module);
+
+  return m ? (long) m->max_frequency : -1;
+}
+
+int
+ttl_profile_branch (ttl_profile profile, char * module,
+		    ttl_function function, unsigned branch,
+		    unsigned long * taken, unsigned long * not_taken)
+{
+  profile_module m = find_module (profile, module);
+  profile_function f;
+  profile_branch b;
+
+  if (!m)
+    return 0;
+  /* The descriptor index only identifies the function if the profile
+     was generated from the same source and options; check the name
+     to catch at least the grossest mismatches.  */
+  for (f = m->functions; f; f = f->next)
+    if (f->index == function->index)
+      break;
+  if (!f || !same_name_p (f, function))
+    return 0;
+  for (b = m->branches; b; b = b->next)
+    if (b->function == function->index && b->number == branch)
+      {
+	*taken = b->taken;
+	*not_taken = b->not_taken;
+	return 1;
+      }
+  return 0;
+}
+
+/* End of profile.c.  */
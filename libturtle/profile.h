@@ -0,0 +1,61 @@
+/* libturtle/profile.h - reading of execution profiles
+
+  Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2, or (at your option)
+  any later version.
+
+  This software is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this package; see the file COPYING.  If not, write to the
+  Free Software Foundation, Inc., 59 Temple Place - Suite 330, Boston,
+  MA 02111-1307, USA.  */
+
+#ifndef TTL_PROFILE_H
+#define TTL_PROFILE_H
+
+#include "memory.h"
+#include "env.h"
+
+/* An execution profile, as written by a program compiled with the
+   pragma `profile-generate' when it exits.  The profile holds, for
+   every instrumented module, the entry count of each function (keyed
+   by the index of its descriptor) and the number of times each
+   conditional jump of the function was taken and not taken.  */
+typedef struct ttl_profile * ttl_profile;
+
+/* Read the profile file `filename', allocating the result from
+   `pool'.  Print an error message and return NULL if the file cannot
+   be read or is malformed.  */
+ttl_profile ttl_read_profile (ttl_pool pool, char * filename);
+
+/* Return the execution frequency of `function' in the module called
+   `module' (the module name as a C identifier), that is the maximum
+   of its entry count and the execution counts of its conditional
+   jumps.  Functions are looked up by name, so that this can be called
+   before code generation.  Return -1 if the profile does not contain
+   the function.  */
+long ttl_profile_frequency (ttl_profile profile, char * module,
+			    ttl_function function);
+
+/* Return the highest execution frequency of any function of the
+   module called `module', or -1 if the module is not in the
+   profile.  */
+long ttl_profile_max_frequency (ttl_profile profile, char * module);
+
+/* Look up the counts of conditional jump number `branch' (counting
+   from 0 in the order of the generated code) of `function', which
+   must already have its descriptor index assigned.  Store the counts
+   into `taken' and `not_taken' and return non-zero if found, return
+   0 otherwise.  */
+int ttl_profile_branch (ttl_profile profile, char * module,
+			ttl_function function, unsigned branch,
+			unsigned long * taken, unsigned long * not_taken);
+
+#endif /* not TTL_PROFILE_H */
@@ -0,0 +1,73 @@
+// bench0.t -- Test file for the bench module.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module bench0;
+
+import io, longs, bench;
+
+var cells: list of int := null;
+
+fun make (n: int): list of int
+  var l: list of int := null;
+  while n > 0 do
+    l := n :: l;
+    n := n - 1;
+  end;
+  return l;
+end;
+
+fun main(argv: list of string): int
+  var t0: bench.timestamp := bench.clock ();
+  var t1: bench.timestamp := bench.clock ();
+  var r: bench.result;
+
+  if bench.elapsed (t0, t1) < 0L then
+    io.put ("clock went backwards");
+    io.nl ();
+    return 1;
+  end;
+  // Intervals too long for a long must not wrap around.
+  if bench.elapsed (bench.timestamp (0L, 0L),
+                    bench.timestamp (100L, 0L)) < longs.max then
+    io.put ("long interval wrapped around");
+    io.nl ();
+    return 1;
+  end;
+
+  r := bench.measure ("cons 1000", 2, 5, fun () cells := make (1000); end);
+  if bench.runs (r) <> 5 or
+     bench.min_ns (r) > bench.mean_ns (r) or
+     bench.mean_ns (r) > bench.max_ns (r) then
+    io.put ("inconsistent times");
+    io.nl ();
+    return 1;
+  end;
+  // Each call allocates at least the 1000 list cells.
+  if bench.allocations (r) < 1000L or bench.words (r) < 2000L then
+    io.put ("wrong allocation count: ");
+    io.put (bench.allocations (r));
+    io.nl ();
+    return 1;
+  end;
+
+  // Enough garbage for several collections.
+  r := bench.measure ("cons 100000", 0, 3,
+                      fun () cells := make (100000); end);
+  if bench.gcs (r) = 0L then
+    io.put ("no garbage collections counted");
+    io.nl ();
+    return 1;
+  end;
+
+  bench.report (r);
+  bench.run ("cons 10", fun () cells := make (10); end);
+  return 0;
+end;
+
+// End of bench0.t.
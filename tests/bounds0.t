@@ -0,0 +1,96 @@
+// bounds0.t -- Test file for range check elimination.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module bounds0;
+
+import io, exceptions;
+
+// All accesses are guarded by the loop condition.
+fun count (s: string, c: char): int
+  var x: int := 0;
+  var n: int := 0;
+  while x < sizeof s do
+    if s[x] = c then
+      n := n + 1;
+    end;
+    x := x + 1;
+  end;
+  return n;
+end;
+
+fun upcase (s: string)
+  var x: int := 0;
+  while x < sizeof s and s[x] <> ' ' do
+    s[x] := 'X';
+    x := x + 1;
+  end;
+end;
+
+fun sum (a: array of int): int
+  var i: int := 0;
+  var total: int := 0;
+  while i < sizeof a do
+    total := total + a[i];
+    a[i] := 0;
+    i := i + 1;
+  end;
+  return total;
+end;
+
+// The index is changed before the access, so it must be checked.
+fun shifted (a: array of int): int
+  var i: int := 0;
+  var total: int := 0;
+  while i < sizeof a do
+    i := i + 1;
+    total := total + a[i];
+  end;
+  return total;
+end;
+
+// Parameters may be negative.
+fun from (a: array of int, i: int): int
+  var total: int := 0;
+  while i < sizeof a do
+    total := total + a[i];
+    i := i + 1;
+  end;
+  return total;
+end;
+
+fun handler (s: string)
+  io.put ("exception: ");
+  io.put (s);
+  io.nl ();
+end;
+
+fun bad_shifted ()
+  io.put (shifted ({1, 2, 3}));
+  io.nl ();
+end;
+
+fun bad_from ()
+  io.put (from ({1, 2, 3}, -1));
+  io.nl ();
+end;
+
+fun main(argv: list of string): int
+  var s: string := "hello world";
+  var a: array of int := {1, 2, 3, 4};
+
+  io.put (count (s, 'o')); io.nl ();
+  upcase (s);
+  io.put (s); io.nl ();
+  io.put (sum (a)); io.put (" "); io.put (sum (a)); io.nl ();
+  exceptions.handle (bad_shifted, handler);
+  exceptions.handle (bad_from, handler);
+  return 0;
+end;
+
+// End of bounds0.t.
@@ -0,0 +1,102 @@
+// data0.t -- Test file for data type representation.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module data0;
+
+import io, exceptions;
+
+// One variant without and one with fields.
+datatype chain = empty or
+                 link (val: int, next: chain);
+
+// Several variants with and without fields.
+datatype shape = nothing or
+                 point or
+                 circle (radius: int) or
+                 rect (width: int, height: int);
+
+// No variant without fields.
+datatype number = small (n: int) or
+                  big (n: int, scale: int);
+
+fun length (c: chain): int
+  var len: int := 0;
+  while link? (c) do
+    len := len + 1;
+    c := next (c);
+  end;
+  return len;
+end;
+
+fun area (s: shape): int
+  if circle? (s) then
+    return 3 * radius (s) * radius (s);
+  elsif rect? (s) then
+    return width (s) * height (s);
+  else
+    return 0;
+  end;
+end;
+
+fun value (n: number): int
+  if small? (n) then
+    return n (n);
+  else
+    return n (n) * scale (n);
+  end;
+end;
+
+fun bad_radius ()
+  io.put (radius (point ()));
+  io.nl ();
+end;
+
+fun handler (s: string)
+  io.put ("exception: ");
+  io.put (s);
+  io.nl ();
+end;
+
+fun main(argv: list of string): int
+  var c: chain := empty ();
+  var s: shape;
+  var n: number;
+  var i: int := 0;
+
+  while i < 5 do
+    c := link (i, c);
+    i := i + 1;
+  end;
+  io.put (length (c)); io.nl ();
+  io.put (empty? (empty ())); io.nl ();
+  io.put (empty? (c)); io.nl ();
+  io.put (empty () = empty ()); io.nl ();
+
+  s := nothing ();
+  io.put (nothing? (s)); io.put (point? (s)); io.put (area (s)); io.nl ();
+  s := point ();
+  io.put (nothing? (s)); io.put (point? (s)); io.put (area (s)); io.nl ();
+  s := circle (2);
+  io.put (circle? (s)); io.put (rect? (s)); io.put (area (s)); io.nl ();
+  s := rect (3, 4);
+  io.put (circle? (s)); io.put (rect? (s)); io.put (area (s)); io.nl ();
+  width! (s, 5);
+  io.put (area (s)); io.nl ();
+
+  n := small (7);
+  io.put (value (n)); io.nl ();
+  n := big (7, 3);
+  n! (n, 2);
+  io.put (value (n)); io.nl ();
+
+  exceptions.handle (bad_radius, handler);
+  return 0;
+end;
+
+// End of data0.t.
@@ -0,0 +1,55 @@
+// exceptions1.t -- Test file for exception handler installation.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module exceptions1;
+
+import io, exceptions;
+
+var count: int := 0;
+
+fun no_raise ()
+  count := count + 1;
+end;
+
+fun raise_it ()
+  exceptions.raise ("outer");
+end;
+
+fun inner_handler (s: string)
+  io.put ("wrong handler: ");
+  io.put (s);
+  io.nl ();
+end;
+
+fun outer_handler (s: string)
+  io.put ("exception: ");
+  io.put (s);
+  io.nl ();
+end;
+
+fun protected ()
+  var i: int := 0;
+
+  // None of these handlers may stay active after `handle' returns,
+  // and installing them must not exhaust the handler stack.
+  while i < 1000 do
+    exceptions.handle (no_raise, inner_handler);
+    i := i + 1;
+  end;
+  raise_it ();
+end;
+
+fun main(argv: list of string): int
+  exceptions.handle (protected, outer_handler);
+  io.put (count);
+  io.nl ();
+  return 0;
+end;
+
+// End of exceptions1.t.
@@ -0,0 +1,67 @@
+// fold0.t -- Test file for constant folding.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module fold0;
+
+import io;
+
+fun pair (x: int, y: int): (int, int)
+  return y, x;
+end;
+
+const debug: bool := false;
+
+fun classify (c: char): int
+  if 'a' < 'b' then
+    return 1;
+  else
+    return 2;
+  end;
+  io.put ("unreachable");
+  return 3;
+end;
+
+fun main(argv: list of string): int
+  var limit: int := 10;
+  var scale: int := limit * 3 + 2;
+  var i: int := 0;
+  var sum: int := 0;
+  var x: int, y: int;
+
+  // Arithmetic must wrap around like the tagged integers at run time.
+  io.put (536870911 + 1); io.nl ();
+  io.put (-536870912 - 1); io.nl ();
+  io.put (65536 * 65536); io.nl ();
+  io.put (-7 / 2); io.put (" "); io.put (-7 % 2); io.nl ();
+  io.put (not (1 < 2 and 3 >= 3)); io.nl ();
+  io.put (scale); io.nl ();
+
+  // Division by zero is left for the run time to report.
+  if debug then
+    io.put (1 / 0);
+  end;
+
+  while debug and i < limit do
+    io.put ("never");
+  end;
+  while i < limit do
+    sum := sum + i * scale;
+    i := i + 1;
+  end;
+  io.put (sum); io.nl ();
+
+  // Tuple assignments must not be mistaken for constant variables.
+  x := 1;
+  x, y := pair (2, 3);
+  io.put (x); io.put (" "); io.put (y); io.nl ();
+  io.put (classify ('z')); io.nl ();
+  return 0;
+end;
+
+// End of fold0.t.
@@ -0,0 +1,64 @@
+// fun2.t -- Test file for function values without free variables.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module fun2;
+
+import io, arraysort<int>;
+
+fun twice (f: fun (int): int, x: int): int
+  return f (f (x));
+end;
+
+fun test_anonymous ()
+  var a: array of int;
+  a := {5, 3, 9, 1, 7};
+  arraysort.sort (a, fun (x: int, y: int): int
+                       return x - y;
+                     end);
+  io.put (a[0]); io.put (" "); io.put (a[4]); io.nl ();
+end;
+
+fun test_nested ()
+  var base: int;
+  base := 100;
+
+  // Recursive, so it refers to the variable `fac' of `test_nested'.
+  fun fac (n: int): int
+    if n <= 1 then
+      return 1;
+    else
+      return n * fac (n - 1);
+    end;
+  end;
+
+  // Closed, but containing a function with free variables.
+  fun adder (n: int): fun (int): int
+    return fun (x: int): int
+             return x + n;
+           end;
+  end;
+
+  // Not closed.
+  fun add_base (x: int): int
+    return x + base;
+  end;
+
+  io.put (fac (5)); io.nl ();
+  io.put (twice (fac, 3)); io.nl ();
+  io.put (twice (adder (3), 1)); io.nl ();
+  io.put (twice (add_base, 1)); io.nl ();
+end;
+
+fun main(argv: list of string): int
+  test_anonymous ();
+  test_nested ();
+  return 0;
+end;
+
+// End of fun2.t.
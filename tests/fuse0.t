@@ -0,0 +1,99 @@
+// fuse0.t -- Test file for fusion of list and array pipelines.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module fuse0;
+
+import io, exceptions, lists<int>, listmap<int, int>, listfold<int>,
+  listreduce<int, int>, arrays<int>, arraymap<int, int>;
+
+fun add (a: int, b: int): int
+  return a + b;
+end;
+
+fun sub (a: int, b: int): int
+  return a - b;
+end;
+
+fun square (a: int): int
+  return a * a;
+end;
+
+fun odd? (a: int): bool
+  return a % 2 = 1;
+end;
+
+fun show (a: int)
+  io.put (a);
+  io.put (" ");
+end;
+
+// Consumers in statement, assignment and return position.
+fun sum_of_odd_squares (n: int): int
+  return listfold.ifoldl (add, 0, lists.filter (odd?, listmap.map (square,
+							       lists.iota (n))));
+end;
+
+fun differences (l: list of int): int
+  var d: int;
+  d := listfold.foldl (sub, listmap.map (square, l));
+  return d;
+end;
+
+fun reduced (l: list of int): int
+  // Must compute sub (3, sub (1, 0)).
+  return listreduce.reducel (sub, 0, lists.filter (odd?, l));
+end;
+
+// The function arguments are evaluated once, in the original order.
+var calls: int := 0;
+
+fun counted (f: fun (int): int): fun (int): int
+  calls := calls + 1;
+  return f;
+end;
+
+fun handler (s: string)
+  io.put ("exception: ");
+  io.put (s);
+  io.nl ();
+end;
+
+fun empty_foldl ()
+  var x: int := listfold.foldl (add, lists.filter (odd?, [2, 4]));
+  io.put (x);
+  io.nl ();
+end;
+
+fun main(argv: list of string): int
+  var a: array of int := {1, 2, 3};
+  var f: fun (int): int := square;
+  var i: int := 0;
+
+  io.put (sum_of_odd_squares (10)); io.nl ();
+  io.put (differences ([3, 2, 1])); io.nl ();
+  io.put (reduced ([1, 2, 3])); io.nl ();
+  lists.foreach (show, listmap.map (f, lists.iota (4))); io.nl ();
+  lists.foreach (show, lists.iota (0)); io.nl ();
+  arrays.foreach (show, arraymap.map (square, arraymap.map (f, a)));
+  io.nl ();
+  while i < 3 do
+    if i > 0 then
+      lists.foreach (show, listmap.map (counted (square),
+				       listmap.map (counted (f),
+						    lists.iota (i))));
+    end;
+    i := i + 1;
+  end;
+  io.nl ();
+  io.put (calls); io.nl ();
+  exceptions.handle (empty_foldl, handler);
+  return 0;
+end;
+
+// End of fuse0.t.
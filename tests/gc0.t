@@ -0,0 +1,47 @@
+// gc0.t -- Test file for merging of GC checks.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module gc0;
+
+import io;
+
+datatype point = point (x: int, y: int);
+
+// The allocations in both branches and after the conditional are
+// covered by a single check per iteration.
+fun points (n: int): list of point
+  var l: list of point := null;
+  var i: int := 0;
+  while i < n do
+    if i % 2 = 0 then
+      l := point (i, i) :: l;
+    else
+      l := point (i, -i) :: point (-i, i) :: l;
+    end;
+    l := point (0, 0) :: l;
+    i := i + 1;
+  end;
+  return l;
+end;
+
+fun length (l: list of point): int
+  var n: int := 0;
+  while l <> null do
+    n := n + 1;
+    l := tl l;
+  end;
+  return n;
+end;
+
+fun main(argv: list of string): int
+  io.put (length (points (1000))); io.nl ();
+  return 0;
+end;
+
+// End of gc0.t.
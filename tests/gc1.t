@@ -0,0 +1,41 @@
+// gc1.t -- Test file for garbage collection in module initializers.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module gc1;
+
+import io;
+
+// The initializer allocates enough to trigger several collections,
+// which move the continuation of the initialization code.
+var numbers: list of int := make (300000);
+
+fun make (n: int): list of int
+  var l: list of int := null;
+  while n > 0 do
+    l := n :: l;
+    n := n - 1;
+  end;
+  return l;
+end;
+
+fun length (l: list of int): int
+  var n: int := 0;
+  while l <> null do
+    n := n + 1;
+    l := tl l;
+  end;
+  return n;
+end;
+
+fun main(argv: list of string): int
+  io.put (length (numbers)); io.nl ();
+  return 0;
+end;
+
+// End of gc1.t.
@@ -0,0 +1,88 @@
+// inline0.t -- Test file for function inlining.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module inline0;
+
+import io, lists<int>, strings;
+
+var calls: int := 0;
+
+fun square (x: int): int
+  return x * x;
+end;
+
+fun sum_squares (a: int, b: int): int
+  return square (a) + square (b);
+end;
+
+// Argument evaluated for side effects must be evaluated exactly once.
+fun next (): int
+  calls := calls + 1;
+  return calls;
+end;
+
+fun twice (x: int): int
+  return x + x;
+end;
+
+fun diff (a: int, b: int): int
+  return b - a;
+end;
+
+fun swap_print (a: int, b: int)
+  var t: int;
+  t := a;
+  a := b;
+  b := t;
+  io.put (a);
+  io.put (" ");
+  io.put (b);
+  io.nl ();
+end;
+
+fun fact (n: int): int
+  if n <= 1 then
+    return 1;
+  else
+    return n * fact (n - 1);
+  end;
+end;
+
+fun main(argv: list of string): int
+  var l: list of int := [1, 2, 3];
+  var i: int := 0;
+
+  io.put (square (7)); io.nl ();
+  io.put (sum_squares (3, 4)); io.nl ();
+  io.put (square (next ())); io.nl ();
+  io.put (square (next ()) + square (i)); io.nl ();
+  io.put (calls); io.nl ();
+  while i < 3 do
+    swap_print (i, i + 1);
+    i := i + 1;
+  end;
+  io.put (lists.head (l)); io.nl ();
+  io.put (strings.length ("hello")); io.nl ();
+  io.put (fact (5)); io.nl ();
+
+  // Arguments which cannot be substituted are bound to variables in
+  // front of the statement, keeping their order.
+  calls := 0;
+  io.put (twice (next ())); io.nl ();
+  io.put (diff (next (), next ())); io.nl ();
+  i := 1 + diff (next (), next ());
+  if twice (next ()) <> 12 or calls <> 6 or i <> 2 then
+    io.put ("wrong evaluation of arguments");
+    io.nl ();
+    return 1;
+  end;
+  return 0;
+end;
+
+// End of inline0.t.
@@ -0,0 +1,64 @@
+// leaf0.t -- Test file for leaf functions.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module leaf0;
+
+import io, math, exceptions;
+
+fun abs (x: int): int = leaf "abs";
+fun labs (x: long): long = leaf "labs";
+fun fabs (x: real): real = leaf "fabs";
+fun pow (x: real, y: real): real = leaf "pow";
+
+fun apply (f: fun (int): int, x: int): int
+  return f (x);
+end;
+
+var caught: int := 0;
+
+fun handler (s: string)
+  io.put ("exception: ");
+  io.put (s);
+  io.nl ();
+  caught := caught + 1;
+end;
+
+// Null arguments raise an exception before calling the C function.
+fun null_real ()
+  var r: real;
+  io.put (fabs (r)); io.nl ();
+end;
+
+fun null_long ()
+  var l: long;
+  io.put (labs (l)); io.nl ();
+end;
+
+fun main(argv: list of string): int
+
+  io.put (abs (-3)); io.nl ();
+  io.put (labs (-3L)); io.nl ();
+  io.put (fabs (-2.5)); io.nl ();
+  io.put (pow (2.0, 10.0)); io.nl ();
+  io.put (math.atan (1.0, 1.0) * 4.0); io.nl ();
+
+  // Leaf functions can be used as function values, too.
+  io.put (apply (abs, -7)); io.nl ();
+
+  exceptions.handle (null_real, handler);
+  exceptions.handle (null_long, handler);
+  if caught <> 2 then
+    io.put ("null arguments not detected");
+    io.nl ();
+    return 1;
+  end;
+  return 0;
+end;
+
+// End of leaf0.t.
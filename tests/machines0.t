@@ -0,0 +1,117 @@
+// machines0.t -- Test file for the machines module.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module machines0;
+
+import io, machines<array of int>;
+
+var touched: int := 0;
+
+fun make (n: int): list of int
+  var l: list of int := null;
+  while n > 0 do
+    l := n :: l;
+    n := n - 1;
+  end;
+  return l;
+end;
+
+fun sum (a: array of int): int
+  var s: int := 0;
+  var i: int := 0;
+  while i < sizeof a do
+    s := s + a[i];
+    i := i + 1;
+  end;
+  return s;
+end;
+
+fun numbers (n: int): array of int
+  var a: array of int := array n of 0;
+  var i: int := 0;
+  while i < n do
+    a[i] := i + 1;
+    i := i + 1;
+  end;
+  return a;
+end;
+
+// Sum the array received from `parent' and send back the sum, the
+// value of `touched' in this machine and the number of the machine.
+// Building garbage makes the machine collect its own heap.
+fun worker (parent: machines.machine)
+  var a: array of int := machines.receive ();
+  var i: int := 0;
+  var garbage: list of int;
+  while i < 20 do
+    garbage := make (10000);
+    i := i + 1;
+  end;
+  touched := touched + 1;
+  machines.send (parent, {sum (a), touched, machines.id (machines.self ())});
+end;
+
+fun main(argv: list of string): int
+  var me: machines.machine := machines.self ();
+  var m1: machines.machine;
+  var m2: machines.machine;
+  var r1: array of int;
+  var r2: array of int;
+  var a: array of int := {1, 2, 3};
+
+  if machines.id (me) <> 0 then
+    io.put ("main machine has wrong id");
+    io.nl ();
+    return 1;
+  end;
+
+  touched := 10;
+  m1 := machines.spawn (fun () worker (me); end);
+  m2 := machines.spawn (fun () worker (me); end);
+  if machines.id (m1) = 0 or machines.id (m1) = machines.id (m2) then
+    io.put ("wrong machine ids");
+    io.nl ();
+    return 1;
+  end;
+  machines.send (m1, numbers (1000));
+  machines.send (m2, numbers (100));
+  r1 := machines.receive ();
+  r2 := machines.receive ();
+  machines.join (m1);
+  machines.join (m2);
+
+  // The module variables of each machine are initialized separately.
+  if r1[0] + r2[0] <> 505550 or r1[1] <> 1 or r2[1] <> 1 or
+     touched <> 10 or r1[2] = r2[2] then
+    io.put ("wrong results: ");
+    io.put (r1[0] + r2[0]);
+    io.nl ();
+    return 1;
+  end;
+
+  // Messages are copies.
+  machines.send (me, a);
+  a[0] := 42;
+  if machines.pending () <> 1 or machines.receive ()[0] <> 1 then
+    io.put ("message not copied");
+    io.nl ();
+    return 1;
+  end;
+
+  // Messages to finished machines are dropped.
+  machines.send (m1, a);
+  if machines.pending () <> 0 then
+    io.put ("wrong number of pending messages");
+    io.nl ();
+    return 1;
+  end;
+  return 0;
+end;
+
+// End of machines0.t.
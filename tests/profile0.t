@@ -0,0 +1,75 @@
+// profile0.t -- Test file for programs instrumented for profiling.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+// Commentary:
+//
+// Compiled with `--pragma=profile-generate', this writes the file
+// `profile0.tprof' on exit.  The instrumentation must not change the
+// results of comparisons and calls.
+
+module profile0;
+
+import io;
+
+datatype shape = circle (radius: int) or square (side: int) or point;
+
+fun area (s: shape): int
+  if circle? (s) then
+    return 3 * radius (s) * radius (s);
+  elsif square? (s) then
+    return side (s) * side (s);
+  else
+    return 0;
+  end;
+end;
+
+fun collatz (n: int): int
+  var steps: int := 0;
+  while n <> 1 do
+    if n % 2 = 0 then
+      n := n / 2;
+    else
+      n := 3 * n + 1;
+    end;
+    steps := steps + 1;
+  end;
+  return steps;
+end;
+
+// Never called, so the profile records it as never executed.
+fun unused (x: real): bool
+  return x < 1.0;
+end;
+
+fun main (argv: list of string): int
+  var i: int := 1;
+  var sum: int := 0;
+
+  while i <= 100 do
+    sum := sum + collatz (i);
+    i := i + 1;
+  end;
+  if sum <> 3142 then
+    io.put ("wrong collatz sum: ");
+    io.put (sum);
+    io.nl ();
+    return 1;
+  end;
+  if area (circle (2)) + area (square (3)) + area (point ()) <> 21 then
+    io.put ("wrong area");
+    io.nl ();
+    return 1;
+  end;
+  if 2.0 < 1.0 or 2L < 1L then
+    return 1;
+  end;
+  return 0;
+end;
+
+// End of profile0.t.
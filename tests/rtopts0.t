@@ -0,0 +1,114 @@
+// rtopts0.t -- Test the profiling, tracing and statistics options
+//              of the run-time system.
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module rtopts0;
+
+import io, ints, strings, binary, bench, sys.procs, sys.files;
+
+fun fib (n: int): int
+  if n < 2 then
+    return n;
+  else
+    return fib (n - 1) + fib (n - 2);
+  end;
+end;
+
+// Keep the machine busy for at least `nsecs' nanoseconds, so that
+// the profiler and the statistics timer get to run.
+//
+fun spin (nsecs: long)
+  var start: bench.timestamp := bench.clock ();
+  var sum: int := 0;
+  while bench.elapsed (start, bench.clock ()) < nsecs do
+    sum := sum + fib (15);
+  end;
+end;
+
+// Run this program again with the run-time option `opt' and return
+// whether it exited successfully.  The child runs for a second and a
+// half if `mode' is "1", otherwise for a fraction of a second.
+//
+fun run (prog: string, opt: string, mode: string): bool
+  var child: int, status: int;
+  var env: string := strings.append ("LD_LIBRARY_PATH=",
+                                     sys.procs.getenv ("LD_LIBRARY_PATH"));
+
+  child := sys.procs.fork ();
+  if child = 0 then
+    sys.procs.execve (prog, [prog, opt, mode], [env]);
+    sys.procs.exit (2);
+  end;
+  child, status := sys.procs.wait ();
+  return sys.procs.WIFEXITED (status) and
+    sys.procs.WEXITSTATUS (status) = 0;
+end;
+
+// Return whether `filename' exists and is not empty, and remove it.
+//
+fun produced? (filename: string): bool
+  var b: binary.binary := binary.make (64);
+  var fd: int, rd: int;
+
+  fd := sys.files.open (filename);
+  if fd < 0 then
+    io.put (io.error, "missing: "); io.put (io.error, filename);
+    io.nl (io.error);
+    return false;
+  end;
+  rd := sys.files.read (fd, b, 64);
+  sys.files.close (fd);
+  if sys.files.unlink (filename) < 0 then
+    io.put (io.error, "cannot delete: "); io.put (io.error, filename);
+    io.nl (io.error);
+  end;
+  if rd <= 0 then
+    io.put (io.error, "empty: "); io.put (io.error, filename);
+    io.nl (io.error);
+    return false;
+  end;
+  return true;
+end;
+
+fun main (argv: list of string): int
+  var prog: string := hd argv;
+  var ok: bool := true;
+  var stats: string := strings.append (prog, ".stats");
+  var fd: int;
+
+  if tl argv <> null then
+    // The child.  The statistics are printed once per second, so it
+    // must run for more than that.
+    if strings.eq (hd tl argv, "0") then
+      spin (300000000L);
+    else
+      spin (1500000000L);
+    end;
+    return 0;
+  end;
+
+  ok := run (prog, "-:p", "0") and ok;
+  ok := produced? (strings.append (prog, ".prof")) and ok;
+  ok := produced? (strings.append (prog, ".folded")) and ok;
+
+  ok := run (prog, "-:t", "0") and ok;
+  ok := produced? (strings.append (prog, ".trace.json")) and ok;
+
+  fd := sys.files.create (stats);
+  ok := run (prog, strings.append ("-:i1,", ints.to_string (fd)), "1") and ok;
+  sys.files.close (fd);
+  ok := produced? (stats) and ok;
+
+  if ok then
+    io.put ("ok\n");
+    return 0;
+  else
+    return 1;
+  end;
+end;
+
+// End of rtopts0.t.
@@ -0,0 +1,94 @@
+// specialize0.t -- Test file for specialization of higher-order functions.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module specialize0;
+
+import io, arrays<int>, arraysort<int>, lists<int>, listmap<int, int>,
+  listfold<int>, hashtab<int, int>, option<int>;
+
+fun compare (a: int, b: int): int
+  return a - b;
+end;
+
+fun square (a: int): int
+  return a * a;
+end;
+
+fun odd? (a: int): bool
+  return a % 2 = 1;
+end;
+
+fun add (a: int, b: int): int
+  return a + b;
+end;
+
+fun hash (a: int): int
+  return a * 7;
+end;
+
+fun eq (a: int, b: int): bool
+  return a = b;
+end;
+
+fun show (a: int)
+  io.put (a);
+  io.put (" ");
+end;
+
+// A local higher-order function, which passes its argument on.
+fun twice (f: fun (int): int, x: int): int
+  return f (f (x));
+end;
+
+fun four_times (f: fun (int): int, x: int): int
+  return twice (f, twice (f, x));
+end;
+
+fun main (argv: list of string): int
+  var a: array of int := {5, 3, 9, 1, 7, 2, 8, 3, 3, 0};
+  var sign: int := -1;
+  var h: hashtab.hashtable, n: option.option;
+
+  arraysort.sort (a, compare);
+  arrays.foreach (show, a);
+  io.nl ();
+  // A closed function expression.
+  arraysort.sort (a, fun (x: int, y: int): int return y - x; end);
+  arrays.foreach (show, a);
+  io.nl ();
+  // Refers to `sign', so the sort is not specialized.
+  arraysort.sort (a, fun (x: int, y: int): int return sign * (y - x); end);
+  arrays.foreach (show, a);
+  io.nl ();
+  lists.foreach (show, lists.filter (odd?, listmap.map (square,
+							[1, 2, 3, 4, 5])));
+  io.nl ();
+  io.put (listfold.ifoldl (add, 0, [1, 2, 3]));
+  io.nl ();
+  io.put (four_times (square, 2));
+  io.nl ();
+  // The table keeps the functions it was made with, so the operations
+  // on it call them directly.
+  h := hashtab.make (hash, eq);
+  hashtab.insert (h, 3, 9);
+  hashtab.insert (h, 4, 16);
+  hashtab.delete (h, 3);
+  n := hashtab.lookup (h, 4);
+  if option.some? (n) then
+    show (option.data (n));
+  end;
+  n := hashtab.lookup (h, 3);
+  if option.none? (n) then
+    io.put ("none");
+  end;
+  io.nl ();
+  return 0;
+end;
+
+// End of specialize0.t.
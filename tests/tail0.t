@@ -0,0 +1,101 @@
+// tail0.t -- Test file for tail recursion compiled into loops.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module tail0;
+
+import io;
+
+// The arguments must all be evaluated before any parameter is
+// overwritten.
+fun gcd (a: int, b: int): int
+  if b = 0 then
+    return a;
+  else
+    return gcd (b, a % b);
+  end;
+end;
+
+// Local variables must be reset to null on every iteration.
+fun count (n: int, acc: int): int
+  var s: string;
+  if s <> null then
+    return -1;
+  end;
+  if n = 0 then
+    return acc;
+  end;
+  s := "x";
+  return count (n - 1, acc + 1);
+end;
+
+fun rev (l: list of int, acc: list of int): list of int
+  if l = null then
+    return acc;
+  end;
+  return rev (tl l, hd l :: acc);
+end;
+
+// Mutually tail-recursive functions.
+fun even (i: int): bool
+  if i = 0 then
+    return true;
+  end;
+  return odd (i - 1);
+end;
+
+fun odd (i: int): bool
+  if i = 0 then
+    return false;
+  end;
+  return even (i - 1);
+end;
+
+fun parity (n: int): string
+  // Calls between local functions of the same scope.
+  fun down (i: int, acc: int): int
+    if i = 0 then
+      return acc;
+    end;
+    return down (i - 1, acc + 1);
+  end;
+  fun start (i: int): int
+    return down (i, 0);
+  end;
+  if even (start (n)) then
+    return "even";
+  else
+    return "odd";
+  end;
+end;
+
+// The nested function refers to the environment, so the tail call
+// must allocate a new one.
+fun adder (n: int, l: list of fun (int): int): list of fun (int): int
+  fun add (x: int): int
+    return x + n;
+  end;
+  if n = 0 then
+    return l;
+  end;
+  return adder (n - 1, add :: l);
+end;
+
+fun main(argv: list of string): int
+  var l: list of fun (int): int;
+
+  io.put (gcd (1071, 462)); io.nl ();
+  io.put (count (100000, 0)); io.nl ();
+  io.put (hd rev ([1, 2, 3], null)); io.nl ();
+  io.put (parity (100001)); io.nl ();
+  l := adder (3, null);
+  io.put ((hd l) (10)); io.put (" "); io.put ((hd tl tl l) (10)); io.nl ();
+  return 0;
+end;
+
+// End of tail0.t.
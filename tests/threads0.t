@@ -0,0 +1,133 @@
+// threads0.t -- Test file for the threads and channels modules.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module threads0;
+
+import io, threads, channels<int>, exceptions;
+
+var counter: int := 0;
+var m: threads.mutex;
+var c: channels.channel;
+var spins: int := 0;
+var stop: bool := false;
+var caught: int := 0;
+
+// Increment `counter' with a thread switch between reading and
+// writing it, which loses updates unless the mutex is held.
+fun increment ()
+  var i: int := 0;
+  var old: int;
+  while i < 100 do
+    threads.lock (m);
+    old := counter;
+    threads.yield ();
+    counter := old + 1;
+    threads.unlock (m);
+    i := i + 1;
+  end;
+end;
+
+fun produce ()
+  var i: int := 1;
+  while i <= 100 do
+    channels.send (c, i);
+    i := i + 1;
+  end;
+end;
+
+// Never yields, so the other threads only run when it is preempted.
+fun spin ()
+  while not stop do
+    spins := spins + 1;
+  end;
+end;
+
+fun handler (s: string)
+  caught := caught + 1;
+end;
+
+// The handler must stay installed for this thread while the others
+// run.
+fun raise_later ()
+  threads.yield ();
+  exceptions.raise ("later");
+end;
+
+fun protected ()
+  exceptions.handle (raise_later, handler);
+end;
+
+fun main(argv: list of string): int
+  var t1: threads.thread;
+  var t2: threads.thread;
+  var t3: threads.thread;
+  var sum: int := 0;
+  var i: int := 0;
+
+  if threads.id (threads.current ()) <> 0 then
+    io.put ("main thread has wrong id");
+    io.nl ();
+    return 1;
+  end;
+
+  m := threads.make_mutex ();
+  t1 := threads.spawn (increment);
+  t2 := threads.spawn (increment);
+  t3 := threads.spawn (increment);
+  threads.join (t1);
+  threads.join (t2);
+  threads.join (t3);
+  if counter <> 300 or not threads.finished (t2) then
+    io.put ("wrong counter: ");
+    io.put (counter);
+    io.nl ();
+    return 1;
+  end;
+  if not threads.try_lock (m) then
+    io.put ("mutex still locked");
+    io.nl ();
+    return 1;
+  end;
+  threads.unlock (m);
+
+  c := channels.make (4);
+  t1 := threads.spawn (produce);
+  while i < 100 do
+    sum := sum + channels.receive (c);
+    i := i + 1;
+  end;
+  threads.join (t1);
+  if sum <> 5050 or channels.size (c) <> 0 then
+    io.put ("wrong sum: ");
+    io.put (sum);
+    io.nl ();
+    return 1;
+  end;
+
+  t1 := threads.spawn (protected);
+  t2 := threads.spawn (protected);
+  threads.join (t1);
+  threads.join (t2);
+  if caught <> 2 then
+    io.put ("wrong number of exceptions caught: ");
+    io.put (caught);
+    io.nl ();
+    return 1;
+  end;
+
+  // Both loops only terminate if the threads are preempted.
+  t1 := threads.spawn (spin);
+  while spins = 0 do
+  end;
+  stop := true;
+  threads.join (t1);
+  return 0;
+end;
+
+// End of threads0.t.
@@ -0,0 +1,120 @@
+// threads1.t -- Test file for threads waiting for input and output.
+//
+// Copyright (C) 2003 Martin Grabmueller <mgrabmue@cs.tu-berlin.de>
+//
+// This is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2, or (at your option)
+// any later version.
+
+module threads1;
+
+import io, threads, sys.net, sys.files, binary, ints, strings;
+
+var clients: int := 20;
+var served: int := 0;
+
+// Read a number from `fd' and answer with its double.  Reading waits
+// for the client, which writes only after all connections are
+// accepted.
+fun serve (fd: int)
+  var buf: binary.binary := binary.make (16);
+  var n: int := sys.files.read (fd, buf, binary.size (buf));
+  var s: string;
+  if n > 0 then
+    s := ints.to_string (2 * ints.from_string
+			      (strings.substring (binary.to_string (buf), 0, n)));
+    n := sys.files.write (fd, binary.from_string (s), sizeof s);
+  end;
+  n := sys.files.close (fd);
+  served := served + 1;
+end;
+
+fun spawn_server (fd: int)
+  var t: threads.thread := threads.spawn (fun () serve (fd); end);
+end;
+
+// Accept connections forever.  After the last client, the thread
+// stays waiting in `accept' when the program ends.
+fun accept_loop (sockfd: int)
+  var fd: int;
+  var addr: sys.net.sockaddr;
+  while true do
+    fd, addr := sys.net.accept (sockfd);
+    if fd >= 0 then
+      spawn_server (fd);
+    end;
+  end;
+end;
+
+fun main(argv: list of string): int
+  var sockfd: int;
+  var port: int := 15454;
+  var fds: array of int := array clients of 0;
+  var buf: binary.binary := binary.make (16);
+  var i: int;
+  var n: int;
+  var sum: int := 0;
+  var t: threads.thread;
+  var s: string;
+
+  // Find a free port on the loopback interface, and skip the test if
+  // there is none.
+  sockfd := sys.net.socket (sys.net.PF_INET, sys.net.SOCK_STREAM, 0);
+  while sys.net.bind (sockfd, sys.net.inetaddr (port, 127, 0, 0, 1)) < 0 do
+    port := port + 1;
+    if port > 15474 then
+      return 0;
+    end;
+  end;
+  if sys.net.listen (sockfd, clients + 4) < 0 then
+    return 0;
+  end;
+  t := threads.spawn (fun () accept_loop (sockfd); end);
+
+  i := 0;
+  while i < clients do
+    fds[i] := sys.net.socket (sys.net.PF_INET, sys.net.SOCK_STREAM, 0);
+    if sys.net.connect (fds[i],
+			sys.net.inetaddr (port, 127, 0, 0, 1)) < 0 then
+      io.put ("cannot connect");
+      io.nl ();
+      return 1;
+    end;
+    i := i + 1;
+  end;
+
+  // The server threads wait for these requests in `read'.
+  i := 0;
+  while i < clients do
+    s := ints.to_string (i + 1);
+    n := sys.files.write (fds[i], binary.from_string (s), sizeof s);
+    i := i + 1;
+  end;
+
+  // Reading the answers lets the server threads run.
+  i := 0;
+  while i < clients do
+    n := sys.files.read (fds[i], buf, binary.size (buf));
+    if n > 0 then
+      sum := sum + ints.from_string (strings.substring
+				     (binary.to_string (buf), 0, n));
+    end;
+    n := sys.files.close (fds[i]);
+    i := i + 1;
+  end;
+
+  // A server thread may be preempted after answering.
+  while served < clients do
+    threads.yield ();
+  end;
+  if sum <> clients * (clients + 1) then
+    io.put ("wrong sum: ");
+    io.put (sum);
+    io.nl ();
+    return 1;
+  end;
+  return 0;
+end;
+
+// End of threads1.t.
@@ -15,6 +15,12 @@ fun swap (x: int, y: int): (int, int)
   return y, x;
 end;
 
+fun swap_twice (x: int, y: int): (int, int)
+  var a: int, b: int;
+  a, b := swap (x, y);
+  return swap (a, b);
+end;
+
 fun main(argv: list of string): int
   var i1: int, i2: int;
   var s1: string, s2: string;
@@ -78,6 +84,14 @@ fun main(argv: list of string): int
   x, y := swap (x, y);
   io.put ("x = "); io.put (x); io.nl ();
   io.put ("y = "); io.put (y); io.nl ();
+  x, y := swap_twice (x, y);
+  io.put ("x = "); io.put (x); io.nl ();
+  io.put ("y = "); io.put (y); io.nl ();
+  var p: (int, int);
+  p := swap (x, y);
+  x, y := p;
+  io.put ("x = "); io.put (x); io.nl ();
+  io.put ("y = "); io.put (y); io.nl ();
   return 0;
 end;
 
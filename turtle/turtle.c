@@ -141,6 +141,7 @@ usage (void)
   -p, --module-path=PATH     set the search path for modules\n\
   -I, --include-path=PATH    set the search path for runtime header files\n\
   -L, --library-path=PATH    set the search path for library files\n\
+  -P, --profile-use=FILE     optimize using the execution profile FILE\n\
   -z, --pragma=PRAGMA        set compilation pragma\n\
     where PRAGMA is one of\n\
       handcoded              handcoded module\n\
@@ -150,16 +151,40 @@ usage (void)
       turtledoc              generate Texinfo documentation from comments\n\
       deps                   write dependency information to .P file\n\
       deps-stdout            write dependency information to standard output\n\
+      profile-generate       instrument the program for --profile-use\n\
+      time-report            print time and memory used by each phase\n\
   -O, --optimize=FLAGS       set optimization flags\n\
     where FLAGS is one or more of\n\
       C                      optimize module-local calls\n\
       c                      do not optimize module-local calls\n\
       J                      convert module-local calls to jumps\n\
       j                      do not convert module-local calls to jumps\n\
-      G                      optimize GC checks over basic blocks\n\
-      g                      do not optimize GC checks over basic blocks\n\
+      G                      merge GC checks over branches\n\
+      g                      do not merge GC checks\n\
       D                      inline data constructors etc.\n\
       d                      do not inline data constructors etc.\n\
+      S                      allocate closed functions statically\n\
+      s                      always allocate closures on the heap\n\
+      M                      return tuples in value registers\n\
+      m                      always return tuples on the heap\n\
+      F                      call leaf functions directly\n\
+      f                      call leaf functions like other functions\n\
+      I                      inline small functions\n\
+      i                      do not inline small functions\n\
+      K                      fold constant expressions\n\
+      k                      do not fold constant expressions\n\
+      B                      remove redundant range checks\n\
+      b                      check all array and string indices\n\
+      T                      compile tail recursion into loops\n\
+      t                      do not compile tail recursion into loops\n\
+      P                      remove redundant stack operations\n\
+      p                      do not remove redundant stack operations\n\
+      H                      share out-of-line garbage collector calls\n\
+      h                      call the garbage collector in place\n\
+      L                      fuse list and array pipelines into loops\n\
+      l                      do not fuse list and array pipelines\n\
+      A                      specialize functions for function arguments\n\
+      a                      do not specialize functions\n\
       0-6                    set optimization level for C compiler\n\
   -d, --debug=MODIFIER       set debugging options\n\
     where MODIFIER is one or more of\n\
@@ -178,6 +203,7 @@ Report bugs to mgrabmue@cs.tu-berlin.de\n",
   -p PATH            set the search path for modules\n\
   -I PATH            set the search path for runtime header files\n\
   -L PATH            set the search path for library files\n\
+  -P FILE            optimize using the execution profile FILE\n\
   -z PRAGMA          set compilation pragma\n\
     where PRAGMA is one of\n\
       handcoded      handcoded module\n\
@@ -187,16 +213,41 @@ Report bugs to mgrabmue@cs.tu-berlin.de\n",
       turtledoc      generate Texinfo documentation from comments\n\
       deps           write dependency information to .P file\n\
       deps-stdout    write dependency information to standard output\n\
+      profile-generate\n\
+                     instrument the program for -P\n\
+      time-report    print time and memory used by each phase\n\
   -O FLAGS           set optimization flags\n\
     where FLAGS is one or more of\n\
       C              optimize module-local calls\n\
       c              do not optimize module-local calls\n\
       J              convert module-local calls to jumps\n\
       j              do not convert module-local calls to jumps\n\
-      G              optimize GC checks over basic blocks\n\
-      g              do not optimize GC checks over basic blocks\n\
+      G              merge GC checks over branches\n\
+      g              do not merge GC checks\n\
       D              inline data constructors etc.\n\
       d              do not inline data constructors etc.\n\
+      S              allocate closed functions statically\n\
+      s              always allocate closures on the heap\n\
+      M              return tuples in value registers\n\
+      m              always return tuples on the heap\n\
+      F              call leaf functions directly\n\
+      f              call leaf functions like other functions\n\
+      I              inline small functions\n\
+      i              do not inline small functions\n\
+      K              fold constant expressions\n\
+      k              do not fold constant expressions\n\
+      B              remove redundant range checks\n\
+      b              check all array and string indices\n\
+      T              compile tail recursion into loops\n\
+      t              do not compile tail recursion into loops\n\
+      P              remove redundant stack operations\n\
+      p              do not remove redundant stack operations\n\
+      H              share out-of-line garbage collector calls\n\
+      h              call the garbage collector in place\n\
+      L              fuse list and array pipelines into loops\n\
+      l              do not fuse list and array pipelines\n\
+      A              specialize functions for function arguments\n\
+      a              do not specialize functions\n\
       0-6            set optimization level for C compiler\n\
   -d MODIFIER        set debugging options\n\
     where MODIFIER is one or more of the letters\n\
@@ -241,6 +292,7 @@ main (int argc, char * argv[])
     {"module-path", required_argument, NULL, 'p'},
     {"include-path", required_argument, NULL, 'I'},
     {"library-path", required_argument, NULL, 'L'},
+    {"profile-use", required_argument, NULL, 'P'},
     {NULL, 0, NULL, 0}
   };
 #endif /* HAVE_GETOPT_LONG */
@@ -251,10 +303,10 @@ main (int argc, char * argv[])
   ttl_init_compile_options (&options);
 
 #if HAVE_GETOPT_LONG
-  while ((arg = getopt_long (argc, argv, "+hvVm:d:I:L:z:O:p:",
+  while ((arg = getopt_long (argc, argv, "+hvVm:d:I:L:z:O:p:P:",
 			     command_line_options, &index)) != EOF)
 #else /* !HAVE_GETOPT_LONG */
-  while ((arg = getopt (argc, argv, "hvVm:d:I:L:z:O:p:")) != EOF)
+  while ((arg = getopt (argc, argv, "hvVm:d:I:L:z:O:p:P:")) != EOF)
 #endif /* !HAVE_GETOPT_LONG */
     {
       switch (arg)
@@ -290,6 +342,10 @@ main (int argc, char * argv[])
 	  options.library_path = optarg;
 	  break;
 
+	case 'P':
+	  options.profile_use = optarg;
+	  break;
+
 	case 'd':
 	  {
 	    char * p = optarg;
@@ -331,6 +387,10 @@ main (int argc, char * argv[])
 	      options.pragma_printdepsstdout = 1;
 	    else if (!strcmp (optarg, "static"))
 	      options.link_static = 1;
+	    else if (!strcmp (optarg, "profile-generate"))
+	      options.pragma_profile_generate = 1;
+	    else if (!strcmp (optarg, "time-report"))
+	      options.pragma_time_report = 1;
 	    else
 	      {
 		fprintf (stderr, "turtle: invalid pragma: %s\n", optarg);
@@ -371,6 +431,72 @@ main (int argc, char * argv[])
 		  case 'd':
 		    options.opt_inline_constructors = 0;
 		    break;
+		  case 'S':
+		    options.opt_static_closures = 1;
+		    break;
+		  case 's':
+		    options.opt_static_closures = 0;
+		    break;
+		  case 'M':
+		    options.opt_multiple_values = 1;
+		    break;
+		  case 'm':
+		    options.opt_multiple_values = 0;
+		    break;
+		  case 'F':
+		    options.opt_leaf_calls = 1;
+		    break;
+		  case 'f':
+		    options.opt_leaf_calls = 0;
+		    break;
+		  case 'I':
+		    options.opt_inline = 1;
+		    break;
+		  case 'i':
+		    options.opt_inline = 0;
+		    break;
+		  case 'K':
+		    options.opt_fold_constants = 1;
+		    break;
+		  case 'k':
+		    options.opt_fold_constants = 0;
+		    break;
+		  case 'B':
+		    options.opt_bounds_checks = 1;
+		    break;
+		  case 'b':
+		    options.opt_bounds_checks = 0;
+		    break;
+		  case 'T':
+		    options.opt_tail_loops = 1;
+		    break;
+		  case 't':
+		    options.opt_tail_loops = 0;
+		    break;
+		  case 'P':
+		    options.opt_peephole = 1;
+		    break;
+		  case 'p':
+		    options.opt_peephole = 0;
+		    break;
+		  case 'H':
+		    options.opt_outline_gc = 1;
+		    break;
+		  case 'h':
+		    options.opt_outline_gc = 0;
+		    break;
+		  case 'L':
+		    options.opt_fuse_lists = 1;
+		    break;
+		  case 'l':
+		    options.opt_fuse_lists = 0;
+		    break;
+		  case 'A':
+		    options.opt_specialize = 1;
+		    break;
+		  case 'a':
+		    options.opt_specialize = 0;
+		    break;
 		  case '0':
 		  case '1':
 		  case '2':